@@ -0,0 +1,420 @@
+#include "hectic.h"
+#include <dirent.h>
+#include <fcntl.h>
+
+/*
+ * JSON throughput benchmark.
+ *
+ *   sh make.sh bench [--save] [--baseline FILE] [--tolerance PERCENT] [DIR ...]
+ *
+ * Every corpus is parsed with each engine and serialized back. Synthetic
+ * corpora come from a fixed-seed generator, so runs on the same machine
+ * compare; every *.json file in the given directories (bench/corpus by
+ * default) is added as-is. Results are compared with the baseline file
+ * and any throughput more than the tolerance below it is reported as a
+ * regression (exit status 1). --save writes the current run as the new
+ * baseline instead.
+ */
+
+#define BENCH_ARENA_SIZE (256 * MEM_MiB)
+#define BENCH_CORPUS_SIZE (2 * MEM_MiB)
+#define BENCH_MIN_SECONDS 0.25
+#define BENCH_ROUNDS 3
+#define BENCH_MAX_CORPORA 64
+
+typedef struct {
+    const char *name;
+    char *text;
+    size_t len;
+} Corpus;
+
+typedef struct {
+    char name[128];   /* corpus/operation */
+    double mb_per_s;
+    double ns_per_node;
+    size_t arena_bytes;
+    double heap_allocs;
+} Measurement;
+
+// -- Allocation counting --
+
+static size_t heap_allocs;
+
+static void *counting_malloc(size_t size) {
+    heap_allocs++;
+    return malloc(size);
+}
+
+// -- Generators --
+
+static uint64_t rng_state;
+
+static uint64_t rng_next(void) {
+    // xorshift64*
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static uint64_t rng_below(uint64_t n) {
+    return rng_next() % n;
+}
+
+static void rng_word(JsonSink *out) {
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyz";
+    size_t len = 2 + (size_t)rng_below(9);
+    for (size_t i = 0; i < len; i++) json_sink_putc(out, letters[rng_below(26)]);
+}
+
+static void gen_text(JsonWriter *w, Arena *scratch, size_t words, bool escapes) {
+    arena_reset(scratch);
+    JsonSink text = json_sink_buffer(scratch, 0);
+    for (size_t i = 0; i < words; i++) {
+        if (i) json_sink_putc(&text, ' ');
+        rng_word(&text);
+        if (escapes && rng_below(8) == 0) json_sink_write(&text, "\"\\\n\t\xc3\xa9\xe2\x82\xac", 9);
+    }
+    json_writer_string(w, json_sink_cstr(&text));
+}
+
+static void gen_twitter(JsonWriter *w, Arena *scratch, size_t target) {
+    json_writer_begin_object(w);
+    json_writer_key(w, "statuses");
+    json_writer_begin_array(w);
+    for (uint64_t id = 1; w->sink->len < target; id++) {
+        json_writer_begin_object(w);
+        json_writer_key(w, "created_at");
+        json_writer_string(w, "Sun Aug 31 00:29:15 +0000 2014");
+        json_writer_key(w, "id");
+        json_writer_integer(w, (int64_t)(505874924095815681ULL + id));
+        json_writer_key(w, "text");
+        gen_text(w, scratch, 8 + (size_t)rng_below(16), true);
+        json_writer_key(w, "user");
+        json_writer_begin_object(w);
+        json_writer_key(w, "id");
+        json_writer_integer(w, (int64_t)rng_below(3000000000ULL));
+        json_writer_key(w, "screen_name");
+        gen_text(w, scratch, 1, false);
+        json_writer_key(w, "followers_count");
+        json_writer_integer(w, (int64_t)rng_below(100000));
+        json_writer_key(w, "verified");
+        json_writer_bool(w, rng_below(10) == 0);
+        json_writer_key(w, "lang");
+        json_writer_string(w, "ja");
+        json_writer_end_object(w);
+        json_writer_key(w, "entities");
+        json_writer_begin_object(w);
+        json_writer_key(w, "hashtags");
+        json_writer_begin_array(w);
+        for (uint64_t h = rng_below(4); h > 0; h--) {
+            json_writer_begin_object(w);
+            json_writer_key(w, "text");
+            gen_text(w, scratch, 1, false);
+            json_writer_key(w, "indices");
+            json_writer_begin_array(w);
+            json_writer_integer(w, (int64_t)rng_below(100));
+            json_writer_integer(w, (int64_t)rng_below(140));
+            json_writer_end_array(w);
+            json_writer_end_object(w);
+        }
+        json_writer_end_array(w);
+        json_writer_key(w, "urls");
+        json_writer_begin_array(w);
+        json_writer_end_array(w);
+        json_writer_end_object(w);
+        json_writer_key(w, "retweet_count");
+        json_writer_integer(w, (int64_t)rng_below(1000));
+        json_writer_key(w, "favorited");
+        json_writer_bool(w, false);
+        json_writer_key(w, "coordinates");
+        json_writer_null(w);
+        json_writer_end_object(w);
+    }
+    json_writer_end_array(w);
+    json_writer_end_object(w);
+}
+
+static void gen_numeric(JsonWriter *w, Arena *scratch, size_t target) {
+    (void)scratch;
+    json_writer_begin_array(w);
+    while (w->sink->len < target) {
+        json_writer_begin_array(w);
+        for (int i = 0; i < 3; i++) json_writer_number(w, (double)(int64_t)rng_next() / 1e15);
+        json_writer_integer(w, (int64_t)rng_below(1u << 20) - (1 << 19));
+        json_writer_end_array(w);
+    }
+    json_writer_end_array(w);
+}
+
+static void gen_strings(JsonWriter *w, Arena *scratch, size_t target) {
+    json_writer_begin_array(w);
+    while (w->sink->len < target) gen_text(w, scratch, 16 + (size_t)rng_below(64), rng_below(2) == 0);
+    json_writer_end_array(w);
+}
+
+static void gen_nested(JsonWriter *w, Arena *scratch, size_t target) {
+    (void)scratch;
+    json_writer_begin_array(w);
+    while (w->sink->len < target) {
+        int depth = 100 + (int)rng_below(400);
+        for (int d = 0; d < depth; d++) {
+            if (d % 2) {
+                json_writer_begin_object(w);
+                json_writer_key(w, "k");
+            } else {
+                json_writer_begin_array(w);
+                json_writer_integer(w, d);
+            }
+        }
+        json_writer_null(w);
+        for (int d = depth - 1; d >= 0; d--) {
+            if (d % 2) json_writer_end_object(w);
+            else json_writer_end_array(w);
+        }
+    }
+    json_writer_end_array(w);
+}
+
+static void gen_wide(JsonWriter *w, Arena *scratch, size_t target) {
+    (void)scratch;
+    char key[32];
+    json_writer_begin_object(w);
+    for (uint64_t i = 0; w->sink->len < target; i++) {
+        snprintf(key, sizeof(key), "field_%llu_%llu", (unsigned long long)i, (unsigned long long)rng_below(1000));
+        json_writer_key(w, key);
+        json_writer_integer(w, (int64_t)i);
+    }
+    json_writer_end_object(w);
+}
+
+static Corpus generate(Arena *arena, const char *name, void (*gen)(JsonWriter *, Arena *, size_t)) {
+    Arena scratch = arena_init(BENCH_CORPUS_SIZE);
+    JsonSink sink = json_sink_buffer(arena, BENCH_CORPUS_SIZE + MEM_MiB);
+    JsonWriter w = json_writer(&sink, 0);
+    rng_state = 0x9E3779B97F4A7C15ULL;
+    gen(&w, &scratch, BENCH_CORPUS_SIZE);
+    arena_free(&scratch);
+    char *text = json_sink_cstr(&sink);
+    return (Corpus){ .name = name, .text = text, .len = sink.len };
+}
+
+static size_t load_directory(Arena *arena, const char *dir, Corpus *out, size_t room) {
+    DIR *d = opendir(dir);
+    if (!d) return 0;
+    size_t count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(d)) && count < room) {
+        size_t n = strlen(entry->d_name);
+        if (n < 6 || strcmp(entry->d_name + n - 5, ".json") != 0) continue;
+        char *path = arena_strdup_fmt(arena, "%s/%s", dir, entry->d_name);
+        FILE *f = fopen(path, "rb");
+        if (!f) continue;
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        char *text = arena_alloc(arena, (size_t)size + 1);
+        size_t got = fread(text, 1, (size_t)size, f);
+        fclose(f);
+        text[got] = '\0';
+        out[count++] = (Corpus){ .name = arena_strdup(arena, entry->d_name), .text = text, .len = got };
+    }
+    closedir(d);
+    return count;
+}
+
+// -- Timing --
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static size_t count_nodes(const Json *item) {
+    size_t n = 1;
+    for (const Json *child = json_children(item); child; child = child->next) n += count_nodes(child);
+    return n;
+}
+
+typedef enum { OP_PARSE, OP_SERIALIZE } Operation;
+
+/* Best of BENCH_ROUNDS rounds, each repeated until BENCH_MIN_SECONDS pass */
+static bool measure(Arena *arena, const Corpus *corpus, Operation op, const JsonParseOptions *opts,
+                    const Json *tree, size_t nodes, Measurement *m) {
+    double best = 0;
+    size_t arena_bytes = 0, allocs = 0, runs = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        size_t iterations = 0;
+        double start = now_seconds(), elapsed;
+        heap_allocs = 0;
+        do {
+            arena_reset(arena);
+            if (op == OP_PARSE) {
+                const char *cursor = corpus->text;
+                JsonResult result = json_parse_with_opts(arena, &cursor, opts);
+                if (IS_RESULT_ERROR(result)) return false;
+            } else if (!JSON_TO_STR(arena, tree)) {
+                return false;
+            }
+            iterations++;
+            elapsed = now_seconds() - start;
+        } while (elapsed < BENCH_MIN_SECONDS);
+        double rate = (double)iterations / elapsed;
+        if (rate > best) best = rate;
+        arena_bytes = (size_t)((char *)arena->current - (char *)arena->begin);
+        allocs += heap_allocs;
+        runs += iterations;
+    }
+    m->mb_per_s = best * (double)corpus->len / 1e6;
+    m->ns_per_node = 1e9 / best / (double)nodes;
+    m->arena_bytes = arena_bytes;
+    m->heap_allocs = (double)allocs / (double)runs;
+    return true;
+}
+
+// -- Baseline --
+
+static void save_baseline(Arena *arena, const char *path, const Measurement *ms, size_t count) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        raise_exception("Cannot write baseline %s", path);
+        return;
+    }
+    JsonSink sink = json_sink_fd(arena, fd, 0);
+    JsonWriter w = json_writer(&sink, 2);
+    json_writer_begin_object(&w);
+    for (size_t i = 0; i < count; i++) {
+        json_writer_key(&w, ms[i].name);
+        json_writer_begin_object(&w);
+        json_writer_key(&w, "mb_per_s");
+        json_writer_number(&w, ms[i].mb_per_s);
+        json_writer_key(&w, "ns_per_node");
+        json_writer_number(&w, ms[i].ns_per_node);
+        json_writer_key(&w, "arena_bytes");
+        json_writer_integer(&w, (int64_t)ms[i].arena_bytes);
+        json_writer_key(&w, "heap_allocs");
+        json_writer_number(&w, ms[i].heap_allocs);
+        json_writer_end_object(&w);
+    }
+    json_writer_end_object(&w);
+    json_sink_putc(&sink, '\n');
+    json_sink_flush(&sink);
+    close(fd);
+    printf("Baseline written to %s\n", path);
+}
+
+static Json *load_baseline(Arena *arena, const char *path) {
+    if (access(path, R_OK) != 0) return NULL;
+    MappedFileResult mapped = view_map_file(arena, path, VIEW_MAP_SEQUENTIAL);
+    if (IS_RESULT_ERROR(mapped)) return NULL;
+    JsonResult parsed = json_parse_view(arena, mapped.Result.some->view, NULL);
+    Json *baseline = IS_RESULT_SOME(parsed) ? json_clone_compact(arena, parsed.Result.some) : NULL;
+    view_unmap_file(mapped.Result.some);
+    return baseline;
+}
+
+static double baseline_number(const Json *entry, const char *key) {
+    const Json *value = json_get_object_item(entry, key);
+    if (!value) return 0;
+    return value->type == JSON_INTEGER ? (double)value->value.integer : value->value.number;
+}
+
+int main(int argc, char **argv) {
+    const char *baseline_path = "bench/baseline.json";
+    const char *dirs[16];
+    size_t dir_count = 0;
+    double tolerance = 10;
+    bool save = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--save") == 0) save = true;
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) baseline_path = argv[++i];
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) tolerance = atof(argv[++i]);
+        else if (dir_count < sizeof(dirs) / sizeof(dirs[0])) dirs[dir_count++] = argv[i];
+    }
+    if (dir_count == 0) dirs[dir_count++] = "bench/corpus";
+
+    logger_init();
+    logger_level(LOG_LEVEL_WARN);
+    set_memory_allocator((MemoryAllocator){ .malloc = counting_malloc, .free = free });
+
+    Arena corpora_arena = arena_init(64 * MEM_MiB);
+    Arena arena = arena_init(BENCH_ARENA_SIZE);
+    Arena tree_arena = arena_init(BENCH_ARENA_SIZE);
+
+    Corpus corpora[BENCH_MAX_CORPORA];
+    size_t count = 0;
+    corpora[count++] = generate(&corpora_arena, "twitter", gen_twitter);
+    corpora[count++] = generate(&corpora_arena, "numeric", gen_numeric);
+    corpora[count++] = generate(&corpora_arena, "strings", gen_strings);
+    corpora[count++] = generate(&corpora_arena, "nested", gen_nested);
+    corpora[count++] = generate(&corpora_arena, "wide", gen_wide);
+    for (size_t d = 0; d < dir_count; d++) {
+        count += load_directory(&corpora_arena, dirs[d], corpora + count, BENCH_MAX_CORPORA - count);
+    }
+
+    struct { const char *name; Operation op; JsonParseOptions opts; } operations[] = {
+        { "parse", OP_PARSE, { .engine = JSON_PARSER_RECURSIVE } },
+        { "parse_structural", OP_PARSE, { .engine = JSON_PARSER_STRUCTURAL } },
+        { "parse_lazy", OP_PARSE, { .engine = JSON_PARSER_LAZY } },
+        { "parse_borrowed", OP_PARSE, { .engine = JSON_PARSER_RECURSIVE, .strings = JSON_STRINGS_BORROWED } },
+        { "serialize", OP_SERIALIZE, { .engine = JSON_PARSER_RECURSIVE } },
+    };
+    size_t operation_count = sizeof(operations) / sizeof(operations[0]);
+    Measurement *results = arena_alloc(&corpora_arena, count * operation_count * sizeof(Measurement));
+    size_t result_count = 0;
+
+    printf("%-32s %10s %10s %14s %12s\n", "benchmark", "MB/s", "ns/node", "arena bytes", "heap allocs");
+    for (size_t c = 0; c < count; c++) {
+        arena_reset(&tree_arena);
+        const char *cursor = corpora[c].text;
+        JsonResult parsed = json_parse_with_opts(&tree_arena, &cursor, NULL);
+        if (IS_RESULT_ERROR(parsed)) {
+            printf("%-32s skipped: not valid JSON\n", corpora[c].name);
+            continue;
+        }
+        size_t nodes = count_nodes(parsed.Result.some);
+        for (size_t o = 0; o < operation_count; o++) {
+            Measurement *m = &results[result_count];
+            snprintf(m->name, sizeof(m->name), "%s/%s", corpora[c].name, operations[o].name);
+            if (!measure(&arena, &corpora[c], operations[o].op, &operations[o].opts, parsed.Result.some, nodes, m)) {
+                printf("%-32s failed\n", m->name);
+                continue;
+            }
+            printf("%-32s %10.1f %10.1f %14zu %12.1f\n", m->name, m->mb_per_s, m->ns_per_node, m->arena_bytes, m->heap_allocs);
+            result_count++;
+        }
+    }
+
+    int status = 0;
+    if (save) {
+        save_baseline(&arena, baseline_path, results, result_count);
+    } else {
+        arena_reset(&arena);
+        Json *baseline = load_baseline(&tree_arena, baseline_path);
+        if (!baseline) {
+            printf("No baseline at %s, run with --save to record one\n", baseline_path);
+        } else {
+            size_t regressions = 0;
+            for (size_t i = 0; i < result_count; i++) {
+                const Json *entry = json_get_object_item(baseline, results[i].name);
+                double before = entry ? baseline_number(entry, "mb_per_s") : 0;
+                if (before <= 0) continue;
+                double change = (results[i].mb_per_s - before) / before * 100;
+                if (change < -tolerance) {
+                    printf("REGRESSION %-32s %10.1f -> %10.1f MB/s (%+.1f%%)\n", results[i].name, before, results[i].mb_per_s, change);
+                    regressions++;
+                }
+            }
+            printf("%zu regression(s) beyond %.0f%% against %s\n", regressions, tolerance, baseline_path);
+            status = regressions ? 1 : 0;
+        }
+    }
+
+    arena_free(&tree_arena);
+    arena_free(&arena);
+    arena_free(&corpora_arena);
+    logger_free();
+    return status;
+}
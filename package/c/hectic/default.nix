@@ -59,9 +59,9 @@ stdenv.mkDerivation {
 	  ;;
         --libs)
           if [ \$static -eq 1 ]; then
-            echo "-L$out/lib -static -lhectic"
+            echo "-L$out/lib -static -lhectic -lpthread"
           else
-            echo "-L$out/lib -lhectic"
+            echo "-L$out/lib -lhectic -lpthread"
           fi
           ;;
         --static)
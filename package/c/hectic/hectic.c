@@ -2,9 +2,21 @@
 #include <fnmatch.h>
 #include <string.h>
 #include <assert.h>
-#include <signal.h>
 #include <errno.h>
-#include <setjmp.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <math.h>
+#include <inttypes.h>
+#include <locale.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HECTIC_SIMD_X86 1
+#include <immintrin.h>
+#endif
 
 MemoryAllocator default_allocator = {
     .malloc = malloc,
@@ -73,6 +85,7 @@ Arena *log_rules_arena = NULL;
 static FILE *log_file = NULL;
 static LogOutputMode log_output_mode = LOG_OUTPUT_STDERR_ONLY;
 static char *log_file_path = NULL;
+static LogFormat log_format = LOG_FORMAT_TEXT;
 
 /**
  * Set log output mode
@@ -82,6 +95,14 @@ void logger_set_output_mode(LogOutputMode mode) {
     log_output_mode = mode;
 }
 
+/**
+ * Set log line format
+ * @param format The line format (text, JSON Lines or logfmt)
+ */
+void logger_set_format(LogFormat format) {
+    log_format = format;
+}
+
 /**
  * Set log file path
  * @param file_path Path to the log file. If NULL, file logging is disabled.
@@ -175,6 +196,18 @@ const char* error_code_to_string(HecticErrorCode code) {
         case TEMPLATE_ERROR_OUT_OF_MEMORY: return "OUT_OF_MEMORY";
         case LOGGER_ERROR_INVALID_RULES_STRING: return "INVALID_RULES_STRING";
         case LOGGER_ERROR_OUT_OF_MEMORY: return "OUT_OF_MEMORY";
+        case JSON_ERROR_INVALID_INPUT: return "INVALID_INPUT";
+        case JSON_ERROR_SYNTAX: return "SYNTAX";
+        case JSON_ERROR_OUT_OF_MEMORY: return "OUT_OF_MEMORY";
+        case JSON_ERROR_DEPTH_LIMIT: return "DEPTH_LIMIT";
+        case JSON_ERROR_TOKEN_TOO_LONG: return "TOKEN_TOO_LONG";
+        case JSON_ERROR_IO: return "IO";
+        case JSON_ERROR_ABORTED: return "ABORTED";
+        case JSON_ERROR_INVALID_PATH: return "INVALID_PATH";
+        case JSON_ERROR_INVALID_BINARY: return "INVALID_BINARY";
+        case VIEW_ERROR_INVALID_INPUT: return "INVALID_INPUT";
+        case VIEW_ERROR_IO: return "IO";
+        case VIEW_ERROR_OUT_OF_MEMORY: return "OUT_OF_MEMORY";
         default: return "UNKNOWN";
     }
 }
@@ -242,6 +275,25 @@ LogLevel log_level_from_string(const char *level_str) {
         return LOG_LEVEL_INFO;
 }
 
+const char* log_format_to_string(LogFormat format) {
+    switch (format) {
+        case LOG_FORMAT_TEXT:   return "TEXT";
+        case LOG_FORMAT_JSON:   return "JSON";
+        case LOG_FORMAT_LOGFMT: return "LOGFMT";
+        default:                return "UNKNOWN";
+    }
+}
+
+LogFormat log_format_from_string(const char *format_str) {
+    if (!format_str) return LOG_FORMAT_TEXT;
+    if (strcmp(format_str, "JSON") == 0)
+        return LOG_FORMAT_JSON;
+    else if (strcmp(format_str, "LOGFMT") == 0)
+        return LOG_FORMAT_LOGFMT;
+    else
+        return LOG_FORMAT_TEXT;
+}
+
 void logger_level_reset() {
     current_log_level = LOG_LEVEL_INFO;
     logger_free();
@@ -288,6 +340,13 @@ void logger_init(void) {
                 log_level_to_string(current_log_level));
     }
     
+    // Check for line format
+    const char* log_format_env = getenv("LOG_FORMAT");
+    if (log_format_env) {
+        logger_set_format(log_format_from_string(log_format_env));
+        fprintf(stderr, "INIT: Log format set to %s\n", log_format_to_string(log_format));
+    }
+
     // Check for file logging environment variables
     const char* log_file_env = getenv("LOG_FILE");
     if (log_file_env) {
@@ -342,6 +401,289 @@ void logger_free(void) {
     log_output_mode = LOG_OUTPUT_STDERR_ONLY;
 }
 
+// Longest encoded log line, longer lines are truncated
+#define LOG_LINE_MAX 4096
+
+typedef struct {
+    char data[LOG_LINE_MAX];
+    size_t len;
+    size_t limit;     // end of the content, the bytes after it are for log_line_emit()
+    size_t complete;  // end of the last whole JSON member, where a cut line is closed
+    bool truncated;   // everything after the first cut is dropped
+    bool in_string;   // a quoted string is open, its closing quote is still owed
+} LogLine;
+
+static void log_line_init(LogLine *l, LogFormat format) {
+    l->len = 0;
+    // Newline and terminator, and for structured lines a closing quote and '}'
+    l->limit = sizeof(l->data) - 2 - (format == LOG_FORMAT_TEXT ? 0 : 2);
+    l->complete = 0;
+    l->truncated = false;
+    l->in_string = false;
+}
+
+static void log_line_append(LogLine *l, const char *s, size_t n) {
+    if (l->truncated) return;
+    size_t room = l->limit - l->len;
+    if (n > room) {
+        // Cut on a character boundary so the line stays valid UTF-8
+        n = room;
+        while (n && ((unsigned char)s[n] & 0xC0) == 0x80) n--;
+        l->truncated = true;
+    }
+    memcpy(l->data + l->len, s, n);
+    l->len += n;
+}
+
+/* All of s, or none of it when it does not fit: escapes and numbers are never cut */
+static void log_line_append_whole(LogLine *l, const char *s, size_t n) {
+    if (n > l->limit - l->len) l->truncated = true;
+    log_line_append(l, s, n);
+}
+
+#define LOG_LINE_APPEND_LITERAL(l, literal) log_line_append_whole(l, literal, sizeof(literal) - 1)
+
+static void log_line_append_str(LogLine *l, const char *s) {
+    log_line_append(l, s, strlen(s));
+}
+
+static void log_line_append_uint(LogLine *l, unsigned long long n) {
+    char digits[20];
+    size_t i = sizeof(digits);
+    do {
+        digits[--i] = (char)('0' + n % 10);
+        n /= 10;
+    } while (n);
+    log_line_append_whole(l, digits + i, sizeof(digits) - i);
+}
+
+static void log_line_append_int(LogLine *l, long long n) {
+    if (n < 0) {
+        LOG_LINE_APPEND_LITERAL(l, "-");
+        log_line_append_uint(l, 0ULL - (unsigned long long)n);
+    } else {
+        log_line_append_uint(l, (unsigned long long)n);
+    }
+}
+
+static void log_line_append_double(LogLine *l, double n) {
+    char buffer[JSON_NUMBER_MAX_LEN];
+    log_line_append_whole(l, buffer, json_number_to_str(n, buffer));
+}
+
+/* Quoted JSON string, also used for quoted logfmt values */
+static void log_line_append_json_string(LogLine *l, const char *s) {
+    static const char hex[] = "0123456789abcdef";
+    LOG_LINE_APPEND_LITERAL(l, "\"");
+    l->in_string = !l->truncated;
+    const char *run = s;
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        log_line_append(l, run, s - run);
+        switch (c) {
+            case '"':  LOG_LINE_APPEND_LITERAL(l, "\\\""); break;
+            case '\\': LOG_LINE_APPEND_LITERAL(l, "\\\\"); break;
+            case '\n': LOG_LINE_APPEND_LITERAL(l, "\\n"); break;
+            case '\r': LOG_LINE_APPEND_LITERAL(l, "\\r"); break;
+            case '\t': LOG_LINE_APPEND_LITERAL(l, "\\t"); break;
+            case '\b': LOG_LINE_APPEND_LITERAL(l, "\\b"); break;
+            case '\f': LOG_LINE_APPEND_LITERAL(l, "\\f"); break;
+            default: {
+                char escape[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+                log_line_append_whole(l, escape, sizeof(escape));
+            }
+        }
+        run = s + 1;
+    }
+    log_line_append(l, run, s - run);
+    LOG_LINE_APPEND_LITERAL(l, "\"");
+    l->in_string = l->in_string && l->truncated;
+}
+
+static void log_line_append_logfmt_string(LogLine *l, const char *s) {
+    bool quote = *s == '\0';
+    for (const char *p = s; *p && !quote; p++) {
+        unsigned char c = (unsigned char)*p;
+        quote = c <= ' ' || c == '=' || c == '"' || c == '\\';
+    }
+    if (quote)
+        log_line_append_json_string(l, s);
+    else
+        log_line_append_str(l, s);
+}
+
+static void log_line_append_kv(LogLine *l, LogFormat format, const LogKv *kv) {
+    if (l->truncated) return;
+    size_t start = l->len;
+    bool json = format == LOG_FORMAT_JSON;
+    if (json) {
+        LOG_LINE_APPEND_LITERAL(l, ",");
+        log_line_append(l, kv->json_key, kv->json_key_len);
+    } else {
+        LOG_LINE_APPEND_LITERAL(l, " ");
+        log_line_append(l, kv->key, kv->key_len);
+        LOG_LINE_APPEND_LITERAL(l, "=");
+    }
+
+    switch (kv->type) {
+        case LOG_KV_STRING:
+            if (!kv->value.string)
+                LOG_LINE_APPEND_LITERAL(l, "null");
+            else if (json)
+                log_line_append_json_string(l, kv->value.string);
+            else
+                log_line_append_logfmt_string(l, kv->value.string);
+            break;
+        case LOG_KV_INT:
+            log_line_append_int(l, kv->value.integer);
+            break;
+        case LOG_KV_UINT:
+            log_line_append_uint(l, kv->value.uinteger);
+            break;
+        case LOG_KV_FLOAT:
+            // NaN and infinities have no JSON representation
+            if (json && (kv->value.number != kv->value.number || kv->value.number - kv->value.number != 0))
+                LOG_LINE_APPEND_LITERAL(l, "null");
+            else
+                log_line_append_double(l, kv->value.number);
+            break;
+        case LOG_KV_BOOL:
+            if (kv->value.boolean)
+                LOG_LINE_APPEND_LITERAL(l, "true");
+            else
+                LOG_LINE_APPEND_LITERAL(l, "false");
+            break;
+    }
+
+    // A field that does not fit is left out whole, a cut one would not parse
+    if (l->truncated) {
+        l->len = start;
+        l->in_string = false;
+    } else {
+        l->complete = l->len;
+    }
+}
+
+static const char *log_timestamp(void) {
+    time_t now = time(NULL);
+    struct tm tm_info;
+    localtime_r(&now, &tm_info);
+    static __thread char timeStr[20];
+    strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &tm_info);
+    return timeStr;
+}
+
+/* Header part of a line, everything before the message */
+static void log_line_append_header(LogLine *l, LogFormat format, const char *time_str,
+                                   LogLevel level, const char *file, const char *func, int line) {
+    switch (format) {
+        case LOG_FORMAT_JSON:
+            LOG_LINE_APPEND_LITERAL(l, "{\"time\":\"");
+            log_line_append_str(l, time_str);
+            LOG_LINE_APPEND_LITERAL(l, "\",\"level\":\"");
+            log_line_append_str(l, log_level_to_string(level));
+            LOG_LINE_APPEND_LITERAL(l, "\"");
+            l->complete = l->len;
+            LOG_LINE_APPEND_LITERAL(l, ",\"file\":");
+            log_line_append_json_string(l, file);
+            if (!l->truncated) l->complete = l->len;
+            LOG_LINE_APPEND_LITERAL(l, ",\"func\":");
+            log_line_append_json_string(l, func);
+            if (!l->truncated) l->complete = l->len;
+            LOG_LINE_APPEND_LITERAL(l, ",\"line\":");
+            log_line_append_int(l, line);
+            if (!l->truncated) l->complete = l->len;
+            LOG_LINE_APPEND_LITERAL(l, ",\"msg\":");
+            break;
+        case LOG_FORMAT_LOGFMT:
+            LOG_LINE_APPEND_LITERAL(l, "time=\"");
+            log_line_append_str(l, time_str);
+            LOG_LINE_APPEND_LITERAL(l, "\" level=");
+            log_line_append_str(l, log_level_to_string(level));
+            LOG_LINE_APPEND_LITERAL(l, " file=");
+            log_line_append_logfmt_string(l, file);
+            LOG_LINE_APPEND_LITERAL(l, " func=");
+            log_line_append_logfmt_string(l, func);
+            LOG_LINE_APPEND_LITERAL(l, " line=");
+            log_line_append_int(l, line);
+            LOG_LINE_APPEND_LITERAL(l, " msg=");
+            break;
+        case LOG_FORMAT_TEXT:
+        default:
+            log_line_append_str(l, time_str);
+            LOG_LINE_APPEND_LITERAL(l, " ");
+            log_line_append_str(l, log_level_to_color(level));
+            log_line_append_str(l, log_level_to_string(level));
+            log_line_append_str(l, OPTIONAL_COLOR(COLOR_RESET));
+            LOG_LINE_APPEND_LITERAL(l, " ");
+            log_line_append_str(l, file);
+            LOG_LINE_APPEND_LITERAL(l, ":");
+            log_line_append_str(l, func);
+            LOG_LINE_APPEND_LITERAL(l, ":");
+            log_line_append_str(l, OPTIONAL_COLOR(COLOR_GREEN));
+            log_line_append_int(l, line);
+            log_line_append_str(l, OPTIONAL_COLOR(COLOR_RESET));
+            LOG_LINE_APPEND_LITERAL(l, " ");
+            break;
+    }
+}
+
+static void log_line_append_message(LogLine *l, LogFormat format, const char *message) {
+    switch (format) {
+        case LOG_FORMAT_JSON:   log_line_append_json_string(l, message); break;
+        case LOG_FORMAT_LOGFMT: log_line_append_json_string(l, message); break;
+        case LOG_FORMAT_TEXT:
+        default:                log_line_append_str(l, message); break;
+    }
+    if (!l->truncated) l->complete = l->len;
+}
+
+/* Terminates the line and writes it to the configured outputs */
+static void log_line_emit(LogLine *l, LogFormat format) {
+    // A string cut short is closed; a cut anywhere else drops the unfinished member
+    if (l->in_string)
+        l->data[l->len++] = '"';
+    else if (l->truncated && format == LOG_FORMAT_JSON)
+        l->len = l->complete;
+    if (format == LOG_FORMAT_JSON)
+        l->data[l->len++] = '}';
+    l->data[l->len++] = '\n';
+    l->data[l->len] = '\0';
+
+    // Write to stderr if needed
+    if (log_output_mode == LOG_OUTPUT_STDERR_ONLY || log_output_mode == LOG_OUTPUT_BOTH) {
+        fwrite(l->data, 1, l->len, stderr);
+    }
+
+    // Write to file if configured
+    if ((log_output_mode == LOG_OUTPUT_FILE_ONLY || log_output_mode == LOG_OUTPUT_BOTH) && log_file != NULL) {
+        if (format != LOG_FORMAT_TEXT) {
+            // Structured formats never contain color codes
+            fwrite(l->data, 1, l->len, log_file);
+        } else {
+            // Remove ANSI color codes for file output
+            char file_buffer[LOG_LINE_MAX];
+            char *src = l->data;
+            char *dst = file_buffer;
+
+            while (*src) {
+                if (*src == '\033') {
+                    // Skip ANSI escape sequence
+                    while (*src && *src != 'm') src++;
+                    if (*src) src++; // Skip the 'm'
+                } else {
+                    *dst++ = *src++;
+                }
+            }
+            *dst = '\0';
+
+            fwrite(file_buffer, 1, dst - file_buffer, log_file);
+        }
+        fflush(log_file); // Ensure log is written immediately
+    }
+}
+
 char* raise_message(
   LogLevel level,
   const char *file,
@@ -355,127 +697,242 @@ char* raise_message(
         return NULL;
     }
 
-    time_t now = time(NULL);
-    struct tm tm_info;
-    localtime_r(&now, &tm_info);
-    static char timeStr[20];
-    strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &tm_info);
+    const char *time_str = log_timestamp();
+    LogFormat line_format = log_format;
 
-    // Format the message first
+    LogLine log_line;
+    log_line_init(&log_line, line_format);
+    log_line_append_header(&log_line, line_format, time_str, level, file, func, line);
+
+    // Format the message
     va_list args;
     va_start(args, format);
-    
-    // Create a buffer for the message
-    char message_buffer[4096]; // Adjust size as needed
-    int header_len = snprintf(message_buffer, sizeof(message_buffer), 
-                             "%s %s%s%s %s:%s:%s%d%s ", 
-                             timeStr, 
-                             log_level_to_color(level), 
-                             log_level_to_string(level), 
-                             OPTIONAL_COLOR(COLOR_RESET),
-                             file,
-                             func,
-                             OPTIONAL_COLOR(COLOR_GREEN),
-                             line,
-                             OPTIONAL_COLOR(COLOR_RESET));
-    
-    // Add the formatted message
-    vsnprintf(message_buffer + header_len, sizeof(message_buffer) - header_len, format, args);
-    va_end(args);
-    
-    // Add newline
-    strcat(message_buffer, "\n");
-    
-    // Write to stderr if needed
-    if (log_output_mode == LOG_OUTPUT_STDERR_ONLY || log_output_mode == LOG_OUTPUT_BOTH) {
-        fprintf(stderr, "%s", message_buffer);
+    if (line_format == LOG_FORMAT_TEXT) {
+        // Text lines take the message as is, straight into the line buffer
+        size_t room = log_line.limit - log_line.len;
+        int written = vsnprintf(log_line.data + log_line.len, room + 1, format, args);
+        if (written > 0)
+            log_line.len += (size_t)written < room ? (size_t)written : room;
+    } else {
+        char message_buffer[LOG_LINE_MAX];
+        vsnprintf(message_buffer, sizeof(message_buffer), format, args);
+        log_line_append_message(&log_line, line_format, message_buffer);
     }
-    
-    // Write to file if configured
-    if ((log_output_mode == LOG_OUTPUT_FILE_ONLY || log_output_mode == LOG_OUTPUT_BOTH) && log_file != NULL) {
-        // Remove ANSI color codes for file output
-        char file_buffer[4096];
-        char *src = message_buffer;
-        char *dst = file_buffer;
-        
-        while (*src) {
-            if (*src == '\033') {
-                // Skip ANSI escape sequence
-                while (*src && *src != 'm') src++;
-                if (*src) src++; // Skip the 'm'
-            } else {
-                *dst++ = *src++;
-            }
-        }
-        *dst = '\0';
-        
-        fprintf(log_file, "%s", file_buffer);
-        fflush(log_file); // Ensure log is written immediately
+    va_end(args);
+
+    log_line_emit(&log_line, line_format);
+
+    return (char *)time_str;
+}
+
+char* raise_kv_message(
+  LogLevel level,
+  const char *file,
+  const char *func,
+  int line,
+  const char *message,
+  const LogKv *fields,
+  size_t count) {
+    // Check against the effective log level for this context
+    LogLevel effective_level = logger_get_effective_level(file, func, line);
+    if (level < effective_level) {
+        return NULL;
     }
 
-    return timeStr;
+    const char *time_str = log_timestamp();
+    LogFormat line_format = log_format;
+
+    LogLine log_line;
+    log_line_init(&log_line, line_format);
+    log_line_append_header(&log_line, line_format, time_str, level, file, func, line);
+    log_line_append_message(&log_line, line_format, message ? message : "");
+
+    // Text lines get the fields as a logfmt suffix
+    for (size_t i = 0; i < count; i++)
+        log_line_append_kv(&log_line, line_format, &fields[i]);
+
+    log_line_emit(&log_line, line_format);
+
+    return (char *)time_str;
+}
+
+char* raise_kv_array(LogLevel level, const char *file, const char *func, int line,
+                     const LogKv *entries, size_t count) {
+    return raise_kv_message(level, file, func, line, entries[0].value.string, entries + 1, count);
 }
 
 // -----------
 // -- debug --
 // -----------
 
+#define PTRSET_INITIAL_CAPACITY 16
+#define PTRSET_INITIAL_NAMES 8
+
+static uint64_t ptrset_name_hash(const char *name) {
+    uint64_t hash = 0xcbf29ce484222325ULL;  // FNV-1a
+    for (; *name; name++) hash = (hash ^ (unsigned char)*name) * 0x100000001b3ULL;
+    return hash | 1;  // 0 marks an empty slot
+}
+
+static size_t ptrset_entry_slot(const void *ptr, uint32_t type_id, uint32_t field_id, size_t mask) {
+    uint64_t h = (uint64_t)(uintptr_t)ptr ^ ((uint64_t)type_id << 32 | field_id);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (size_t)h & mask;
+}
+
 PtrSet *ptrset_init__(POSITION_INFO_DECLARATION, Arena *arena) {
     PtrSet *set = arena_alloc__(file, func, line, arena, sizeof(PtrSet));
-    set->data = arena_alloc__(file, func, line, arena, 4 * sizeof(struct { void const *ptr; const char *type; const char *field_name; }));
+    set->entries = arena_alloc__(file, func, line, arena, PTRSET_INITIAL_CAPACITY * sizeof(PtrSetEntry));
+    memset(set->entries, 0, PTRSET_INITIAL_CAPACITY * sizeof(PtrSetEntry));
     set->size = 0;
-    set->capacity = 4;
+    set->capacity = PTRSET_INITIAL_CAPACITY;
+    set->names = arena_alloc__(file, func, line, arena, PTRSET_INITIAL_NAMES * sizeof(PtrSetName));
+    memset(set->names, 0, PTRSET_INITIAL_NAMES * sizeof(PtrSetName));
+    set->name_count = 0;
+    set->name_capacity = PTRSET_INITIAL_NAMES;
     return set;
 }
 
+/* Id of an interned name, 0 when it has not been seen */
+static uint32_t ptrset_name_find(const PtrSet *set, const char *name, uint64_t hash) {
+    size_t mask = set->name_capacity - 1;
+    for (size_t i = (size_t)hash & mask; set->names[i].hash; i = (i + 1) & mask) {
+        const PtrSetName *slot = &set->names[i];
+        // Names are nearly always the same string literal, so try the pointer first
+        if (slot->hash == hash && (slot->name == name || strcmp(slot->name, name) == 0)) return slot->id;
+    }
+    return 0;
+}
+
+static void ptrset_name_place(PtrSetName *names, size_t mask, PtrSetName name) {
+    size_t i = (size_t)name.hash & mask;
+    while (names[i].hash) i = (i + 1) & mask;
+    names[i] = name;
+}
+
+static uint32_t ptrset_name_intern(CTX_DECLARATION, PtrSet *set, const char *name) {
+    uint64_t hash = ptrset_name_hash(name);
+    uint32_t id = ptrset_name_find(set, name, hash);
+    if (id) return id;
+
+    if ((set->name_count + 1) * 2 > set->name_capacity) {
+        size_t capacity = set->name_capacity * 2;
+        PtrSetName *names = arena_alloc__(CTX(arena), capacity * sizeof(PtrSetName));
+        memset(names, 0, capacity * sizeof(PtrSetName));
+        for (size_t i = 0; i < set->name_capacity; i++)
+            if (set->names[i].hash) ptrset_name_place(names, capacity - 1, set->names[i]);
+        set->names = names;
+        set->name_capacity = capacity;
+    }
+    id = (uint32_t)++set->name_count;
+    ptrset_name_place(set->names, set->name_capacity - 1, (PtrSetName){ .name = name, .hash = hash, .id = id });
+    return id;
+}
+
+static PtrSetEntry *ptrset_entry_find(const PtrSet *set, const void *ptr, uint32_t type_id, uint32_t field_id) {
+    size_t mask = set->capacity - 1;
+    for (size_t i = ptrset_entry_slot(ptr, type_id, field_id, mask); set->entries[i].type_id; i = (i + 1) & mask) {
+        PtrSetEntry *entry = &set->entries[i];
+        if (entry->ptr == ptr && entry->type_id == type_id && entry->field_id == field_id) return entry;
+    }
+    return NULL;
+}
+
+static void ptrset_entry_place(PtrSetEntry *entries, size_t mask, PtrSetEntry entry) {
+    size_t i = ptrset_entry_slot(entry.ptr, entry.type_id, entry.field_id, mask);
+    while (entries[i].type_id) i = (i + 1) & mask;
+    entries[i] = entry;
+}
+
 bool debug_ptrset_contains__(PtrSet *set, const void *ptr, const char *type, const char *field_name) {
     if (!set) return false;
-    for (size_t i = 0; i < set->size; i++) {
-        if (set->data[i].ptr == ptr && 
-            strcmp(set->data[i].type, type) == 0 && 
-            strcmp(set->data[i].field_name, field_name) == 0)
-            return true;
-    }
-    return false;
+    // A name that was never interned cannot be part of any entry
+    uint32_t type_id = ptrset_name_find(set, type, ptrset_name_hash(type));
+    if (!type_id) return false;
+    uint32_t field_id = ptrset_name_find(set, field_name, ptrset_name_hash(field_name));
+    if (!field_id) return false;
+    return ptrset_entry_find(set, ptr, type_id, field_id) != NULL;
 }
 
 void debug_ptrset_add__(CTX_DECLARATION, PtrSet *set, const void *ptr, const char *type, const char *field_name) {
     if (!set) return;
-    if (set->size == set->capacity) {
-        set->capacity = set->capacity ? set->capacity * 2 : 4;
-        set->data = arena_realloc__(CTX(arena), set->data, set->capacity * sizeof(struct { void const *ptr; const char *type; const char *field_name; }), 
-                                  set->capacity * 2 * sizeof(struct { void const *ptr; const char *type; const char *field_name; }));
-    }
-    set->data[set->size].ptr = ptr;
-    set->data[set->size].type = type;
-    set->data[set->size].field_name = field_name;
+    uint32_t type_id = ptrset_name_intern(CTX(arena), set, type);
+    uint32_t field_id = ptrset_name_intern(CTX(arena), set, field_name);
+    if (ptrset_entry_find(set, ptr, type_id, field_id)) return;
+
+    // Keep the load at or under 3/4 so probes stay short
+    if ((set->size + 1) * 4 > set->capacity * 3) {
+        size_t capacity = set->capacity * 2;
+        PtrSetEntry *entries = arena_alloc__(CTX(arena), capacity * sizeof(PtrSetEntry));
+        memset(entries, 0, capacity * sizeof(PtrSetEntry));
+        for (size_t i = 0; i < set->capacity; i++)
+            if (set->entries[i].type_id) ptrset_entry_place(entries, capacity - 1, set->entries[i]);
+        set->entries = entries;
+        set->capacity = capacity;
+    }
+    ptrset_entry_place(set->entries, set->capacity - 1, (PtrSetEntry){ .ptr = ptr, .type_id = type_id, .field_id = field_id });
     set->size++;
 }
 
 
-static sigjmp_buf jmp_env;
+// -- Pointer probe --
+
+#define READABLE_CACHE_SIZE 8
 
-void segfault_handler(int signo) {
-    (void)signo;
-    siglongjmp(jmp_env, 1);
+/*
+ * write() of one byte into a pipe fails with EFAULT instead of faulting,
+ * so the probe needs no signal handler and no jump buffer. The pipe is
+ * shared: every probe writes one byte and reads one back, so it never
+ * holds more bytes than there are threads probing at once.
+ */
+static int readable_pipe[2] = {-1, -1};
+static uintptr_t readable_page_mask;
+static pthread_once_t readable_once = PTHREAD_ONCE_INIT;
+
+/* Pages this thread recently found readable; slot 0 is never a valid page */
+static __thread uintptr_t readable_pages[READABLE_CACHE_SIZE];
+static __thread unsigned readable_next;
+
+static void readable_init(void) {
+    long page = sysconf(_SC_PAGESIZE);
+    readable_page_mask = ~(uintptr_t)((page > 0 ? page : 4096) - 1);
+    if (pipe(readable_pipe) != 0) {
+        readable_pipe[0] = readable_pipe[1] = -1;
+        return;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(readable_pipe[i], F_SETFD, FD_CLOEXEC);
+        fcntl(readable_pipe[i], F_SETFL, O_NONBLOCK);
+    }
 }
 
 int is_readable(const void *ptr) {
-    struct sigaction sa, old_sa;
-    sa.sa_handler = segfault_handler;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = 0;
-    sigaction(SIGSEGV, &sa, &old_sa);
-
-    if (sigsetjmp(jmp_env, 1) == 0) {
-        volatile char c = *(volatile const char *)ptr;
-        (void)c;  // Suppress unused variable warning
-        sigaction(SIGSEGV, &old_sa, NULL);
-        return 1;  // Read success
-    } else {
-        sigaction(SIGSEGV, &old_sa, NULL);
-        return 0;  // Read caused segmentation fault
+    pthread_once(&readable_once, readable_init);
+
+    // Nothing is mapped in the first page
+    uintptr_t page = (uintptr_t)ptr & readable_page_mask;
+    if (!page) return 0;
+    for (int i = 0; i < READABLE_CACHE_SIZE; i++)
+        if (readable_pages[i] == page) return 1;
+
+    // Without a pipe nothing can be checked
+    if (readable_pipe[1] < 0) return 1;
+
+    int saved_errno = errno;
+    ssize_t n;
+    do n = write(readable_pipe[1], ptr, 1);
+    while (n < 0 && errno == EINTR);
+    // Only EFAULT says no; any other failure (a full pipe, say) leaves it unknown, taken as readable
+    int readable = n == 1 || errno != EFAULT;
+    if (n == 1) {
+        char byte;
+        while (read(readable_pipe[0], &byte, 1) < 0 && errno == EINTR) {}
+        readable_pages[readable_next++ % READABLE_CACHE_SIZE] = page;
     }
+    errno = saved_errno;
+    return readable;
 }
 
 char *enum_to_debug_str__(CTX_DECLARATION, const char *name, size_t enum_value, const char *enum_str) {
@@ -503,6 +960,10 @@ char *float_to_debug_str__(CTX_DECLARATION, const char *name, double number) {
     return arena_strdup_fmt__(CTX(arena), "%s = %f", name, number);
 }
 
+char *int64_to_debug_str__(CTX_DECLARATION, const char *name, int64_t number) {
+    return arena_strdup_fmt__(CTX(arena), "%s = %" PRId64, name, number);
+}
+
 char *bool_to_debug_str__(CTX_DECLARATION, const char *name, int boolean) {
     return arena_strdup_fmt__(CTX(arena), "%s = %s", name, boolean ? "true" : "false");
 }
@@ -522,6 +983,225 @@ char *char_to_debug_str__(CTX_DECLARATION, const char *name, char c) {
     return arena_strdup_fmt__(CTX(arena), "%s = %c", name, c);
 }
 
+// -- Debug writer --
+
+#define DEBUG_INDENT "  "
+
+/* Room for `need` more bytes and a NUL */
+static void debug_writer_reserve(DebugWriter *writer, size_t need) {
+    if (writer->capacity - writer->len > need) return;
+    size_t capacity = writer->capacity ? writer->capacity * 2 : 256;
+    while (capacity - writer->len <= need) capacity *= 2;
+
+    /* Still the last allocation of the arena: extend it in place */
+    Arena *arena = writer->arena;
+    size_t aligned = (writer->capacity + 7) & ~((size_t)7);
+    if (writer->data && writer->data + aligned == (char *)arena->current
+        && (size_t)((char *)arena->begin + arena->capacity - writer->data) >= capacity) {
+        arena->current = writer->data + ((capacity + 7) & ~((size_t)7));
+        writer->capacity = capacity;
+        return;
+    }
+
+    char *grown = arena_alloc__(writer->file, writer->func, writer->line, arena, capacity);
+    if (writer->len) memcpy(grown, writer->data, writer->len);
+    writer->data = grown;
+    writer->capacity = capacity;
+}
+
+static void debug_put(DebugWriter *writer, const char *data, size_t len) {
+    if (writer->stream) {
+        fwrite(data, 1, len, writer->stream);
+        return;
+    }
+    debug_writer_reserve(writer, len);
+    memcpy(writer->data + writer->len, data, len);
+    writer->len += len;
+}
+
+#define DEBUG_PUT_LITERAL(writer, literal) debug_put(writer, literal, sizeof(literal) - 1)
+
+static void debug_vformat(DebugWriter *writer, const char *fmt, va_list args) {
+    if (writer->stream) {
+        vfprintf(writer->stream, fmt, args);
+        return;
+    }
+    // Straight into the free tail; only output that does not fit is formatted again
+    va_list retry;
+    va_copy(retry, args);
+    size_t room = writer->capacity - writer->len;
+    int n = vsnprintf(room ? writer->data + writer->len : NULL, room, fmt, args);
+    if (n >= 0 && (size_t)n >= room) {
+        debug_writer_reserve(writer, (size_t)n);
+        vsnprintf(writer->data + writer->len, (size_t)n + 1, fmt, retry);
+    }
+    va_end(retry);
+    if (n > 0) writer->len += (size_t)n;
+}
+
+static void debug_format(DebugWriter *writer, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    debug_vformat(writer, fmt, args);
+    va_end(args);
+}
+
+static void debug_newline(DebugWriter *writer) {
+    DEBUG_PUT_LITERAL(writer, "\n");
+    for (int i = 0; i < writer->level; i++) DEBUG_PUT_LITERAL(writer, DEBUG_INDENT);
+}
+
+static void debug_field_begin(DebugWriter *writer) {
+    if (!writer->first) {
+        if (writer->pretty) {
+            DEBUG_PUT_LITERAL(writer, ",");
+            debug_newline(writer);
+        } else {
+            DEBUG_PUT_LITERAL(writer, ", ");
+        }
+    }
+    writer->first = false;
+}
+
+/* debug_to_pretty_str() ends its output with a newline */
+static void debug_field_end(DebugWriter *writer) {
+    if (writer->pretty && writer->level == 0) DEBUG_PUT_LITERAL(writer, "\n");
+}
+
+DebugWriter debug_writer_buffer__(POSITION_INFO_DECLARATION, Arena *arena, PtrSet *visited, bool pretty) {
+    raise_trace__(file, func, line, "DEBUG WRITER: buffer (arena: %p, pretty: %d)", arena, pretty);
+    return (DebugWriter){ .arena = arena, .visited = visited, .pretty = pretty, .first = true,
+                          .file = file, .func = func, .line = line };
+}
+
+DebugWriter debug_writer_file__(POSITION_INFO_DECLARATION, Arena *arena, FILE *stream, PtrSet *visited, bool pretty) {
+    raise_trace__(file, func, line, "DEBUG WRITER: file (stream: %p, pretty: %d)", (void *)stream, pretty);
+    return (DebugWriter){ .arena = arena, .visited = visited, .stream = stream, .pretty = pretty, .first = true,
+                          .file = file, .func = func, .line = line };
+}
+
+char *debug_writer_cstr(DebugWriter *writer) {
+    if (writer->stream) return NULL;
+    debug_writer_reserve(writer, 0);
+    writer->data[writer->len] = '\0';
+    return writer->data;
+}
+
+void debug_write_field(DebugWriter *writer, const char *fmt, ...) {
+    debug_field_begin(writer);
+    va_list args;
+    va_start(args, fmt);
+    debug_vformat(writer, fmt, args);
+    va_end(args);
+    debug_field_end(writer);
+}
+
+void debug_write_text(DebugWriter *writer, const char *text) {
+    debug_field_begin(writer);
+    debug_put(writer, text, strlen(text));
+    debug_field_end(writer);
+}
+
+bool debug_write_visit(DebugWriter *writer, const char *kind, const char *type, const char *name, const void *ptr) {
+    if (!name) name = "$1";
+    if (debug_ptrset_contains__(writer->visited, ptr, type, name)) {
+        debug_write_field(writer, "%s%s%s %s %s = <cycle detected> %s%p%s", DEBUG_COLOR(COLOR_GREEN), kind, DEBUG_COLOR(COLOR_RESET), type, name, DEBUG_COLOR(COLOR_CYAN), ptr, DEBUG_COLOR(COLOR_RESET));
+        return false;
+    }
+    if (!ptr) {
+        debug_write_field(writer, "%s%s%s %s %s = NULL", DEBUG_COLOR(COLOR_GREEN), kind, DEBUG_COLOR(COLOR_RESET), type, name);
+        return false;
+    }
+    debug_ptrset_add__(writer->file, writer->func, writer->line, writer->arena, writer->visited, ptr, type, name);
+    return true;
+}
+
+void debug_write_open(DebugWriter *writer, const char *kind, const char *type, const char *name) {
+    debug_field_begin(writer);
+    debug_format(writer, "%s%s%s %s %s = {", DEBUG_COLOR(COLOR_GREEN), kind, DEBUG_COLOR(COLOR_RESET), type, name ? name : "$1");
+    writer->level++;
+    writer->first = true;
+    if (writer->pretty) debug_newline(writer);
+}
+
+void debug_write_leave(DebugWriter *writer, const void *ptr) {
+    writer->level--;
+    if (writer->pretty) debug_newline(writer);
+    debug_format(writer, "} %s%p%s", DEBUG_COLOR(COLOR_CYAN), ptr, DEBUG_COLOR(COLOR_RESET));
+    writer->first = false;
+    debug_field_end(writer);
+}
+
+bool debug_write_enter(DebugWriter *writer, const char *kind, const char *type, const char *name, const void *ptr) {
+    if (!debug_write_visit(writer, kind, type, name, ptr)) return false;
+    debug_write_open(writer, kind, type, name);
+    return true;
+}
+
+void debug_write_string(DebugWriter *writer, const char *name, const char *string) {
+    if (!string)
+        debug_write_field(writer, "%s = NULL", name);
+    else if (!is_readable(string))
+        debug_write_field(writer, "%s = <memory unreadable>", name);
+    else
+        debug_write_field(writer, "%s = %s%p%s \"%s\"", name, DEBUG_COLOR(COLOR_CYAN), (const void *)string, DEBUG_COLOR(COLOR_RESET), string);
+}
+
+void debug_write_int(DebugWriter *writer, const char *name, int number) {
+    debug_write_field(writer, "%s = %d", name, number);
+}
+
+void debug_write_float(DebugWriter *writer, const char *name, double number) {
+    debug_write_field(writer, "%s = %f", name, number);
+}
+
+void debug_write_int64(DebugWriter *writer, const char *name, int64_t number) {
+    debug_write_field(writer, "%s = %" PRId64, name, number);
+}
+
+void debug_write_size_t(DebugWriter *writer, const char *name, size_t number) {
+    debug_write_field(writer, "%s = %zu", name, number);
+}
+
+void debug_write_ptr(DebugWriter *writer, const char *name, const void *ptr) {
+    if (!ptr) debug_write_field(writer, "%s = NULL", name);
+    else debug_write_field(writer, "%s = %p", name, ptr);
+}
+
+void debug_write_char(DebugWriter *writer, const char *name, char c) {
+    debug_write_field(writer, "%s = %c", name, c);
+}
+
+void debug_write_bool(DebugWriter *writer, const char *name, int boolean) {
+    debug_write_field(writer, "%s = %s", name, boolean ? "true" : "false");
+}
+
+void debug_write_enum(DebugWriter *writer, const char *name, size_t enum_value, const char *enum_str) {
+    debug_write_field(writer, "%senum%s %s = %s%s%s %zu ", DEBUG_COLOR(COLOR_GREEN), DEBUG_COLOR(COLOR_RESET), name, DEBUG_COLOR(COLOR_CYAN), enum_str, DEBUG_COLOR(COLOR_RESET), enum_value);
+}
+
+/* Pointers of the structs a sibling chain left open, closed innermost first */
+typedef struct {
+    const void **items;
+    size_t count;
+    size_t capacity;
+} DebugChain;
+
+static void debug_chain_push(DebugWriter *writer, DebugChain *chain, const void *ptr) {
+    if (chain->count == chain->capacity) {
+        size_t capacity = chain->capacity ? chain->capacity * 2 : 16;
+        const void **items = arena_alloc__(writer->file, writer->func, writer->line, writer->arena, capacity * sizeof(*items));
+        if (chain->count) memcpy(items, chain->items, chain->count * sizeof(*items));
+        chain->items = items;
+        chain->capacity = capacity;
+    }
+    chain->items[chain->count++] = ptr;
+}
+
+static void debug_chain_close(DebugWriter *writer, DebugChain *chain) {
+    while (chain->count) debug_write_leave(writer, chain->items[--chain->count]);
+}
+
 char *union_to_debug_str__(POSITION_INFO_DECLARATION, Arena *arena, const char *type, const char *name, const void *ptr, size_t active_variant, size_t count, ...) {
     if (count % 2 == 0) {
         raise_exception__(file, func, line, "HECTICLIB ERROR: Union to debug str: count is even");
@@ -550,149 +1230,65 @@ char *union_to_debug_str__(POSITION_INFO_DECLARATION, Arena *arena, const char *
     
     va_end(args);
     
+    DebugWriter writer = debug_writer_buffer__(file, func, line, arena, NULL, false);
     if (!variant_exists) {
-        return arena_strdup_fmt__(file, func, line, arena, 
-            "%sunion%s %s %s = <invalid variant %d> %s%p%s", 
+        debug_write_field(&writer, "%sunion%s %s %s = <invalid variant %d> %s%p%s", 
             DEBUG_COLOR(COLOR_GREEN), DEBUG_COLOR(COLOR_RESET), 
-            type, name, active_variant, DEBUG_COLOR(COLOR_CYAN), ptr, DEBUG_COLOR(COLOR_RESET));
-    }
-    
-    if (!value) {
-        return arena_strdup_fmt__(file, func, line, arena, 
-            "%sunion%s %s %s = <unknown variant> %s%p%s", 
+            type, name, (int)active_variant, DEBUG_COLOR(COLOR_CYAN), ptr, DEBUG_COLOR(COLOR_RESET));
+    } else if (!value) {
+        debug_write_field(&writer, "%sunion%s %s %s = <unknown variant> %s%p%s", 
             DEBUG_COLOR(COLOR_GREEN), DEBUG_COLOR(COLOR_RESET), 
             type, name, DEBUG_COLOR(COLOR_CYAN), ptr, DEBUG_COLOR(COLOR_RESET));
+    } else {
+        debug_write_open(&writer, "union", type, name);
+        debug_write_text(&writer, value);
+        debug_write_leave(&writer, ptr);
     }
-    
-    return arena_strdup_fmt__(file, func, line, arena, 
-        "%sunion%s %s %s = {%s} %s%p%s", 
-        DEBUG_COLOR(COLOR_GREEN), DEBUG_COLOR(COLOR_RESET), 
-        type, name, value, DEBUG_COLOR(COLOR_CYAN), ptr, DEBUG_COLOR(COLOR_RESET));
-}
-
-/* Private function */
-char *debug_join_debug_strings_v(CTX_DECLARATION, int count, va_list args) {
-    raise_trace__(file, func, line, "DEBUG JOIN: Joining %d strings", count);
-    int total_len = 1;
-
-    va_list args_copy;
-    va_copy(args_copy, args);
-    raise_trace__(file, func, line, "DEBUG JOIN: Starting first pass");
-    for (int i = 0; i < count; i++) {
-        char *s = va_arg(args_copy, char*);
-        int len = strlen(s);
-        raise_trace__(file, func, line, "DEBUG JOIN: String %d: [%s] %p len: %d", i, s, s, len);
-        total_len += len;
-    }
-    va_end(args_copy);
-
-    char *joined = arena_alloc__(CTX(arena), total_len);
-    joined[0] = '\0';
-
-    raise_trace__(file, func, line, "DEBUG JOIN: concatenating strings");
-    va_copy(args_copy, args);
-    for (int i = 0; i < count; i++) {
-        char *s = va_arg(args_copy, char*);
-        strcat(joined, s);
-        if (i < count - 1) {
-            strcat(joined, ", ");
-        }
-    }
-    va_end(args_copy);
-
-    return joined;
+    return debug_writer_cstr(&writer);
 }
 
 char *struct_to_debug_str__(CTX_DECLARATION, const char *type, const char *name, const void *ptr, int count, ...) {
     raise_trace__(file, func, line, "DEBUG STR: type: %s, name: %s, ptr: %p, count: %d", type, name, ptr, count);
 
+    DebugWriter writer = debug_writer_buffer__(file, func, line, arena, NULL, false);
+    debug_write_open(&writer, "struct", type, name);
     va_list args;
     va_start(args, count);
-    char *joined = debug_join_debug_strings_v(CTX(arena), count, args);
+    for (int i = 0; i < count; i++) debug_write_text(&writer, va_arg(args, const char *));
     va_end(args);
-
-    return arena_strdup_fmt__(CTX(arena), "%sstruct%s %s %s = {%s} %s%p%s", DEBUG_COLOR(COLOR_GREEN), DEBUG_COLOR(COLOR_RESET), type, name, joined, DEBUG_COLOR(COLOR_CYAN), ptr, DEBUG_COLOR(COLOR_RESET));
+    debug_write_leave(&writer, ptr);
+    return debug_writer_cstr(&writer);
 }
 
 char *debug_to_pretty_str__(POSITION_INFO_DECLARATION, Arena *arena, const char *s) {
-  int indent = 0;
-  size_t len = strlen(s) * 3; // Estimate for extra spaces, newlines, and indents
-  char *result = arena_alloc__(file, func, line, arena, len);
-  char *current = result;
-  size_t remaining = len;
-
-  #define INDENT_STR "  "
+  DebugWriter writer = debug_writer_buffer__(file, func, line, arena, NULL, false);
 
   while (*s) {
+    // Copy everything up to the next structural character in one piece
+    size_t run = strcspn(s, "{},");
+    debug_put(&writer, s, run);
+    s += run;
+
     if (*s == '{') {
-      int written = snprintf(current, remaining, "{\n");
-      current += written;
-      remaining -= written;
-      
-      indent++;
-      for (int i = 0; i < indent; i++) {
-        written = snprintf(current, remaining, INDENT_STR);
-        current += written;
-        remaining -= written;
-      }
+      writer.level++;
+      DEBUG_PUT_LITERAL(&writer, "{");
+      debug_newline(&writer);
       s++;
     } else if (*s == '}') {
-      int written = snprintf(current, remaining, "\n");
-      current += written;
-      remaining -= written;
-      
-      indent--;
-      for (int i = 0; i < indent; i++) {
-        written = snprintf(current, remaining, INDENT_STR);
-        current += written;
-        remaining -= written;
-      }
-      
-      written = snprintf(current, remaining, "}");
-      current += written;
-      remaining -= written;
+      writer.level--;
+      debug_newline(&writer);
+      DEBUG_PUT_LITERAL(&writer, "}");
       s++;
     } else if (*s == ',') {
-      int written = snprintf(current, remaining, ",\n");
-      current += written;
-      remaining -= written;
-      
-      for (int i = 0; i < indent; i++) {
-        written = snprintf(current, remaining, INDENT_STR);
-        current += written;
-        remaining -= written;
-      }
+      DEBUG_PUT_LITERAL(&writer, ",");
+      debug_newline(&writer);
       s++;
       s = skip_whitespace(s);
-    } else {
-      if (remaining > 1) {
-        *current++ = *s;
-        remaining--;
-      }
-      s++;
-    }
-    
-    // If we're running low on space, expand the buffer
-    if (remaining < 20) {
-      size_t used = current - result;
-      size_t new_len = len * 2;
-      result = arena_realloc__(file, func, line, arena, result, len, new_len);
-      current = result + used;
-      remaining = new_len - used;
-      len = new_len;
     }
   }
-  
-  // Add final newline and null terminator
-  if (remaining > 2) {
-    *current++ = '\n';
-    *current = '\0';
-  } else {
-    // Ensure null-termination even if we can't add the newline
-    result[len - 1] = '\0';
-  }
-  
-  return result;
+
+  DEBUG_PUT_LITERAL(&writer, "\n");
+  return debug_writer_cstr(&writer);
 }
 
 // ------------
@@ -914,26 +1510,30 @@ char* arena_strdup__(POSITION_INFO_DECLARATION, Arena *arena, const char *s) {
  * The string is formatted using the provided format string and arguments.
  */
 char* arena_strdup_fmt__(POSITION_INFO_DECLARATION, Arena *arena, const char *fmt, ...) {
+    // Format straight into the free tail and claim it; only output that does not fit is formatted again
+    size_t available = arena->begin ? arena->capacity - (size_t)((char *)arena->current - (char *)arena->begin) : 0;
+
     va_list args;
     va_start(args, fmt);
-    int len = vsnprintf(NULL, 0, fmt, args);
+    int len = vsnprintf(available ? arena->current : NULL, available, fmt, args);
     va_end(args);
 
     if (len < 0) return NULL;
+    if ((size_t)len < available) return arena_alloc__(file, func, line, arena, (size_t)len + 1);
 
-    char *temp = arena_alloc__(file, func, line, DISPOSABLE_ARENA, len + 1);
+    char *result = arena_alloc__(file, func, line, arena, (size_t)len + 1);
     va_start(args, fmt);
-    vsnprintf(temp, len + 1, fmt, args);
+    vsnprintf(result, (size_t)len + 1, fmt, args);
     va_end(args);
 
-    return arena_strdup__(file, func, line, arena, temp);
+    return result;
 }
 
 char* arena_strncpy__(POSITION_INFO_DECLARATION, Arena *arena, const char *start, size_t len) {
     // Function entry logging
     raise_trace__(file, func, line,
-        "ARENA STRNCPY: Copying string (arena: %p, source: %p, length: %zu, preview: %.20s%s)",
-        arena, start, len, start ? start : "", start && strlen(start) > 20 ? "..." : "");
+        "ARENA STRNCPY: Copying string (arena: %p, source: %p, length: %zu, preview: %.*s%s)",
+        arena, start, len, start ? (int)(len < 20 ? len : 20) : 0, start ? start : "", len > 20 ? "..." : "");
     
     // Check for NULL string
     if (!start) {
@@ -1068,604 +1668,5848 @@ void substr_clone__(POSITION_INFO_DECLARATION, const char * const src, char *des
         len, (int)len, dest);
 }
 
+// ----------
+// -- Simd --
+// ----------
+
+/* Detected once, before any thread reads it; simd_set_level() replaces it */
+static int simd_current_level;
+static pthread_once_t simd_level_once = PTHREAD_ONCE_INIT;
+
+const char *simd_level_to_string(SimdLevel level) {
+    switch (level) {
+        case SIMD_LEVEL_SCALAR: return "SCALAR";
+        case SIMD_LEVEL_SSE2: return "SSE2";
+        case SIMD_LEVEL_AVX2: return "AVX2";
+        default: return "UNKNOWN";
+    }
+}
+
+SimdLevel simd_level_detect(void) {
+#ifdef HECTIC_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SIMD_LEVEL_AVX2;
+    if (__builtin_cpu_supports("sse2")) return SIMD_LEVEL_SSE2;
+#endif
+    return SIMD_LEVEL_SCALAR;
+}
+
+static void simd_level_init(void) {
+    simd_current_level = (int)simd_level_detect();
+    raise_debug("SIMD: Using %s", simd_level_to_string((SimdLevel)simd_current_level));
+}
+
+SimdLevel simd_level(void) {
+    pthread_once(&simd_level_once, simd_level_init);
+    return (SimdLevel)simd_current_level;
+}
+
+void simd_set_level(SimdLevel level) {
+    // Settle detection first so a later first simd_level() does not undo this
+    pthread_once(&simd_level_once, simd_level_init);
+    SimdLevel detected = simd_level_detect();
+    if (level > detected) {
+        raise_warn("SIMD: %s is not supported by this CPU, using %s",
+                   simd_level_to_string(level), simd_level_to_string(detected));
+        level = detected;
+    }
+    simd_current_level = (int)level;
+}
+
 // ----------
 // -- Json --
 // ----------
 
-char *json_to_pretty_str__(POSITION_INFO_DECLARATION, Arena *arena, const Json * const item, int indent_level) {
-    raise_debug__(file, func, line, 
-                  "PRETTY: Starting JSON prettification (item: %p, indent: %d)", 
-                  item, indent_level);
-    
-    if (!item) {
-        raise_exception__(file, func, line, 
-                     "PRETTY: Invalid JSON object (NULL) provided for prettification");
-        return NULL;
+/*
+ * Shortest round-trip doubles: Grisu3 (Loitsch, "Printing Floating-Point
+ * Numbers Quickly and Accurately with Integers") produces the digits and
+ * proves them shortest and closest; for the few values it cannot prove, an
+ * exact search over printf precisions takes over. The layout follows
+ * ECMAScript Number::toString so that integral values print without an
+ * exponent up to 1e21.
+ */
+
+typedef struct {
+    uint64_t f;
+    int e;
+} DiyFp;
+
+#define DIYFP_SIGNIFICAND_SIZE 64
+#define DOUBLE_SIGNIFICAND_SIZE 52
+#define DOUBLE_HIDDEN_BIT 0x0010000000000000ULL
+
+/* Normalized 64-bit approximations of 10^-348, 10^-340, ..., 10^340 */
+static const uint64_t json_cached_powers_f[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL,
+    0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL,
+    0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL, 0xc21094364dfb5637ULL,
+    0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+    0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL,
+    0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL, 0x964e858c91ba2655ULL, 0xdff9772470297ebdULL,
+    0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+    0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+    0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL,
+    0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL,
+    0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL,
+    0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL,
+    0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL, 0x8bab8eefb6409c1aULL,
+    0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+    0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+
+static const int16_t json_cached_powers_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+static const uint64_t json_pow10[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+    1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+    1000000000000000000ULL, 10000000000000000000ULL,
+};
+
+static DiyFp diyfp_from_double(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int biased_e = (int)((bits >> DOUBLE_SIGNIFICAND_SIZE) & 0x7FF);
+    uint64_t significand = bits & (DOUBLE_HIDDEN_BIT - 1);
+    if (biased_e) return (DiyFp){ significand + DOUBLE_HIDDEN_BIT, biased_e - 1075 };
+    return (DiyFp){ significand, -1074 };
+}
+
+static DiyFp diyfp_mul(DiyFp x, DiyFp y) {
+    const uint64_t mask = 0xFFFFFFFFULL;
+    uint64_t a = x.f >> 32, b = x.f & mask, c = y.f >> 32, d = y.f & mask;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & mask) + (bc & mask);
+    tmp += 1ULL << 31; // round
+    return (DiyFp){ ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64 };
+}
+
+static DiyFp diyfp_normalize(DiyFp x) {
+    int shift = __builtin_clzll(x.f);
+    return (DiyFp){ x.f << shift, x.e - shift };
+}
+
+/* Boundaries m- and m+ halfway to the neighbouring doubles, sharing m+'s exponent */
+static void diyfp_boundaries(DiyFp v, DiyFp *minus, DiyFp *plus) {
+    DiyFp p = { (v.f << 1) + 1, v.e - 1 };
+    while (!(p.f & (DOUBLE_HIDDEN_BIT << 1))) {
+        p.f <<= 1;
+        p.e--;
     }
-    
-    if (!arena) {
-        raise_exception__(file, func, line,
-                     "PRETTY: Invalid arena (NULL) provided for prettification");
-        return NULL;
+    p.f <<= DIYFP_SIGNIFICAND_SIZE - DOUBLE_SIGNIFICAND_SIZE - 2;
+    p.e -= DIYFP_SIGNIFICAND_SIZE - DOUBLE_SIGNIFICAND_SIZE - 2;
+
+    // Only a power of two above the denormals has a closer lower neighbour
+    DiyFp m = v.f == DOUBLE_HIDDEN_BIT && v.e != -1074 ? (DiyFp){ (v.f << 2) - 1, v.e - 2 } : (DiyFp){ (v.f << 1) - 1, v.e - 1 };
+    m.f <<= m.e - p.e;
+    m.e = p.e;
+    *minus = m;
+    *plus = p;
+}
+
+/* Cached power c with binary exponent in [-60, -32] after multiplication; *k is its decimal exponent negated */
+static DiyFp diyfp_cached_power(int e, int *k) {
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int ik = (int)dk;
+    if (dk - ik > 0.0) ik++;
+    unsigned int index = (unsigned int)((ik >> 3) + 1);
+    *k = -(-348 + (int)(index << 3));
+    return (DiyFp){ json_cached_powers_f[index], json_cached_powers_e[index] };
+}
+
+/*
+ * Moves the last digit towards w while it stays inside the unsafe interval,
+ * then checks the result against the error of the scaled boundaries (unit):
+ * false when it may be outside the real interval or not the closest.
+ */
+static bool grisu_round_weed(char *buffer, int len, uint64_t distance_too_high_w, uint64_t unsafe_interval,
+                             uint64_t rest, uint64_t ten_kappa, uint64_t unit) {
+    uint64_t small_distance = distance_too_high_w - unit;
+    uint64_t big_distance = distance_too_high_w + unit;
+    while (rest < small_distance && unsafe_interval - rest >= ten_kappa
+           && (rest + ten_kappa < small_distance || small_distance - rest >= rest + ten_kappa - small_distance)) {
+        buffer[len - 1]--;
+        rest += ten_kappa;
     }
-    
-    char *out = arena_alloc__(file, func, line, arena, 1024);
-    if (!out) {
-        raise_exception__(file, func, line, 
-                     "PRETTY: Memory allocation failed during JSON prettification");
-        return NULL;
+    if (rest < big_distance && unsafe_interval - rest >= ten_kappa
+        && (rest + ten_kappa < big_distance || big_distance - rest > rest + ten_kappa - big_distance)) {
+        return false;
     }
-    
-    char *ptr = out;
-    
-    if (item->type == JSON_OBJECT) {
-        ptr += sprintf(ptr, "{\n");
-        
-        Json *child = item->value.child;
-        int child_count = 0;
-        
-        raise_trace__(file, func, line, 
-                      "PRETTY: Processing JSON object children");
-        
-        while (child) {
-            for (int i = 0; i < indent_level + 1; i++) {
-                ptr += sprintf(ptr, "  ");
-            }
-            
-            ptr += sprintf(ptr, "\"%s\": ", child->key ? child->key : "");
-            char *child_str = json_to_pretty_str__(file, func, line, arena, child, indent_level + 1);
-            if (child_str) {
-                ptr += sprintf(ptr, "%s", child_str);
-            } else {
-                raise_warn__(file, func, line, 
-                              "PRETTY: Failed to prettify child element (key=%s)", 
-                              child->key ? child->key : "<null>");
-            }
-            
-            if (child->next) {
-                ptr += sprintf(ptr, ",\n");
-            } else {
-                ptr += sprintf(ptr, "\n");
-            }
-            child = child->next;
-            child_count++;
+    return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+}
+
+static int count_decimal_digits32(uint32_t n) {
+    int digits = 1;
+    while (digits < 10 && n >= json_pow10[digits]) digits++;
+    return digits;
+}
+
+/* Digits of the shortest number in (low, high), widened by one unit of error each way */
+static bool grisu_digit_gen(DiyFp low, DiyFp w, DiyFp high, char *buffer, int *len, int *k) {
+    uint64_t unit = 1;
+    uint64_t too_high = high.f + unit;
+    uint64_t unsafe_interval = too_high - (low.f - unit);
+    const DiyFp one = { 1ULL << -w.e, w.e };
+    uint32_t p1 = (uint32_t)(too_high >> -one.e);
+    uint64_t p2 = too_high & (one.f - 1);
+    int kappa = count_decimal_digits32(p1);
+    *len = 0;
+
+    while (kappa > 0) {
+        uint32_t divisor = (uint32_t)json_pow10[kappa - 1];
+        buffer[(*len)++] = (char)('0' + p1 / divisor);
+        p1 %= divisor;
+        kappa--;
+        uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+        if (rest < unsafe_interval) {
+            *k += kappa;
+            return grisu_round_weed(buffer, *len, too_high - w.f, unsafe_interval, rest,
+                                    (uint64_t)divisor << -one.e, unit);
         }
-        
-        for (int i = 0; i < indent_level; i++) {
-            ptr += sprintf(ptr, "  ");
-        }
-        sprintf(ptr, "}");
-        raise_trace__(file, func, line, 
-                      "PRETTY: Object prettification complete with %d child elements", child_count);
-    } else if (item->type == JSON_ARRAY) {
-        ptr += sprintf(ptr, "[\n");
-        
-        Json *child = item->value.child;
-        int child_count = 0;
-        
-        raise_trace__(file, func, line, 
-                      "PRETTY: Processing JSON array elements");
-        
-        while (child) {
-            // Add indentation
-            for (int i = 0; i < indent_level + 1; i++) {
-                ptr += sprintf(ptr, "  ");
-            }
-            
-            char *child_str = json_to_pretty_str__(file, func, line, arena, child, indent_level + 1);
-            if (child_str) {
-                ptr += sprintf(ptr, "%s", child_str);
-            } else {
-                raise_warn__(file, func, line, 
-                              "PRETTY: Failed to prettify array element at index %d", child_count);
-            }
-            
-            if (child->next) {
-                ptr += sprintf(ptr, ",\n");
+    }
+
+    for (;;) {
+        p2 *= 10;
+        unit *= 10;
+        unsafe_interval *= 10;
+        buffer[(*len)++] = (char)('0' + (p2 >> -one.e));
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < unsafe_interval) {
+            *k += kappa;
+            return grisu_round_weed(buffer, *len, (too_high - w.f) * unit, unsafe_interval, p2, one.f, unit);
+        }
+    }
+}
+
+/* Shortest digits of a positive finite value: value ~= digits * 10^k; false when they are not proven */
+static bool grisu3(double value, char *buffer, int *len, int *k) {
+    DiyFp v = diyfp_from_double(value);
+    DiyFp minus, plus;
+    diyfp_boundaries(v, &minus, &plus);
+    DiyFp c_mk = diyfp_cached_power(plus.e, k);
+    DiyFp w = diyfp_mul(diyfp_normalize(v), c_mk);
+    return grisu_digit_gen(diyfp_mul(minus, c_mk), w, diyfp_mul(plus, c_mk), buffer, len, k);
+}
+
+static double json_strtod_c(const char *start, const char *end);
+
+/* digits * 10^exponent, correctly rounded */
+static double json_digits_to_double(uint64_t digits, int exponent) {
+    char text[40];
+    int len = snprintf(text, sizeof(text), "%llue%d", (unsigned long long)digits, exponent);
+    return json_strtod_c(text, text + len);
+}
+
+/*
+ * Exact fallback: the first precision where printf's correctly rounded
+ * digits, or their neighbour on the other side of value, read back. The
+ * neighbour matters where the lower boundary is the closer one.
+ */
+static void json_shortest_slow(double value, char *buffer, int *len, int *k) {
+    char text[40];
+    for (int precision = 1; precision <= 17; precision++) {
+        snprintf(text, sizeof(text), "%.*e", precision - 1, value);
+        uint64_t digits = 0;
+        const char *c = text;
+        for (; *c != 'e'; c++) {
+            if (*c >= '0' && *c <= '9') digits = digits * 10 + (uint64_t)(*c - '0');
+        }
+        int exponent = atoi(c + 1) - (precision - 1);
+        double back = json_digits_to_double(digits, exponent);
+        if (back != value) {
+            if (back < value) {
+                digits++;
+            } else if (digits == json_pow10[precision - 1]) {
+                digits = digits * 10 - 1;
+                exponent--;
             } else {
-                ptr += sprintf(ptr, "\n");
+                digits--;
             }
-            child = child->next;
-            child_count++;
+            if (json_digits_to_double(digits, exponent) != value) continue;
         }
-        
-        for (int i = 0; i < indent_level; i++) {
-            ptr += sprintf(ptr, "  ");
-        }
-        sprintf(ptr, "]");
-        raise_trace__(file, func, line, 
-                      "PRETTY: Array prettification complete with %d elements", child_count);
-    } else if (item->type == JSON_STRING) {
-        sprintf(ptr, "\"%s\"", item->value.string ? item->value.string : "");
-    } else if (item->type == JSON_NUMBER) {
-        sprintf(ptr, "%g", item->value.number);
-    } else if (item->type == JSON_BOOL) {
-        sprintf(ptr, item->value.boolean ? "true" : "false");
-    } else if (item->type == JSON_NULL) {
-        sprintf(ptr, "null");
-    }
-    
-    raise_log__(file, func, line, 
-                  "PRETTY: JSON %s prettified (length=%zu)", 
-                  json_type_to_string(item->type), strlen(out));
-    
-    return out;
+        while (digits % 10 == 0) {
+            digits /= 10;
+            exponent++;
+        }
+        *len = snprintf(buffer, 20, "%llu", (unsigned long long)digits);
+        *k = exponent;
+        return;
+    }
+    // Seventeen digits always read back
+    assert(0);
 }
 
-const char* json_type_to_string(JsonType type) {
-    switch (type) {
-        case JSON_NULL: return "NULL";
-        case JSON_BOOL: return "BOOL";
-        case JSON_NUMBER: return "NUMBER";
-        case JSON_STRING: return "STRING";
-        case JSON_ARRAY: return "ARRAY";
-        case JSON_OBJECT: return "OBJECT";
-        default: return "UNKNOWN";
+size_t json_number_to_str(double value, char *out) {
+    char *o = out;
+    if (value != value) return (size_t)sprintf(out, "nan");
+    if (value - value != 0) return (size_t)sprintf(out, value < 0 ? "-inf" : "inf");
+    if (signbit(value)) {
+        *o++ = '-';
+        value = -value;
+    }
+    if (value == 0) {
+        *o++ = '0';
+        *o = '\0';
+        return (size_t)(o - out);
     }
+
+    char digits[20];
+    int len, k;
+    if (!grisu3(value, digits, &len, &k)) json_shortest_slow(value, digits, &len, &k);
+    int point = len + k; // value = 0.digits * 10^point
+
+    if (len <= point && point <= 21) {
+        memcpy(o, digits, (size_t)len);
+        o += len;
+        for (int i = len; i < point; i++) *o++ = '0';
+    } else if (0 < point && point <= 21) {
+        memcpy(o, digits, (size_t)point);
+        o += point;
+        *o++ = '.';
+        memcpy(o, digits + point, (size_t)(len - point));
+        o += len - point;
+    } else if (-6 < point && point <= 0) {
+        *o++ = '0';
+        *o++ = '.';
+        for (int i = point; i < 0; i++) *o++ = '0';
+        memcpy(o, digits, (size_t)len);
+        o += len;
+    } else {
+        *o++ = digits[0];
+        if (len > 1) {
+            *o++ = '.';
+            memcpy(o, digits + 1, (size_t)(len - 1));
+            o += len - 1;
+        }
+        o += sprintf(o, "e%+d", point - 1);
+        return (size_t)(o - out);
+    }
+    *o = '\0';
+    return (size_t)(o - out);
 }
 
-static Json *json_parse_value__(POSITION_INFO_DECLARATION, const char **s, Arena *arena);
+// -- Json sink --
 
-/* Parse a JSON string (does not handle full escaping) */
-static char *json_parse_string__(POSITION_INFO_DECLARATION, const char **s_ptr, Arena *arena) {
-    const char *s = *s_ptr;
-    raise_debug__(file, func, line, "Entering json_parse_string__ at position: %p", s);
-    if (*s != '"') {
-        raise_debug__(file, func, line, "Expected '\"' at start of string, got: %c", *s);
-        return NULL;
-    }
-    s++; // skip opening quote
-    const char *start = s;
-    while (*s && *s != '"') {
-        if (*s == '\\') {
-            s++; // skip escape char indicator
-        }
-        s++;
+static bool json_sink_grow(JsonSink *sink, size_t need) {
+    size_t new_cap = sink->cap ? sink->cap * 2 : 256;
+    while (new_cap - sink->len < need) new_cap *= 2;
+
+    /* Still the last allocation of the arena: extend it in place */
+    Arena *arena = sink->arena;
+    size_t aligned_cap = (sink->cap + 7) & ~((size_t)7);
+    if (sink->data && sink->data + aligned_cap == (char *)arena->current
+        && (size_t)((char *)arena->begin + arena->capacity - sink->data) >= new_cap) {
+        arena->current = sink->data + ((new_cap + 7) & ~((size_t)7));
+        sink->cap = new_cap;
+        return true;
     }
-    if (*s != '"') {
-        raise_debug__(file, func, line, "Unterminated string starting at: %p", start);
-        return NULL;
+
+    char *grown = arena_alloc_or_null__(sink->file, sink->func, sink->line, arena, new_cap, false);
+    if (!grown) return false;
+    if (sink->len) memcpy(grown, sink->data, sink->len);
+    sink->data = grown;
+    sink->cap = new_cap;
+    return true;
+}
+
+static bool json_sink_drain_fd(JsonSink *sink, size_t need) {
+    size_t done = 0;
+    while (done < sink->len) {
+        ssize_t n = write(sink->fd, sink->data + done, sink->len - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += (size_t)n;
     }
-    size_t len = s - start;
-    char *str = arena_alloc__(file, func, line, arena, len + 1);
-    if (!str) {
-        raise_debug__(file, func, line, "Memory allocation failed in json_parse_string__");
-        return NULL;
+    sink->len = 0;
+    (void)need;
+    return true;
+}
+
+JsonSink json_sink_buffer__(POSITION_INFO_DECLARATION, Arena *arena, size_t capacity) {
+    JsonSink sink = { .arena = arena, .drain = json_sink_grow, .fd = -1, .file = file, .func = func, .line = line };
+    if (capacity) {
+        sink.data = arena_alloc__(file, func, line, arena, capacity);
+        sink.cap = capacity;
     }
-    memcpy(str, start, len);
-    str[len] = '\0';
-    *s_ptr = s + 1; // skip closing quote
-    raise_debug__(file, func, line, "Parsed string: \"%s\" (length: %zu)", str, len);
-    return str;
+    return sink;
 }
 
-/* Parse a number using strtod */
-static double json_parse_number__(POSITION_INFO_DECLARATION, const char **s_ptr) {
-    raise_debug__(file, func, line, "Parsing number at position: %p", *s_ptr);
-    char *end;
-    double num = strtod(*s_ptr, &end);
-    if (*s_ptr == end)
-        raise_debug__(file, func, line, "No valid number found at: %p", *s_ptr);
-    *s_ptr = end;
-    raise_debug__(file, func, line, "Parsed number: %g", num);
-    return num;
+JsonSink json_sink_fd__(POSITION_INFO_DECLARATION, Arena *arena, int fd, size_t capacity) {
+    if (!capacity) capacity = 64 * MEM_KiB;
+    return (JsonSink){
+        .data = arena_alloc__(file, func, line, arena, capacity),
+        .cap = capacity,
+        .drain = json_sink_drain_fd,
+        .arena = arena,
+        .fd = fd,
+        .file = file,
+        .func = func,
+        .line = line,
+    };
 }
 
-/* Parse a JSON array: [ value, value, ... ] */
-static Json *json_parse_array__(POSITION_INFO_DECLARATION, const char **s, Arena *arena) {
-    raise_debug__(file, func, line, "Entering json_parse_array__ at position: %p", *s);
-    if (**s != '[') return NULL;
-    (*s)++; // skip '['
-    *s = skip_whitespace(*s);
-    Json *array = arena_alloc__(file, func, line, arena, sizeof(Json));
-    if (!array) {
-        raise_debug__(file, func, line, "Memory allocation failed in json_parse_array__");
-        return NULL;
-    }
-    memset(array, 0, sizeof(Json));
-    array->type = JSON_ARRAY;
-    Json *last = NULL;
-    if (**s == ']') { // empty array
-        (*s)++;
-        raise_debug__(file, func, line, "Parsed empty array");
-        return array;
-    }
-    while (**s) {
-        Json *element = json_parse_value__(file, func, line, s, arena);
-        if (!element) {
-            raise_debug__(file, func, line, "Failed to parse array element");
-            return NULL;
+void json_sink_write(JsonSink *sink, const char *data, size_t len) {
+    if (sink->failed) return;
+    if (sink->cap - sink->len < len) {
+        if (!sink->drain(sink, len)) {
+            sink->failed = true;
+            return;
         }
-        if (!array->value.child)
-            array->value.child = element;
-        else
-            last->next = element;
-        last = element;
-        *s = skip_whitespace(*s);
-        if (**s == ',') {
-            (*s)++;
-            *s = skip_whitespace(*s);
-        } else if (**s == ']') {
-            (*s)++;
-            raise_debug__(file, func, line, "Completed parsing array");
-            break;
-        } else {
-            raise_debug__(file, func, line, "Unexpected character '%c' in array", **s);
-            return NULL;
+        /* Drained sinks take oversized writes in pieces */
+        while (sink->cap - sink->len < len) {
+            size_t part = sink->cap - sink->len;
+            memcpy(sink->data + sink->len, data, part);
+            sink->len += part;
+            data += part;
+            len -= part;
+            if (!sink->drain(sink, len)) {
+                sink->failed = true;
+                return;
+            }
         }
     }
-    raise_debug__(file, func, line, "Completed parsing array");
-    return array;
+    memcpy(sink->data + sink->len, data, len);
+    sink->len += len;
 }
 
-/* Parse a JSON object: { "key": value, ... } */
-static Json *json_parse_object__(POSITION_INFO_DECLARATION, const char **s, Arena *arena) {
-    raise_debug__(file, func, line, "Entering json_parse_object__ at position: %p", *s);
-    if (**s != '{') return NULL;
-    (*s)++; // skip '{'
-    *s = skip_whitespace(*s);
-    Json *object = arena_alloc__(file, func, line, arena, sizeof(Json));
-    if (!object) {
-        raise_debug__(file, func, line, "Memory allocation failed in json_parse_object__");
-        return NULL;
-    }
-    memset(object, 0, sizeof(Json));
-    object->type = JSON_OBJECT;
-    Json *last = NULL;
-    if (**s == '}') {
-        (*s)++;
-        raise_debug__(file, func, line, "Parsed empty object");
-        return object;
-    }
-    while (**s) {
-        char *key = json_parse_string__(file, func, line, s, arena);
-        if (!key) {
-            raise_debug__(file, func, line, "Failed to parse key in object");
-            return NULL;
-        }
-        *s = skip_whitespace(*s);
-        if (**s != ':') {
-            raise_debug__(file, func, line, "Expected ':' after key \"%s\", got: %c", key, **s);
-            return NULL;
-        }
-        (*s)++; // skip ':'
-        *s = skip_whitespace(*s);
-        Json *value = json_parse_value__(file, func, line, s, arena);
-        if (!value) {
-            raise_debug__(file, func, line, "Failed to parse value for key \"%s\"", key);
-            return NULL;
-        }
-        value->key = key; // assign key to the value
-        if (!object->value.child)
-            object->value.child = value;
-        else
-            last->next = value;
-        last = value;
-        *s = skip_whitespace(*s);
-        if (**s == ',') {
-            (*s)++;
-            *s = skip_whitespace(*s);
-        } else if (**s == '}') {
-            (*s)++;
-            break;
-        } else {
-            raise_debug__(file, func, line, "Unexpected character '%c' in object", **s);
-            return NULL;
+void json_sink_putc(JsonSink *sink, char c) {
+    if (sink->len == sink->cap) json_sink_write(sink, &c, 1);
+    else if (!sink->failed) sink->data[sink->len++] = c;
+}
+
+bool json_sink_flush(JsonSink *sink) {
+    if (!sink->failed && sink->fd >= 0 && sink->len && !sink->drain(sink, 0)) sink->failed = true;
+    return !sink->failed;
+}
+
+char *json_sink_cstr(JsonSink *sink) {
+    json_sink_putc(sink, '\0');
+    if (sink->failed) return NULL;
+    sink->len--;
+    return sink->data;
+}
+
+#define JSON_SINK_LITERAL(sink, literal) json_sink_write(sink, literal, sizeof(literal) - 1)
+
+/* Quoted string; escape-free runs are written in one piece */
+static void json_sink_chars(JsonSink *sink, const char *s, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+    const char *end = s + len;
+    json_sink_putc(sink, '"');
+    const char *run = s;
+    for (; s < end; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        json_sink_write(sink, run, (size_t)(s - run));
+        switch (c) {
+            case '"':  JSON_SINK_LITERAL(sink, "\\\""); break;
+            case '\\': JSON_SINK_LITERAL(sink, "\\\\"); break;
+            case '\b': JSON_SINK_LITERAL(sink, "\\b"); break;
+            case '\f': JSON_SINK_LITERAL(sink, "\\f"); break;
+            case '\n': JSON_SINK_LITERAL(sink, "\\n"); break;
+            case '\r': JSON_SINK_LITERAL(sink, "\\r"); break;
+            case '\t': JSON_SINK_LITERAL(sink, "\\t"); break;
+            default: {
+                char escape[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+                json_sink_write(sink, escape, sizeof(escape));
+            }
         }
+        run = s + 1;
     }
-    raise_debug__(file, func, line, "Completed parsing object");
-    return object;
+    json_sink_write(sink, run, (size_t)(s - run));
+    json_sink_putc(sink, '"');
 }
 
-/* Full JSON value parser */
-static Json *json_parse_value__(POSITION_INFO_DECLARATION, const char **s, Arena *arena) {
-    *s = skip_whitespace(*s);
-    raise_debug__(file, func, line, "Parsing JSON value at position: %p", *s);
-    if (**s == '"') {
-        Json *item = arena_alloc__(file, func, line, arena, sizeof(Json));
-        if (!item) {
-            raise_debug__(file, func, line, "Memory allocation failed in json_parse_value for string");
-            return NULL;
-        }
-        memset(item, 0, sizeof(Json));
-        item->type = JSON_STRING;
-        item->value.string = json_parse_string__(file, func, line, s, arena);
-        return item;
-    } else if (strncmp(*s, "null", 4) == 0) {
-        Json *item = arena_alloc__(file, func, line, arena, sizeof(Json));
-        if (!item) return NULL;
-        memset(item, 0, sizeof(Json));
-        item->type = JSON_NULL;
-        *s += 4;
-        return item;
-    } else if (strncmp(*s, "true", 4) == 0) {
-        Json *item = arena_alloc__(file, func, line, arena, sizeof(Json));
-        if (!item) return NULL;
-        memset(item, 0, sizeof(Json));
-        item->type = JSON_BOOL;
-        item->value.boolean = 1;
-        *s += 4;
-        return item;
-    } else if (strncmp(*s, "false", 5) == 0) {
-        Json *item = arena_alloc__(file, func, line, arena, sizeof(Json));
-        if (!item) return NULL;
-        memset(item, 0, sizeof(Json));
-        item->type = JSON_BOOL;
-        item->value.boolean = 0;
-        *s += 5;
-        return item;
-    } else if ((**s == '-') || isdigit((unsigned char)**s)) {
-        Json *item = arena_alloc__(file, func, line, arena, sizeof(Json));
-        if (!item) {
-            raise_debug__(file, func, line, "Memory allocation failed in json_parse_value for number");
-            return NULL;
-        }
-        memset(item, 0, sizeof(Json));
-        item->type = JSON_NUMBER;
-        item->value.number = json_parse_number__(file, func, line, s);
-        return item;
-    } else if (**s == '[') {
-        return json_parse_array__(file, func, line, s, arena);
-    } else if (**s == '{') {
-        return json_parse_object__(file, func, line, s, arena);
-    }
-    raise_debug__(file, func, line, "Unrecognized JSON value at position: %p", *s);
-    return NULL;
+void json_sink_string(JsonSink *sink, const char *s) {
+    json_sink_chars(sink, s, strlen(s));
 }
 
-// FIXME(yukkop): **s changes in the function. Need to fix.
-Json *json_parse__(POSITION_INFO_DECLARATION, Arena *arena, const char **s) {
-    // Function entry logging with DEBUG level
-    raise_debug__(file, func, line, 
-        "PARSE: Starting JSON parsing (input: %p)", *s);
-    
-    // Check input parameters
-    if (!s || !*s) {
-        raise_exception__(file, func, line,
-            "PARSE: Invalid input parameters (NULL pointer provided for JSON parsing)");
-        return NULL;
+void json_sink_number(JsonSink *sink, double value) {
+    char buffer[JSON_NUMBER_MAX_LEN];
+    // NaN and infinities have no JSON representation
+    if (value != value || value - value != 0) {
+        JSON_SINK_LITERAL(sink, "null");
+        return;
     }
-    
-    if (!arena) {
-        raise_exception__(file, func, line,
-            "PARSE: Invalid arena (NULL) provided for JSON parsing");
-        return NULL;
+    json_sink_write(sink, buffer, json_number_to_str(value, buffer));
+}
+
+void json_sink_integer(JsonSink *sink, int64_t value) {
+    char buffer[24];
+    char *p = buffer + sizeof(buffer);
+    // Negate through unsigned so INT64_MIN does not overflow
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    do {
+        *--p = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0) *--p = '-';
+    json_sink_write(sink, p, (size_t)(buffer + sizeof(buffer) - p));
+}
+
+static void json_sink_indent(JsonSink *sink, int spaces) {
+    static const char blanks[] = "                                ";
+    while (spaces > 0) {
+        int n = spaces < (int)sizeof(blanks) - 1 ? spaces : (int)sizeof(blanks) - 1;
+        json_sink_write(sink, blanks, (size_t)n);
+        spaces -= n;
     }
-    
-    // Show input preview for debugging with TRACE level
-    raise_trace__(file, func, line,
-        "PARSE: Input preview: '%.20s%s'", *s, strlen(*s) > 20 ? "..." : "");
-    
-    // Process JSON value
-    Json *result = json_parse_value__(file, func, line, s, arena);
-    
-    // Log parsing result
-    if (!result) {
-        raise_warn__(file, func, line, 
-            "PARSE: Failed to parse JSON at position %p (context: '%.10s')", 
-            *s, *s && strlen(*s) > 0 ? *s : "<empty>");
-    } else {
-        raise_log__(file, func, line, 
-            "PARSE: JSON parsing completed successfully (type: %s)", json_type_to_string(result->type));
+}
+
+static inline Json *json_child__(POSITION_INFO_DECLARATION, const Json *container);
+#define json_child(container) json_child__(__FILE__, __func__, __LINE__, container)
+static const char *json_string_bytes(const Json *item, size_t *len, char **temp);
+
+/*
+ * Canonical form (RFC 8785). Members are ordered by their keys' UTF-16
+ * code units, duplicates keep their order; numbers are written as the
+ * shortest text of the double they stand for, so 1, 1.0 and 1e0 agree.
+ */
+
+/* UTF-8 byte order is code point order, except that UTF-16 puts surrogate pairs (leads F0-F4) before U+E000-U+FFFF (leads EE, EF) */
+static int json_key_compare(const char *a, const char *b) {
+    const unsigned char *x = (const unsigned char *)a, *y = (const unsigned char *)b;
+    while (*x && *x == *y) {
+        x++;
+        y++;
     }
-    
-    return result;
+    if (*x >= 0xEE && *y >= 0xEE && (*x >= 0xF0) != (*y >= 0xF0)) return *x >= 0xF0 ? -1 : 1;
+    return (int)*x - (int)*y;
 }
 
-char *json_to_str__(POSITION_INFO_DECLARATION, Arena *arena, const Json * const item) {
-    return json_to_str_with_opts__(file, func, line, arena, item, JSON_NORAW);
+typedef struct {
+    const Json *item;
+    size_t order;
+} JsonMember;
+
+static int json_member_compare(const void *a, const void *b) {
+    const JsonMember *x = a, *y = b;
+    int order = json_key_compare(x->item->key ? x->item->key : "", y->item->key ? y->item->key : "");
+    if (order) return order;
+    return x->order < y->order ? -1 : x->order > y->order;
 }
 
-/* Minimal JSON printer with raw output option.
-   When raw is non-zero and the item is a JSON_STRING, it is printed without quotes.
-*/
+/* Members of object in canonical order, NULL when out of memory; release with arena_memory_free */
+static JsonMember *json_sorted_members(const Json *object, size_t *count) {
+    size_t n = 0;
+    for (const Json *child = json_child(object); child; child = child->next) n++;
+    JsonMember *members = arena_memory_alloc((n ? n : 1) * sizeof(JsonMember));
+    if (!members) return NULL;
+    n = 0;
+    for (const Json *child = json_child(object); child; child = child->next, n++) {
+        members[n] = (JsonMember){ .item = child, .order = n };
+    }
+    qsort(members, n, sizeof(JsonMember), json_member_compare);
+    *count = n;
+    return members;
+}
+
+/* The double a number stands for; false for NaN and infinities, which are written as null */
+static bool json_canonical_number(const Json *item, double *out) {
+    switch (item->type) {
+        case JSON_NUMBER: *out = item->value.number; break;
+        case JSON_INTEGER: *out = (double)item->value.integer; break;
+        case JSON_RAW_NUMBER: {
+            const char *text = item->value.string ? item->value.string : "0";
+            *out = json_strtod_c(text, text + strlen(text));
+            break;
+        }
+        default: return false;
+    }
+    if (*out != *out || *out - *out != 0) return false;
+    if (*out == 0) *out = 0;  // no -0
+    return true;
+}
+
+/*
+ * A number as hashed and compared: integral values in the int64 range
+ * exactly, taken from the integer itself where the node has one, anything
+ * else as its double. The canonical double alone would merge ids above
+ * 2^53. False for NaN and infinities.
+ */
+typedef struct {
+    bool integral;
+    int64_t integer;
+    double number;
+} JsonExactNumber;
+
+static bool json_exact_number(const Json *item, JsonExactNumber *out) {
+    int64_t integer;
+    if (item->type == JSON_INTEGER
+        || (item->type == JSON_RAW_NUMBER && item->value.string
+            && view_parse_int64(string_to_view(item->value.string), &integer))) {
+        *out = (JsonExactNumber){ .integral = true, .integer = item->type == JSON_INTEGER ? item->value.integer : integer };
+        return true;
+    }
+    double number;
+    if (!json_canonical_number(item, &number)) return false;
+    if (number >= -9223372036854775808.0 && number < 9223372036854775808.0 && (double)(int64_t)number == number) {
+        *out = (JsonExactNumber){ .integral = true, .integer = (int64_t)number };
+    } else {
+        *out = (JsonExactNumber){ .integral = false, .number = number };
+    }
+    return true;
+}
+
+static void json_write_value(JsonSink *sink, const Json *item, const JsonWriteOptions *opts, int level);
+
+static void json_write_canonical_object(JsonSink *sink, const Json *object, const JsonWriteOptions *opts, int level) {
+    size_t count = 0;
+    JsonMember *members = json_sorted_members(object, &count);
+    if (!members) {
+        sink->failed = true;
+        return;
+    }
+    json_sink_putc(sink, '{');
+    for (size_t i = 0; i < count; i++) {
+        if (i) json_sink_putc(sink, ',');
+        json_sink_string(sink, members[i].item->key ? members[i].item->key : "");
+        json_sink_putc(sink, ':');
+        json_write_value(sink, members[i].item, opts, level + 1);
+    }
+    json_sink_putc(sink, '}');
+    arena_memory_free(members);
+}
+
+static void json_write_value(JsonSink *sink, const Json *item, const JsonWriteOptions *opts, int level) {
+    if (opts->canonical) {
+        double number;
+        if (item->type == JSON_OBJECT) {
+            json_write_canonical_object(sink, item, opts, level);
+            return;
+        }
+        if (item->type == JSON_NUMBER || item->type == JSON_INTEGER || item->type == JSON_RAW_NUMBER) {
+            JsonExactNumber exact;
+            if (opts->exact_integers && json_exact_number(item, &exact) && exact.integral) json_sink_integer(sink, exact.integer);
+            else if (json_canonical_number(item, &number)) json_sink_number(sink, number);
+            else JSON_SINK_LITERAL(sink, "null");
+            return;
+        }
+    }
+    switch (item->type) {
+        case JSON_OBJECT:
+        case JSON_ARRAY: {
+            bool object = item->type == JSON_OBJECT;
+            json_sink_putc(sink, object ? '{' : '[');
+            if (opts->indent) json_sink_putc(sink, '\n');
+            for (const Json *child = json_child(item); child; child = child->next) {
+                json_sink_indent(sink, opts->indent * (level + 1));
+                if (object) {
+                    json_sink_string(sink, child->key ? child->key : "");
+                    if (opts->indent) JSON_SINK_LITERAL(sink, ": ");
+                    else json_sink_putc(sink, ':');
+                }
+                json_write_value(sink, child, opts, level + 1);
+                if (child->next) json_sink_putc(sink, ',');
+                if (opts->indent) json_sink_putc(sink, '\n');
+            }
+            json_sink_indent(sink, opts->indent * level);
+            json_sink_putc(sink, object ? '}' : ']');
+            break;
+        }
+        case JSON_STRING: {
+            char *temp;
+            size_t len;
+            const char *text = json_string_bytes(item, &len, &temp);
+            if (opts->raw) json_sink_write(sink, text, len);
+            else json_sink_chars(sink, text, len);
+            arena_memory_free(temp);
+            break;
+        }
+        case JSON_NUMBER:
+            json_sink_number(sink, item->value.number);
+            break;
+        case JSON_INTEGER:
+            json_sink_integer(sink, item->value.integer);
+            break;
+        case JSON_RAW_NUMBER:
+            if (item->value.string) json_sink_write(sink, item->value.string, strlen(item->value.string));
+            break;
+        case JSON_BOOL:
+            if (item->value.boolean) JSON_SINK_LITERAL(sink, "true");
+            else JSON_SINK_LITERAL(sink, "false");
+            break;
+        case JSON_NULL:
+            JSON_SINK_LITERAL(sink, "null");
+            break;
+    }
+}
+
+bool json_write__(POSITION_INFO_DECLARATION, JsonSink *sink, const Json *item, const JsonWriteOptions *opts) {
+    static const JsonWriteOptions defaults = {0};
+    static const JsonWriteOptions canonical = { .canonical = true };
+    static const JsonWriteOptions canonical_exact = { .canonical = true, .exact_integers = true };
+    if (!sink || !item) {
+        raise_exception__(file, func, line,
+                     "FORMAT: Invalid arguments (sink: %p, item: %p)", sink, item);
+        return false;
+    }
+    if (!opts) opts = &defaults;
+    else if (opts->canonical) opts = opts->exact_integers ? &canonical_exact : &canonical;  // no indent, strings always quoted
+    json_write_value(sink, item, opts, 0);
+    if (sink->failed) {
+        raise_warn__(file, func, line, "FORMAT: Failed to write JSON %s to sink", json_type_to_string(item->type));
+    }
+    return !sink->failed;
+}
+
+/*
+ * Writer. Only the innermost level's state is needed: a container that
+ * just closed is by definition not the first value of its parent. Layout
+ * matches json_write, so a tree and the same calls give the same text.
+ */
+
+JsonWriter json_writer(JsonSink *sink, int indent) {
+    return (JsonWriter){ .sink = sink, .indent = indent, .first = true };
+}
+
+/* Separator, newline and indentation before a value or key */
+static void json_writer_element(JsonWriter *writer) {
+    if (writer->after_key) {
+        writer->after_key = false;
+        return;
+    }
+    if (writer->level == 0) return;
+    if (!writer->first) json_sink_putc(writer->sink, ',');
+    if (writer->indent) {
+        if (!writer->first) json_sink_putc(writer->sink, '\n');
+        json_sink_indent(writer->sink, writer->indent * writer->level);
+    }
+    writer->first = false;
+}
+
+static void json_writer_open(JsonWriter *writer, char open) {
+    json_writer_element(writer);
+    json_sink_putc(writer->sink, open);
+    if (writer->indent) json_sink_putc(writer->sink, '\n');
+    writer->level++;
+    writer->first = true;
+}
+
+static void json_writer_close(JsonWriter *writer, char close) {
+    writer->level--;
+    if (writer->indent) {
+        if (!writer->first) json_sink_putc(writer->sink, '\n');
+        json_sink_indent(writer->sink, writer->indent * writer->level);
+    }
+    json_sink_putc(writer->sink, close);
+    writer->first = false;
+}
+
+void json_writer_begin_object(JsonWriter *writer) {
+    json_writer_open(writer, '{');
+}
+
+void json_writer_end_object(JsonWriter *writer) {
+    json_writer_close(writer, '}');
+}
+
+void json_writer_begin_array(JsonWriter *writer) {
+    json_writer_open(writer, '[');
+}
+
+void json_writer_end_array(JsonWriter *writer) {
+    json_writer_close(writer, ']');
+}
+
+void json_writer_key(JsonWriter *writer, const char *key) {
+    json_writer_element(writer);
+    json_sink_string(writer->sink, key ? key : "");
+    if (writer->indent) JSON_SINK_LITERAL(writer->sink, ": ");
+    else json_sink_putc(writer->sink, ':');
+    writer->after_key = true;
+}
+
+void json_writer_string(JsonWriter *writer, const char *value) {
+    json_writer_element(writer);
+    if (value) json_sink_string(writer->sink, value);
+    else JSON_SINK_LITERAL(writer->sink, "null");
+}
+
+void json_writer_string_len(JsonWriter *writer, const char *value, size_t len) {
+    json_writer_element(writer);
+    json_sink_chars(writer->sink, value, len);
+}
+
+void json_writer_integer(JsonWriter *writer, int64_t value) {
+    json_writer_element(writer);
+    json_sink_integer(writer->sink, value);
+}
+
+void json_writer_number(JsonWriter *writer, double value) {
+    json_writer_element(writer);
+    json_sink_number(writer->sink, value);
+}
+
+void json_writer_bool(JsonWriter *writer, bool value) {
+    json_writer_element(writer);
+    if (value) JSON_SINK_LITERAL(writer->sink, "true");
+    else JSON_SINK_LITERAL(writer->sink, "false");
+}
+
+void json_writer_null(JsonWriter *writer) {
+    json_writer_element(writer);
+    JSON_SINK_LITERAL(writer->sink, "null");
+}
+
+void json_writer_value(JsonWriter *writer, const Json *item) {
+    if (!item) {
+        json_writer_null(writer);
+        return;
+    }
+    const JsonWriteOptions opts = { .indent = writer->indent };
+    json_writer_element(writer);
+    json_write_value(writer->sink, item, &opts, writer->level);
+}
+
+static char *json_to_str_internal__(POSITION_INFO_DECLARATION, Arena *arena, const Json * const item,
+                                    const JsonWriteOptions *opts, int level) {
+    if (!item) {
+        raise_exception__(file, func, line,
+                     "FORMAT: Invalid JSON object (NULL) provided for string conversion");
+        return NULL;
+    }
+
+    if (!arena) {
+        raise_exception__(file, func, line,
+                     "FORMAT: Invalid arena (NULL) provided for string conversion");
+        return NULL;
+    }
+
+    JsonSink sink = json_sink_buffer__(file, func, line, arena, 0);
+    json_write_value(&sink, item, opts, level);
+    char *out = json_sink_cstr(&sink);
+    if (!out) {
+        raise_exception__(file, func, line,
+                     "FORMAT: Memory allocation failed during JSON string conversion");
+        return NULL;
+    }
+
+    raise_log__(file, func, line,
+                  "FORMAT: JSON %s converted to string (length=%zu)",
+                  json_type_to_string(item->type), sink.len);
+    return out;
+}
+
+char *json_to_pretty_str__(POSITION_INFO_DECLARATION, Arena *arena, const Json * const item, int indent_level) {
+    const JsonWriteOptions opts = { .indent = 2 };
+    return json_to_str_internal__(file, func, line, arena, item, &opts, indent_level);
+}
+
+/*
+ * Structural hash: the canonical form is written into a small buffer
+ * sink whose drain folds whole 64-bit words into the state (xxHash64
+ * rounds) and keeps the tail for the next fill, so no text is kept.
+ */
+
+#define JSON_HASH_PRIME1 0x9E3779B185EBCA87ULL
+#define JSON_HASH_PRIME2 0xC2B2AE3D27D4EB4FULL
+#define JSON_HASH_PRIME3 0x165667B19E3779F9ULL
+
+typedef struct {
+    uint64_t state;
+    uint64_t total;
+} JsonHashState;
+
+static uint64_t json_hash_round(uint64_t state, uint64_t word) {
+    state += word * JSON_HASH_PRIME2;
+    state = (state << 31) | (state >> 33);
+    return state * JSON_HASH_PRIME1;
+}
+
+static bool json_sink_drain_hash(JsonSink *sink, size_t need) {
+    JsonHashState *hash = sink->ctx;
+    size_t words = sink->len / 8;
+    for (size_t i = 0; i < words; i++) {
+        uint64_t word;
+        memcpy(&word, sink->data + i * 8, sizeof(word));
+        hash->state = json_hash_round(hash->state, word);
+    }
+    hash->total += words * 8;
+    sink->len -= words * 8;
+    memmove(sink->data, sink->data + words * 8, sink->len);
+    (void)need;
+    return true;
+}
+
+uint64_t json_hash__(POSITION_INFO_DECLARATION, const Json *item) {
+    char buffer[256];
+    JsonHashState hash = { .state = JSON_HASH_PRIME3 };
+    JsonSink sink = { .data = buffer, .cap = sizeof(buffer), .drain = json_sink_drain_hash, .fd = -1, .ctx = &hash };
+    static const JsonWriteOptions canonical = { .canonical = true, .exact_integers = true };
+    if (!item) {
+        raise_exception__(file, func, line, "FORMAT: Invalid JSON object (NULL) provided for hashing");
+        return 0;
+    }
+
+    json_write_value(&sink, item, &canonical, 0);
+    if (sink.failed) raise_warn__(file, func, line, "FORMAT: Out of memory while hashing JSON %s", json_type_to_string(item->type));
+    json_sink_drain_hash(&sink, 0);
+    uint64_t tail = 0;
+    memcpy(&tail, buffer, sink.len);
+    uint64_t h = json_hash_round(hash.state, tail) ^ (hash.total + sink.len);
+    h ^= h >> 33;
+    h *= JSON_HASH_PRIME2;
+    h ^= h >> 29;
+    h *= JSON_HASH_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+/* Same form as the hash; false as soon as one difference shows */
+static bool json_equal_value(const Json *a, const Json *b) {
+    JsonExactNumber x, y;
+    bool a_number = json_exact_number(a, &x), b_number = json_exact_number(b, &y);
+    if (a_number || b_number) {
+        return a_number && b_number && x.integral == y.integral
+            && (x.integral ? x.integer == y.integer : x.number == y.number);
+    }
+    // NaN and infinities are null in canonical form
+    JsonType a_type = a->type == JSON_NUMBER || a->type == JSON_INTEGER || a->type == JSON_RAW_NUMBER ? JSON_NULL : a->type;
+    JsonType b_type = b->type == JSON_NUMBER || b->type == JSON_INTEGER || b->type == JSON_RAW_NUMBER ? JSON_NULL : b->type;
+    if (a_type != b_type) return false;
+
+    switch (a_type) {
+        case JSON_NULL:
+            return true;
+        case JSON_BOOL:
+            return !a->value.boolean == !b->value.boolean;
+        case JSON_STRING: {
+            char *a_temp, *b_temp;
+            size_t a_len, b_len;
+            const char *a_text = json_string_bytes(a, &a_len, &a_temp);
+            const char *b_text = json_string_bytes(b, &b_len, &b_temp);
+            bool equal = a_len == b_len && memcmp(a_text, b_text, a_len) == 0;
+            arena_memory_free(a_temp);
+            arena_memory_free(b_temp);
+            return equal;
+        }
+        case JSON_ARRAY: {
+            const Json *p = json_child(a), *q = json_child(b);
+            for (; p && q; p = p->next, q = q->next) {
+                if (!json_equal_value(p, q)) return false;
+            }
+            return !p && !q;
+        }
+        case JSON_OBJECT: {
+            size_t a_count = 0, b_count = 0;
+            JsonMember *a_members = json_sorted_members(a, &a_count);
+            JsonMember *b_members = a_members ? json_sorted_members(b, &b_count) : NULL;
+            bool equal = b_members && a_count == b_count;
+            for (size_t i = 0; equal && i < a_count; i++) {
+                const Json *p = a_members[i].item, *q = b_members[i].item;
+                equal = strcmp(p->key ? p->key : "", q->key ? q->key : "") == 0 && json_equal_value(p, q);
+            }
+            arena_memory_free(a_members);
+            arena_memory_free(b_members);
+            return equal;
+        }
+        default:
+            return false;
+    }
+}
+
+bool json_equal__(POSITION_INFO_DECLARATION, const Json *a, const Json *b) {
+    if (!a || !b) return a == b;
+    if (a == b) return true;
+    if (json_hash__(file, func, line, a) != json_hash__(file, func, line, b)) {
+        raise_trace__(file, func, line, "FORMAT: JSON %s and %s differ by hash",
+                      json_type_to_string(a->type), json_type_to_string(b->type));
+        return false;
+    }
+    return json_equal_value(a, b);
+}
+
+const char* json_type_to_string(JsonType type) {
+    switch (type) {
+        case JSON_NULL: return "NULL";
+        case JSON_BOOL: return "BOOL";
+        case JSON_NUMBER: return "NUMBER";
+        case JSON_STRING: return "STRING";
+        case JSON_ARRAY: return "ARRAY";
+        case JSON_OBJECT: return "OBJECT";
+        case JSON_INTEGER: return "INTEGER";
+        case JSON_RAW_NUMBER: return "RAW_NUMBER";
+        default: return "UNKNOWN";
+    }
+}
+
+/*
+ * Object key tables. Open addressing with linear probing over child
+ * pointers; the table is sized to at most half full. A lazy index is only
+ * the header with the arena to build in, slots stay NULL until the first
+ * lookup needs them.
+ */
+struct JsonObjectIndex {
+    Arena *arena;
+    size_t mask;     /* Slot count - 1, slot count is a power of two */
+    Json **slots;    /* NULL until built */
+    bool failed;     /* No room for the table, lookups walk the list */
+    const char *lazy;                /* Lazy parse: source of a container whose children are not parsed yet */
+    const JsonParseOptions *opts;    /* Lazy parse: options for that later parse */
+};
+
+static void json_lazy_expand__(POSITION_INFO_DECLARATION, Json *container);
+
+/* First child of an array or object, parsing the children now if the parse was lazy */
+static inline Json *json_child__(POSITION_INFO_DECLARATION, const Json *container) {
+    if (container->index && container->index->lazy) {
+        json_lazy_expand__(file, func, line, (Json *)container);
+    }
+    return container->value.child;
+}
+
+Json *json_children__(POSITION_INFO_DECLARATION, const Json *container) {
+    if (!container || (container->type != JSON_ARRAY && container->type != JSON_OBJECT)) return NULL;
+    return json_child__(file, func, line, container);
+}
+
+static uint64_t json_key_hash(const char *key) {
+    uint64_t hash = 0xcbf29ce484222325ULL;  // FNV-1a
+    for (; *key; key++) {
+        hash ^= (unsigned char)*key;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static void json_object_index_fill(Json **slots, size_t mask, Json *child) {
+    for (; child; child = child->next) {
+        if (!child->key) continue;
+        size_t slot = (size_t)json_key_hash(child->key) & mask;
+        // Keep the first of duplicate keys, as the linear search does
+        while (slots[slot] && strcmp(slots[slot]->key, child->key) != 0) slot = (slot + 1) & mask;
+        if (!slots[slot]) slots[slot] = child;
+    }
+}
+
+static bool json_object_index_build(POSITION_INFO_DECLARATION, JsonObjectIndex *index, const Json *object) {
+    size_t count = 0;
+    for (const Json *child = json_child__(file, func, line, object); child; child = child->next) count++;
+
+    size_t capacity = 8;
+    while (capacity < count * 2) capacity *= 2;
+    Json **slots = arena_alloc_or_null__(file, func, line, index->arena, capacity * sizeof(Json *), false);
+    if (!slots) {
+        index->failed = true;
+        return false;
+    }
+    memset(slots, 0, capacity * sizeof(Json *));
+
+    size_t mask = capacity - 1;
+    json_object_index_fill(slots, mask, object->value.child);
+    index->mask = mask;
+    index->slots = slots;
+    raise_trace__(file, func, line, "ACCESS: Indexed %zu keys of object %p in %zu slots", count, object, capacity);
+    return true;
+}
+
+bool json_object_index__(POSITION_INFO_DECLARATION, Arena *arena, Json *object) {
+    if (!arena || !object || object->type != JSON_OBJECT) {
+        raise_warn__(file, func, line, "ACCESS: json_object_index needs an arena and an object");
+        return false;
+    }
+    json_child__(file, func, line, object);
+    JsonObjectIndex *index = arena_alloc_or_null__(file, func, line, arena, sizeof(JsonObjectIndex), false);
+    if (!index) return false;
+    *index = (JsonObjectIndex){ .arena = arena };
+    if (!json_object_index_build(file, func, line, index, object)) return false;
+    object->index = index;
+    return true;
+}
+
+void json_object_unindex(Json *object) {
+    if (object && object->index && !object->index->lazy) object->index = NULL;
+}
+
+/* Does the writes a later read of node would do */
+static bool json_settle_node(POSITION_INFO_DECLARATION, Json *node) {
+    if (node->type != JSON_ARRAY && node->type != JSON_OBJECT) return true;
+    json_child__(file, func, line, node);
+    JsonObjectIndex *index = node->index;
+    if (node->type != JSON_OBJECT || !index || index->slots || index->failed) return true;
+    return json_object_index_build(file, func, line, index, node);
+}
+
+bool json_settle__(POSITION_INFO_DECLARATION, Json *item) {
+    if (!item) return true;
+    bool ok = json_settle_node(file, func, line, item);
+
+    // One cursor per level, at the next sibling to settle, so deep trees do not recurse
+    Json **stack = NULL;
+    size_t depth = 0, capacity = 0;
+    Json *first = item->type == JSON_ARRAY || item->type == JSON_OBJECT ? item->value.child : NULL;
+    if (first) {
+        capacity = 16;
+        stack = arena_memory_alloc(capacity * sizeof(Json *));
+        if (!stack) {
+            raise_exception__(file, func, line, "ACCESS: Out of memory settling %p", item);
+            return false;
+        }
+        stack[depth++] = first;
+    }
+    while (depth) {
+        Json *node = stack[depth - 1];
+        if (!node) {
+            depth--;
+            continue;
+        }
+        stack[depth - 1] = node->next;
+        ok = json_settle_node(file, func, line, node) && ok;
+        Json *child = node->type == JSON_ARRAY || node->type == JSON_OBJECT ? node->value.child : NULL;
+        if (!child) continue;
+        if (depth == capacity) {
+            Json **grown = arena_memory_alloc(capacity * 2 * sizeof(Json *));
+            if (!grown) {
+                raise_exception__(file, func, line, "ACCESS: Out of memory settling %p", item);
+                arena_memory_free(stack);
+                return false;
+            }
+            memcpy(grown, stack, depth * sizeof(Json *));
+            arena_memory_free(stack);
+            stack = grown;
+            capacity *= 2;
+        }
+        stack[depth++] = child;
+    }
+    if (stack) arena_memory_free(stack);
+    raise_trace__(file, func, line, "ACCESS: Settled %p", item);
+    return ok;
+}
+
+/* Called by the parsers once an object is complete, with its key count */
+static void json_object_index_parsed__(POSITION_INFO_DECLARATION, Arena *arena, Json *object,
+                                       size_t keys, const JsonParseOptions *opts) {
+    size_t threshold = opts->index_threshold ? opts->index_threshold : JSON_INDEX_THRESHOLD_DEFAULT;
+    if (opts->index == JSON_INDEX_NONE || keys < threshold) return;
+    if (opts->index == JSON_INDEX_EAGER) {
+        json_object_index__(file, func, line, arena, object);
+        return;
+    }
+    JsonObjectIndex *index = arena_alloc_or_null__(file, func, line, arena, sizeof(JsonObjectIndex), false);
+    if (!index) return;
+    *index = (JsonObjectIndex){ .arena = arena };
+    object->index = index;
+}
+
+/* Look key up in the table; false means the table is unusable and the caller should walk */
+static bool json_object_index_find(POSITION_INFO_DECLARATION, const Json *object, const char *key, Json **found) {
+    JsonObjectIndex *index = object->index;
+    if (index->failed) return false;
+    if (!index->slots && !json_object_index_build(file, func, line, index, object)) return false;
+    size_t slot = (size_t)json_key_hash(key) & index->mask;
+    while (index->slots[slot] && strcmp(index->slots[slot]->key, key) != 0) slot = (slot + 1) & index->mask;
+    *found = index->slots[slot];
+    return true;
+}
+
+/*
+ * String scanning, shared by both engines. The closing quote and any
+ * backslash are found 16 or 32 bytes at a time. An escape-free body is
+ * validated and copied with a single memcpy; a body with escapes is decoded
+ * into a buffer of its raw length, which decoding never exceeds.
+ */
+
+static const char *json_find_special_scalar(const char *p) {
+    while (*p && *p != '"' && *p != '\\') p++;
+    return p;
+}
+
+#ifdef HECTIC_SIMD_X86
+/*
+ * The end of input is only known by its NUL, so loads are aligned: they
+ * never cross a page boundary, but may read past the terminator, which is
+ * why ASan must not instrument them.
+ */
+__attribute__((target("sse2"), no_sanitize_address))
+static const char *json_find_special_sse2(const char *p) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i zero = _mm_setzero_si128();
+    const char *block = (const char *)((uintptr_t)p & ~(uintptr_t)15);
+    unsigned int skip = (unsigned int)(p - block);
+    for (;;) {
+        __m128i v = _mm_load_si128((const __m128i *)(const void *)block);
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                       _mm_cmpeq_epi8(v, zero));
+        unsigned int mask = ((unsigned int)_mm_movemask_epi8(special) >> skip) << skip;
+        if (mask) return block + __builtin_ctz(mask);
+        block += 16;
+        skip = 0;
+    }
+}
+
+__attribute__((target("avx2"), no_sanitize_address))
+static const char *json_find_special_avx2(const char *p) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i zero = _mm256_setzero_si256();
+    const char *block = (const char *)((uintptr_t)p & ~(uintptr_t)31);
+    unsigned int skip = (unsigned int)(p - block);
+    for (;;) {
+        __m256i v = _mm256_load_si256((const __m256i *)(const void *)block);
+        __m256i special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+                                          _mm256_cmpeq_epi8(v, zero));
+        uint64_t mask = ((uint64_t)(uint32_t)_mm256_movemask_epi8(special) >> skip) << skip;
+        if (mask) return block + __builtin_ctzll(mask);
+        block += 32;
+        skip = 0;
+    }
+}
+
+/* Length of the leading ASCII run; the length is known, so plain unaligned loads */
+__attribute__((target("sse2")))
+static size_t json_ascii_prefix_sse2(const unsigned char *p, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(const void *)(p + i)));
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+    while (i < len && p[i] < 0x80) i++;
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t json_ascii_prefix_avx2(const unsigned char *p, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)(const void *)(p + i)));
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+    while (i < len && p[i] < 0x80) i++;
+    return i;
+}
+#endif
+
+static size_t json_ascii_prefix_scalar(const unsigned char *p, size_t len) {
+    size_t i = 0;
+    while (i < len && p[i] < 0x80) i++;
+    return i;
+}
+
+/* First '"', '\\' or NUL at or after p */
+static const char *json_find_special(const char *p) {
+    switch (simd_level()) {
+#ifdef HECTIC_SIMD_X86
+        case SIMD_LEVEL_AVX2: return json_find_special_avx2(p);
+        case SIMD_LEVEL_SSE2: return json_find_special_sse2(p);
+#endif
+        default: return json_find_special_scalar(p);
+    }
+}
+
+/*
+ * UTF-8 validation: ASCII runs are skipped with vector loads, multi-byte
+ * sequences are checked against the well-formed ranges of Unicode table 3-7
+ * (no overlongs, no surrogates, nothing above U+10FFFF).
+ */
+static bool json_utf8_valid(const char *s, size_t len) {
+    const unsigned char *p = (const unsigned char *)s;
+    size_t i = 0;
+    SimdLevel level = simd_level();
+    while (i < len) {
+#ifdef HECTIC_SIMD_X86
+        if (level == SIMD_LEVEL_AVX2) i += json_ascii_prefix_avx2(p + i, len - i);
+        else if (level == SIMD_LEVEL_SSE2) i += json_ascii_prefix_sse2(p + i, len - i);
+        else
+#endif
+        i += json_ascii_prefix_scalar(p + i, len - i);
+        if (i >= len) break;
+
+        unsigned char c = p[i];
+        unsigned char low = 0x80, high = 0xBF;
+        size_t continuation;
+        if (c >= 0xC2 && c <= 0xDF) continuation = 1;
+        else if (c >= 0xE0 && c <= 0xEF) {
+            continuation = 2;
+            if (c == 0xE0) low = 0xA0;
+            if (c == 0xED) high = 0x9F;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            continuation = 3;
+            if (c == 0xF0) low = 0x90;
+            if (c == 0xF4) high = 0x8F;
+        } else return false;
+
+        if (len - i <= continuation) return false;
+        if (p[i + 1] < low || p[i + 1] > high) return false;
+        for (size_t k = 2; k <= continuation; k++) {
+            if ((p[i + k] & 0xC0) != 0x80) return false;
+        }
+        i += continuation + 1;
+    }
+    return true;
+}
+
+static long json_hex4(const char *p) {
+    long value = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        int digit;
+        if (c >= '0' && c <= '9') digit = c - '0';
+        else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+        else return -1;
+        value = value * 16 + digit;
+    }
+    return value;
+}
+
+static char *json_utf8_encode(char *out, long cp) {
+    if (cp < 0x80) {
+        *out++ = (char)cp;
+    } else if (cp < 0x800) {
+        *out++ = (char)(0xC0 | (cp >> 6));
+        *out++ = (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        *out++ = (char)(0xE0 | (cp >> 12));
+        *out++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+        *out++ = (char)(0x80 | (cp & 0x3F));
+    } else {
+        *out++ = (char)(0xF0 | (cp >> 18));
+        *out++ = (char)(0x80 | ((cp >> 12) & 0x3F));
+        *out++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+        *out++ = (char)(0x80 | (cp & 0x3F));
+    }
+    return out;
+}
+
+/* Decode one escape at *p (a backslash) into out; NULL on a malformed escape */
+static char *json_decode_escape(const char **p, char *out, const char **error) {
+    const char *s = *p;
+    long cp;
+    switch (s[1]) {
+        case '"':  *out++ = '"';  *p = s + 2; return out;
+        case '\\': *out++ = '\\'; *p = s + 2; return out;
+        case '/':  *out++ = '/';  *p = s + 2; return out;
+        case 'b':  *out++ = '\b'; *p = s + 2; return out;
+        case 'f':  *out++ = '\f'; *p = s + 2; return out;
+        case 'n':  *out++ = '\n'; *p = s + 2; return out;
+        case 'r':  *out++ = '\r'; *p = s + 2; return out;
+        case 't':  *out++ = '\t'; *p = s + 2; return out;
+        case 'u':  break;
+        default:
+            *error = "Invalid escape sequence";
+            return NULL;
+    }
+
+    cp = json_hex4(s + 2);
+    if (cp < 0) {
+        *error = "Invalid \\u escape";
+        return NULL;
+    }
+    s += 6;
+    if (cp >= 0xD800 && cp <= 0xDBFF) {
+        long low = (s[0] == '\\' && s[1] == 'u') ? json_hex4(s + 2) : -1;
+        if (low < 0xDC00 || low > 0xDFFF) {
+            *error = "Unpaired UTF-16 surrogate in \\u escape";
+            return NULL;
+        }
+        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+        s += 6;
+    } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+        *error = "Unpaired UTF-16 surrogate in \\u escape";
+        return NULL;
+    } else if (cp == 0) {
+        *error = "\\u0000 cannot be stored in a C string";
+        return NULL;
+    }
+    *p = s;
+    return json_utf8_encode(out, cp);
+}
+
+/*
+ * Decode the raw body [start, end) into out, which may alias start since
+ * decoding never grows the text. Returns the end of the output.
+ */
+static char *json_decode_body(const char *start, const char *end, char *out, const char **error) {
+    const char *run = start;
+    for (;;) {
+        /* end is a quote or the terminating NUL, so the scan stops there at the latest */
+        const char *p = json_find_special(run);
+        size_t len = (size_t)(p - run);
+        if (!json_utf8_valid(run, len)) {
+            *error = "Invalid UTF-8 in string";
+            return NULL;
+        }
+        memmove(out, run, len);
+        out += len;
+        if (p == end) return out;
+        if (*p != '\\') {
+            *error = "Unexpected NUL byte in string";
+            return NULL;
+        }
+        out = json_decode_escape(&p, out, error);
+        if (!out) return NULL;
+        run = p;
+    }
+}
+
+/* json_decode_body without the output: checks [start, end) and writes nothing */
+static bool json_check_body(const char *start, const char *end, const char **error) {
+    const char *run = start;
+    for (;;) {
+        const char *p = json_find_special(run);
+        if (!json_utf8_valid(run, (size_t)(p - run))) {
+            *error = "Invalid UTF-8 in string";
+            return false;
+        }
+        if (p == end) return true;
+        if (*p != '\\') {
+            *error = "Unexpected NUL byte in string";
+            return false;
+        }
+        char unit[4];
+        if (!json_decode_escape(&p, unit, error)) return false;
+        run = p;
+    }
+}
+
+/*
+ * Decode a string body starting right after its opening quote. Returns the
+ * decoded copy and points *end at the closing quote, or NULL with *error set.
+ */
+static char *json_decode_string__(POSITION_INFO_DECLARATION, Arena *arena, const char *start,
+                                  const char **end, const char **error) {
+    const char *p = json_find_special(start);
+    if (*p == '"') {
+        size_t len = (size_t)(p - start);
+        if (!json_utf8_valid(start, len)) {
+            *error = "Invalid UTF-8 in string";
+            return NULL;
+        }
+        char *str = arena_alloc__(file, func, line, arena, len + 1);
+        memcpy(str, start, len);
+        str[len] = '\0';
+        *end = p;
+        return str;
+    }
+
+    const char *close = p;
+    while (*close == '\\' && close[1]) {
+        close = json_find_special(close + 2);
+    }
+    if (*close != '"') {
+        *error = "Unterminated string";
+        return NULL;
+    }
+
+    char *str = arena_alloc__(file, func, line, arena, (size_t)(close - start) + 1);
+    char *out = json_decode_body(start, close, str, error);
+    if (!out) return NULL;
+    *out = '\0';
+    *end = close;
+    return str;
+}
+
+/*
+ * json_decode_string__ under a JsonStringMode. flags is NULL for keys,
+ * which are never borrowed: lookups need them NUL-terminated.
+ */
+static char *json_take_string__(POSITION_INFO_DECLARATION, Arena *arena, const char *start, const char **end,
+                                const char **error, JsonStringMode mode, unsigned *flags) {
+    if (mode == JSON_STRINGS_COPY || (mode == JSON_STRINGS_BORROWED && !flags)) {
+        return json_decode_string__(file, func, line, arena, start, end, error);
+    }
+
+    const char *p = json_find_special(start);
+    const char *close = p;
+    while (*close == '\\' && close[1]) {
+        close = json_find_special(close + 2);
+    }
+    if (*close != '"') {
+        *error = "Unterminated string";
+        return NULL;
+    }
+    bool escaped = p != close;
+    if (!escaped && !json_utf8_valid(start, (size_t)(close - start))) {
+        *error = "Invalid UTF-8 in string";
+        return NULL;
+    }
+    *end = close;
+
+    if (mode == JSON_STRINGS_INSITU) {
+        // Decoding only ever shrinks, so it can write over its own input
+        char *out = escaped ? json_decode_body(start, close, (char *)start, error) : (char *)close;
+        if (!out) return NULL;
+        *out = '\0';
+        return (char *)start;
+    }
+
+    size_t body = (size_t)(close - start);
+    if (body > (~0u >> JSON_STRING_LENGTH_SHIFT)) {
+        // Too long to record in flags
+        return json_decode_string__(file, func, line, arena, start, end, error);
+    }
+    // Borrowed bodies must still be valid; the escapes are decoded when read
+    if (escaped && !json_check_body(start, close, error)) return NULL;
+    *flags = JSON_STRING_BORROWED | (escaped ? JSON_STRING_ESCAPED : 0) | (unsigned)body << JSON_STRING_LENGTH_SHIFT;
+    return (char *)start;
+}
+
+/* Bytes of a string value; a borrowed body with escapes is decoded into *temp, free it after */
+static const char *json_string_bytes(const Json *item, size_t *len, char **temp) {
+    *temp = NULL;
+    if (!(item->flags & JSON_STRING_BORROWED)) {
+        const char *text = item->value.string ? item->value.string : "";
+        *len = strlen(text);
+        return text;
+    }
+    const char *start = item->value.string;
+    size_t body = item->flags >> JSON_STRING_LENGTH_SHIFT;
+    if (!(item->flags & JSON_STRING_ESCAPED)) {
+        *len = body;
+        return start;
+    }
+    const char *error = NULL;
+    *temp = arena_memory_alloc(body + 1);
+    char *out = *temp ? json_decode_body(start, start + body, *temp, &error) : NULL;
+    *len = out ? (size_t)(out - *temp) : 0;
+    return out ? *temp : "";
+}
+
+const char *json_string__(POSITION_INFO_DECLARATION, Arena *arena, Json *item) {
+    if (!item || (item->type != JSON_STRING && item->type != JSON_RAW_NUMBER)) return NULL;
+    if (item->flags & JSON_STRING_BORROWED) {
+        const char *start = item->value.string;
+        size_t body = item->flags >> JSON_STRING_LENGTH_SHIFT;
+        const char *error = NULL;
+        char *copy = arena_alloc__(file, func, line, arena, body + 1);
+        char *out = json_decode_body(start, start + body, copy, &error);
+        if (!out) {
+            raise_warn__(file, func, line, "ACCESS: %s in borrowed string %p", error, start);
+            return NULL;
+        }
+        *out = '\0';
+        item->value.string = copy;
+        item->flags = 0;
+    }
+    return item->value.string;
+}
+
+/*
+ * Compacting copy. A first walk counts the nodes and index headers and
+ * gives every distinct string an offset in a shared string area; the
+ * second copies the tree depth-first into one block laid out as nodes,
+ * then headers, then strings. Borrowed strings are decoded on the way, so
+ * the copy depends on neither the source arena nor the input.
+ */
+
+typedef struct {
+    const char *text;  /* Source bytes, kept valid until the copy is done */
+    char *temp;        /* Decoded borrowed string owned by the table */
+    size_t len;
+    uint64_t hash;
+    size_t offset;     /* In the string area */
+    bool written;
+} JsonCloneString;
+
+typedef struct {
+    JsonCloneString *slots;
+    size_t mask;
+    size_t used;
+    size_t nodes;
+    size_t indexes;
+    size_t bytes;
+    Arena *arena;
+    Json *next_node;
+    JsonObjectIndex *next_index;
+    char *strings;
+    bool failed;
+} JsonClone;
+
+static uint64_t json_bytes_hash(const char *text, size_t len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;  // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/* Slot holding text, or the empty slot where it belongs */
+static JsonCloneString *json_clone_slot(JsonClone *clone, const char *text, size_t len, uint64_t hash) {
+    size_t i = (size_t)hash & clone->mask;
+    while (clone->slots[i].text
+           && (clone->slots[i].hash != hash || clone->slots[i].len != len || memcmp(clone->slots[i].text, text, len) != 0)) {
+        i = (i + 1) & clone->mask;
+    }
+    return &clone->slots[i];
+}
+
+static bool json_clone_grow(JsonClone *clone) {
+    size_t capacity = clone->slots ? (clone->mask + 1) * 2 : 64;
+    JsonCloneString *old = clone->slots;
+    size_t old_capacity = old ? clone->mask + 1 : 0;
+    clone->slots = arena_memory_alloc(capacity * sizeof(JsonCloneString));
+    if (!clone->slots) {
+        clone->slots = old;
+        return false;
+    }
+    memset(clone->slots, 0, capacity * sizeof(JsonCloneString));
+    clone->mask = capacity - 1;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old[i].text) *json_clone_slot(clone, old[i].text, old[i].len, old[i].hash) = old[i];
+    }
+    arena_memory_free(old);
+    return true;
+}
+
+/* First walk: give text an offset unless an equal string has one; takes ownership of temp */
+static void json_clone_intern(JsonClone *clone, const char *text, size_t len, char *temp) {
+    if (clone->failed) {
+        arena_memory_free(temp);
+        return;
+    }
+    if (2 * (clone->used + 1) > (clone->slots ? clone->mask + 1 : 0) && !json_clone_grow(clone)) {
+        arena_memory_free(temp);
+        clone->failed = true;
+        return;
+    }
+    uint64_t hash = json_bytes_hash(text, len);
+    JsonCloneString *slot = json_clone_slot(clone, text, len, hash);
+    if (slot->text) {
+        arena_memory_free(temp);
+        return;
+    }
+    *slot = (JsonCloneString){ .text = text, .temp = temp, .len = len, .hash = hash, .offset = clone->bytes };
+    clone->used++;
+    clone->bytes += len + 1;
+}
+
+/* Second walk: the copy of text in the string area, written on first use */
+static char *json_clone_text(JsonClone *clone, const char *text, size_t len) {
+    JsonCloneString *slot = json_clone_slot(clone, text, len, json_bytes_hash(text, len));
+    char *copy = clone->strings + slot->offset;
+    if (!slot->written) {
+        memcpy(copy, text, len);
+        copy[len] = '\0';
+        slot->written = true;
+    }
+    return copy;
+}
+
+static void json_clone_measure(JsonClone *clone, const Json *item) {
+    clone->nodes++;
+    if (item->key) json_clone_intern(clone, item->key, strlen(item->key), NULL);
+    if (item->type == JSON_ARRAY || item->type == JSON_OBJECT) {
+        for (const Json *child = json_child(item); child; child = child->next) json_clone_measure(clone, child);
+        if (item->type == JSON_OBJECT && item->index) clone->indexes++;
+    } else if ((item->type == JSON_STRING || item->type == JSON_RAW_NUMBER) && item->value.string) {
+        char *temp;
+        size_t len;
+        const char *text = json_string_bytes(item, &len, &temp);
+        json_clone_intern(clone, text, len, temp);
+    }
+}
+
+static Json *json_clone_copy(JsonClone *clone, const Json *item) {
+    Json *copy = clone->next_node++;
+    *copy = (Json){ .type = item->type, .value = item->value };
+    if (item->key) copy->key = json_clone_text(clone, item->key, strlen(item->key));
+    if (item->type == JSON_ARRAY || item->type == JSON_OBJECT) {
+        Json *last = NULL;
+        copy->value.child = NULL;
+        for (const Json *child = json_child(item); child; child = child->next) {
+            Json *next = json_clone_copy(clone, child);
+            if (last) last->next = next;
+            else copy->value.child = next;
+            last = next;
+        }
+        if (item->type == JSON_OBJECT && item->index) {
+            copy->index = clone->next_index++;
+            *copy->index = (JsonObjectIndex){ .arena = clone->arena };
+        }
+    } else if ((item->type == JSON_STRING || item->type == JSON_RAW_NUMBER) && item->value.string) {
+        char *temp;
+        size_t len;
+        const char *text = json_string_bytes(item, &len, &temp);
+        copy->value.string = json_clone_text(clone, text, len);
+        arena_memory_free(temp);
+    }
+    return copy;
+}
+
+Json *json_clone_compact__(POSITION_INFO_DECLARATION, Arena *arena, const Json *item) {
+    if (!arena || !item) {
+        raise_exception__(file, func, line, "CLONE: Invalid arguments (arena: %p, item: %p)", arena, item);
+        return NULL;
+    }
+
+    JsonClone clone = { .arena = arena };
+    json_clone_measure(&clone, item);
+    size_t nodes = clone.nodes * sizeof(Json);
+    size_t indexes = clone.indexes * sizeof(JsonObjectIndex);
+    char *block = clone.failed ? NULL
+                : arena_alloc_or_null__(file, func, line, arena, nodes + indexes + clone.bytes, false);
+    Json *root = NULL;
+    if (block) {
+        clone.next_node = (Json *)block;
+        clone.next_index = (JsonObjectIndex *)(block + nodes);
+        clone.strings = block + nodes + indexes;
+        root = json_clone_copy(&clone, item);
+        raise_debug__(file, func, line, "CLONE: Copied %zu nodes and %zu distinct strings into %zu bytes",
+                      clone.nodes, clone.used, nodes + indexes + clone.bytes);
+    } else {
+        raise_exception__(file, func, line, "CLONE: Out of memory copying JSON %s (%zu nodes, %zu string bytes)",
+                          json_type_to_string(item->type), clone.nodes, clone.bytes);
+    }
+
+    for (size_t i = 0; clone.slots && i <= clone.mask; i++) arena_memory_free(clone.slots[i].temp);
+    arena_memory_free(clone.slots);
+    return root;
+}
+
+/* Parse a JSON string, decoding escapes and validating UTF-8 */
+static char *json_parse_string__(POSITION_INFO_DECLARATION, const char **s_ptr, Arena *arena,
+                                 JsonStringMode mode, unsigned *flags) {
+    const char *s = *s_ptr;
+    raise_debug__(file, func, line, "Entering json_parse_string__ at position: %p", s);
+    if (*s != '"') {
+        raise_debug__(file, func, line, "Expected '\"' at start of string, got: %c", *s);
+        return NULL;
+    }
+    const char *close = NULL;
+    const char *error = NULL;
+    char *str = json_take_string__(file, func, line, arena, s + 1, &close, &error, mode, flags);
+    if (!str) {
+        raise_debug__(file, func, line, "%s in string starting at: %p", error, s);
+        return NULL;
+    }
+    *s_ptr = close + 1; // skip closing quote
+    raise_debug__(file, func, line, "Parsed string of %zu bytes", (size_t)(close - s - 1));
+    return str;
+}
+
+/*
+ * Numbers follow the JSON grammar exactly and never go through the locale.
+ * Integers that fit become JSON_INTEGER. Doubles take the first path that
+ * applies: exact double arithmetic when mantissa and power of ten are both
+ * exact (Clinger), then Eisel-Lemire on a 128-bit power of five, then a
+ * correctly rounded strtod pinned to the C locale.
+ */
+
+#define JSON_MAX_MANTISSA_DIGITS 19
+
+typedef struct {
+    const char *start;
+    const char *end;
+    uint64_t mantissa;   /* First 19 significant digits */
+    int64_t exponent;    /* value = mantissa * 10^exponent */
+    bool negative;
+    bool integral;       /* Neither fraction nor exponent part */
+    bool truncated;      /* Non-zero digits beyond the 19th were dropped */
+} JsonNumberScan;
+
+/* Scan the longest JSON number at p; false when p does not start one */
+static bool json_scan_number(const char *p, JsonNumberScan *n) {
+    int digits = 0;
+    memset(n, 0, sizeof(*n));
+    n->start = p;
+    n->integral = true;
+    if (*p == '-') {
+        n->negative = true;
+        p++;
+    }
+    if (!isdigit((unsigned char)*p)) return false;
+
+    if (*p == '0') {
+        p++;
+    } else {
+        for (; isdigit((unsigned char)*p); p++) {
+            if (digits < JSON_MAX_MANTISSA_DIGITS) {
+                n->mantissa = n->mantissa * 10 + (uint64_t)(*p - '0');
+                digits++;
+            } else {
+                n->exponent++;
+                if (*p != '0') n->truncated = true;
+            }
+        }
+    }
+
+    if (*p == '.' && isdigit((unsigned char)p[1])) {
+        n->integral = false;
+        for (p++; isdigit((unsigned char)*p); p++) {
+            if (digits < JSON_MAX_MANTISSA_DIGITS) {
+                n->mantissa = n->mantissa * 10 + (uint64_t)(*p - '0');
+                n->exponent--;
+                if (n->mantissa) digits++;
+            } else if (*p != '0') {
+                n->truncated = true;
+            }
+        }
+    }
+
+    if (*p == 'e' || *p == 'E') {
+        const char *e = p + 1;
+        bool negative_exponent = false;
+        if (*e == '+' || *e == '-') negative_exponent = *e++ == '-';
+        if (isdigit((unsigned char)*e)) {
+            int64_t value = 0;
+            for (; isdigit((unsigned char)*e); e++) {
+                if (value < 100000) value = value * 10 + (*e - '0');
+            }
+            n->exponent += negative_exponent ? -value : value;
+            n->integral = false;
+            p = e;
+        }
+    }
+    n->end = p;
+    return true;
+}
+
+static bool json_number_to_int64(const JsonNumberScan *n, int64_t *out) {
+    if (!n->integral || n->truncated || n->exponent != 0) return false;
+    if (n->negative) {
+        if (n->mantissa == 0 || n->mantissa > (uint64_t)INT64_MAX + 1) return false; // -0 stays a double
+        *out = n->mantissa == (uint64_t)INT64_MAX + 1 ? INT64_MIN : -(int64_t)n->mantissa;
+    } else {
+        if (n->mantissa > (uint64_t)INT64_MAX) return false;
+        *out = (int64_t)n->mantissa;
+    }
+    return true;
+}
+
+/* 128-bit normalized 5^q for q in [-342, 308]: {high, low} (negative powers rounded up) */
+static const uint64_t json_pow5_128[][2] = {
+    {0xeef453d6923bd65aULL, 0x113faa2906a13b3fULL},
+    {0x9558b4661b6565f8ULL, 0x4ac7ca59a424c507ULL},
+    {0xbaaee17fa23ebf76ULL, 0x5d79bcf00d2df649ULL},
+    {0xe95a99df8ace6f53ULL, 0xf4d82c2c107973dcULL},
+    {0x91d8a02bb6c10594ULL, 0x79071b9b8a4be869ULL},
+    {0xb64ec836a47146f9ULL, 0x9748e2826cdee284ULL},
+    {0xe3e27a444d8d98b7ULL, 0xfd1b1b2308169b25ULL},
+    {0x8e6d8c6ab0787f72ULL, 0xfe30f0f5e50e20f7ULL},
+    {0xb208ef855c969f4fULL, 0xbdbd2d335e51a935ULL},
+    {0xde8b2b66b3bc4723ULL, 0xad2c788035e61382ULL},
+    {0x8b16fb203055ac76ULL, 0x4c3bcb5021afcc31ULL},
+    {0xaddcb9e83c6b1793ULL, 0xdf4abe242a1bbf3dULL},
+    {0xd953e8624b85dd78ULL, 0xd71d6dad34a2af0dULL},
+    {0x87d4713d6f33aa6bULL, 0x8672648c40e5ad68ULL},
+    {0xa9c98d8ccb009506ULL, 0x680efdaf511f18c2ULL},
+    {0xd43bf0effdc0ba48ULL, 0x0212bd1b2566def2ULL},
+    {0x84a57695fe98746dULL, 0x014bb630f7604b57ULL},
+    {0xa5ced43b7e3e9188ULL, 0x419ea3bd35385e2dULL},
+    {0xcf42894a5dce35eaULL, 0x52064cac828675b9ULL},
+    {0x818995ce7aa0e1b2ULL, 0x7343efebd1940993ULL},
+    {0xa1ebfb4219491a1fULL, 0x1014ebe6c5f90bf8ULL},
+    {0xca66fa129f9b60a6ULL, 0xd41a26e077774ef6ULL},
+    {0xfd00b897478238d0ULL, 0x8920b098955522b4ULL},
+    {0x9e20735e8cb16382ULL, 0x55b46e5f5d5535b0ULL},
+    {0xc5a890362fddbc62ULL, 0xeb2189f734aa831dULL},
+    {0xf712b443bbd52b7bULL, 0xa5e9ec7501d523e4ULL},
+    {0x9a6bb0aa55653b2dULL, 0x47b233c92125366eULL},
+    {0xc1069cd4eabe89f8ULL, 0x999ec0bb696e840aULL},
+    {0xf148440a256e2c76ULL, 0xc00670ea43ca250dULL},
+    {0x96cd2a865764dbcaULL, 0x380406926a5e5728ULL},
+    {0xbc807527ed3e12bcULL, 0xc605083704f5ecf2ULL},
+    {0xeba09271e88d976bULL, 0xf7864a44c633682eULL},
+    {0x93445b8731587ea3ULL, 0x7ab3ee6afbe0211dULL},
+    {0xb8157268fdae9e4cULL, 0x5960ea05bad82964ULL},
+    {0xe61acf033d1a45dfULL, 0x6fb92487298e33bdULL},
+    {0x8fd0c16206306babULL, 0xa5d3b6d479f8e056ULL},
+    {0xb3c4f1ba87bc8696ULL, 0x8f48a4899877186cULL},
+    {0xe0b62e2929aba83cULL, 0x331acdabfe94de87ULL},
+    {0x8c71dcd9ba0b4925ULL, 0x9ff0c08b7f1d0b14ULL},
+    {0xaf8e5410288e1b6fULL, 0x07ecf0ae5ee44dd9ULL},
+    {0xdb71e91432b1a24aULL, 0xc9e82cd9f69d6150ULL},
+    {0x892731ac9faf056eULL, 0xbe311c083a225cd2ULL},
+    {0xab70fe17c79ac6caULL, 0x6dbd630a48aaf406ULL},
+    {0xd64d3d9db981787dULL, 0x092cbbccdad5b108ULL},
+    {0x85f0468293f0eb4eULL, 0x25bbf56008c58ea5ULL},
+    {0xa76c582338ed2621ULL, 0xaf2af2b80af6f24eULL},
+    {0xd1476e2c07286faaULL, 0x1af5af660db4aee1ULL},
+    {0x82cca4db847945caULL, 0x50d98d9fc890ed4dULL},
+    {0xa37fce126597973cULL, 0xe50ff107bab528a0ULL},
+    {0xcc5fc196fefd7d0cULL, 0x1e53ed49a96272c8ULL},
+    {0xff77b1fcbebcdc4fULL, 0x25e8e89c13bb0f7aULL},
+    {0x9faacf3df73609b1ULL, 0x77b191618c54e9acULL},
+    {0xc795830d75038c1dULL, 0xd59df5b9ef6a2417ULL},
+    {0xf97ae3d0d2446f25ULL, 0x4b0573286b44ad1dULL},
+    {0x9becce62836ac577ULL, 0x4ee367f9430aec32ULL},
+    {0xc2e801fb244576d5ULL, 0x229c41f793cda73fULL},
+    {0xf3a20279ed56d48aULL, 0x6b43527578c1110fULL},
+    {0x9845418c345644d6ULL, 0x830a13896b78aaa9ULL},
+    {0xbe5691ef416bd60cULL, 0x23cc986bc656d553ULL},
+    {0xedec366b11c6cb8fULL, 0x2cbfbe86b7ec8aa8ULL},
+    {0x94b3a202eb1c3f39ULL, 0x7bf7d71432f3d6a9ULL},
+    {0xb9e08a83a5e34f07ULL, 0xdaf5ccd93fb0cc53ULL},
+    {0xe858ad248f5c22c9ULL, 0xd1b3400f8f9cff68ULL},
+    {0x91376c36d99995beULL, 0x23100809b9c21fa1ULL},
+    {0xb58547448ffffb2dULL, 0xabd40a0c2832a78aULL},
+    {0xe2e69915b3fff9f9ULL, 0x16c90c8f323f516cULL},
+    {0x8dd01fad907ffc3bULL, 0xae3da7d97f6792e3ULL},
+    {0xb1442798f49ffb4aULL, 0x99cd11cfdf41779cULL},
+    {0xdd95317f31c7fa1dULL, 0x40405643d711d583ULL},
+    {0x8a7d3eef7f1cfc52ULL, 0x482835ea666b2572ULL},
+    {0xad1c8eab5ee43b66ULL, 0xda3243650005eecfULL},
+    {0xd863b256369d4a40ULL, 0x90bed43e40076a82ULL},
+    {0x873e4f75e2224e68ULL, 0x5a7744a6e804a291ULL},
+    {0xa90de3535aaae202ULL, 0x711515d0a205cb36ULL},
+    {0xd3515c2831559a83ULL, 0x0d5a5b44ca873e03ULL},
+    {0x8412d9991ed58091ULL, 0xe858790afe9486c2ULL},
+    {0xa5178fff668ae0b6ULL, 0x626e974dbe39a872ULL},
+    {0xce5d73ff402d98e3ULL, 0xfb0a3d212dc8128fULL},
+    {0x80fa687f881c7f8eULL, 0x7ce66634bc9d0b99ULL},
+    {0xa139029f6a239f72ULL, 0x1c1fffc1ebc44e80ULL},
+    {0xc987434744ac874eULL, 0xa327ffb266b56220ULL},
+    {0xfbe9141915d7a922ULL, 0x4bf1ff9f0062baa8ULL},
+    {0x9d71ac8fada6c9b5ULL, 0x6f773fc3603db4a9ULL},
+    {0xc4ce17b399107c22ULL, 0xcb550fb4384d21d3ULL},
+    {0xf6019da07f549b2bULL, 0x7e2a53a146606a48ULL},
+    {0x99c102844f94e0fbULL, 0x2eda7444cbfc426dULL},
+    {0xc0314325637a1939ULL, 0xfa911155fefb5308ULL},
+    {0xf03d93eebc589f88ULL, 0x793555ab7eba27caULL},
+    {0x96267c7535b763b5ULL, 0x4bc1558b2f3458deULL},
+    {0xbbb01b9283253ca2ULL, 0x9eb1aaedfb016f16ULL},
+    {0xea9c227723ee8bcbULL, 0x465e15a979c1cadcULL},
+    {0x92a1958a7675175fULL, 0x0bfacd89ec191ec9ULL},
+    {0xb749faed14125d36ULL, 0xcef980ec671f667bULL},
+    {0xe51c79a85916f484ULL, 0x82b7e12780e7401aULL},
+    {0x8f31cc0937ae58d2ULL, 0xd1b2ecb8b0908810ULL},
+    {0xb2fe3f0b8599ef07ULL, 0x861fa7e6dcb4aa15ULL},
+    {0xdfbdcece67006ac9ULL, 0x67a791e093e1d49aULL},
+    {0x8bd6a141006042bdULL, 0xe0c8bb2c5c6d24e0ULL},
+    {0xaecc49914078536dULL, 0x58fae9f773886e18ULL},
+    {0xda7f5bf590966848ULL, 0xaf39a475506a899eULL},
+    {0x888f99797a5e012dULL, 0x6d8406c952429603ULL},
+    {0xaab37fd7d8f58178ULL, 0xc8e5087ba6d33b83ULL},
+    {0xd5605fcdcf32e1d6ULL, 0xfb1e4a9a90880a64ULL},
+    {0x855c3be0a17fcd26ULL, 0x5cf2eea09a55067fULL},
+    {0xa6b34ad8c9dfc06fULL, 0xf42faa48c0ea481eULL},
+    {0xd0601d8efc57b08bULL, 0xf13b94daf124da26ULL},
+    {0x823c12795db6ce57ULL, 0x76c53d08d6b70858ULL},
+    {0xa2cb1717b52481edULL, 0x54768c4b0c64ca6eULL},
+    {0xcb7ddcdda26da268ULL, 0xa9942f5dcf7dfd09ULL},
+    {0xfe5d54150b090b02ULL, 0xd3f93b35435d7c4cULL},
+    {0x9efa548d26e5a6e1ULL, 0xc47bc5014a1a6dafULL},
+    {0xc6b8e9b0709f109aULL, 0x359ab6419ca1091bULL},
+    {0xf867241c8cc6d4c0ULL, 0xc30163d203c94b62ULL},
+    {0x9b407691d7fc44f8ULL, 0x79e0de63425dcf1dULL},
+    {0xc21094364dfb5636ULL, 0x985915fc12f542e4ULL},
+    {0xf294b943e17a2bc4ULL, 0x3e6f5b7b17b2939dULL},
+    {0x979cf3ca6cec5b5aULL, 0xa705992ceecf9c42ULL},
+    {0xbd8430bd08277231ULL, 0x50c6ff782a838353ULL},
+    {0xece53cec4a314ebdULL, 0xa4f8bf5635246428ULL},
+    {0x940f4613ae5ed136ULL, 0x871b7795e136be99ULL},
+    {0xb913179899f68584ULL, 0x28e2557b59846e3fULL},
+    {0xe757dd7ec07426e5ULL, 0x331aeada2fe589cfULL},
+    {0x9096ea6f3848984fULL, 0x3ff0d2c85def7621ULL},
+    {0xb4bca50b065abe63ULL, 0x0fed077a756b53a9ULL},
+    {0xe1ebce4dc7f16dfbULL, 0xd3e8495912c62894ULL},
+    {0x8d3360f09cf6e4bdULL, 0x64712dd7abbbd95cULL},
+    {0xb080392cc4349decULL, 0xbd8d794d96aacfb3ULL},
+    {0xdca04777f541c567ULL, 0xecf0d7a0fc5583a0ULL},
+    {0x89e42caaf9491b60ULL, 0xf41686c49db57244ULL},
+    {0xac5d37d5b79b6239ULL, 0x311c2875c522ced5ULL},
+    {0xd77485cb25823ac7ULL, 0x7d633293366b828bULL},
+    {0x86a8d39ef77164bcULL, 0xae5dff9c02033197ULL},
+    {0xa8530886b54dbdebULL, 0xd9f57f830283fdfcULL},
+    {0xd267caa862a12d66ULL, 0xd072df63c324fd7bULL},
+    {0x8380dea93da4bc60ULL, 0x4247cb9e59f71e6dULL},
+    {0xa46116538d0deb78ULL, 0x52d9be85f074e608ULL},
+    {0xcd795be870516656ULL, 0x67902e276c921f8bULL},
+    {0x806bd9714632dff6ULL, 0x00ba1cd8a3db53b6ULL},
+    {0xa086cfcd97bf97f3ULL, 0x80e8a40eccd228a4ULL},
+    {0xc8a883c0fdaf7df0ULL, 0x6122cd128006b2cdULL},
+    {0xfad2a4b13d1b5d6cULL, 0x796b805720085f81ULL},
+    {0x9cc3a6eec6311a63ULL, 0xcbe3303674053bb0ULL},
+    {0xc3f490aa77bd60fcULL, 0xbedbfc4411068a9cULL},
+    {0xf4f1b4d515acb93bULL, 0xee92fb5515482d44ULL},
+    {0x991711052d8bf3c5ULL, 0x751bdd152d4d1c4aULL},
+    {0xbf5cd54678eef0b6ULL, 0xd262d45a78a0635dULL},
+    {0xef340a98172aace4ULL, 0x86fb897116c87c34ULL},
+    {0x9580869f0e7aac0eULL, 0xd45d35e6ae3d4da0ULL},
+    {0xbae0a846d2195712ULL, 0x8974836059cca109ULL},
+    {0xe998d258869facd7ULL, 0x2bd1a438703fc94bULL},
+    {0x91ff83775423cc06ULL, 0x7b6306a34627ddcfULL},
+    {0xb67f6455292cbf08ULL, 0x1a3bc84c17b1d542ULL},
+    {0xe41f3d6a7377eecaULL, 0x20caba5f1d9e4a93ULL},
+    {0x8e938662882af53eULL, 0x547eb47b7282ee9cULL},
+    {0xb23867fb2a35b28dULL, 0xe99e619a4f23aa43ULL},
+    {0xdec681f9f4c31f31ULL, 0x6405fa00e2ec94d4ULL},
+    {0x8b3c113c38f9f37eULL, 0xde83bc408dd3dd04ULL},
+    {0xae0b158b4738705eULL, 0x9624ab50b148d445ULL},
+    {0xd98ddaee19068c76ULL, 0x3badd624dd9b0957ULL},
+    {0x87f8a8d4cfa417c9ULL, 0xe54ca5d70a80e5d6ULL},
+    {0xa9f6d30a038d1dbcULL, 0x5e9fcf4ccd211f4cULL},
+    {0xd47487cc8470652bULL, 0x7647c3200069671fULL},
+    {0x84c8d4dfd2c63f3bULL, 0x29ecd9f40041e073ULL},
+    {0xa5fb0a17c777cf09ULL, 0xf468107100525890ULL},
+    {0xcf79cc9db955c2ccULL, 0x7182148d4066eeb4ULL},
+    {0x81ac1fe293d599bfULL, 0xc6f14cd848405530ULL},
+    {0xa21727db38cb002fULL, 0xb8ada00e5a506a7cULL},
+    {0xca9cf1d206fdc03bULL, 0xa6d90811f0e4851cULL},
+    {0xfd442e4688bd304aULL, 0x908f4a166d1da663ULL},
+    {0x9e4a9cec15763e2eULL, 0x9a598e4e043287feULL},
+    {0xc5dd44271ad3cdbaULL, 0x40eff1e1853f29fdULL},
+    {0xf7549530e188c128ULL, 0xd12bee59e68ef47cULL},
+    {0x9a94dd3e8cf578b9ULL, 0x82bb74f8301958ceULL},
+    {0xc13a148e3032d6e7ULL, 0xe36a52363c1faf01ULL},
+    {0xf18899b1bc3f8ca1ULL, 0xdc44e6c3cb279ac1ULL},
+    {0x96f5600f15a7b7e5ULL, 0x29ab103a5ef8c0b9ULL},
+    {0xbcb2b812db11a5deULL, 0x7415d448f6b6f0e7ULL},
+    {0xebdf661791d60f56ULL, 0x111b495b3464ad21ULL},
+    {0x936b9fcebb25c995ULL, 0xcab10dd900beec34ULL},
+    {0xb84687c269ef3bfbULL, 0x3d5d514f40eea742ULL},
+    {0xe65829b3046b0afaULL, 0x0cb4a5a3112a5112ULL},
+    {0x8ff71a0fe2c2e6dcULL, 0x47f0e785eaba72abULL},
+    {0xb3f4e093db73a093ULL, 0x59ed216765690f56ULL},
+    {0xe0f218b8d25088b8ULL, 0x306869c13ec3532cULL},
+    {0x8c974f7383725573ULL, 0x1e414218c73a13fbULL},
+    {0xafbd2350644eeacfULL, 0xe5d1929ef90898faULL},
+    {0xdbac6c247d62a583ULL, 0xdf45f746b74abf39ULL},
+    {0x894bc396ce5da772ULL, 0x6b8bba8c328eb783ULL},
+    {0xab9eb47c81f5114fULL, 0x066ea92f3f326564ULL},
+    {0xd686619ba27255a2ULL, 0xc80a537b0efefebdULL},
+    {0x8613fd0145877585ULL, 0xbd06742ce95f5f36ULL},
+    {0xa798fc4196e952e7ULL, 0x2c48113823b73704ULL},
+    {0xd17f3b51fca3a7a0ULL, 0xf75a15862ca504c5ULL},
+    {0x82ef85133de648c4ULL, 0x9a984d73dbe722fbULL},
+    {0xa3ab66580d5fdaf5ULL, 0xc13e60d0d2e0ebbaULL},
+    {0xcc963fee10b7d1b3ULL, 0x318df905079926a8ULL},
+    {0xffbbcfe994e5c61fULL, 0xfdf17746497f7052ULL},
+    {0x9fd561f1fd0f9bd3ULL, 0xfeb6ea8bedefa633ULL},
+    {0xc7caba6e7c5382c8ULL, 0xfe64a52ee96b8fc0ULL},
+    {0xf9bd690a1b68637bULL, 0x3dfdce7aa3c673b0ULL},
+    {0x9c1661a651213e2dULL, 0x06bea10ca65c084eULL},
+    {0xc31bfa0fe5698db8ULL, 0x486e494fcff30a62ULL},
+    {0xf3e2f893dec3f126ULL, 0x5a89dba3c3efccfaULL},
+    {0x986ddb5c6b3a76b7ULL, 0xf89629465a75e01cULL},
+    {0xbe89523386091465ULL, 0xf6bbb397f1135823ULL},
+    {0xee2ba6c0678b597fULL, 0x746aa07ded582e2cULL},
+    {0x94db483840b717efULL, 0xa8c2a44eb4571cdcULL},
+    {0xba121a4650e4ddebULL, 0x92f34d62616ce413ULL},
+    {0xe896a0d7e51e1566ULL, 0x77b020baf9c81d17ULL},
+    {0x915e2486ef32cd60ULL, 0x0ace1474dc1d122eULL},
+    {0xb5b5ada8aaff80b8ULL, 0x0d819992132456baULL},
+    {0xe3231912d5bf60e6ULL, 0x10e1fff697ed6c69ULL},
+    {0x8df5efabc5979c8fULL, 0xca8d3ffa1ef463c1ULL},
+    {0xb1736b96b6fd83b3ULL, 0xbd308ff8a6b17cb2ULL},
+    {0xddd0467c64bce4a0ULL, 0xac7cb3f6d05ddbdeULL},
+    {0x8aa22c0dbef60ee4ULL, 0x6bcdf07a423aa96bULL},
+    {0xad4ab7112eb3929dULL, 0x86c16c98d2c953c6ULL},
+    {0xd89d64d57a607744ULL, 0xe871c7bf077ba8b7ULL},
+    {0x87625f056c7c4a8bULL, 0x11471cd764ad4972ULL},
+    {0xa93af6c6c79b5d2dULL, 0xd598e40d3dd89bcfULL},
+    {0xd389b47879823479ULL, 0x4aff1d108d4ec2c3ULL},
+    {0x843610cb4bf160cbULL, 0xcedf722a585139baULL},
+    {0xa54394fe1eedb8feULL, 0xc2974eb4ee658828ULL},
+    {0xce947a3da6a9273eULL, 0x733d226229feea32ULL},
+    {0x811ccc668829b887ULL, 0x0806357d5a3f525fULL},
+    {0xa163ff802a3426a8ULL, 0xca07c2dcb0cf26f7ULL},
+    {0xc9bcff6034c13052ULL, 0xfc89b393dd02f0b5ULL},
+    {0xfc2c3f3841f17c67ULL, 0xbbac2078d443ace2ULL},
+    {0x9d9ba7832936edc0ULL, 0xd54b944b84aa4c0dULL},
+    {0xc5029163f384a931ULL, 0x0a9e795e65d4df11ULL},
+    {0xf64335bcf065d37dULL, 0x4d4617b5ff4a16d5ULL},
+    {0x99ea0196163fa42eULL, 0x504bced1bf8e4e45ULL},
+    {0xc06481fb9bcf8d39ULL, 0xe45ec2862f71e1d6ULL},
+    {0xf07da27a82c37088ULL, 0x5d767327bb4e5a4cULL},
+    {0x964e858c91ba2655ULL, 0x3a6a07f8d510f86fULL},
+    {0xbbe226efb628afeaULL, 0x890489f70a55368bULL},
+    {0xeadab0aba3b2dbe5ULL, 0x2b45ac74ccea842eULL},
+    {0x92c8ae6b464fc96fULL, 0x3b0b8bc90012929dULL},
+    {0xb77ada0617e3bbcbULL, 0x09ce6ebb40173744ULL},
+    {0xe55990879ddcaabdULL, 0xcc420a6a101d0515ULL},
+    {0x8f57fa54c2a9eab6ULL, 0x9fa946824a12232dULL},
+    {0xb32df8e9f3546564ULL, 0x47939822dc96abf9ULL},
+    {0xdff9772470297ebdULL, 0x59787e2b93bc56f7ULL},
+    {0x8bfbea76c619ef36ULL, 0x57eb4edb3c55b65aULL},
+    {0xaefae51477a06b03ULL, 0xede622920b6b23f1ULL},
+    {0xdab99e59958885c4ULL, 0xe95fab368e45ecedULL},
+    {0x88b402f7fd75539bULL, 0x11dbcb0218ebb414ULL},
+    {0xaae103b5fcd2a881ULL, 0xd652bdc29f26a119ULL},
+    {0xd59944a37c0752a2ULL, 0x4be76d3346f0495fULL},
+    {0x857fcae62d8493a5ULL, 0x6f70a4400c562ddbULL},
+    {0xa6dfbd9fb8e5b88eULL, 0xcb4ccd500f6bb952ULL},
+    {0xd097ad07a71f26b2ULL, 0x7e2000a41346a7a7ULL},
+    {0x825ecc24c873782fULL, 0x8ed400668c0c28c8ULL},
+    {0xa2f67f2dfa90563bULL, 0x728900802f0f32faULL},
+    {0xcbb41ef979346bcaULL, 0x4f2b40a03ad2ffb9ULL},
+    {0xfea126b7d78186bcULL, 0xe2f610c84987bfa8ULL},
+    {0x9f24b832e6b0f436ULL, 0x0dd9ca7d2df4d7c9ULL},
+    {0xc6ede63fa05d3143ULL, 0x91503d1c79720dbbULL},
+    {0xf8a95fcf88747d94ULL, 0x75a44c6397ce912aULL},
+    {0x9b69dbe1b548ce7cULL, 0xc986afbe3ee11abaULL},
+    {0xc24452da229b021bULL, 0xfbe85badce996168ULL},
+    {0xf2d56790ab41c2a2ULL, 0xfae27299423fb9c3ULL},
+    {0x97c560ba6b0919a5ULL, 0xdccd879fc967d41aULL},
+    {0xbdb6b8e905cb600fULL, 0x5400e987bbc1c920ULL},
+    {0xed246723473e3813ULL, 0x290123e9aab23b68ULL},
+    {0x9436c0760c86e30bULL, 0xf9a0b6720aaf6521ULL},
+    {0xb94470938fa89bceULL, 0xf808e40e8d5b3e69ULL},
+    {0xe7958cb87392c2c2ULL, 0xb60b1d1230b20e04ULL},
+    {0x90bd77f3483bb9b9ULL, 0xb1c6f22b5e6f48c2ULL},
+    {0xb4ecd5f01a4aa828ULL, 0x1e38aeb6360b1af3ULL},
+    {0xe2280b6c20dd5232ULL, 0x25c6da63c38de1b0ULL},
+    {0x8d590723948a535fULL, 0x579c487e5a38ad0eULL},
+    {0xb0af48ec79ace837ULL, 0x2d835a9df0c6d851ULL},
+    {0xdcdb1b2798182244ULL, 0xf8e431456cf88e65ULL},
+    {0x8a08f0f8bf0f156bULL, 0x1b8e9ecb641b58ffULL},
+    {0xac8b2d36eed2dac5ULL, 0xe272467e3d222f3fULL},
+    {0xd7adf884aa879177ULL, 0x5b0ed81dcc6abb0fULL},
+    {0x86ccbb52ea94baeaULL, 0x98e947129fc2b4e9ULL},
+    {0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL},
+    {0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL},
+    {0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL},
+    {0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL},
+    {0xcdb02555653131b6ULL, 0x3792f412cb06794dULL},
+    {0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL},
+    {0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL},
+    {0xc8de047564d20a8bULL, 0xf245825a5a445275ULL},
+    {0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL},
+    {0x9ced737bb6c4183dULL, 0x55464dd69685606bULL},
+    {0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL},
+    {0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL},
+    {0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL},
+    {0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL},
+    {0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL},
+    {0x95a8637627989aadULL, 0xdde7001379a44aa8ULL},
+    {0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL},
+    {0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL},
+    {0x9226712162ab070dULL, 0xcab3961304ca70e8ULL},
+    {0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL},
+    {0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL},
+    {0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL},
+    {0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL},
+    {0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL},
+    {0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL},
+    {0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL},
+    {0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL},
+    {0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL},
+    {0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL},
+    {0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL},
+    {0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL},
+    {0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL},
+    {0xcfb11ead453994baULL, 0x67de18eda5814af2ULL},
+    {0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL},
+    {0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL},
+    {0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL},
+    {0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL},
+    {0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL},
+    {0xc612062576589ddaULL, 0x95364afe032a819eULL},
+    {0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL},
+    {0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL},
+    {0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL},
+    {0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL},
+    {0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL},
+    {0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL},
+    {0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL},
+    {0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL},
+    {0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL},
+    {0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL},
+    {0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL},
+    {0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL},
+    {0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL},
+    {0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL},
+    {0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL},
+    {0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL},
+    {0x89705f4136b4a597ULL, 0x31680a88f8953031ULL},
+    {0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL},
+    {0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL},
+    {0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL},
+    {0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL},
+    {0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL},
+    {0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL},
+    {0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL},
+    {0xccccccccccccccccULL, 0xcccccccccccccccdULL},
+    {0x8000000000000000ULL, 0x0000000000000000ULL},
+    {0xa000000000000000ULL, 0x0000000000000000ULL},
+    {0xc800000000000000ULL, 0x0000000000000000ULL},
+    {0xfa00000000000000ULL, 0x0000000000000000ULL},
+    {0x9c40000000000000ULL, 0x0000000000000000ULL},
+    {0xc350000000000000ULL, 0x0000000000000000ULL},
+    {0xf424000000000000ULL, 0x0000000000000000ULL},
+    {0x9896800000000000ULL, 0x0000000000000000ULL},
+    {0xbebc200000000000ULL, 0x0000000000000000ULL},
+    {0xee6b280000000000ULL, 0x0000000000000000ULL},
+    {0x9502f90000000000ULL, 0x0000000000000000ULL},
+    {0xba43b74000000000ULL, 0x0000000000000000ULL},
+    {0xe8d4a51000000000ULL, 0x0000000000000000ULL},
+    {0x9184e72a00000000ULL, 0x0000000000000000ULL},
+    {0xb5e620f480000000ULL, 0x0000000000000000ULL},
+    {0xe35fa931a0000000ULL, 0x0000000000000000ULL},
+    {0x8e1bc9bf04000000ULL, 0x0000000000000000ULL},
+    {0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL},
+    {0xde0b6b3a76400000ULL, 0x0000000000000000ULL},
+    {0x8ac7230489e80000ULL, 0x0000000000000000ULL},
+    {0xad78ebc5ac620000ULL, 0x0000000000000000ULL},
+    {0xd8d726b7177a8000ULL, 0x0000000000000000ULL},
+    {0x878678326eac9000ULL, 0x0000000000000000ULL},
+    {0xa968163f0a57b400ULL, 0x0000000000000000ULL},
+    {0xd3c21bcecceda100ULL, 0x0000000000000000ULL},
+    {0x84595161401484a0ULL, 0x0000000000000000ULL},
+    {0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL},
+    {0xcecb8f27f4200f3aULL, 0x0000000000000000ULL},
+    {0x813f3978f8940984ULL, 0x4000000000000000ULL},
+    {0xa18f07d736b90be5ULL, 0x5000000000000000ULL},
+    {0xc9f2c9cd04674edeULL, 0xa400000000000000ULL},
+    {0xfc6f7c4045812296ULL, 0x4d00000000000000ULL},
+    {0x9dc5ada82b70b59dULL, 0xf020000000000000ULL},
+    {0xc5371912364ce305ULL, 0x6c28000000000000ULL},
+    {0xf684df56c3e01bc6ULL, 0xc732000000000000ULL},
+    {0x9a130b963a6c115cULL, 0x3c7f400000000000ULL},
+    {0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL},
+    {0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL},
+    {0x96769950b50d88f4ULL, 0x1314448000000000ULL},
+    {0xbc143fa4e250eb31ULL, 0x17d955a000000000ULL},
+    {0xeb194f8e1ae525fdULL, 0x5dcfab0800000000ULL},
+    {0x92efd1b8d0cf37beULL, 0x5aa1cae500000000ULL},
+    {0xb7abc627050305adULL, 0xf14a3d9e40000000ULL},
+    {0xe596b7b0c643c719ULL, 0x6d9ccd05d0000000ULL},
+    {0x8f7e32ce7bea5c6fULL, 0xe4820023a2000000ULL},
+    {0xb35dbf821ae4f38bULL, 0xdda2802c8a800000ULL},
+    {0xe0352f62a19e306eULL, 0xd50b2037ad200000ULL},
+    {0x8c213d9da502de45ULL, 0x4526f422cc340000ULL},
+    {0xaf298d050e4395d6ULL, 0x9670b12b7f410000ULL},
+    {0xdaf3f04651d47b4cULL, 0x3c0cdd765f114000ULL},
+    {0x88d8762bf324cd0fULL, 0xa5880a69fb6ac800ULL},
+    {0xab0e93b6efee0053ULL, 0x8eea0d047a457a00ULL},
+    {0xd5d238a4abe98068ULL, 0x72a4904598d6d880ULL},
+    {0x85a36366eb71f041ULL, 0x47a6da2b7f864750ULL},
+    {0xa70c3c40a64e6c51ULL, 0x999090b65f67d924ULL},
+    {0xd0cf4b50cfe20765ULL, 0xfff4b4e3f741cf6dULL},
+    {0x82818f1281ed449fULL, 0xbff8f10e7a8921a4ULL},
+    {0xa321f2d7226895c7ULL, 0xaff72d52192b6a0dULL},
+    {0xcbea6f8ceb02bb39ULL, 0x9bf4f8a69f764490ULL},
+    {0xfee50b7025c36a08ULL, 0x02f236d04753d5b4ULL},
+    {0x9f4f2726179a2245ULL, 0x01d762422c946590ULL},
+    {0xc722f0ef9d80aad6ULL, 0x424d3ad2b7b97ef5ULL},
+    {0xf8ebad2b84e0d58bULL, 0xd2e0898765a7deb2ULL},
+    {0x9b934c3b330c8577ULL, 0x63cc55f49f88eb2fULL},
+    {0xc2781f49ffcfa6d5ULL, 0x3cbf6b71c76b25fbULL},
+    {0xf316271c7fc3908aULL, 0x8bef464e3945ef7aULL},
+    {0x97edd871cfda3a56ULL, 0x97758bf0e3cbb5acULL},
+    {0xbde94e8e43d0c8ecULL, 0x3d52eeed1cbea317ULL},
+    {0xed63a231d4c4fb27ULL, 0x4ca7aaa863ee4bddULL},
+    {0x945e455f24fb1cf8ULL, 0x8fe8caa93e74ef6aULL},
+    {0xb975d6b6ee39e436ULL, 0xb3e2fd538e122b44ULL},
+    {0xe7d34c64a9c85d44ULL, 0x60dbbca87196b616ULL},
+    {0x90e40fbeea1d3a4aULL, 0xbc8955e946fe31cdULL},
+    {0xb51d13aea4a488ddULL, 0x6babab6398bdbe41ULL},
+    {0xe264589a4dcdab14ULL, 0xc696963c7eed2dd1ULL},
+    {0x8d7eb76070a08aecULL, 0xfc1e1de5cf543ca2ULL},
+    {0xb0de65388cc8ada8ULL, 0x3b25a55f43294bcbULL},
+    {0xdd15fe86affad912ULL, 0x49ef0eb713f39ebeULL},
+    {0x8a2dbf142dfcc7abULL, 0x6e3569326c784337ULL},
+    {0xacb92ed9397bf996ULL, 0x49c2c37f07965404ULL},
+    {0xd7e77a8f87daf7fbULL, 0xdc33745ec97be906ULL},
+    {0x86f0ac99b4e8dafdULL, 0x69a028bb3ded71a3ULL},
+    {0xa8acd7c0222311bcULL, 0xc40832ea0d68ce0cULL},
+    {0xd2d80db02aabd62bULL, 0xf50a3fa490c30190ULL},
+    {0x83c7088e1aab65dbULL, 0x792667c6da79e0faULL},
+    {0xa4b8cab1a1563f52ULL, 0x577001b891185938ULL},
+    {0xcde6fd5e09abcf26ULL, 0xed4c0226b55e6f86ULL},
+    {0x80b05e5ac60b6178ULL, 0x544f8158315b05b4ULL},
+    {0xa0dc75f1778e39d6ULL, 0x696361ae3db1c721ULL},
+    {0xc913936dd571c84cULL, 0x03bc3a19cd1e38e9ULL},
+    {0xfb5878494ace3a5fULL, 0x04ab48a04065c723ULL},
+    {0x9d174b2dcec0e47bULL, 0x62eb0d64283f9c76ULL},
+    {0xc45d1df942711d9aULL, 0x3ba5d0bd324f8394ULL},
+    {0xf5746577930d6500ULL, 0xca8f44ec7ee36479ULL},
+    {0x9968bf6abbe85f20ULL, 0x7e998b13cf4e1ecbULL},
+    {0xbfc2ef456ae276e8ULL, 0x9e3fedd8c321a67eULL},
+    {0xefb3ab16c59b14a2ULL, 0xc5cfe94ef3ea101eULL},
+    {0x95d04aee3b80ece5ULL, 0xbba1f1d158724a12ULL},
+    {0xbb445da9ca61281fULL, 0x2a8a6e45ae8edc97ULL},
+    {0xea1575143cf97226ULL, 0xf52d09d71a3293bdULL},
+    {0x924d692ca61be758ULL, 0x593c2626705f9c56ULL},
+    {0xb6e0c377cfa2e12eULL, 0x6f8b2fb00c77836cULL},
+    {0xe498f455c38b997aULL, 0x0b6dfb9c0f956447ULL},
+    {0x8edf98b59a373fecULL, 0x4724bd4189bd5eacULL},
+    {0xb2977ee300c50fe7ULL, 0x58edec91ec2cb657ULL},
+    {0xdf3d5e9bc0f653e1ULL, 0x2f2967b66737e3edULL},
+    {0x8b865b215899f46cULL, 0xbd79e0d20082ee74ULL},
+    {0xae67f1e9aec07187ULL, 0xecd8590680a3aa11ULL},
+    {0xda01ee641a708de9ULL, 0xe80e6f4820cc9495ULL},
+    {0x884134fe908658b2ULL, 0x3109058d147fdcddULL},
+    {0xaa51823e34a7eedeULL, 0xbd4b46f0599fd415ULL},
+    {0xd4e5e2cdc1d1ea96ULL, 0x6c9e18ac7007c91aULL},
+    {0x850fadc09923329eULL, 0x03e2cf6bc604ddb0ULL},
+    {0xa6539930bf6bff45ULL, 0x84db8346b786151cULL},
+    {0xcfe87f7cef46ff16ULL, 0xe612641865679a63ULL},
+    {0x81f14fae158c5f6eULL, 0x4fcb7e8f3f60c07eULL},
+    {0xa26da3999aef7749ULL, 0xe3be5e330f38f09dULL},
+    {0xcb090c8001ab551cULL, 0x5cadf5bfd3072cc5ULL},
+    {0xfdcb4fa002162a63ULL, 0x73d9732fc7c8f7f6ULL},
+    {0x9e9f11c4014dda7eULL, 0x2867e7fddcdd9afaULL},
+    {0xc646d63501a1511dULL, 0xb281e1fd541501b8ULL},
+    {0xf7d88bc24209a565ULL, 0x1f225a7ca91a4226ULL},
+    {0x9ae757596946075fULL, 0x3375788de9b06958ULL},
+    {0xc1a12d2fc3978937ULL, 0x0052d6b1641c83aeULL},
+    {0xf209787bb47d6b84ULL, 0xc0678c5dbd23a49aULL},
+    {0x9745eb4d50ce6332ULL, 0xf840b7ba963646e0ULL},
+    {0xbd176620a501fbffULL, 0xb650e5a93bc3d898ULL},
+    {0xec5d3fa8ce427affULL, 0xa3e51f138ab4cebeULL},
+    {0x93ba47c980e98cdfULL, 0xc66f336c36b10137ULL},
+    {0xb8a8d9bbe123f017ULL, 0xb80b0047445d4184ULL},
+    {0xe6d3102ad96cec1dULL, 0xa60dc059157491e5ULL},
+    {0x9043ea1ac7e41392ULL, 0x87c89837ad68db2fULL},
+    {0xb454e4a179dd1877ULL, 0x29babe4598c311fbULL},
+    {0xe16a1dc9d8545e94ULL, 0xf4296dd6fef3d67aULL},
+    {0x8ce2529e2734bb1dULL, 0x1899e4a65f58660cULL},
+    {0xb01ae745b101e9e4ULL, 0x5ec05dcff72e7f8fULL},
+    {0xdc21a1171d42645dULL, 0x76707543f4fa1f73ULL},
+    {0x899504ae72497ebaULL, 0x6a06494a791c53a8ULL},
+    {0xabfa45da0edbde69ULL, 0x0487db9d17636892ULL},
+    {0xd6f8d7509292d603ULL, 0x45a9d2845d3c42b6ULL},
+    {0x865b86925b9bc5c2ULL, 0x0b8a2392ba45a9b2ULL},
+    {0xa7f26836f282b732ULL, 0x8e6cac7768d7141eULL},
+    {0xd1ef0244af2364ffULL, 0x3207d795430cd926ULL},
+    {0x8335616aed761f1fULL, 0x7f44e6bd49e807b8ULL},
+    {0xa402b9c5a8d3a6e7ULL, 0x5f16206c9c6209a6ULL},
+    {0xcd036837130890a1ULL, 0x36dba887c37a8c0fULL},
+    {0x802221226be55a64ULL, 0xc2494954da2c9789ULL},
+    {0xa02aa96b06deb0fdULL, 0xf2db9baa10b7bd6cULL},
+    {0xc83553c5c8965d3dULL, 0x6f92829494e5acc7ULL},
+    {0xfa42a8b73abbf48cULL, 0xcb772339ba1f17f9ULL},
+    {0x9c69a97284b578d7ULL, 0xff2a760414536efbULL},
+    {0xc38413cf25e2d70dULL, 0xfef5138519684abaULL},
+    {0xf46518c2ef5b8cd1ULL, 0x7eb258665fc25d69ULL},
+    {0x98bf2f79d5993802ULL, 0xef2f773ffbd97a61ULL},
+    {0xbeeefb584aff8603ULL, 0xaafb550ffacfd8faULL},
+    {0xeeaaba2e5dbf6784ULL, 0x95ba2a53f983cf38ULL},
+    {0x952ab45cfa97a0b2ULL, 0xdd945a747bf26183ULL},
+    {0xba756174393d88dfULL, 0x94f971119aeef9e4ULL},
+    {0xe912b9d1478ceb17ULL, 0x7a37cd5601aab85dULL},
+    {0x91abb422ccb812eeULL, 0xac62e055c10ab33aULL},
+    {0xb616a12b7fe617aaULL, 0x577b986b314d6009ULL},
+    {0xe39c49765fdf9d94ULL, 0xed5a7e85fda0b80bULL},
+    {0x8e41ade9fbebc27dULL, 0x14588f13be847307ULL},
+    {0xb1d219647ae6b31cULL, 0x596eb2d8ae258fc8ULL},
+    {0xde469fbd99a05fe3ULL, 0x6fca5f8ed9aef3bbULL},
+    {0x8aec23d680043beeULL, 0x25de7bb9480d5854ULL},
+    {0xada72ccc20054ae9ULL, 0xaf561aa79a10ae6aULL},
+    {0xd910f7ff28069da4ULL, 0x1b2ba1518094da04ULL},
+    {0x87aa9aff79042286ULL, 0x90fb44d2f05d0842ULL},
+    {0xa99541bf57452b28ULL, 0x353a1607ac744a53ULL},
+    {0xd3fa922f2d1675f2ULL, 0x42889b8997915ce8ULL},
+    {0x847c9b5d7c2e09b7ULL, 0x69956135febada11ULL},
+    {0xa59bc234db398c25ULL, 0x43fab9837e699095ULL},
+    {0xcf02b2c21207ef2eULL, 0x94f967e45e03f4bbULL},
+    {0x8161afb94b44f57dULL, 0x1d1be0eebac278f5ULL},
+    {0xa1ba1ba79e1632dcULL, 0x6462d92a69731732ULL},
+    {0xca28a291859bbf93ULL, 0x7d7b8f7503cfdcfeULL},
+    {0xfcb2cb35e702af78ULL, 0x5cda735244c3d43eULL},
+    {0x9defbf01b061adabULL, 0x3a0888136afa64a7ULL},
+    {0xc56baec21c7a1916ULL, 0x088aaa1845b8fdd0ULL},
+    {0xf6c69a72a3989f5bULL, 0x8aad549e57273d45ULL},
+    {0x9a3c2087a63f6399ULL, 0x36ac54e2f678864bULL},
+    {0xc0cb28a98fcf3c7fULL, 0x84576a1bb416a7ddULL},
+    {0xf0fdf2d3f3c30b9fULL, 0x656d44a2a11c51d5ULL},
+    {0x969eb7c47859e743ULL, 0x9f644ae5a4b1b325ULL},
+    {0xbc4665b596706114ULL, 0x873d5d9f0dde1feeULL},
+    {0xeb57ff22fc0c7959ULL, 0xa90cb506d155a7eaULL},
+    {0x9316ff75dd87cbd8ULL, 0x09a7f12442d588f2ULL},
+    {0xb7dcbf5354e9beceULL, 0x0c11ed6d538aeb2fULL},
+    {0xe5d3ef282a242e81ULL, 0x8f1668c8a86da5faULL},
+    {0x8fa475791a569d10ULL, 0xf96e017d694487bcULL},
+    {0xb38d92d760ec4455ULL, 0x37c981dcc395a9acULL},
+    {0xe070f78d3927556aULL, 0x85bbe253f47b1417ULL},
+    {0x8c469ab843b89562ULL, 0x93956d7478ccec8eULL},
+    {0xaf58416654a6babbULL, 0x387ac8d1970027b2ULL},
+    {0xdb2e51bfe9d0696aULL, 0x06997b05fcc0319eULL},
+    {0x88fcf317f22241e2ULL, 0x441fece3bdf81f03ULL},
+    {0xab3c2fddeeaad25aULL, 0xd527e81cad7626c3ULL},
+    {0xd60b3bd56a5586f1ULL, 0x8a71e223d8d3b074ULL},
+    {0x85c7056562757456ULL, 0xf6872d5667844e49ULL},
+    {0xa738c6bebb12d16cULL, 0xb428f8ac016561dbULL},
+    {0xd106f86e69d785c7ULL, 0xe13336d701beba52ULL},
+    {0x82a45b450226b39cULL, 0xecc0024661173473ULL},
+    {0xa34d721642b06084ULL, 0x27f002d7f95d0190ULL},
+    {0xcc20ce9bd35c78a5ULL, 0x31ec038df7b441f4ULL},
+    {0xff290242c83396ceULL, 0x7e67047175a15271ULL},
+    {0x9f79a169bd203e41ULL, 0x0f0062c6e984d386ULL},
+    {0xc75809c42c684dd1ULL, 0x52c07b78a3e60868ULL},
+    {0xf92e0c3537826145ULL, 0xa7709a56ccdf8a82ULL},
+    {0x9bbcc7a142b17ccbULL, 0x88a66076400bb691ULL},
+    {0xc2abf989935ddbfeULL, 0x6acff893d00ea435ULL},
+    {0xf356f7ebf83552feULL, 0x0583f6b8c4124d43ULL},
+    {0x98165af37b2153deULL, 0xc3727a337a8b704aULL},
+    {0xbe1bf1b059e9a8d6ULL, 0x744f18c0592e4c5cULL},
+    {0xeda2ee1c7064130cULL, 0x1162def06f79df73ULL},
+    {0x9485d4d1c63e8be7ULL, 0x8addcb5645ac2ba8ULL},
+    {0xb9a74a0637ce2ee1ULL, 0x6d953e2bd7173692ULL},
+    {0xe8111c87c5c1ba99ULL, 0xc8fa8db6ccdd0437ULL},
+    {0x910ab1d4db9914a0ULL, 0x1d9c9892400a22a2ULL},
+    {0xb54d5e4a127f59c8ULL, 0x2503beb6d00cab4bULL},
+    {0xe2a0b5dc971f303aULL, 0x2e44ae64840fd61dULL},
+    {0x8da471a9de737e24ULL, 0x5ceaecfed289e5d2ULL},
+    {0xb10d8e1456105dadULL, 0x7425a83e872c5f47ULL},
+    {0xdd50f1996b947518ULL, 0xd12f124e28f77719ULL},
+    {0x8a5296ffe33cc92fULL, 0x82bd6b70d99aaa6fULL},
+    {0xace73cbfdc0bfb7bULL, 0x636cc64d1001550bULL},
+    {0xd8210befd30efa5aULL, 0x3c47f7e05401aa4eULL},
+    {0x8714a775e3e95c78ULL, 0x65acfaec34810a71ULL},
+    {0xa8d9d1535ce3b396ULL, 0x7f1839a741a14d0dULL},
+    {0xd31045a8341ca07cULL, 0x1ede48111209a050ULL},
+    {0x83ea2b892091e44dULL, 0x934aed0aab460432ULL},
+    {0xa4e4b66b68b65d60ULL, 0xf81da84d5617853fULL},
+    {0xce1de40642e3f4b9ULL, 0x36251260ab9d668eULL},
+    {0x80d2ae83e9ce78f3ULL, 0xc1d72b7c6b426019ULL},
+    {0xa1075a24e4421730ULL, 0xb24cf65b8612f81fULL},
+    {0xc94930ae1d529cfcULL, 0xdee033f26797b627ULL},
+    {0xfb9b7cd9a4a7443cULL, 0x169840ef017da3b1ULL},
+    {0x9d412e0806e88aa5ULL, 0x8e1f289560ee864eULL},
+    {0xc491798a08a2ad4eULL, 0xf1a6f2bab92a27e2ULL},
+    {0xf5b5d7ec8acb58a2ULL, 0xae10af696774b1dbULL},
+    {0x9991a6f3d6bf1765ULL, 0xacca6da1e0a8ef29ULL},
+    {0xbff610b0cc6edd3fULL, 0x17fd090a58d32af3ULL},
+    {0xeff394dcff8a948eULL, 0xddfc4b4cef07f5b0ULL},
+    {0x95f83d0a1fb69cd9ULL, 0x4abdaf101564f98eULL},
+    {0xbb764c4ca7a4440fULL, 0x9d6d1ad41abe37f1ULL},
+    {0xea53df5fd18d5513ULL, 0x84c86189216dc5edULL},
+    {0x92746b9be2f8552cULL, 0x32fd3cf5b4e49bb4ULL},
+    {0xb7118682dbb66a77ULL, 0x3fbc8c33221dc2a1ULL},
+    {0xe4d5e82392a40515ULL, 0x0fabaf3feaa5334aULL},
+    {0x8f05b1163ba6832dULL, 0x29cb4d87f2a7400eULL},
+    {0xb2c71d5bca9023f8ULL, 0x743e20e9ef511012ULL},
+    {0xdf78e4b2bd342cf6ULL, 0x914da9246b255416ULL},
+    {0x8bab8eefb6409c1aULL, 0x1ad089b6c2f7548eULL},
+    {0xae9672aba3d0c320ULL, 0xa184ac2473b529b1ULL},
+    {0xda3c0f568cc4f3e8ULL, 0xc9e5d72d90a2741eULL},
+    {0x8865899617fb1871ULL, 0x7e2fa67c7a658892ULL},
+    {0xaa7eebfb9df9de8dULL, 0xddbb901b98feeab7ULL},
+    {0xd51ea6fa85785631ULL, 0x552a74227f3ea565ULL},
+    {0x8533285c936b35deULL, 0xd53a88958f87275fULL},
+    {0xa67ff273b8460356ULL, 0x8a892abaf368f137ULL},
+    {0xd01fef10a657842cULL, 0x2d2b7569b0432d85ULL},
+    {0x8213f56a67f6b29bULL, 0x9c3b29620e29fc73ULL},
+    {0xa298f2c501f45f42ULL, 0x8349f3ba91b47b8fULL},
+    {0xcb3f2f7642717713ULL, 0x241c70a936219a73ULL},
+    {0xfe0efb53d30dd4d7ULL, 0xed238cd383aa0110ULL},
+    {0x9ec95d1463e8a506ULL, 0xf4363804324a40aaULL},
+    {0xc67bb4597ce2ce48ULL, 0xb143c6053edcd0d5ULL},
+    {0xf81aa16fdc1b81daULL, 0xdd94b7868e94050aULL},
+    {0x9b10a4e5e9913128ULL, 0xca7cf2b4191c8326ULL},
+    {0xc1d4ce1f63f57d72ULL, 0xfd1c2f611f63a3f0ULL},
+    {0xf24a01a73cf2dccfULL, 0xbc633b39673c8cecULL},
+    {0x976e41088617ca01ULL, 0xd5be0503e085d813ULL},
+    {0xbd49d14aa79dbc82ULL, 0x4b2d8644d8a74e18ULL},
+    {0xec9c459d51852ba2ULL, 0xddf8e7d60ed1219eULL},
+    {0x93e1ab8252f33b45ULL, 0xcabb90e5c942b503ULL},
+    {0xb8da1662e7b00a17ULL, 0x3d6a751f3b936243ULL},
+    {0xe7109bfba19c0c9dULL, 0x0cc512670a783ad4ULL},
+    {0x906a617d450187e2ULL, 0x27fb2b80668b24c5ULL},
+    {0xb484f9dc9641e9daULL, 0xb1f9f660802dedf6ULL},
+    {0xe1a63853bbd26451ULL, 0x5e7873f8a0396973ULL},
+    {0x8d07e33455637eb2ULL, 0xdb0b487b6423e1e8ULL},
+    {0xb049dc016abc5e5fULL, 0x91ce1a9a3d2cda62ULL},
+    {0xdc5c5301c56b75f7ULL, 0x7641a140cc7810fbULL},
+    {0x89b9b3e11b6329baULL, 0xa9e904c87fcb0a9dULL},
+    {0xac2820d9623bf429ULL, 0x546345fa9fbdcd44ULL},
+    {0xd732290fbacaf133ULL, 0xa97c177947ad4095ULL},
+    {0x867f59a9d4bed6c0ULL, 0x49ed8eabcccc485dULL},
+    {0xa81f301449ee8c70ULL, 0x5c68f256bfff5a74ULL},
+    {0xd226fc195c6a2f8cULL, 0x73832eec6fff3111ULL},
+    {0x83585d8fd9c25db7ULL, 0xc831fd53c5ff7eabULL},
+    {0xa42e74f3d032f525ULL, 0xba3e7ca8b77f5e55ULL},
+    {0xcd3a1230c43fb26fULL, 0x28ce1bd2e55f35ebULL},
+    {0x80444b5e7aa7cf85ULL, 0x7980d163cf5b81b3ULL},
+    {0xa0555e361951c366ULL, 0xd7e105bcc332621fULL},
+    {0xc86ab5c39fa63440ULL, 0x8dd9472bf3fefaa7ULL},
+    {0xfa856334878fc150ULL, 0xb14f98f6f0feb951ULL},
+    {0x9c935e00d4b9d8d2ULL, 0x6ed1bf9a569f33d3ULL},
+    {0xc3b8358109e84f07ULL, 0x0a862f80ec4700c8ULL},
+    {0xf4a642e14c6262c8ULL, 0xcd27bb612758c0faULL},
+    {0x98e7e9cccfbd7dbdULL, 0x8038d51cb897789cULL},
+    {0xbf21e44003acdd2cULL, 0xe0470a63e6bd56c3ULL},
+    {0xeeea5d5004981478ULL, 0x1858ccfce06cac74ULL},
+    {0x95527a5202df0ccbULL, 0x0f37801e0c43ebc8ULL},
+    {0xbaa718e68396cffdULL, 0xd30560258f54e6baULL},
+    {0xe950df20247c83fdULL, 0x47c6b82ef32a2069ULL},
+    {0x91d28b7416cdd27eULL, 0x4cdc331d57fa5441ULL},
+    {0xb6472e511c81471dULL, 0xe0133fe4adf8e952ULL},
+    {0xe3d8f9e563a198e5ULL, 0x58180fddd97723a6ULL},
+    {0x8e679c2f5e44ff8fULL, 0x570f09eaa7ea7648ULL},
+};
+
+static const double json_exact_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/* High 64 bits of a * b; the low half goes to *low */
+static uint64_t json_mul_128(uint64_t a, uint64_t b, uint64_t *low) {
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 json_u128;
+    json_u128 product = (json_u128)a * b;
+    *low = (uint64_t)product;
+    return (uint64_t)(product >> 64);
+#else
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32, b_lo = (uint32_t)b, b_hi = b >> 32;
+    uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+    uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+    *low = (cross << 32) | (uint32_t)lo_lo;
+    return (hi_lo >> 32) + (cross >> 32) + hi_hi;
+#endif
+}
+
+/*
+ * Eisel-Lemire: w * 10^q as IEEE bits, or false when the 128-bit
+ * approximation cannot decide the rounding.
+ */
+static bool json_eisel_lemire(uint64_t w, int64_t q, uint64_t *bits) {
+    if (w == 0 || q < -342) {
+        *bits = 0;
+        return true;
+    }
+    if (q > 308) {
+        *bits = 0x7FFULL << 52;
+        return true;
+    }
+
+    int lz = __builtin_clzll(w);
+    w <<= lz;
+    const uint64_t *pow5 = json_pow5_128[q + 342];
+    uint64_t low;
+    uint64_t high = json_mul_128(w, pow5[0], &low);
+    if ((high & 0x1FF) == 0x1FF) {
+        uint64_t second_low;
+        uint64_t second_high = json_mul_128(w, pow5[1], &second_low);
+        low += second_high;
+        if (second_high > low) high++;
+        if (low == UINT64_MAX && (q < -27 || q > 55)) return false;
+    }
+
+    int upperbit = (int)(high >> 63);
+    uint64_t mantissa = high >> (upperbit + 9);
+    int power2 = (int)((((152170 + 65536) * q) >> 16) + 63) + upperbit - lz + 1023;
+
+    if (power2 <= 0) { // subnormal
+        if (-power2 + 1 >= 64) {
+            *bits = 0;
+            return true;
+        }
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        power2 = mantissa < (1ULL << 52) ? 0 : 1;
+        *bits = ((uint64_t)power2 << 52) | (mantissa & ((1ULL << 52) - 1));
+        return true;
+    }
+
+    // Exactly halfway: round to even instead of up
+    if (low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1
+        && (mantissa << (upperbit + 9)) == high) {
+        mantissa &= ~1ULL;
+    }
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= (2ULL << 52)) {
+        mantissa = 1ULL << 52;
+        power2++;
+    }
+    mantissa &= ~(1ULL << 52);
+    if (power2 >= 0x7FF) {
+        power2 = 0x7FF;
+        mantissa = 0;
+    }
+    *bits = ((uint64_t)power2 << 52) | mantissa;
+    return true;
+}
+
+/* Correctly rounded fallback: strtod with the C locale, whatever the process locale is */
+static locale_t json_c_locale = (locale_t)0;
+static pthread_once_t json_c_locale_once = PTHREAD_ONCE_INIT;
+
+static void json_c_locale_init(void) {
+    json_c_locale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+}
+
+static double json_strtod_c(const char *start, const char *end) {
+    pthread_once(&json_c_locale_once, json_c_locale_init);
+    locale_t c_locale = json_c_locale;
+    char small[64];
+    size_t len = (size_t)(end - start);
+    char *copy = len < sizeof(small) ? small : arena_memory_alloc(len + 1);
+    if (!copy) return strtod(start, NULL);
+    memcpy(copy, start, len);
+    copy[len] = '\0';
+    locale_t previous = c_locale ? uselocale(c_locale) : (locale_t)0;
+    double value = strtod(copy, NULL);
+    if (previous) uselocale(previous);
+    if (copy != small) arena_memory_free(copy);
+    return value;
+}
+
+static double json_number_to_double(const JsonNumberScan *n) {
+    uint64_t bits, bits_up;
+    double value;
+    if (!n->truncated) {
+        if (n->mantissa <= (1ULL << 53) && n->exponent >= -22 && n->exponent <= 22) {
+            value = (double)n->mantissa;
+            if (n->exponent < 0) value /= json_exact_pow10[-n->exponent];
+            else value *= json_exact_pow10[n->exponent];
+            return n->negative ? -value : value;
+        }
+        if (json_eisel_lemire(n->mantissa, n->exponent, &bits)) {
+            memcpy(&value, &bits, sizeof(value));
+            return n->negative ? -value : value;
+        }
+    } else if (json_eisel_lemire(n->mantissa, n->exponent, &bits)
+               && json_eisel_lemire(n->mantissa + 1, n->exponent, &bits_up) && bits == bits_up) {
+        /* The dropped digits lie between the two candidates, which agree */
+        memcpy(&value, &bits, sizeof(value));
+        return n->negative ? -value : value;
+    }
+    return json_strtod_c(n->start, n->end);
+}
+
+/* Parse the number at p into item according to mode; returns its end or NULL */
+static const char *json_parse_number__(POSITION_INFO_DECLARATION, Arena *arena, const char *p,
+                                       Json *item, JsonNumberMode mode) {
+    JsonNumberScan n;
+    if (!json_scan_number(p, &n)) {
+        raise_debug__(file, func, line, "No valid number found at: %p", p);
+        return NULL;
+    }
+    if (mode == JSON_NUMBERS_RAW) {
+        size_t len = (size_t)(n.end - n.start);
+        item->type = JSON_RAW_NUMBER;
+        item->value.string = arena_alloc__(file, func, line, arena, len + 1);
+        memcpy(item->value.string, n.start, len);
+        item->value.string[len] = '\0';
+    } else if (mode != JSON_NUMBERS_DOUBLE && json_number_to_int64(&n, &item->value.integer)) {
+        item->type = JSON_INTEGER;
+    } else {
+        item->type = JSON_NUMBER;
+        item->value.number = json_number_to_double(&n);
+    }
+    return n.end;
+}
+
+static Json *json_alloc_item__(POSITION_INFO_DECLARATION, Arena *arena, JsonType type) {
+    Json *item = arena_alloc__(file, func, line, arena, sizeof(Json));
+    memset(item, 0, sizeof(Json));
+    item->type = type;
+    return item;
+}
+
+/* An open container while parsing: its last child so far and how many it has */
+typedef struct {
+    Json *container;
+    Json *last;
+    size_t count;
+} JsonBuildFrame;
+
+/* Parse a string, literal or number at *s; containers are left to the caller */
+static Json *json_parse_scalar__(POSITION_INFO_DECLARATION, const char **s, Arena *arena, const JsonParseOptions *opts) {
+    raise_debug__(file, func, line, "Parsing JSON value at position: %p", *s);
+    Json *item;
+    if (**s == '"') {
+        item = json_alloc_item__(file, func, line, arena, JSON_STRING);
+        item->value.string = json_parse_string__(file, func, line, s, arena, opts->strings, &item->flags);
+        if (!item->value.string) return NULL;
+    } else if (strncmp(*s, "null", 4) == 0) {
+        item = json_alloc_item__(file, func, line, arena, JSON_NULL);
+        *s += 4;
+    } else if (strncmp(*s, "true", 4) == 0) {
+        item = json_alloc_item__(file, func, line, arena, JSON_BOOL);
+        item->value.boolean = 1;
+        *s += 4;
+    } else if (strncmp(*s, "false", 5) == 0) {
+        item = json_alloc_item__(file, func, line, arena, JSON_BOOL);
+        *s += 5;
+    } else if ((**s == '-') || isdigit((unsigned char)**s)) {
+        item = json_alloc_item__(file, func, line, arena, JSON_NUMBER);
+        const char *end = json_parse_number__(file, func, line, arena, *s, item, opts->numbers);
+        if (!end) return NULL;
+        *s = end;
+    } else {
+        raise_debug__(file, func, line, "Unrecognized JSON value at position: %p", *s);
+        return NULL;
+    }
+    return item;
+}
+
+/*
+ * Full JSON value parser. The recursive-descent grammar runs as one loop
+ * over an explicit stack of open containers kept in the arena, so nesting
+ * costs a 24-byte frame instead of a C stack frame and stops cleanly at
+ * opts->max_depth. A container left open at the end of input is accepted,
+ * and so is a trailing comma right before it. On failure *code tells a
+ * syntax error from JSON_ERROR_DEPTH_LIMIT or JSON_ERROR_OUT_OF_MEMORY.
+ */
+static Json *json_parse_value__(POSITION_INFO_DECLARATION, const char **s, Arena *arena,
+                                const JsonParseOptions *opts, HecticErrorCode *code) {
+    size_t max_depth = opts->max_depth ? opts->max_depth : JSON_MAX_DEPTH_DEFAULT;
+    JsonBuildFrame *stack = NULL;
+    size_t depth = 0, capacity = 0;
+    Json *root = NULL;
+    char *key = NULL;
+
+    *code = JSON_ERROR_SYNTAX;
+    for (;;) {
+        if (depth > 0 && stack[depth - 1].container->type == JSON_OBJECT) {
+            key = json_parse_string__(file, func, line, s, arena, opts->strings, NULL);
+            if (!key) {
+                raise_debug__(file, func, line, "Failed to parse key in object");
+                return NULL;
+            }
+            *s = skip_whitespace(*s);
+            if (**s != ':') {
+                raise_debug__(file, func, line, "Expected ':' after key \"%s\", got: %c", key, **s);
+                return NULL;
+            }
+            (*s)++; // skip ':'
+        }
+
+        *s = skip_whitespace(*s);
+        Json *item;
+        if (**s == '[' || **s == '{') {
+            if (depth == max_depth) {
+                raise_debug__(file, func, line, "PARSE: Nesting deeper than %zu at %p", max_depth, *s);
+                *code = JSON_ERROR_DEPTH_LIMIT;
+                return NULL;
+            }
+            item = json_alloc_item__(file, func, line, arena, **s == '[' ? JSON_ARRAY : JSON_OBJECT);
+            *s = skip_whitespace(*s + 1);
+        } else {
+            item = json_parse_scalar__(file, func, line, s, arena, opts);
+            if (!item) return NULL;
+        }
+
+        if (depth > 0) {
+            JsonBuildFrame *top = &stack[depth - 1];
+            if (top->container->type == JSON_OBJECT) item->key = key;
+            if (top->last) top->last->next = item;
+            else top->container->value.child = item;
+            top->last = item;
+            top->count++;
+        } else {
+            root = item;
+        }
+
+        if (item->type == JSON_ARRAY || item->type == JSON_OBJECT) {
+            char close = item->type == JSON_ARRAY ? ']' : '}';
+            if (**s == close) {
+                (*s)++;
+            } else if (**s) {
+                if (depth == capacity) {
+                    size_t new_capacity = capacity ? capacity * 2 : 16;
+                    JsonBuildFrame *grown = arena_alloc_or_null__(file, func, line, arena,
+                                                                  new_capacity * sizeof(JsonBuildFrame), false);
+                    if (!grown) {
+                        raise_debug__(file, func, line, "PARSE: Failed to grow nesting stack to %zu frames", new_capacity);
+                        *code = JSON_ERROR_OUT_OF_MEMORY;
+                        return NULL;
+                    }
+                    if (stack) memcpy(grown, stack, depth * sizeof(JsonBuildFrame));
+                    stack = grown;
+                    capacity = new_capacity;
+                }
+                stack[depth++] = (JsonBuildFrame){ .container = item, .last = NULL, .count = 0 };
+                continue;
+            }
+            /* Empty, or opened at the end of input: nothing to push */
+        }
+
+        // Close every container the value completes; stop at the next member
+        for (;;) {
+            if (depth == 0) return root;
+            JsonBuildFrame *top = &stack[depth - 1];
+            bool object = top->container->type == JSON_OBJECT;
+            *s = skip_whitespace(*s);
+            if (**s == ',') {
+                *s = skip_whitespace(*s + 1);
+                if (**s) break;
+                /* Trailing comma at the end of input closes the container */
+            } else if (**s == (object ? '}' : ']')) {
+                (*s)++;
+            } else {
+                raise_debug__(file, func, line, "Unexpected character '%c' in %s", **s, object ? "object" : "array");
+                return NULL;
+            }
+            if (object) json_object_index_parsed__(file, func, line, arena, top->container, top->count, opts);
+            depth--;
+        }
+    }
+}
+
+/*
+ * Structural engine.
+ *
+ * Stage 1 classifies the input 64 bytes at a time into bitmasks (quotes,
+ * backslashes, structural characters, whitespace), drops escaped quotes,
+ * masks string contents out with a prefix xor and records the offset of
+ * every token: structural characters, both quotes of each string and the
+ * first byte of every bare scalar. Stage 2 walks that index with an explicit
+ * stack and builds the same tree `json_parse_value__` would, including its
+ * leniencies (a container left open at the end of input is accepted, and so
+ * is a trailing comma right before it).
+ */
+
+#define JSON_BLOCK_SIZE 64
+
+typedef struct {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t structural;
+    uint64_t whitespace;
+} JsonBlockMasks;
+
+typedef struct {
+    uint64_t escape_carry;  /* 1 when the previous block ended with an unescaped backslash */
+    uint64_t in_string;     /* all ones when the previous block ended inside a string */
+    uint64_t scalar_carry;  /* 1 when the previous block ended inside a bare scalar */
+    uint32_t *positions;
+    size_t count;
+} JsonIndexer;
+
+enum {
+    JSON_CLASS_QUOTE      = 1 << 0,
+    JSON_CLASS_BACKSLASH  = 1 << 1,
+    JSON_CLASS_STRUCTURAL = 1 << 2,
+    JSON_CLASS_WHITESPACE = 1 << 3,
+};
+
+/* Whitespace matches isspace() in the C locale, as skip_whitespace() does */
+static const unsigned char json_char_class[256] = {
+    ['"']  = JSON_CLASS_QUOTE,
+    ['\\'] = JSON_CLASS_BACKSLASH,
+    ['{']  = JSON_CLASS_STRUCTURAL,
+    ['}']  = JSON_CLASS_STRUCTURAL,
+    ['[']  = JSON_CLASS_STRUCTURAL,
+    [']']  = JSON_CLASS_STRUCTURAL,
+    [':']  = JSON_CLASS_STRUCTURAL,
+    [',']  = JSON_CLASS_STRUCTURAL,
+    [' ']  = JSON_CLASS_WHITESPACE,
+    ['\t'] = JSON_CLASS_WHITESPACE,
+    ['\n'] = JSON_CLASS_WHITESPACE,
+    ['\v'] = JSON_CLASS_WHITESPACE,
+    ['\f'] = JSON_CLASS_WHITESPACE,
+    ['\r'] = JSON_CLASS_WHITESPACE,
+};
+
+static void json_block_masks_scalar(const unsigned char *p, JsonBlockMasks *m) {
+    uint64_t quote = 0, backslash = 0, structural = 0, whitespace = 0;
+    for (int i = 0; i < JSON_BLOCK_SIZE; i++) {
+        unsigned char c = json_char_class[p[i]];
+        quote      |= (uint64_t)((c & JSON_CLASS_QUOTE) != 0) << i;
+        backslash  |= (uint64_t)((c & JSON_CLASS_BACKSLASH) != 0) << i;
+        structural |= (uint64_t)((c & JSON_CLASS_STRUCTURAL) != 0) << i;
+        whitespace |= (uint64_t)((c & JSON_CLASS_WHITESPACE) != 0) << i;
+    }
+    m->quote = quote;
+    m->backslash = backslash;
+    m->structural = structural;
+    m->whitespace = whitespace;
+}
+
+#ifdef HECTIC_SIMD_X86
+/*
+ * '[' and ']' differ from '{' and '}' only in bit 0x20, so OR-ing it in folds
+ * four structural compares into two. "\t\n\v\f\r" is the range 9..13, tested
+ * with one unsigned min after subtracting 9.
+ */
+__attribute__((target("sse2")))
+static void json_block_masks_sse2(const unsigned char *p, JsonBlockMasks *m) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    const __m128i brace_open = _mm_set1_epi8('{');
+    const __m128i brace_close = _mm_set1_epi8('}');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i control_span = _mm_set1_epi8('\r' - '\t');
+
+    *m = (JsonBlockMasks){0};
+    for (int k = 0; k < JSON_BLOCK_SIZE / 16; k++) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(const void *)(p + 16 * k));
+        __m128i folded = _mm_or_si128(v, case_bit);
+        __m128i structural = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(folded, brace_open), _mm_cmpeq_epi8(folded, brace_close)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+        __m128i control = _mm_sub_epi8(v, tab);
+        __m128i whitespace = _mm_or_si128(
+            _mm_cmpeq_epi8(_mm_min_epu8(control, control_span), control),
+            _mm_cmpeq_epi8(v, space));
+        int shift = 16 * k;
+        m->quote      |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)) << shift;
+        m->backslash  |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)) << shift;
+        m->structural |= (uint64_t)(uint32_t)_mm_movemask_epi8(structural) << shift;
+        m->whitespace |= (uint64_t)(uint32_t)_mm_movemask_epi8(whitespace) << shift;
+    }
+}
+
+__attribute__((target("avx2")))
+static void json_block_masks_avx2(const unsigned char *p, JsonBlockMasks *m) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    const __m256i brace_open = _mm256_set1_epi8('{');
+    const __m256i brace_close = _mm256_set1_epi8('}');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i control_span = _mm256_set1_epi8('\r' - '\t');
+
+    *m = (JsonBlockMasks){0};
+    for (int k = 0; k < JSON_BLOCK_SIZE / 32; k++) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(const void *)(p + 32 * k));
+        __m256i folded = _mm256_or_si256(v, case_bit);
+        __m256i structural = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(folded, brace_open), _mm256_cmpeq_epi8(folded, brace_close)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, colon), _mm256_cmpeq_epi8(v, comma)));
+        __m256i control = _mm256_sub_epi8(v, tab);
+        __m256i whitespace = _mm256_or_si256(
+            _mm256_cmpeq_epi8(_mm256_min_epu8(control, control_span), control),
+            _mm256_cmpeq_epi8(v, space));
+        int shift = 32 * k;
+        m->quote      |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)) << shift;
+        m->backslash  |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslash)) << shift;
+        m->structural |= (uint64_t)(uint32_t)_mm256_movemask_epi8(structural) << shift;
+        m->whitespace |= (uint64_t)(uint32_t)_mm256_movemask_epi8(whitespace) << shift;
+    }
+}
+#endif
+
+/* Bit i of the result is the xor of bits 0..i of x */
+static inline uint64_t json_prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+static inline void json_index_block(JsonIndexer *ix, const JsonBlockMasks *m, size_t base) {
+    /* A backslash escapes the next byte unless it is escaped itself */
+    uint64_t escaped = ix->escape_carry;
+    uint64_t backslash = m->backslash;
+    ix->escape_carry = 0;
+    while (backslash) {
+        int bit = __builtin_ctzll(backslash);
+        backslash &= backslash - 1;
+        if (escaped & (1ULL << bit)) continue;
+        if (bit == JSON_BLOCK_SIZE - 1) ix->escape_carry = 1;
+        else escaped |= 1ULL << (bit + 1);
+    }
+
+    /* Opening quote and string contents are set, the closing quote is not */
+    uint64_t quote = m->quote & ~escaped;
+    uint64_t in_string = json_prefix_xor(quote) ^ ix->in_string;
+    ix->in_string = 0 - (in_string >> 63);
+
+    uint64_t structural = m->structural & ~in_string;
+    uint64_t scalar = ~(m->structural | m->whitespace | quote | in_string);
+    uint64_t scalar_start = scalar & ~((scalar << 1) | ix->scalar_carry);
+    ix->scalar_carry = scalar >> 63;
+
+    uint64_t tokens = structural | quote | scalar_start;
+    while (tokens) {
+        ix->positions[ix->count++] = (uint32_t)(base + (size_t)__builtin_ctzll(tokens));
+        tokens &= tokens - 1;
+    }
+}
+
+typedef void (*JsonBlockMasksFn)(const unsigned char *p, JsonBlockMasks *m);
+
+/* Always inlined so that each instruction set gets its own loop with the mask function inlined */
+static inline __attribute__((always_inline))
+void json_index_run(JsonIndexer *ix, const char *input, size_t len, JsonBlockMasksFn masks) {
+    const unsigned char *p = (const unsigned char *)input;
+    JsonBlockMasks m;
+    size_t base = 0;
+    for (; base + JSON_BLOCK_SIZE <= len; base += JSON_BLOCK_SIZE) {
+        masks(p + base, &m);
+        json_index_block(ix, &m, base);
+    }
+    if (base < len) {
+        /* Pad the tail with whitespace, which never produces a token */
+        unsigned char tail[JSON_BLOCK_SIZE];
+        memset(tail, ' ', sizeof(tail));
+        memcpy(tail, p + base, len - base);
+        masks(tail, &m);
+        json_index_block(ix, &m, base);
+    }
+}
+
+static void json_index_scalar(JsonIndexer *ix, const char *input, size_t len) {
+    json_index_run(ix, input, len, json_block_masks_scalar);
+}
+
+#ifdef HECTIC_SIMD_X86
+__attribute__((target("sse2")))
+static void json_index_sse2(JsonIndexer *ix, const char *input, size_t len) {
+    json_index_run(ix, input, len, json_block_masks_sse2);
+}
+
+__attribute__((target("avx2")))
+static void json_index_avx2(JsonIndexer *ix, const char *input, size_t len) {
+    json_index_run(ix, input, len, json_block_masks_avx2);
+}
+#endif
+
+static void json_index(JsonIndexer *ix, const char *input, size_t len) {
+    switch (simd_level()) {
+#ifdef HECTIC_SIMD_X86
+        case SIMD_LEVEL_AVX2: json_index_avx2(ix, input, len); return;
+        case SIMD_LEVEL_SSE2: json_index_sse2(ix, input, len); return;
+#endif
+        default: json_index_scalar(ix, input, len); return;
+    }
+}
+
+typedef enum {
+    JSON_BUILD_VALUE,
+    JSON_BUILD_KEY,
+    JSON_BUILD_AFTER_VALUE,
+} JsonBuildState;
+
+/*
+ * Lazy parse. The document is checked up front against the grammar of
+ * json_parse_value__, without building anything, so it accepts exactly what
+ * the other engines accept. Children are then parsed one level at a time
+ * on first access through json_child, and nested containers are only
+ * delimited with a bracket-and-quote skip, the check having been done.
+ */
+
+/* Closing quote of the string body at start, checked like json_decode_body does it; NULL with *error set */
+static const char *json_check_string(const char *start, const char **error) {
+    const char *run = start;
+    for (;;) {
+        const char *p = json_find_special(run);
+        if (!json_utf8_valid(run, (size_t)(p - run))) {
+            *error = "Invalid UTF-8 in string";
+            return NULL;
+        }
+        if (*p == '"') return p;
+        if (*p != '\\') {
+            *error = "Unterminated string";
+            return NULL;
+        }
+        char scratch[4];
+        if (!json_decode_escape(&p, scratch, error)) return NULL;
+        run = p;
+    }
+}
+
+/* Moves *s past the scalar json_parse_scalar__ would read there; false when there is none */
+static bool json_check_scalar(const char **s) {
+    const char *p = *s;
+    if (*p == '"') {
+        const char *error = NULL;
+        const char *close = json_check_string(p + 1, &error);
+        if (!close) return false;
+        *s = close + 1;
+    } else if (strncmp(p, "null", 4) == 0 || strncmp(p, "true", 4) == 0) {
+        *s = p + 4;
+    } else if (strncmp(p, "false", 5) == 0) {
+        *s = p + 5;
+    } else {
+        JsonNumberScan n;
+        if ((*p != '-' && !isdigit((unsigned char)*p)) || !json_scan_number(p, &n)) return false;
+        *s = n.end;
+    }
+    return true;
+}
+
+/*
+ * json_parse_value__ without the tree: the same grammar, leniencies and
+ * depth limit, and *s ends up where it would. Open containers are one bit
+ * each, set for objects; the stack only leaves the C stack past 1024 levels.
+ */
+static bool json_check_value(const char **s, size_t max_depth, HecticErrorCode *code) {
+    uint64_t local[JSON_MAX_DEPTH_DEFAULT / 64];
+    uint64_t *objects = local;
+    size_t words = sizeof(local) / sizeof(local[0]);
+    size_t depth = 0;
+    bool ok = false;
+
+    *code = JSON_ERROR_SYNTAX;
+    for (;;) {
+        if (depth > 0 && (objects[(depth - 1) / 64] >> ((depth - 1) % 64) & 1)) {
+            if (**s != '"' || !json_check_scalar(s)) goto done;
+            *s = skip_whitespace(*s);
+            if (**s != ':') goto done;
+            (*s)++;
+        }
+
+        *s = skip_whitespace(*s);
+        if (**s == '[' || **s == '{') {
+            if (depth == max_depth) {
+                *code = JSON_ERROR_DEPTH_LIMIT;
+                goto done;
+            }
+            bool object = **s == '{';
+            *s = skip_whitespace(*s + 1);
+            if (**s == (object ? '}' : ']')) {
+                (*s)++;
+            } else if (**s) {
+                if (depth == words * 64) {
+                    uint64_t *grown = arena_memory_alloc(words * 2 * sizeof(uint64_t));
+                    if (!grown) {
+                        *code = JSON_ERROR_OUT_OF_MEMORY;
+                        goto done;
+                    }
+                    memcpy(grown, objects, words * sizeof(uint64_t));
+                    if (objects != local) arena_memory_free(objects);
+                    objects = grown;
+                    words *= 2;
+                }
+                uint64_t bit = (uint64_t)1 << (depth % 64);
+                if (object) objects[depth / 64] |= bit;
+                else objects[depth / 64] &= ~bit;
+                depth++;
+                continue;
+            }
+            /* Empty, or opened at the end of input */
+        } else if (!json_check_scalar(s)) {
+            goto done;
+        }
+
+        for (;;) {
+            if (depth == 0) {
+                ok = true;
+                goto done;
+            }
+            bool object = objects[(depth - 1) / 64] >> ((depth - 1) % 64) & 1;
+            *s = skip_whitespace(*s);
+            if (**s == ',') {
+                *s = skip_whitespace(*s + 1);
+                if (**s) break;
+                /* Trailing comma at the end of input closes the container */
+            } else if (**s == (object ? '}' : ']')) {
+                (*s)++;
+            } else {
+                goto done;
+            }
+            depth--;
+        }
+    }
+
+done:
+    if (objects != local) arena_memory_free(objects);
+    return ok;
+}
+
+/* End of a container already checked by json_check_value, or NULL when its brackets do not balance or nest too deep */
+static const char *json_skip_container(const char *p, size_t max_depth, HecticErrorCode *code) {
+    size_t depth = 0;
+    *code = JSON_ERROR_SYNTAX;
+    for (;;) {
+        p += strcspn(p, "\"[]{}");
+        switch (*p) {
+            case '\0':
+                return NULL;
+            case '"':
+                for (p = json_find_special(p + 1); *p == '\\'; p = json_find_special(p + 2)) {
+                    if (!p[1]) return NULL;
+                }
+                if (!*p) return NULL;
+                break;
+            case '[':
+            case '{':
+                if (depth++ == max_depth) {
+                    *code = JSON_ERROR_DEPTH_LIMIT;
+                    return NULL;
+                }
+                break;
+            default:
+                if (--depth == 0) return p + 1;
+                break;
+        }
+        p++;
+    }
+}
+
+/* checked: *s lies inside a document json_check_value has accepted */
+static Json *json_lazy_value__(POSITION_INFO_DECLARATION, const char **s, Arena *arena,
+                               const JsonParseOptions *opts, bool checked, HecticErrorCode *code) {
+    *s = skip_whitespace(*s);
+    *code = JSON_ERROR_SYNTAX;
+    if (**s != '[' && **s != '{') return json_parse_scalar__(file, func, line, s, arena, opts);
+
+    size_t max_depth = opts->max_depth ? opts->max_depth : JSON_MAX_DEPTH_DEFAULT;
+    const char *end = *s;
+    if (checked) {
+        end = json_skip_container(end, max_depth, code);
+    } else if (!json_check_value(&end, max_depth, code)) {
+        end = NULL;
+    }
+    if (!end) {
+        raise_debug__(file, func, line, "PARSE: %s container at %p",
+                      *code == JSON_ERROR_DEPTH_LIMIT ? "Too deeply nested" : "Malformed", *s);
+        return NULL;
+    }
+    Json *item = json_alloc_item__(file, func, line, arena, **s == '[' ? JSON_ARRAY : JSON_OBJECT);
+    item->index = arena_alloc__(file, func, line, arena, sizeof(JsonObjectIndex));
+    *item->index = (JsonObjectIndex){ .arena = arena, .lazy = *s, .opts = opts };
+    *s = end;
+    return item;
+}
+
+static void json_lazy_expand__(POSITION_INFO_DECLARATION, Json *container) {
+    JsonObjectIndex *pending = container->index;
+    const char *s = pending->lazy;
+    Arena *arena = pending->arena;
+    const JsonParseOptions *opts = pending->opts;
+    container->index = NULL;
+
+    bool object = container->type == JSON_OBJECT;
+    char close = object ? '}' : ']';
+    Json *last = NULL;
+    size_t count = 0;
+    s = skip_whitespace(s + 1);
+    // Only the top container can be left open at the end of input, the check let it through
+    bool closed = *s == close || !*s;
+    while (!closed) {
+        char *key = NULL;
+        if (object) {
+            key = json_parse_string__(file, func, line, &s, arena, opts->strings, NULL);
+            s = skip_whitespace(s);
+            if (!key || *s != ':') break;
+            s++;
+        }
+        HecticErrorCode code;
+        Json *value = json_lazy_value__(file, func, line, &s, arena, opts, true, &code);
+        if (!value) break;
+        value->key = key;
+        if (last) last->next = value;
+        else container->value.child = value;
+        last = value;
+        count++;
+        s = skip_whitespace(s);
+        if (*s == ',') {
+            s = skip_whitespace(s + 1);
+            closed = !*s;
+        } else {
+            closed = *s == close;
+            if (!closed) break;
+        }
+    }
+    if (closed) {
+        if (object && count) json_object_index_parsed__(file, func, line, arena, container, count, opts);
+        raise_trace__(file, func, line, "PARSE: Expanded lazy %s with %zu children",
+                      json_type_to_string(container->type), count);
+        return;
+    }
+    raise_warn__(file, func, line, "PARSE: Malformed JSON %s in lazily parsed region near '%.10s'",
+                 json_type_to_string(container->type), s);
+    container->value.child = NULL;
+}
+
+
+static JsonResult json_build_from_index__(POSITION_INFO_DECLARATION, Arena *arena, const char **s,
+                                          size_t len, const uint32_t *pos, size_t count,
+                                          const JsonParseOptions *opts) {
+    const char *input = *s;
+    const char *end = input;  /* First byte after the last completed value */
+    const char *error = NULL;
+    HecticErrorCode code = JSON_ERROR_SYNTAX;
+    size_t max_depth = opts->max_depth ? opts->max_depth : JSON_MAX_DEPTH_DEFAULT;
+    JsonBuildFrame *stack = NULL;
+    size_t depth = 0, capacity = 0;
+    Json *root = NULL;
+    char *key = NULL;
+    size_t i = 0;
+    JsonBuildState state = JSON_BUILD_VALUE;
+
+    while (!error) {
+        if (state == JSON_BUILD_KEY) {
+            if (i >= count || input[pos[i]] != '"') {
+                error = "Expected string key in object";
+                break;
+            }
+            const char *close = NULL;
+            key = json_take_string__(file, func, line, arena, input + pos[i] + 1, &close, &error, opts->strings, NULL);
+            if (!key) break;
+            i += 2;
+            if (i >= count || input[pos[i]] != ':') {
+                error = "Expected ':' after key";
+                break;
+            }
+            i++;
+            state = JSON_BUILD_VALUE;
+        } else if (state == JSON_BUILD_VALUE) {
+            if (i >= count) {
+                error = "Unrecognized JSON value";
+                break;
+            }
+            const char *p = input + pos[i];
+            Json *item = NULL;
+            state = JSON_BUILD_AFTER_VALUE;
+            if (*p == '"') {
+                const char *close = NULL;
+                unsigned flags = 0;
+                char *string = json_take_string__(file, func, line, arena, p + 1, &close, &error, opts->strings, &flags);
+                if (!string) break;
+                item = json_alloc_item__(file, func, line, arena, JSON_STRING);
+                item->value.string = string;
+                item->flags = flags;
+                end = close + 1;
+                i += 2;
+            } else if (strncmp(p, "null", 4) == 0) {
+                item = json_alloc_item__(file, func, line, arena, JSON_NULL);
+                end = p + 4;
+                i++;
+            } else if (strncmp(p, "true", 4) == 0) {
+                item = json_alloc_item__(file, func, line, arena, JSON_BOOL);
+                item->value.boolean = 1;
+                end = p + 4;
+                i++;
+            } else if (strncmp(p, "false", 5) == 0) {
+                item = json_alloc_item__(file, func, line, arena, JSON_BOOL);
+                end = p + 5;
+                i++;
+            } else if (*p == '-' || isdigit((unsigned char)*p)) {
+                item = json_alloc_item__(file, func, line, arena, JSON_NUMBER);
+                end = json_parse_number__(file, func, line, arena, p, item, opts->numbers);
+                if (!end) {
+                    error = "Invalid number";
+                    break;
+                }
+                i++;
+            } else if (*p == '[' || *p == '{') {
+                if (depth == max_depth) {
+                    error = "Nesting deeper than max_depth";
+                    code = JSON_ERROR_DEPTH_LIMIT;
+                    break;
+                }
+                item = json_alloc_item__(file, func, line, arena, *p == '[' ? JSON_ARRAY : JSON_OBJECT);
+                i++;
+            } else {
+                error = "Unrecognized JSON value";
+                break;
+            }
+
+            if (depth > 0) {
+                JsonBuildFrame *top = &stack[depth - 1];
+                if (top->container->type == JSON_OBJECT) item->key = key;
+                if (top->last) top->last->next = item;
+                else top->container->value.child = item;
+                top->last = item;
+                top->count++;
+            } else {
+                root = item;
+            }
+
+            if (item->type == JSON_ARRAY || item->type == JSON_OBJECT) {
+                char close = item->type == JSON_ARRAY ? ']' : '}';
+                if (i < count && input[pos[i]] == close) {
+                    end = input + pos[i] + 1;
+                    i++;
+                } else if (i == count) {
+                    /* Opened at the end of input: accepted as an empty container */
+                    end = input + len;
+                } else {
+                    if (depth == capacity) {
+                        size_t new_capacity = capacity ? capacity * 2 : 32;
+                        JsonBuildFrame *grown = arena_memory_alloc(new_capacity * sizeof(JsonBuildFrame));
+                        if (!grown) {
+                            arena_memory_free(stack);
+                            return RESULT_ERROR(JsonResult, JSON_ERROR_OUT_OF_MEMORY, "Failed to grow JSON nesting stack");
+                        }
+                        if (stack) {
+                            memcpy(grown, stack, depth * sizeof(JsonBuildFrame));
+                            arena_memory_free(stack);
+                        }
+                        stack = grown;
+                        capacity = new_capacity;
+                    }
+                    stack[depth++] = (JsonBuildFrame){ .container = item, .last = NULL, .count = 0 };
+                    state = item->type == JSON_ARRAY ? JSON_BUILD_VALUE : JSON_BUILD_KEY;
+                }
+            }
+        } else {
+            if (depth == 0) break;
+            JsonBuildFrame *top = &stack[depth - 1];
+            char close = top->container->type == JSON_ARRAY ? ']' : '}';
+            const char *next = skip_whitespace(end);
+            if (i >= count || input + pos[i] != next) {
+                error = "Unexpected character after value";
+                break;
+            }
+            bool closed = false;
+            if (*next == ',') {
+                i++;
+                if (i == count) {
+                    /* Trailing comma at the end of input closes the container */
+                    closed = true;
+                    end = input + len;
+                } else {
+                    state = top->container->type == JSON_ARRAY ? JSON_BUILD_VALUE : JSON_BUILD_KEY;
+                }
+            } else if (*next == close) {
+                i++;
+                closed = true;
+                end = next + 1;
+            } else {
+                error = "Unexpected character after value";
+            }
+            if (closed) {
+                if (top->container->type == JSON_OBJECT) {
+                    json_object_index_parsed__(file, func, line, arena, top->container, top->count, opts);
+                }
+                depth--;
+            }
+        }
+    }
+
+    arena_memory_free(stack);
+    if (error) {
+        *s = i < count ? input + pos[i] : input + len;
+        raise_debug__(file, func, line, "PARSE: %s at offset %zu", error, (size_t)(*s - input));
+        return RESULT_ERROR(JsonResult, code, (char *)error);
+    }
+    *s = end;
+    return RESULT_SOME(JsonResult, *root);
+}
+
+/* len is the input's length when known, SIZE_MAX to measure up to the NUL */
+static JsonResult json_parse_structural__(POSITION_INFO_DECLARATION, Arena *arena, const char **s,
+                                          size_t len, const JsonParseOptions *opts) {
+    if (len == SIZE_MAX) len = strlen(*s);
+    if (len >= UINT32_MAX) {
+        return RESULT_ERROR(JsonResult, JSON_ERROR_INVALID_INPUT, "Input too large for the structural index");
+    }
+
+    JsonIndexer ix = {0};
+    ix.positions = arena_memory_alloc((len + 1) * sizeof(uint32_t));
+    if (!ix.positions) {
+        return RESULT_ERROR(JsonResult, JSON_ERROR_OUT_OF_MEMORY, "Failed to allocate structural index");
+    }
+    json_index(&ix, *s, len);
+    raise_trace__(file, func, line, "PARSE: Structural index holds %zu tokens for %zu bytes (%s)",
+                  ix.count, len, simd_level_to_string(simd_level()));
+
+    JsonResult result = json_build_from_index__(file, func, line, arena, s, len, ix.positions, ix.count, opts);
+    arena_memory_free(ix.positions);
+    return result;
+}
+
+static const char *json_parser_engine_to_string(JsonParserEngine engine) {
+    switch (engine) {
+        case JSON_PARSER_RECURSIVE: return "RECURSIVE";
+        case JSON_PARSER_STRUCTURAL: return "STRUCTURAL";
+        case JSON_PARSER_LAZY: return "LAZY";
+        default: return "UNKNOWN";
+    }
+}
+
+static JsonResult json_parse_opts__(POSITION_INFO_DECLARATION, Arena *arena, const char **s, size_t len,
+                                    const JsonParseOptions *opts) {
+    // Check input parameters
+    if (!s || !*s) {
+        raise_exception__(file, func, line,
+            "PARSE: Invalid input parameters (NULL pointer provided for JSON parsing)");
+        return RESULT_ERROR(JsonResult, JSON_ERROR_INVALID_INPUT, "NULL input");
+    }
+    
+    if (!arena) {
+        raise_exception__(file, func, line,
+            "PARSE: Invalid arena (NULL) provided for JSON parsing");
+        return RESULT_ERROR(JsonResult, JSON_ERROR_INVALID_INPUT, "NULL arena");
+    }
+
+    const JsonParseOptions defaults = { .engine = JSON_PARSER_RECURSIVE };
+    if (!opts) opts = &defaults;
+    JsonParserEngine engine = opts->engine;
+
+    // Function entry logging with DEBUG level
+    raise_debug__(file, func, line, 
+        "PARSE: Starting JSON parsing (input: %p, engine: %s)", *s, json_parser_engine_to_string(engine));
+    
+    // Show input preview for debugging with TRACE level
+    raise_trace__(file, func, line,
+        "PARSE: Input preview: '%.20s%s'", *s, strnlen(*s, 21) > 20 ? "..." : "");
+    
+    // Process JSON value
+    JsonResult result;
+    if (engine == JSON_PARSER_STRUCTURAL) {
+        result = json_parse_structural__(file, func, line, arena, s, len, opts);
+    } else if (engine == JSON_PARSER_LAZY) {
+        // Expansion happens after this call returns, so it needs its own copy of the options
+        JsonParseOptions *kept = arena_alloc__(file, func, line, arena, sizeof(JsonParseOptions));
+        *kept = *opts;
+        HecticErrorCode code;
+        Json *value = json_lazy_value__(file, func, line, s, arena, kept, false, &code);
+        result = value ? RESULT_SOME(JsonResult, *value)
+                       : RESULT_ERROR(JsonResult, code, "Failed to parse JSON value");
+    } else {
+        HecticErrorCode code;
+        Json *value = json_parse_value__(file, func, line, s, arena, opts, &code);
+        result = value ? RESULT_SOME(JsonResult, *value)
+                       : RESULT_ERROR(JsonResult, code, "Failed to parse JSON value");
+    }
+    
+    // Log parsing result
+    if (IS_RESULT_ERROR(result)) {
+        raise_warn__(file, func, line, 
+            "PARSE: Failed to parse JSON at position %p (context: '%.10s')", 
+            *s, *s && **s ? *s : "<empty>");
+    } else {
+        raise_log__(file, func, line, 
+            "PARSE: JSON parsing completed successfully (type: %s)", json_type_to_string(result.Result.some->type));
+    }
+    
+    return result;
+}
+
+JsonResult json_parse_with_opts__(POSITION_INFO_DECLARATION, Arena *arena, const char **s, const JsonParseOptions *opts) {
+    if (opts && opts->strings == JSON_STRINGS_INSITU) {
+        raise_exception__(file, func, line, "PARSE: In-situ parsing writes to the input, use json_parse_insitu");
+        return RESULT_ERROR(JsonResult, JSON_ERROR_INVALID_INPUT, "In-situ strings need json_parse_insitu");
+    }
+    return json_parse_opts__(file, func, line, arena, s, SIZE_MAX, opts);
+}
+
+JsonResult json_parse_insitu__(POSITION_INFO_DECLARATION, Arena *arena, char **s, const JsonParseOptions *opts) {
+    JsonParseOptions insitu = opts ? *opts : (JsonParseOptions){ .engine = JSON_PARSER_RECURSIVE };
+    insitu.strings = JSON_STRINGS_INSITU;
+    const char *cursor = s ? *s : NULL;
+    JsonResult result = json_parse_opts__(file, func, line, arena, &cursor, SIZE_MAX, &insitu);
+    if (s) *s = (char *)cursor;
+    return result;
+}
+
+static HecticErrorCode view_to_cstr__(POSITION_INFO_DECLARATION, Arena *arena, View input, const char **out);
+
+JsonResult json_parse_view__(POSITION_INFO_DECLARATION, Arena *arena, View input, const JsonParseOptions *opts) {
+    const char *text;
+    HecticErrorCode code = view_to_cstr__(file, func, line, arena, input, &text);
+    if (code != HECTIC_ERROR_NONE) {
+        return RESULT_ERROR(JsonResult, code, "Unusable view");
+    }
+
+    const char *cursor = text;
+    JsonResult result = json_parse_with_opts__(file, func, line, arena, &cursor, opts);
+    TRY(result);
+
+    // The value has to fill the view: only whitespace may follow, and a NUL inside cuts it short
+    cursor = skip_whitespace(cursor);
+    if (cursor != text + input.len) {
+        raise_warn__(file, func, line,
+            "PARSE: Unexpected content at byte %zu of a %zu byte view", (size_t)(cursor - text), input.len);
+        return RESULT_ERROR(JsonResult, JSON_ERROR_SYNTAX, "Unexpected content after JSON value");
+    }
+    return result;
+}
+
+// FIXME(yukkop): **s changes in the function. Need to fix.
+Json *json_parse__(POSITION_INFO_DECLARATION, Arena *arena, const char **s) {
+    JsonResult result = json_parse_with_opts__(file, func, line, arena, s, NULL);
+    return IS_RESULT_ERROR(result) ? NULL : result.Result.some;
+}
+
+/*
+ * JSON Lines. Workers split the next chunk off the input under the lock,
+ * then parse it without the lock; the calling thread consumes chunks in
+ * order. At most `window` chunks are in flight, which bounds memory and
+ * keeps results ordered without sorting.
+ */
+
+/* "[0,0,...]" costs a 40-byte node for every two input bytes, so this always fits */
+#define JSON_LINES_ARENA_FACTOR 24
+#define JSON_LINES_ARENA_SLACK 4096
+
+typedef struct {
+    JsonLine *lines;
+    size_t count;
+    size_t capacity;
+    Arena **arenas;   /* Each at a fixed address: key tables of the values keep pointers to it */
+    size_t arena_count;
+    size_t arena_capacity;
+    bool done;
+    bool failed;   /* Out of memory, the batch stops at this chunk */
+} JsonLinesChunk;
+
+typedef struct {
+    const char *text;   /* NUL-terminated */
+    size_t len;
+    size_t cursor;      /* Where the next chunk starts */
+    size_t line_number; /* Line at the cursor */
+    size_t chunk_size;
+    const JsonParseOptions *parse;
+    JsonLinesChunk *ring;
+    size_t window;
+    size_t taken;
+    size_t emitted;
+    bool stop;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    const char *file;
+    const char *func;
+    int line;
+} JsonLinesRun;
+
+typedef bool (*JsonLinesEmit)(JsonLinesChunk *chunk, void *ctx);
+
+/* Room for one more item in a malloc'd array */
+static bool json_lines_reserve(void **items, size_t *capacity, size_t count, size_t isize) {
+    if (count < *capacity) return true;
+    size_t grown = *capacity ? *capacity * 2 : 16;
+    void *bigger = arena_memory_alloc(grown * isize);
+    if (!bigger) return false;
+    if (*items) {
+        memcpy(bigger, *items, count * isize);
+        arena_memory_free(*items);
+    }
+    *items = bigger;
+    *capacity = grown;
+    return true;
+}
+
+static void json_lines_release_chunk(JsonLinesChunk *chunk) {
+    for (size_t i = 0; i < chunk->arena_count; i++) arena_memory_free(chunk->arenas[i]);
+    if (chunk->arenas) arena_memory_free(chunk->arenas);
+    if (chunk->lines) arena_memory_free(chunk->lines);
+    memset(chunk, 0, sizeof(JsonLinesChunk));
+}
+
+/*
+ * Arena with room for the worst-case tree of a `bytes` long record. A new
+ * one is sized for everything left in the chunk, `rest` bytes, at a
+ * typical few times the input; it is malloc'd, not cleared, so untouched
+ * room costs no pages. The Arena heads its own block, so the address
+ * handed out stays valid however the arena list moves, until the block
+ * is freed.
+ */
+static Arena *json_lines_arena(JsonLinesChunk *chunk, size_t bytes, size_t rest) {
+    size_t need = bytes * JSON_LINES_ARENA_FACTOR + JSON_LINES_ARENA_SLACK;
+    if (chunk->arena_count) {
+        Arena *last = chunk->arenas[chunk->arena_count - 1];
+        size_t used = (size_t)((char *)last->current - (char *)last->begin);
+        if (last->capacity - used >= need) return last;
+    }
+
+    void *arenas = chunk->arenas;
+    if (!json_lines_reserve(&arenas, &chunk->arena_capacity, chunk->arena_count, sizeof(Arena *))) return NULL;
+    chunk->arenas = arenas;
+
+    size_t capacity = rest * 4 + JSON_LINES_ARENA_SLACK;
+    if (capacity < need) capacity = need;
+    size_t head = (sizeof(Arena) + 15) & ~(size_t)15;
+    Arena *arena = arena_memory_alloc(head + capacity);
+    if (!arena) return NULL;
+    char *memory = (char *)arena + head;
+    *arena = (Arena){ .begin = memory, .current = memory, .capacity = capacity };
+    chunk->arenas[chunk->arena_count++] = arena;
+    return arena;
+}
+
+/* Records from the cursor on until the chunk holds chunk_size bytes. Called under the lock. */
+static bool json_lines_split(JsonLinesRun *run, JsonLinesChunk *chunk) {
+    const char *text = run->text;
+    const char *end = text + run->len;
+    const char *p = text + run->cursor;
+    const char *limit = run->len - run->cursor > run->chunk_size ? p + run->chunk_size : end;
+
+    while (p < limit) {
+        const char *start = p;
+        size_t first_line = run->line_number;
+        bool in_string = false;
+
+        // A newline inside a string does not end the record, whatever it does to the parse
+        while (p < end) {
+            const char *q = in_string ? json_find_special(p) : p + strcspn(p, "\"\n");
+            if (q > end) q = end;
+            if (in_string) {
+                for (const char *n = p; (n = memchr(n, '\n', (size_t)(q - n))); n++) run->line_number++;
+            }
+            p = q;
+            if (p == end || (*p == '\n' && !in_string)) break;
+            if (*p == '"') in_string = !in_string;
+            else if (*p == '\\' && p + 1 < end) p++;
+            p++;
+        }
+
+        const char *content = start;
+        while (content < p && isspace((unsigned char)*content)) content++;
+        if (content < p) {
+            void *lines = chunk->lines;
+            if (!json_lines_reserve(&lines, &chunk->capacity, chunk->count, sizeof(JsonLine))) return false;
+            chunk->lines = lines;
+            chunk->lines[chunk->count++] = (JsonLine){
+                .line = first_line,
+                .offset = (size_t)(start - text),
+                .length = (size_t)(p - start),
+                .error = { .code = HECTIC_ERROR_NONE, .message = NULL },
+            };
+        }
+        if (p < end) {
+            p++;
+            run->line_number++;
+        }
+    }
+
+    run->cursor = (size_t)(p - text);
+    return true;
+}
+
+static bool json_lines_parse_chunk(JsonLinesRun *run, JsonLinesChunk *chunk) {
+    if (!chunk->count) return true;
+    const JsonLine *last = &chunk->lines[chunk->count - 1];
+    size_t chunk_end = last->offset + last->length;
+
+    for (size_t i = 0; i < chunk->count; i++) {
+        JsonLine *record = &chunk->lines[i];
+        Arena *arena = json_lines_arena(chunk, record->length, chunk_end - record->offset);
+        if (!arena) return false;
+
+        const char *cursor = run->text + record->offset;
+        const char *end = cursor + record->length;
+        JsonResult result = json_parse_opts__(run->file, run->func, run->line, arena, &cursor, record->length, run->parse);
+        if (IS_RESULT_SOME(result)) {
+            while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')) cursor++;
+            if (cursor == end) {
+                record->value = result.Result.some;
+                continue;
+            }
+            result = RESULT_ERROR(JsonResult, JSON_ERROR_SYNTAX, "Unexpected content after the value");
+        }
+        record->error = result.Result.error;
+        raise_debug__(run->file, run->func, run->line, "PARSE: Line %zu: %s", record->line, record->error.message);
+    }
+    return true;
+}
+
+static void *json_lines_worker(void *arg) {
+    JsonLinesRun *run = arg;
+    pthread_mutex_lock(&run->lock);
+    for (;;) {
+        while (!run->stop && run->cursor < run->len && run->taken - run->emitted >= run->window) {
+            pthread_cond_wait(&run->changed, &run->lock);
+        }
+        if (run->stop || run->cursor >= run->len) break;
+
+        JsonLinesChunk *chunk = &run->ring[run->taken++ % run->window];
+        bool ok = json_lines_split(run, chunk);
+        pthread_mutex_unlock(&run->lock);
+
+        ok = ok && json_lines_parse_chunk(run, chunk);
+
+        pthread_mutex_lock(&run->lock);
+        chunk->failed = !ok;
+        chunk->done = true;
+        pthread_cond_broadcast(&run->changed);
+    }
+    pthread_mutex_unlock(&run->lock);
+    return NULL;
+}
+
+static EmptyResult json_lines_run__(POSITION_INFO_DECLARATION, Arena *arena, View input, const JsonLinesOptions *opts,
+                                    JsonLinesEmit emit, void *ctx) {
+    const JsonLinesOptions defaults = {0};
+    if (!opts) opts = &defaults;
+    if (opts->parse.engine == JSON_PARSER_LAZY || opts->parse.strings == JSON_STRINGS_INSITU) {
+        raise_exception__(file, func, line, "PARSE: JSON Lines take neither the lazy engine nor in-situ strings");
+        return RESULT_ERROR(EmptyResult, JSON_ERROR_INVALID_INPUT, "Unsupported parse options for JSON Lines");
+    }
+    if (!arena) {
+        raise_exception__(file, func, line, "PARSE: Invalid arena (NULL) provided for JSON Lines");
+        return RESULT_ERROR(EmptyResult, JSON_ERROR_INVALID_INPUT, "NULL arena");
+    }
+
+    const char *text;
+    HecticErrorCode code = view_to_cstr__(file, func, line, arena, input, &text);
+    if (code != HECTIC_ERROR_NONE) {
+        return RESULT_ERROR(EmptyResult, code, "Unusable view");
+    }
+
+    size_t threads = opts->threads;
+    if (!threads) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (size_t)online : 1;
+    }
+
+    // Only the structural engine stops at the end of the record; the others
+    // would run on into the next lines and outgrow the record's arena
+    JsonParseOptions bounded = opts->parse;
+    bounded.engine = JSON_PARSER_STRUCTURAL;
+
+    JsonLinesRun run = {
+        .text = text,
+        .len = input.len,
+        .line_number = 1,
+        .chunk_size = opts->chunk_size ? opts->chunk_size : JSON_LINES_CHUNK_DEFAULT,
+        .parse = &bounded,
+        .window = threads * 2,
+        .file = file,
+        .func = func,
+        .line = line,
+    };
+    run.ring = arena_memory_alloc(run.window * sizeof(JsonLinesChunk));
+    pthread_t *workers = arena_memory_alloc(threads * sizeof(pthread_t));
+    if (!run.ring || !workers) {
+        if (run.ring) arena_memory_free(run.ring);
+        if (workers) arena_memory_free(workers);
+        raise_exception__(file, func, line, "PARSE: Out of memory for %zu JSON Lines workers", threads);
+        return RESULT_ERROR(EmptyResult, JSON_ERROR_OUT_OF_MEMORY, "Out of memory");
+    }
+    memset(run.ring, 0, run.window * sizeof(JsonLinesChunk));
+    pthread_mutex_init(&run.lock, NULL);
+    pthread_cond_init(&run.changed, NULL);
+
+    size_t started = 0;
+    while (started < threads && pthread_create(&workers[started], NULL, json_lines_worker, &run) == 0) started++;
+    raise_debug__(file, func, line, "PARSE: JSON Lines over %zu bytes with %zu workers", input.len, started);
+
+    EmptyResult result = { .type = RESULT_SOME };
+    if (!started) {
+        raise_exception__(file, func, line, "PARSE: Could not start any JSON Lines worker");
+        result = RESULT_ERROR(EmptyResult, JSON_ERROR_OUT_OF_MEMORY, "No worker thread");
+    }
+
+    pthread_mutex_lock(&run.lock);
+    while (started) {
+        JsonLinesChunk *chunk = &run.ring[run.emitted % run.window];
+        while (!(run.emitted < run.taken && chunk->done) && !(run.emitted == run.taken && run.cursor >= run.len)) {
+            pthread_cond_wait(&run.changed, &run.lock);
+        }
+        if (run.emitted == run.taken) break;
+        pthread_mutex_unlock(&run.lock);
+
+        if (chunk->failed) {
+            raise_exception__(file, func, line, "PARSE: Out of memory in a JSON Lines worker");
+            result = RESULT_ERROR(EmptyResult, JSON_ERROR_OUT_OF_MEMORY, "Out of memory");
+        } else if (!emit(chunk, ctx)) {
+            raise_debug__(file, func, line, "PARSE: JSON Lines stopped by the consumer");
+            result = RESULT_ERROR(EmptyResult, JSON_ERROR_ABORTED, "Stopped by the callback");
+        }
+        json_lines_release_chunk(chunk);
+
+        pthread_mutex_lock(&run.lock);
+        run.emitted++;
+        pthread_cond_broadcast(&run.changed);
+        if (IS_RESULT_ERROR(result)) break;
+    }
+    run.stop = true;
+    pthread_cond_broadcast(&run.changed);
+    pthread_mutex_unlock(&run.lock);
+
+    for (size_t i = 0; i < started; i++) pthread_join(workers[i], NULL);
+    // Chunks parsed ahead of an early stop
+    for (size_t i = 0; i < run.window; i++) json_lines_release_chunk(&run.ring[i]);
+
+    pthread_cond_destroy(&run.changed);
+    pthread_mutex_destroy(&run.lock);
+    arena_memory_free(workers);
+    arena_memory_free(run.ring);
+    return result;
+}
+
+typedef struct {
+    JsonLine *lines;
+    size_t count;
+    size_t capacity;
+    size_t failed;
+    Arena **arenas;
+    size_t arena_count;
+    size_t arena_capacity;
+} JsonLinesCollector;
+
+/* Takes the chunk's records and arenas over, so releasing the chunk keeps them */
+static bool json_lines_collect(JsonLinesChunk *chunk, void *ctx) {
+    JsonLinesCollector *all = ctx;
+    for (size_t i = 0; i < chunk->count; i++) {
+        void *lines = all->lines;
+        if (!json_lines_reserve(&lines, &all->capacity, all->count, sizeof(JsonLine))) return false;
+        all->lines = lines;
+        all->lines[all->count++] = chunk->lines[i];
+        if (!chunk->lines[i].value) all->failed++;
+    }
+    while (chunk->arena_count) {
+        void *arenas = all->arenas;
+        if (!json_lines_reserve(&arenas, &all->arena_capacity, all->arena_count, sizeof(Arena *))) return false;
+        all->arenas = arenas;
+        all->arenas[all->arena_count++] = chunk->arenas[--chunk->arena_count];
+    }
+    return true;
+}
+
+JsonLinesResult json_lines_parse__(POSITION_INFO_DECLARATION, Arena *arena, View input, const JsonLinesOptions *opts) {
+    JsonLinesCollector all = {0};
+    EmptyResult run = json_lines_run__(file, func, line, arena, input, opts, json_lines_collect, &all);
+
+    JsonLines *lines = NULL;
+    if (IS_RESULT_SOME(run)) {
+        lines = arena_alloc_or_null__(file, func, line, arena, sizeof(JsonLines), false);
+        JsonLine *copy = lines && all.count
+            ? arena_alloc_or_null__(file, func, line, arena, all.count * sizeof(JsonLine), false)
+            : NULL;
+        if (lines && (copy || !all.count)) {
+            if (all.count) memcpy(copy, all.lines, all.count * sizeof(JsonLine));
+            *lines = (JsonLines){
+                .lines = copy,
+                .count = all.count,
+                .failed = all.failed,
+                .arenas = all.arenas,
+                .arena_count = all.arena_count,
+            };
+        } else {
+            raise_exception__(file, func, line, "PARSE: Out of memory for %zu JSON Lines records", all.count);
+            run = RESULT_ERROR(EmptyResult, JSON_ERROR_OUT_OF_MEMORY, "Out of memory");
+        }
+    }
+    if (all.lines) arena_memory_free(all.lines);
+
+    if (IS_RESULT_ERROR(run)) {
+        JsonLines owned = { .arenas = all.arenas, .arena_count = all.arena_count };
+        json_lines_free__(file, func, line, &owned);
+        return (JsonLinesResult){ .type = RESULT_ERROR, .Result.error = run.Result.error };
+    }
+    raise_debug__(file, func, line, "PARSE: %zu JSON Lines records, %zu failed", lines->count, lines->failed);
+    return RESULT_SOME(JsonLinesResult, *lines);
+}
+
+void json_lines_free__(POSITION_INFO_DECLARATION, JsonLines *lines) {
+    if (!lines) {
+        raise_warn__(file, func, line, "PARSE: Attempted to free NULL JSON Lines");
+        return;
+    }
+    for (size_t i = 0; i < lines->arena_count; i++) arena_memory_free(lines->arenas[i]);
+    if (lines->arenas) arena_memory_free(lines->arenas);
+    lines->arenas = NULL;
+    lines->arena_count = 0;
+}
+
+typedef struct {
+    JsonLineCallback callback;
+    void *ctx;
+} JsonLinesEach;
+
+static bool json_lines_call(JsonLinesChunk *chunk, void *ctx) {
+    JsonLinesEach *each = ctx;
+    for (size_t i = 0; i < chunk->count; i++) {
+        if (!each->callback(&chunk->lines[i], each->ctx)) return false;
+    }
+    return true;
+}
+
+EmptyResult json_lines_each__(POSITION_INFO_DECLARATION, Arena *arena, View input, const JsonLinesOptions *opts,
+                              JsonLineCallback callback, void *ctx) {
+    if (!callback) {
+        raise_exception__(file, func, line, "PARSE: NULL callback for JSON Lines");
+        return RESULT_ERROR(EmptyResult, JSON_ERROR_INVALID_INPUT, "NULL callback");
+    }
+    JsonLinesEach each = { .callback = callback, .ctx = ctx };
+    return json_lines_run__(file, func, line, arena, input, opts, json_lines_call, &each);
+}
+
+/*
+ * Tape. Word layout, tag in the top byte:
+ *   'r' root        payload: number of words on the tape
+ *   'n' 't' 'f'     null, true, false
+ *   'l' 'd'         int64 / double, the bits follow in the next word
+ *   '"' 'R'         string / raw number, payload: offset into strings, next word: length
+ *   '[' '{'         payload: index just past the matching end word, next word: element count
+ *   ']' '}'         payload: index of the matching begin word
+ * Object members are a '"' key followed by the value.
+ */
+
+#define JSON_TAPE_TAG(word) ((char)((word) >> 56))
+#define JSON_TAPE_PAYLOAD(word) ((word) & 0x00FFFFFFFFFFFFFFULL)
+#define JSON_TAPE_WORD(tag, payload) (((uint64_t)(unsigned char)(tag) << 56) | (uint64_t)(payload))
+
+typedef struct {
+    uint64_t *words;
+    size_t count;
+    char *strings;
+    size_t strings_len;
+} JsonTapeWriter;
+
+static void json_tape_put_string(JsonTapeWriter *w, char tag, const char *s, size_t len) {
+    w->words[w->count++] = JSON_TAPE_WORD(tag, w->strings_len);
+    w->words[w->count++] = len;
+    memcpy(w->strings + w->strings_len, s, len);
+    w->strings[w->strings_len + len] = '\0';
+    w->strings_len += len + 1;
+}
+
+static void json_tape_put_number(JsonTapeWriter *w, const JsonNumberScan *n) {
+    int64_t integer;
+    if (json_number_to_int64(n, &integer)) {
+        w->words[w->count++] = JSON_TAPE_WORD('l', 0);
+        memcpy(&w->words[w->count++], &integer, sizeof(uint64_t));
+    } else {
+        double number = json_number_to_double(n);
+        w->words[w->count++] = JSON_TAPE_WORD('d', 0);
+        memcpy(&w->words[w->count++], &number, sizeof(uint64_t));
+    }
+}
+
+static JsonTape *json_tape_finish(POSITION_INFO_DECLARATION, Arena *arena, JsonTapeWriter *w) {
+    JsonTape *tape = arena_alloc__(file, func, line, arena, sizeof(JsonTape));
+    w->words[0] = JSON_TAPE_WORD('r', w->count);
+    tape->words = w->words;
+    tape->count = w->count;
+    tape->strings = w->strings;
+    tape->strings_len = w->strings_len;
+    return tape;
+}
+
+/* Stage two over the structural index: emit words instead of nodes */
+static JsonTapeResult json_tape_build__(POSITION_INFO_DECLARATION, Arena *arena, const char **s,
+                                        size_t len, const uint32_t *pos, size_t count) {
+    const char *input = *s;
+    const char *end = input;
+    const char *error = NULL;
+    size_t *stack = NULL;   /* Begin word of each open container */
+    size_t depth = 0, capacity = 0;
+    size_t i = 0;
+    JsonBuildState state = JSON_BUILD_VALUE;
+
+    // Every index position yields at most two words, plus the root word
+    JsonTapeWriter w = {
+        .words = arena_alloc__(file, func, line, arena, (2 * count + 2) * sizeof(uint64_t)),
+        .count = 1,
+        .strings = arena_alloc__(file, func, line, arena, len + 1),
+        .strings_len = 0,
+    };
+
+    while (!error) {
+        if (state == JSON_BUILD_KEY || (state == JSON_BUILD_VALUE && i < count && input[pos[i]] == '"')) {
+            if (i >= count || input[pos[i]] != '"') {
+                error = "Expected string key in object";
+                break;
+            }
+            // Decoded text is never longer than the source, so it fits in the strings buffer
+            const char *start = input + pos[i] + 1;
+            const char *close = i + 1 < count ? input + pos[i + 1] : input + len;
+            if (*close != '"') {
+                error = "Unterminated string";
+                break;
+            }
+            char *out = json_decode_body(start, close, w.strings + w.strings_len, &error);
+            if (!out) break;
+            size_t decoded = (size_t)(out - (w.strings + w.strings_len));
+            w.words[w.count++] = JSON_TAPE_WORD('"', w.strings_len);
+            w.words[w.count++] = decoded;
+            *out = '\0';
+            w.strings_len += decoded + 1;
+            end = close + 1;
+            i += 2;
+            if (state == JSON_BUILD_KEY) {
+                if (i >= count || input[pos[i]] != ':') {
+                    error = "Expected ':' after key";
+                    break;
+                }
+                i++;
+                state = JSON_BUILD_VALUE;
+            } else {
+                state = JSON_BUILD_AFTER_VALUE;
+            }
+        } else if (state == JSON_BUILD_VALUE) {
+            if (i >= count) {
+                error = "Unrecognized JSON value";
+                break;
+            }
+            const char *p = input + pos[i++];
+            JsonNumberScan n;
+            state = JSON_BUILD_AFTER_VALUE;
+            if (strncmp(p, "null", 4) == 0) {
+                w.words[w.count++] = JSON_TAPE_WORD('n', 0);
+                end = p + 4;
+            } else if (strncmp(p, "true", 4) == 0) {
+                w.words[w.count++] = JSON_TAPE_WORD('t', 0);
+                end = p + 4;
+            } else if (strncmp(p, "false", 5) == 0) {
+                w.words[w.count++] = JSON_TAPE_WORD('f', 0);
+                end = p + 5;
+            } else if ((*p == '-' || isdigit((unsigned char)*p)) && json_scan_number(p, &n)) {
+                json_tape_put_number(&w, &n);
+                end = n.end;
+            } else if (*p == '[' || *p == '{') {
+                if (depth == capacity) {
+                    size_t new_capacity = capacity ? capacity * 2 : 32;
+                    size_t *grown = arena_memory_alloc(new_capacity * sizeof(size_t));
+                    if (!grown) {
+                        arena_memory_free(stack);
+                        return RESULT_ERROR(JsonTapeResult, JSON_ERROR_OUT_OF_MEMORY, "Failed to grow JSON nesting stack");
+                    }
+                    if (stack) {
+                        memcpy(grown, stack, depth * sizeof(size_t));
+                        arena_memory_free(stack);
+                    }
+                    stack = grown;
+                    capacity = new_capacity;
+                }
+                stack[depth++] = w.count;
+                w.words[w.count++] = JSON_TAPE_WORD(*p, 0);
+                w.words[w.count++] = 0;
+                char close = *p == '[' ? ']' : '}';
+                if (i < count && input[pos[i]] == close) {
+                    state = JSON_BUILD_AFTER_VALUE;
+                    end = input + pos[i];  /* The close is consumed below */
+                } else {
+                    state = *p == '[' ? JSON_BUILD_VALUE : JSON_BUILD_KEY;
+                }
+            } else {
+                error = *p == '-' || isdigit((unsigned char)*p) ? "Invalid number" : "Unrecognized JSON value";
+            }
+        } else {
+            if (depth == 0) break;
+            size_t begin = stack[depth - 1];
+            char open = JSON_TAPE_TAG(w.words[begin]);
+            const char *next = skip_whitespace(end);
+            if (i >= count || input + pos[i] != next) {
+                error = "Unexpected character after value";
+                break;
+            }
+            // An empty container jumps here with end at its close
+            bool empty = w.count == begin + 2;
+            if (!empty) w.words[begin + 1]++;
+            if (*next == ',' && !empty) {
+                i++;
+                state = open == '[' ? JSON_BUILD_VALUE : JSON_BUILD_KEY;
+            } else if (*next == (open == '[' ? ']' : '}')) {
+                i++;
+                depth--;
+                w.words[w.count] = JSON_TAPE_WORD(open == '[' ? ']' : '}', begin);
+                w.count++;
+                w.words[begin] = JSON_TAPE_WORD(open, w.count);
+                end = next + 1;
+            } else {
+                error = "Unexpected character after value";
+            }
+        }
+    }
+
+    arena_memory_free(stack);
+    if (!error && (depth > 0 || w.count == 1)) error = depth > 0 ? "Unclosed container" : "Unrecognized JSON value";
+    if (error) {
+        *s = i < count ? input + pos[i] : input + len;
+        raise_debug__(file, func, line, "PARSE: %s at offset %zu", error, (size_t)(*s - input));
+        return RESULT_ERROR(JsonTapeResult, JSON_ERROR_SYNTAX, (char *)error);
+    }
+    *s = end;
+    JsonTape *tape = json_tape_finish(file, func, line, arena, &w);
+    raise_trace__(file, func, line, "PARSE: Tape holds %zu words and %zu string bytes", tape->count, tape->strings_len);
+    return RESULT_SOME(JsonTapeResult, *tape);
+}
+
+JsonTapeResult json_tape_parse__(POSITION_INFO_DECLARATION, Arena *arena, const char **s) {
+    if (!arena || !s || !*s) {
+        raise_exception__(file, func, line, "PARSE: Invalid arguments for tape parsing");
+        return RESULT_ERROR(JsonTapeResult, JSON_ERROR_INVALID_INPUT, "NULL input");
+    }
+    size_t len = strlen(*s);
+    if (len >= UINT32_MAX) {
+        return RESULT_ERROR(JsonTapeResult, JSON_ERROR_INVALID_INPUT, "Input too large for the structural index");
+    }
+    JsonIndexer ix = {0};
+    ix.positions = arena_memory_alloc((len + 1) * sizeof(uint32_t));
+    if (!ix.positions) {
+        return RESULT_ERROR(JsonTapeResult, JSON_ERROR_OUT_OF_MEMORY, "Failed to allocate structural index");
+    }
+    json_index(&ix, *s, len);
+    JsonTapeResult result = json_tape_build__(file, func, line, arena, s, len, ix.positions, ix.count);
+    arena_memory_free(ix.positions);
+    return result;
+}
+
+static void json_tape_measure(const Json *item, size_t *words, size_t *bytes) {
+    for (; item; item = item->next) {
+        if (item->key) {
+            *words += 2;
+            *bytes += strlen(item->key) + 1;
+        }
+        switch (item->type) {
+            case JSON_NULL:
+            case JSON_BOOL:
+                *words += 1;
+                break;
+            case JSON_STRING:
+            case JSON_RAW_NUMBER: {
+                char *temp;
+                size_t len;
+                json_string_bytes(item, &len, &temp);
+                arena_memory_free(temp);
+                *bytes += len + 1;
+                *words += 2;
+                break;
+            }
+            case JSON_ARRAY:
+            case JSON_OBJECT:
+                *words += 3;
+                json_tape_measure(json_child(item), words, bytes);
+                break;
+            default:
+                *words += 2;
+                break;
+        }
+    }
+}
+
+static void json_tape_emit(JsonTapeWriter *w, const Json *item, bool siblings) {
+    for (; item; item = siblings ? item->next : NULL) {
+        if (item->key) json_tape_put_string(w, '"', item->key, strlen(item->key));
+        switch (item->type) {
+            case JSON_NULL:
+                w->words[w->count++] = JSON_TAPE_WORD('n', 0);
+                break;
+            case JSON_BOOL:
+                w->words[w->count++] = JSON_TAPE_WORD(item->value.boolean ? 't' : 'f', 0);
+                break;
+            case JSON_NUMBER:
+                w->words[w->count++] = JSON_TAPE_WORD('d', 0);
+                memcpy(&w->words[w->count++], &item->value.number, sizeof(uint64_t));
+                break;
+            case JSON_INTEGER:
+                w->words[w->count++] = JSON_TAPE_WORD('l', 0);
+                memcpy(&w->words[w->count++], &item->value.integer, sizeof(uint64_t));
+                break;
+            case JSON_STRING:
+            case JSON_RAW_NUMBER: {
+                char *temp;
+                size_t len;
+                const char *text = json_string_bytes(item, &len, &temp);
+                json_tape_put_string(w, item->type == JSON_STRING ? '"' : 'R', text, len);
+                arena_memory_free(temp);
+                break;
+            }
+            case JSON_ARRAY:
+            case JSON_OBJECT: {
+                char open = item->type == JSON_ARRAY ? '[' : '{';
+                size_t begin = w->count;
+                size_t elements = 0;
+                for (const Json *child = json_child(item); child; child = child->next) elements++;
+                w->count += 2;
+                json_tape_emit(w, json_child(item), true);
+                w->words[w->count++] = JSON_TAPE_WORD(open == '[' ? ']' : '}', begin);
+                w->words[begin] = JSON_TAPE_WORD(open, w->count);
+                w->words[begin + 1] = elements;
+                break;
+            }
+        }
+    }
+}
+
+JsonTapeResult json_tape_from_json__(POSITION_INFO_DECLARATION, Arena *arena, const Json *root) {
+    if (!arena || !root) {
+        raise_exception__(file, func, line, "FORMAT: Invalid arguments (arena: %p, root: %p)", arena, root);
+        return RESULT_ERROR(JsonTapeResult, JSON_ERROR_INVALID_INPUT, "NULL input");
+    }
+    // The root is converted alone: its key and siblings are not part of the document
+    Json single = *root;
+    single.key = NULL;
+    single.next = NULL;
+    size_t words = 1, bytes = 0;
+    json_tape_measure(&single, &words, &bytes);
+    JsonTapeWriter w = {
+        .words = arena_alloc__(file, func, line, arena, words * sizeof(uint64_t)),
+        .count = 1,
+        .strings = arena_alloc__(file, func, line, arena, bytes ? bytes : 1),
+        .strings_len = 0,
+    };
+    json_tape_emit(&w, &single, false);
+    JsonTape *tape = json_tape_finish(file, func, line, arena, &w);
+    return RESULT_SOME(JsonTapeResult, *tape);
+}
+
+JsonType json_tape_type(const JsonTape *tape, size_t at) {
+    switch (JSON_TAPE_TAG(tape->words[at])) {
+        case 't':
+        case 'f': return JSON_BOOL;
+        case 'l': return JSON_INTEGER;
+        case 'd': return JSON_NUMBER;
+        case '"': return JSON_STRING;
+        case 'R': return JSON_RAW_NUMBER;
+        case '[': return JSON_ARRAY;
+        case '{': return JSON_OBJECT;
+        default: return JSON_NULL;
+    }
+}
+
+size_t json_tape_skip(const JsonTape *tape, size_t at) {
+    uint64_t word = tape->words[at];
+    switch (JSON_TAPE_TAG(word)) {
+        case '[':
+        case '{': return (size_t)JSON_TAPE_PAYLOAD(word);
+        case 'l':
+        case 'd':
+        case '"':
+        case 'R': return at + 2;
+        default: return at + 1;
+    }
+}
+
+size_t json_tape_length(const JsonTape *tape, size_t at) {
+    switch (JSON_TAPE_TAG(tape->words[at])) {
+        case '[':
+        case '{':
+        case '"':
+        case 'R': return (size_t)tape->words[at + 1];
+        default: return 0;
+    }
+}
+
+bool json_tape_bool(const JsonTape *tape, size_t at) {
+    return JSON_TAPE_TAG(tape->words[at]) == 't';
+}
+
+int64_t json_tape_integer(const JsonTape *tape, size_t at) {
+    int64_t integer = 0;
+    double number;
+    switch (JSON_TAPE_TAG(tape->words[at])) {
+        case 'l':
+            memcpy(&integer, &tape->words[at + 1], sizeof(integer));
+            break;
+        case 'd':
+            memcpy(&number, &tape->words[at + 1], sizeof(number));
+            integer = (int64_t)number;
+            break;
+    }
+    return integer;
+}
+
+double json_tape_number(const JsonTape *tape, size_t at) {
+    double number = 0;
+    int64_t integer;
+    switch (JSON_TAPE_TAG(tape->words[at])) {
+        case 'd':
+            memcpy(&number, &tape->words[at + 1], sizeof(number));
+            break;
+        case 'l':
+            memcpy(&integer, &tape->words[at + 1], sizeof(integer));
+            number = (double)integer;
+            break;
+    }
+    return number;
+}
+
+const char *json_tape_string(const JsonTape *tape, size_t at) {
+    char tag = JSON_TAPE_TAG(tape->words[at]);
+    if (tag != '"' && tag != 'R') return NULL;
+    return tape->strings + JSON_TAPE_PAYLOAD(tape->words[at]);
+}
+
+JsonTapeIter json_tape_iter(const JsonTape *tape, size_t container) {
+    char tag = JSON_TAPE_TAG(tape->words[container]);
+    JsonTapeIter it = { .tape = tape, .at = 0, .end = 0, .object = tag == '{' };
+    if (tag == '[' || tag == '{') {
+        it.at = container + 2;
+        it.end = (size_t)JSON_TAPE_PAYLOAD(tape->words[container]) - 1;
+    }
+    return it;
+}
+
+bool json_tape_iter_next(JsonTapeIter *it, size_t *value, const char **key) {
+    if (it->at >= it->end) return false;
+    if (it->object) {
+        if (key) *key = json_tape_string(it->tape, it->at);
+        it->at += 2;
+    } else if (key) {
+        *key = NULL;
+    }
+    *value = it->at;
+    it->at = json_tape_skip(it->tape, it->at);
+    return true;
+}
+
+size_t json_tape_array_get(const JsonTape *tape, size_t array, size_t index) {
+    if (JSON_TAPE_TAG(tape->words[array]) != '[' || index >= json_tape_length(tape, array)) return JSON_TAPE_NONE;
+    size_t at = array + 2;
+    while (index--) at = json_tape_skip(tape, at);
+    return at;
+}
+
+size_t json_tape_object_get(const JsonTape *tape, size_t object, const char *key) {
+    if (JSON_TAPE_TAG(tape->words[object]) != '{') return JSON_TAPE_NONE;
+    size_t key_len = strlen(key);
+    JsonTapeIter it = json_tape_iter(tape, object);
+    while (it.at < it.end) {
+        size_t key_at = it.at;
+        size_t value_at = key_at + 2;
+        if (tape->words[key_at + 1] == key_len && memcmp(json_tape_string(tape, key_at), key, key_len) == 0) {
+            return value_at;
+        }
+        it.at = json_tape_skip(tape, value_at);
+    }
+    return JSON_TAPE_NONE;
+}
+
+Json *json_tape_to_json__(POSITION_INFO_DECLARATION, Arena *arena, const JsonTape *tape, size_t at) {
+    static const JsonParseOptions defaults = {0};
+    Json *item = json_alloc_item__(file, func, line, arena, json_tape_type(tape, at));
+    switch (item->type) {
+        case JSON_BOOL:
+            item->value.boolean = json_tape_bool(tape, at);
+            break;
+        case JSON_INTEGER:
+            item->value.integer = json_tape_integer(tape, at);
+            break;
+        case JSON_NUMBER:
+            item->value.number = json_tape_number(tape, at);
+            break;
+        case JSON_STRING:
+        case JSON_RAW_NUMBER:
+            item->value.string = (char *)json_tape_string(tape, at);
+            break;
+        case JSON_ARRAY:
+        case JSON_OBJECT: {
+            JsonTapeIter it = json_tape_iter(tape, at);
+            Json *last = NULL;
+            size_t value;
+            const char *key;
+            while (json_tape_iter_next(&it, &value, &key)) {
+                Json *child = json_tape_to_json__(file, func, line, arena, tape, value);
+                child->key = (char *)key;
+                if (last) last->next = child;
+                else item->value.child = child;
+                last = child;
+            }
+            if (item->type == JSON_OBJECT) {
+                json_object_index_parsed__(file, func, line, arena, item, json_tape_length(tape, at), &defaults);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return item;
+}
+
+/*
+ * Binary documents. References reuse the tape word layout; 'i' carries a
+ * 56-bit two's complement integer inline. Accessor loads go through memcpy
+ * with a bounds check and strings must end in their NUL, so damaged bytes
+ * read as missing values instead of faulting. json_binary_to_json() also
+ * refuses container refs that loop.
+ */
+
+#define JSON_BINARY_HEADER_SIZE 32
+#define JSON_BINARY_INLINE_MIN (-(INT64_C(1) << 55))
+#define JSON_BINARY_INLINE_MAX ((INT64_C(1) << 55) - 1)
+
+static const char json_binary_magic[4] = { 'H', 'J', 'B', '\0' };
+
+static size_t json_binary_pad(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+/* FNV-1a over 64-bit words with a final mix; each step is a bijection, so any single changed word shows */
+static uint64_t json_binary_checksum(const unsigned char *data, size_t len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static uint64_t json_binary_load64(const JsonBinary *binary, uint64_t offset) {
+    uint64_t word = 0;
+    if (offset <= binary->size && binary->size - offset >= sizeof(word)) {
+        memcpy(&word, binary->data + offset, sizeof(word));
+    }
+    return word;
+}
+
+/* Length-prefixed text at offset, NULL when it does not fit the binary */
+static const char *json_binary_text(const JsonBinary *binary, uint64_t offset, size_t *len) {
+    uint64_t n = json_binary_load64(binary, offset);
+    // The checksum is no proof against a crafted file: without its NUL a string would run off the end
+    if (offset + 8 > binary->size || n >= binary->size - offset - 8 || binary->data[offset + 8 + n] != '\0') return NULL;
+    *len = (size_t)n;
+    return (const char *)binary->data + offset + 8;
+}
+
+static int json_binary_compare(const char *a, size_t a_len, const char *b, size_t b_len) {
+    int c = memcmp(a, b, a_len < b_len ? a_len : b_len);
+    return c ? c : (a_len > b_len) - (a_len < b_len);
+}
+
+static size_t json_binary_measure(const Json *item) {
+    switch (item->type) {
+        case JSON_INTEGER:
+            return item->value.integer < JSON_BINARY_INLINE_MIN || item->value.integer > JSON_BINARY_INLINE_MAX ? 8 : 0;
+        case JSON_NUMBER:
+            return 8;
+        case JSON_STRING:
+        case JSON_RAW_NUMBER: {
+            char *temp;
+            size_t len;
+            json_string_bytes(item, &len, &temp);
+            arena_memory_free(temp);
+            return 8 + json_binary_pad(len + 1);
+        }
+        case JSON_ARRAY:
+        case JSON_OBJECT: {
+            size_t count = 0, size = 0;
+            for (const Json *child = json_child(item); child; child = child->next) {
+                count++;
+                size += json_binary_measure(child);
+                if (item->type == JSON_OBJECT) size += 8 + json_binary_pad(strlen(child->key ? child->key : "") + 1);
+            }
+            return size + (item->type == JSON_ARRAY ? 8 + 8 * count : 8 + 16 * count + json_binary_pad(4 * count));
+        }
+        default:
+            return 0;
+    }
+}
+
+typedef struct {
+    unsigned char *data;  /* Zeroed, so padding is deterministic */
+    size_t used;
+} JsonBinaryWriter;
+
+static void json_binary_store64(JsonBinaryWriter *w, size_t offset, uint64_t word) {
+    memcpy(w->data + offset, &word, sizeof(word));
+}
+
+static uint64_t json_binary_put_text(JsonBinaryWriter *w, const char *text, size_t len) {
+    size_t at = w->used;
+    json_binary_store64(w, at, len);
+    memcpy(w->data + at + 8, text, len);
+    w->used += 8 + json_binary_pad(len + 1);
+    return at;
+}
+
+/* Members ordered by key, ties by position, so a lower bound finds the first of duplicate keys */
+static bool json_binary_member_less(const JsonBinaryWriter *w, const uint64_t *keys, uint32_t a, uint32_t b) {
+    uint64_t a_len, b_len;
+    memcpy(&a_len, w->data + keys[a], sizeof(a_len));
+    memcpy(&b_len, w->data + keys[b], sizeof(b_len));
+    int c = json_binary_compare((const char *)w->data + keys[a] + 8, (size_t)a_len,
+                                (const char *)w->data + keys[b] + 8, (size_t)b_len);
+    return c ? c < 0 : a < b;
+}
+
+static void json_binary_sift(const JsonBinaryWriter *w, const uint64_t *keys, uint32_t *order, size_t root, size_t n) {
+    for (;;) {
+        size_t child = 2 * root + 1;
+        if (child >= n) return;
+        if (child + 1 < n && json_binary_member_less(w, keys, order[child], order[child + 1])) child++;
+        if (!json_binary_member_less(w, keys, order[root], order[child])) return;
+        uint32_t swap = order[root];
+        order[root] = order[child];
+        order[child] = swap;
+        root = child;
+    }
+}
+
+static JsonBinaryRef json_binary_emit(JsonBinaryWriter *w, const Json *item) {
+    switch (item->type) {
+        case JSON_BOOL:
+            return JSON_TAPE_WORD(item->value.boolean ? 't' : 'f', 0);
+        case JSON_INTEGER: {
+            int64_t integer = item->value.integer;
+            if (integer >= JSON_BINARY_INLINE_MIN && integer <= JSON_BINARY_INLINE_MAX) {
+                return JSON_TAPE_WORD('i', JSON_TAPE_PAYLOAD((uint64_t)integer));
+            }
+            size_t at = w->used;
+            memcpy(w->data + at, &integer, sizeof(integer));
+            w->used += 8;
+            return JSON_TAPE_WORD('l', at);
+        }
+        case JSON_NUMBER: {
+            size_t at = w->used;
+            memcpy(w->data + at, &item->value.number, sizeof(double));
+            w->used += 8;
+            return JSON_TAPE_WORD('d', at);
+        }
+        case JSON_STRING:
+        case JSON_RAW_NUMBER: {
+            char *temp;
+            size_t len;
+            const char *text = json_string_bytes(item, &len, &temp);
+            uint64_t at = json_binary_put_text(w, text, len);
+            arena_memory_free(temp);
+            return JSON_TAPE_WORD(item->type == JSON_STRING ? '"' : 'R', at);
+        }
+        case JSON_ARRAY: {
+            size_t count = 0;
+            for (const Json *child = json_child(item); child; child = child->next) count++;
+            size_t at = w->used;
+            json_binary_store64(w, at, count);
+            w->used += 8 + 8 * count;
+            size_t i = 0;
+            for (const Json *child = json_child(item); child; child = child->next, i++) {
+                json_binary_store64(w, at + 8 + 8 * i, json_binary_emit(w, child));
+            }
+            return JSON_TAPE_WORD('[', at);
+        }
+        case JSON_OBJECT: {
+            size_t count = 0;
+            for (const Json *child = json_child(item); child; child = child->next) count++;
+            size_t at = w->used;
+            json_binary_store64(w, at, count);
+            w->used += 8 + 16 * count + json_binary_pad(4 * count);
+            uint64_t *keys = (uint64_t *)(w->data + at + 8);
+            uint32_t *order = (uint32_t *)(w->data + at + 8 + 16 * count);
+            size_t i = 0;
+            for (const Json *child = json_child(item); child; child = child->next, i++) {
+                const char *key = child->key ? child->key : "";
+                keys[i] = json_binary_put_text(w, key, strlen(key));
+                json_binary_store64(w, at + 8 + 8 * (count + i), json_binary_emit(w, child));
+                order[i] = (uint32_t)i;
+            }
+            // Heap sort: in place and no comparator context needed
+            for (size_t start = count / 2; start-- > 0;) json_binary_sift(w, keys, order, start, count);
+            for (size_t end = count; end-- > 1;) {
+                uint32_t swap = order[0];
+                order[0] = order[end];
+                order[end] = swap;
+                json_binary_sift(w, keys, order, 0, end);
+            }
+            return JSON_TAPE_WORD('{', at);
+        }
+        default:
+            return JSON_TAPE_WORD('n', 0);
+    }
+}
+
+/* size bytes at data, zeroed, from json_binary_measure */
+static void json_binary_encode_into(const Json *root, unsigned char *data, size_t size) {
+    JsonBinaryWriter w = { .data = data, .used = JSON_BINARY_HEADER_SIZE };
+    JsonBinaryRef ref = json_binary_emit(&w, root);
+    assert(w.used == size);
+    uint32_t version = JSON_BINARY_VERSION;
+    uint64_t total = size;
+    uint64_t checksum = json_binary_checksum(data + JSON_BINARY_HEADER_SIZE, size - JSON_BINARY_HEADER_SIZE);
+    memcpy(data, json_binary_magic, sizeof(json_binary_magic));
+    memcpy(data + 4, &version, sizeof(version));
+    memcpy(data + 8, &total, sizeof(total));
+    memcpy(data + 16, &checksum, sizeof(checksum));
+    memcpy(data + 24, &ref, sizeof(ref));
+}
+
+JsonBinaryResult json_binary_encode__(POSITION_INFO_DECLARATION, Arena *arena, const Json *root) {
+    if (!arena || !root) {
+        raise_exception__(file, func, line, "FORMAT: Invalid arguments (arena: %p, root: %p)", arena, root);
+        return RESULT_ERROR(JsonBinaryResult, JSON_ERROR_INVALID_INPUT, "NULL input");
+    }
+    size_t size = JSON_BINARY_HEADER_SIZE + json_binary_measure(root);
+    JsonBinary *binary = arena_alloc_or_null__(file, func, line, arena, sizeof(JsonBinary), false);
+    unsigned char *data = binary ? arena_alloc_or_null__(file, func, line, arena, size, false) : NULL;
+    if (!data) {
+        raise_exception__(file, func, line, "FORMAT: Out of memory for a %zu byte binary", size);
+        return RESULT_ERROR(JsonBinaryResult, JSON_ERROR_OUT_OF_MEMORY, "Out of memory");
+    }
+    memset(data, 0, size);
+    json_binary_encode_into(root, data, size);
+    *binary = (JsonBinary){ .data = data, .size = size, .file = NULL };
+    memcpy(&binary->root, data + 24, sizeof(binary->root));
+    raise_debug__(file, func, line, "FORMAT: Encoded a %zu byte binary", size);
+    return RESULT_SOME(JsonBinaryResult, *binary);
+}
+
+EmptyResult json_binary_write__(POSITION_INFO_DECLARATION, const Json *root, const char *path) {
+    if (!root || !path) {
+        raise_exception__(file, func, line, "FORMAT: Invalid arguments (root: %p, path: %p)", root, path);
+        return RESULT_ERROR(EmptyResult, JSON_ERROR_INVALID_INPUT, "NULL input");
+    }
+    size_t size = JSON_BINARY_HEADER_SIZE + json_binary_measure(root);
+    size_t path_len = strlen(path);
+    unsigned char *data = arena_memory_alloc(size);
+    char *temp_path = arena_memory_alloc(path_len + sizeof(".XXXXXX"));
+    if (!data || !temp_path) {
+        if (data) arena_memory_free(data);
+        if (temp_path) arena_memory_free(temp_path);
+        raise_exception__(file, func, line, "FORMAT: Out of memory for a %zu byte binary", size);
+        return RESULT_ERROR(EmptyResult, JSON_ERROR_OUT_OF_MEMORY, "Out of memory");
+    }
+    memset(data, 0, size);
+    json_binary_encode_into(root, data, size);
+    memcpy(temp_path, path, path_len);
+    memcpy(temp_path + path_len, ".XXXXXX", sizeof(".XXXXXX"));
+
+    // Written to a fresh file next to the target and renamed over it, so readers never see half a
+    // file and concurrent writers never share a temporary. It keeps the target's mode, else 0644.
+    EmptyResult result = { .type = RESULT_SOME };
+    int fd = mkstemp(temp_path);
+    struct stat target;
+    mode_t mode = stat(path, &target) == 0 ? target.st_mode & 07777 : 0644;
+    FILE *out = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    if (fd >= 0 && !out) close(fd);
+    bool written = out && fchmod(fd, mode) == 0 && fwrite(data, 1, size, out) == size && fflush(out) == 0
+                   && fsync(fd) == 0;
+    if (out && fclose(out) != 0) written = false;
+    if (!written || rename(temp_path, path) != 0) {
+        raise_exception__(file, func, line, "FORMAT: Cannot write %s: %s", path, strerror(errno));
+        if (fd >= 0) unlink(temp_path);
+        result = RESULT_ERROR(EmptyResult, JSON_ERROR_IO, "Cannot write binary file");
+    } else {
+        raise_debug__(file, func, line, "FORMAT: Wrote a %zu byte binary to %s", size, path);
+    }
+    arena_memory_free(temp_path);
+    arena_memory_free(data);
+    return result;
+}
+
+JsonBinaryResult json_binary_load__(POSITION_INFO_DECLARATION, Arena *arena, View bytes) {
+    if (!arena || !bytes.data || bytes.isize != sizeof(char)) {
+        raise_exception__(file, func, line, "PARSE: Invalid arguments (arena: %p, data: %p)", arena, bytes.data);
+        return RESULT_ERROR(JsonBinaryResult, JSON_ERROR_INVALID_INPUT, "NULL input");
+    }
+    const unsigned char *data = bytes.data;
+    const char *error = NULL;
+    uint32_t version = 0;
+    uint64_t size = 0, checksum = 0;
+    JsonBinaryRef root = JSON_BINARY_NONE;
+    if (bytes.len < JSON_BINARY_HEADER_SIZE || memcmp(data, json_binary_magic, sizeof(json_binary_magic)) != 0) {
+        error = "Not a binary JSON document";
+    } else {
+        memcpy(&version, data + 4, sizeof(version));
+        memcpy(&size, data + 8, sizeof(size));
+        memcpy(&checksum, data + 16, sizeof(checksum));
+        memcpy(&root, data + 24, sizeof(root));
+        if (version != JSON_BINARY_VERSION) error = "Unsupported version or byte order";
+        else if (size != bytes.len || size % 8) error = "Size does not match the header";
+        else if (json_binary_checksum(data + JSON_BINARY_HEADER_SIZE, bytes.len - JSON_BINARY_HEADER_SIZE) != checksum) {
+            error = "Checksum mismatch";
+        }
+    }
+    if (error) {
+        raise_exception__(file, func, line, "PARSE: %s (%zu bytes, version %u)", error, bytes.len, (unsigned)version);
+        return RESULT_ERROR(JsonBinaryResult, JSON_ERROR_INVALID_BINARY, (char *)error);
+    }
+
+    JsonBinary *binary = arena_alloc_or_null__(file, func, line, arena, sizeof(JsonBinary), false);
+    if (!binary) {
+        raise_exception__(file, func, line, "PARSE: Out of memory for the binary handle");
+        return RESULT_ERROR(JsonBinaryResult, JSON_ERROR_OUT_OF_MEMORY, "Out of memory");
+    }
+    *binary = (JsonBinary){ .data = data, .size = bytes.len, .root = root, .file = NULL };
+    return RESULT_SOME(JsonBinaryResult, *binary);
+}
+
+JsonBinaryResult json_binary_open__(POSITION_INFO_DECLARATION, Arena *arena, const char *path) {
+    MappedFileResult mapped = view_map_file__(file, func, line, arena, path, VIEW_MAP_WILLNEED);
+    if (IS_RESULT_ERROR(mapped)) {
+        return (JsonBinaryResult){ .type = RESULT_ERROR, .Result.error = mapped.Result.error };
+    }
+    JsonBinaryResult result = json_binary_load__(file, func, line, arena, mapped.Result.some->view);
+    if (IS_RESULT_ERROR(result)) {
+        view_unmap_file__(file, func, line, mapped.Result.some);
+        return result;
+    }
+    result.Result.some->file = mapped.Result.some;
+    return result;
+}
+
+void json_binary_close__(POSITION_INFO_DECLARATION, JsonBinary *binary) {
+    if (!binary) {
+        raise_warn__(file, func, line, "PARSE: Attempted to close a NULL binary");
+        return;
+    }
+    if (binary->file) view_unmap_file__(file, func, line, binary->file);
+    binary->file = NULL;
+    binary->data = NULL;
+    binary->size = 0;
+    binary->root = JSON_BINARY_NONE;
+}
+
+JsonType json_binary_type(const JsonBinary *binary, JsonBinaryRef ref) {
+    (void)binary;
+    switch (JSON_TAPE_TAG(ref)) {
+        case 't':
+        case 'f': return JSON_BOOL;
+        case 'i':
+        case 'l': return JSON_INTEGER;
+        case 'd': return JSON_NUMBER;
+        case '"': return JSON_STRING;
+        case 'R': return JSON_RAW_NUMBER;
+        case '[': return JSON_ARRAY;
+        case '{': return JSON_OBJECT;
+        default: return JSON_NULL;
+    }
+}
+
+size_t json_binary_length(const JsonBinary *binary, JsonBinaryRef ref) {
+    switch (JSON_TAPE_TAG(ref)) {
+        case '[':
+        case '{':
+        case '"':
+        case 'R': return (size_t)json_binary_load64(binary, JSON_TAPE_PAYLOAD(ref));
+        default: return 0;
+    }
+}
+
+bool json_binary_bool(const JsonBinary *binary, JsonBinaryRef ref) {
+    (void)binary;
+    return JSON_TAPE_TAG(ref) == 't';
+}
+
+int64_t json_binary_integer(const JsonBinary *binary, JsonBinaryRef ref) {
+    uint64_t word = json_binary_load64(binary, JSON_TAPE_PAYLOAD(ref));
+    int64_t integer = 0;
+    double number;
+    switch (JSON_TAPE_TAG(ref)) {
+        case 'i':
+            // Sign-extend the 56-bit payload
+            integer = (int64_t)(ref << 8) >> 8;
+            break;
+        case 'l':
+            memcpy(&integer, &word, sizeof(integer));
+            break;
+        case 'd':
+            memcpy(&number, &word, sizeof(number));
+            integer = (int64_t)number;
+            break;
+    }
+    return integer;
+}
+
+double json_binary_number(const JsonBinary *binary, JsonBinaryRef ref) {
+    double number = 0;
+    switch (JSON_TAPE_TAG(ref)) {
+        case 'd': {
+            uint64_t word = json_binary_load64(binary, JSON_TAPE_PAYLOAD(ref));
+            memcpy(&number, &word, sizeof(number));
+            break;
+        }
+        case 'i':
+        case 'l':
+            number = (double)json_binary_integer(binary, ref);
+            break;
+    }
+    return number;
+}
+
+const char *json_binary_string(const JsonBinary *binary, JsonBinaryRef ref) {
+    char tag = JSON_TAPE_TAG(ref);
+    size_t len;
+    if (tag != '"' && tag != 'R') return NULL;
+    return json_binary_text(binary, JSON_TAPE_PAYLOAD(ref), &len);
+}
+
+JsonBinaryRef json_binary_array_get(const JsonBinary *binary, JsonBinaryRef array, size_t index) {
+    if (JSON_TAPE_TAG(array) != '[' || index >= json_binary_length(binary, array)) return JSON_BINARY_NONE;
+    return json_binary_load64(binary, JSON_TAPE_PAYLOAD(array) + 8 + 8 * (uint64_t)index);
+}
+
+JsonBinaryRef json_binary_object_at(const JsonBinary *binary, JsonBinaryRef object, size_t index, const char **key) {
+    if (JSON_TAPE_TAG(object) != '{') return JSON_BINARY_NONE;
+    uint64_t at = JSON_TAPE_PAYLOAD(object);
+    uint64_t count = json_binary_load64(binary, at);
+    if (index >= count) return JSON_BINARY_NONE;
+    if (key) {
+        size_t len;
+        *key = json_binary_text(binary, json_binary_load64(binary, at + 8 + 8 * index), &len);
+    }
+    return json_binary_load64(binary, at + 8 + 8 * (count + index));
+}
+
+JsonBinaryRef json_binary_object_get(const JsonBinary *binary, JsonBinaryRef object, const char *key) {
+    if (JSON_TAPE_TAG(object) != '{' || !key) return JSON_BINARY_NONE;
+    uint64_t at = JSON_TAPE_PAYLOAD(object);
+    uint64_t count = json_binary_load64(binary, at);
+    uint64_t order_at = at + 8 + 16 * count;
+    if (count > binary->size || order_at + 4 * count > binary->size) return JSON_BINARY_NONE;
+
+    size_t key_len = strlen(key);
+    size_t low = 0, high = (size_t)count;
+    uint32_t member = 0;
+    bool found = false;
+    // Lower bound, so duplicate keys resolve to the first one like json_get_object_item
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        memcpy(&member, binary->data + order_at + 4 * mid, sizeof(member));
+        size_t len;
+        const char *text = member < count ? json_binary_text(binary, json_binary_load64(binary, at + 8 + 8 * (uint64_t)member), &len) : NULL;
+        if (!text) return JSON_BINARY_NONE;
+        int c = json_binary_compare(text, len, key, key_len);
+        if (c < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+            found = c == 0;
+        }
+    }
+    if (!found) return JSON_BINARY_NONE;
+    memcpy(&member, binary->data + order_at + 4 * low, sizeof(member));
+    return json_binary_load64(binary, at + 8 + 8 * (count + member));
+}
+
+/*
+ * The writer lays containers out in the order this walk visits them, so
+ * each one must start past the previous one: a file whose refs loop
+ * back or share a container would otherwise expand without end.
+ */
+static Json *json_binary_to_json_at(POSITION_INFO_DECLARATION, Arena *arena, const JsonBinary *binary,
+                                    JsonBinaryRef ref, size_t depth, uint64_t *previous) {
+    static const JsonParseOptions defaults = {0};
+    JsonType type = json_binary_type(binary, ref);
+    if (type == JSON_ARRAY || type == JSON_OBJECT) {
+        uint64_t at = JSON_TAPE_PAYLOAD(ref);
+        if (depth >= JSON_MAX_DEPTH_DEFAULT || at <= *previous) {
+            raise_warn__(file, func, line, "PARSE: Binary container at %llu %s, read as null", (unsigned long long)at,
+                         depth >= JSON_MAX_DEPTH_DEFAULT ? "nests too deep" : "does not follow its parent");
+            type = JSON_NULL;
+        } else {
+            *previous = at;
+        }
+    }
+    Json *item = json_alloc_item__(file, func, line, arena, type);
+    switch (item->type) {
+        case JSON_BOOL:
+            item->value.boolean = json_binary_bool(binary, ref);
+            break;
+        case JSON_INTEGER:
+            item->value.integer = json_binary_integer(binary, ref);
+            break;
+        case JSON_NUMBER:
+            item->value.number = json_binary_number(binary, ref);
+            break;
+        case JSON_STRING:
+        case JSON_RAW_NUMBER:
+            item->value.string = (char *)json_binary_string(binary, ref);
+            if (!item->value.string) item->type = JSON_NULL;
+            break;
+        case JSON_ARRAY:
+        case JSON_OBJECT: {
+            size_t count = json_binary_length(binary, ref);
+            if (count > binary->size / 8) count = 0;
+            Json *last = NULL;
+            for (size_t i = 0; i < count; i++) {
+                const char *key = NULL;
+                JsonBinaryRef child_ref = item->type == JSON_ARRAY
+                    ? json_binary_array_get(binary, ref, i)
+                    : json_binary_object_at(binary, ref, i, &key);
+                Json *child = json_binary_to_json_at(file, func, line, arena, binary, child_ref, depth + 1, previous);
+                child->key = (char *)(item->type == JSON_OBJECT ? (key ? key : "") : NULL);
+                if (last) last->next = child;
+                else item->value.child = child;
+                last = child;
+            }
+            if (item->type == JSON_OBJECT) {
+                json_object_index_parsed__(file, func, line, arena, item, count, &defaults);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return item;
+}
+
+Json *json_binary_to_json__(POSITION_INFO_DECLARATION, Arena *arena, const JsonBinary *binary, JsonBinaryRef ref) {
+    uint64_t previous = 0;
+    return json_binary_to_json_at(file, func, line, arena, binary, ref, 0, &previous);
+}
+
+/*
+ * Streaming tokenizer. Strings are gathered raw (escapes still encoded)
+ * into the token buffer and decoded in place with json_decode_body, the
+ * same decoder the tree parsers use. Unlike json_parse, the stream is
+ * strict: no trailing commas and no containers left open at end of input.
+ */
+
+#define JSON_STREAM_READ_SIZE (64 * MEM_KiB)
+
+typedef enum {
+    JSON_LEX_NONE,
+    JSON_LEX_STRING,
+    JSON_LEX_SCALAR,
+} JsonStreamLex;
+
+typedef enum {
+    JSON_EXPECT_VALUE,
+    JSON_EXPECT_VALUE_OR_END,
+    JSON_EXPECT_KEY,
+    JSON_EXPECT_KEY_OR_END,
+    JSON_EXPECT_COLON,
+    JSON_EXPECT_COMMA_OR_END,
+    JSON_EXPECT_DONE,
+} JsonStreamExpect;
+
+struct JsonStream {
+    char *stack;            /* '{' or '[' for every open container */
+    size_t depth;
+    size_t max_depth;
+    char *token;            /* Current string or scalar, NUL-terminated when emitted */
+    size_t token_len;
+    size_t max_token;
+    const char *chunk;
+    size_t chunk_len;
+    size_t chunk_pos;
+    size_t offset;          /* Bytes of earlier chunks */
+    bool finished;
+    bool escape;            /* Last string byte was an unescaped backslash */
+    bool string_is_key;
+    JsonStreamLex lex;
+    JsonStreamExpect expect;
+    HecticError error;
+};
+
+const char *json_token_type_to_string(JsonTokenType type) {
+    switch (type) {
+        case JSON_TOKEN_NONE: return "NONE";
+        case JSON_TOKEN_OBJECT_BEGIN: return "OBJECT_BEGIN";
+        case JSON_TOKEN_OBJECT_END: return "OBJECT_END";
+        case JSON_TOKEN_ARRAY_BEGIN: return "ARRAY_BEGIN";
+        case JSON_TOKEN_ARRAY_END: return "ARRAY_END";
+        case JSON_TOKEN_KEY: return "KEY";
+        case JSON_TOKEN_STRING: return "STRING";
+        case JSON_TOKEN_NUMBER: return "NUMBER";
+        case JSON_TOKEN_INTEGER: return "INTEGER";
+        case JSON_TOKEN_BOOL: return "BOOL";
+        case JSON_TOKEN_NULL: return "NULL";
+        case JSON_TOKEN_END: return "END";
+        case JSON_TOKEN_ERROR: return "ERROR";
+        default: return "UNKNOWN";
+    }
+}
+
+JsonStream *json_stream_init__(POSITION_INFO_DECLARATION, Arena *arena, size_t max_depth, size_t max_token) {
+    if (!arena || max_token < 2) {
+        raise_exception__(file, func, line,
+            "STREAM: Invalid arguments (arena: %p, max_token: %zu)", arena, max_token);
+        return NULL;
+    }
+    if (!max_depth) max_depth = JSON_MAX_DEPTH_DEFAULT;
+    JsonStream *stream = arena_alloc__(file, func, line, arena, sizeof(JsonStream));
+    memset(stream, 0, sizeof(JsonStream));
+    stream->stack = arena_alloc__(file, func, line, arena, max_depth);
+    stream->max_depth = max_depth;
+    stream->token = arena_alloc__(file, func, line, arena, max_token);
+    stream->max_token = max_token;
+    stream->expect = JSON_EXPECT_VALUE;
+    raise_debug__(file, func, line,
+        "STREAM: Initialized (max_depth: %zu, max_token: %zu)", max_depth, max_token);
+    return stream;
+}
+
+void json_stream_feed(JsonStream *stream, const char *chunk, size_t len) {
+    stream->offset += stream->chunk_pos;
+    stream->chunk = chunk;
+    stream->chunk_len = len;
+    stream->chunk_pos = 0;
+}
+
+void json_stream_finish(JsonStream *stream) {
+    json_stream_feed(stream, NULL, 0);
+    stream->finished = true;
+}
+
+HecticError json_stream_error(const JsonStream *stream) {
+    return stream->error;
+}
+
+size_t json_stream_offset(const JsonStream *stream) {
+    return stream->offset + stream->chunk_pos;
+}
+
+static JsonTokenType json_stream_fail(JsonStream *stream, HecticErrorCode code, char *message) {
+    stream->error = (HecticError){ .code = code, .message = message };
+    return JSON_TOKEN_ERROR;
+}
+
+static bool json_stream_push(JsonStream *stream, char c) {
+    if (stream->token_len + 1 >= stream->max_token) return false; // keep room for the NUL
+    stream->token[stream->token_len++] = c;
+    return true;
+}
+
+static void json_stream_after_value(JsonStream *stream) {
+    stream->expect = stream->depth ? JSON_EXPECT_COMMA_OR_END : JSON_EXPECT_DONE;
+}
+
+static JsonTokenType json_stream_emit_string(JsonStream *stream, JsonToken *token) {
+    const char *error = NULL;
+    stream->token[stream->token_len] = '\0';
+    char *end = json_decode_body(stream->token, stream->token + stream->token_len, stream->token, &error);
+    if (!end) return json_stream_fail(stream, JSON_ERROR_SYNTAX, (char *)error);
+    *end = '\0';
+
+    stream->lex = JSON_LEX_NONE;
+    token->string = stream->token;
+    token->length = (size_t)(end - stream->token);
+    token->depth = stream->depth;
+    if (stream->string_is_key) {
+        stream->expect = JSON_EXPECT_COLON;
+        token->type = JSON_TOKEN_KEY;
+    } else {
+        json_stream_after_value(stream);
+        token->type = JSON_TOKEN_STRING;
+    }
+    return token->type;
+}
+
+static JsonTokenType json_stream_emit_scalar(JsonStream *stream, JsonToken *token) {
+    const char *s = stream->token;
+    stream->token[stream->token_len] = '\0';
+    stream->lex = JSON_LEX_NONE;
+    token->string = s;
+    token->length = stream->token_len;
+    token->depth = stream->depth;
+    if (strcmp(s, "null") == 0) {
+        token->type = JSON_TOKEN_NULL;
+    } else if (strcmp(s, "true") == 0 || strcmp(s, "false") == 0) {
+        token->type = JSON_TOKEN_BOOL;
+        token->boolean = *s == 't';
+    } else if (*s == '-' || isdigit((unsigned char)*s)) {
+        JsonNumberScan n;
+        if (!json_scan_number(s, &n) || n.end != s + stream->token_len) {
+            return json_stream_fail(stream, JSON_ERROR_SYNTAX, "Invalid number");
+        }
+        if (json_number_to_int64(&n, &token->integer)) {
+            token->type = JSON_TOKEN_INTEGER;
+            token->number = (double)token->integer;
+        } else {
+            token->type = JSON_TOKEN_NUMBER;
+            token->number = json_number_to_double(&n);
+        }
+    } else {
+        return json_stream_fail(stream, JSON_ERROR_SYNTAX, "Unrecognized JSON value");
+    }
+    json_stream_after_value(stream);
+    return token->type;
+}
+
+JsonTokenType json_stream_next(JsonStream *stream, JsonToken *token) {
+    if (stream->error.code != HECTIC_ERROR_NONE) return JSON_TOKEN_ERROR;
+    memset(token, 0, sizeof(JsonToken));
+
+    for (;;) {
+        if (stream->lex == JSON_LEX_STRING) {
+            while (stream->chunk_pos < stream->chunk_len) {
+                char c = stream->chunk[stream->chunk_pos++];
+                if (stream->escape) stream->escape = false;
+                else if (c == '\\') stream->escape = true;
+                else if (c == '"') return json_stream_emit_string(stream, token);
+                if (!json_stream_push(stream, c)) {
+                    return json_stream_fail(stream, JSON_ERROR_TOKEN_TOO_LONG, "String longer than max_token");
+                }
+            }
+            if (!stream->finished) return JSON_TOKEN_NONE;
+            return json_stream_fail(stream, JSON_ERROR_SYNTAX, "Unterminated string");
+        }
+
+        if (stream->lex == JSON_LEX_SCALAR) {
+            while (stream->chunk_pos < stream->chunk_len) {
+                char c = stream->chunk[stream->chunk_pos];
+                if (json_char_class[(unsigned char)c]) return json_stream_emit_scalar(stream, token);
+                if (!json_stream_push(stream, c)) {
+                    return json_stream_fail(stream, JSON_ERROR_TOKEN_TOO_LONG, "Scalar longer than max_token");
+                }
+                stream->chunk_pos++;
+            }
+            if (!stream->finished) return JSON_TOKEN_NONE;
+            return json_stream_emit_scalar(stream, token);
+        }
+
+        while (stream->chunk_pos < stream->chunk_len
+               && (json_char_class[(unsigned char)stream->chunk[stream->chunk_pos]] & JSON_CLASS_WHITESPACE)) {
+            stream->chunk_pos++;
+        }
+        if (stream->chunk_pos == stream->chunk_len) {
+            if (!stream->finished) return JSON_TOKEN_NONE;
+            if (stream->expect != JSON_EXPECT_DONE) {
+                return json_stream_fail(stream, JSON_ERROR_SYNTAX, "Unexpected end of input");
+            }
+            token->type = JSON_TOKEN_END;
+            return JSON_TOKEN_END;
+        }
+
+        char c = stream->chunk[stream->chunk_pos++];
+        bool value_expected = stream->expect == JSON_EXPECT_VALUE || stream->expect == JSON_EXPECT_VALUE_OR_END;
+        bool key_expected = stream->expect == JSON_EXPECT_KEY || stream->expect == JSON_EXPECT_KEY_OR_END;
+        char top = stream->depth ? stream->stack[stream->depth - 1] : 0;
+        switch (c) {
+            case '{':
+            case '[':
+                if (!value_expected) break;
+                if (stream->depth == stream->max_depth) {
+                    return json_stream_fail(stream, JSON_ERROR_DEPTH_LIMIT, "Nesting deeper than max_depth");
+                }
+                token->depth = stream->depth;
+                stream->stack[stream->depth++] = c;
+                stream->expect = c == '{' ? JSON_EXPECT_KEY_OR_END : JSON_EXPECT_VALUE_OR_END;
+                token->type = c == '{' ? JSON_TOKEN_OBJECT_BEGIN : JSON_TOKEN_ARRAY_BEGIN;
+                return token->type;
+            case '}':
+            case ']':
+                if (top != (c == '}' ? '{' : '[')) break;
+                if (stream->expect != JSON_EXPECT_COMMA_OR_END
+                    && stream->expect != (c == '}' ? JSON_EXPECT_KEY_OR_END : JSON_EXPECT_VALUE_OR_END)) break;
+                token->depth = --stream->depth;
+                json_stream_after_value(stream);
+                token->type = c == '}' ? JSON_TOKEN_OBJECT_END : JSON_TOKEN_ARRAY_END;
+                return token->type;
+            case ',':
+                if (stream->expect != JSON_EXPECT_COMMA_OR_END) break;
+                stream->expect = top == '{' ? JSON_EXPECT_KEY : JSON_EXPECT_VALUE;
+                continue;
+            case ':':
+                if (stream->expect != JSON_EXPECT_COLON) break;
+                stream->expect = JSON_EXPECT_VALUE;
+                continue;
+            case '"':
+                if (!value_expected && !key_expected) break;
+                stream->string_is_key = key_expected;
+                stream->lex = JSON_LEX_STRING;
+                stream->escape = false;
+                stream->token_len = 0;
+                continue;
+            default:
+                if (!value_expected) break;
+                stream->lex = JSON_LEX_SCALAR;
+                stream->token_len = 0;
+                json_stream_push(stream, c);
+                continue;
+        }
+        stream->chunk_pos--;
+        return json_stream_fail(stream, JSON_ERROR_SYNTAX, "Unexpected character");
+    }
+}
+
+EmptyResult json_stream_parse__(POSITION_INFO_DECLARATION, JsonStream *stream,
+                                JsonStreamReader reader, void *reader_ctx, JsonStreamCallback callback, void *user) {
+    if (!stream || !reader || !callback) {
+        raise_exception__(file, func, line, "STREAM: Invalid arguments (NULL stream, reader or callback)");
+        return RESULT_ERROR(EmptyResult, JSON_ERROR_INVALID_INPUT, "NULL stream, reader or callback");
+    }
+    char *buffer = arena_memory_alloc(JSON_STREAM_READ_SIZE);
+    if (!buffer) {
+        return RESULT_ERROR(EmptyResult, JSON_ERROR_OUT_OF_MEMORY, "Failed to allocate read buffer");
+    }
+
+    EmptyResult result = { .type = RESULT_SOME };
+    JsonToken token;
+    for (;;) {
+        JsonTokenType type = json_stream_next(stream, &token);
+        if (type == JSON_TOKEN_NONE) {
+            ssize_t n = reader(reader_ctx, buffer, JSON_STREAM_READ_SIZE);
+            if (n < 0) {
+                result = RESULT_ERROR(EmptyResult, JSON_ERROR_IO, "Failed to read input");
+                break;
+            }
+            if (n == 0) json_stream_finish(stream);
+            else json_stream_feed(stream, buffer, (size_t)n);
+            continue;
+        }
+        if (type == JSON_TOKEN_ERROR) {
+            result = (EmptyResult){ .type = RESULT_ERROR, .Result.error = stream->error };
+            break;
+        }
+        if (!callback(&token, user)) {
+            result = RESULT_ERROR(EmptyResult, JSON_ERROR_ABORTED, "Stopped by callback");
+            break;
+        }
+        if (type == JSON_TOKEN_END) break;
+    }
+    arena_memory_free(buffer);
+
+    if (IS_RESULT_ERROR(result)) {
+        raise_debug__(file, func, line, "STREAM: %s at offset %zu",
+                      result.Result.error.message, json_stream_offset(stream));
+    }
+    return result;
+}
+
+static ssize_t json_stream_read_fd(void *ctx, char *buf, size_t cap) {
+    int fd = *(int *)ctx;
+    ssize_t n;
+    do {
+        n = read(fd, buf, cap);
+    } while (n < 0 && errno == EINTR);
+    return n;
+}
+
+EmptyResult json_stream_parse_fd__(POSITION_INFO_DECLARATION, JsonStream *stream,
+                                   int fd, JsonStreamCallback callback, void *user) {
+    return json_stream_parse__(file, func, line, stream, json_stream_read_fd, &fd, callback, user);
+}
+
+char *json_to_str__(POSITION_INFO_DECLARATION, Arena *arena, const Json * const item) {
+    return json_to_str_with_opts__(file, func, line, arena, item, JSON_NORAW);
+}
+
+/* Compact printer. When raw is non-zero, strings are printed without quotes or escaping. */
 char *json_to_str_with_opts__(POSITION_INFO_DECLARATION, Arena *arena, const Json * const item, JsonRawOpt raw) {
-    // Function entry with DEBUG level
-    raise_debug__(file, func, line, 
-                  "FORMAT: Starting JSON conversion to string (item: %p, raw_mode: %s)", 
-                  item, raw == JSON_RAW ? "enabled" : "disabled");
+    const JsonWriteOptions opts = { .raw = raw };
+    return json_to_str_internal__(file, func, line, arena, item, &opts, 0);
+}
+
+/* Retrieve an object item by key (case-sensitive) */
+Json *json_get_object_item__(POSITION_INFO_DECLARATION, const Json * const object, const char * const key) {
+    raise_trace__(file, func, line, 
+                 "ACCESS: Searching for key \"%s\" in JSON object %p", 
+                 key ? key : "<null>", object);
     
     // Check input parameters
-    if (!item) {
-        raise_exception__(file, func, line, 
-                     "FORMAT: Invalid JSON object (NULL) provided for string conversion");
+    if (!object) {
+        raise_warn__(file, func, line, 
+                     "ACCESS: Invalid object (NULL) passed to json_get_object_item");
         return NULL;
     }
     
-    if (!arena) {
-        raise_exception__(file, func, line,
-                     "FORMAT: Invalid arena (NULL) provided for string conversion");
+    if (!key) {
+        raise_warn__(file, func, line, 
+                     "ACCESS: Invalid key (NULL) passed to json_get_object_item");
         return NULL;
     }
     
-    // Allocate memory for the string
-    char *out = arena_alloc__(file, func, line, arena, 1024);
-    if (!out) {
-        raise_exception__(file, func, line, 
-                     "FORMAT: Memory allocation failed during JSON string conversion");
+    if (object->type != JSON_OBJECT) {
+        raise_warn__(file, func, line, 
+                     "ACCESS: JSON value is not an object (actual type: %d)", object->type);
         return NULL;
     }
     
-    char *ptr = out;
-    const char* type_name = "unknown";
+    // Wide objects answer from their key table
+    Json *child = json_child__(file, func, line, object);
+    if (object->index && json_object_index_find(file, func, line, object, key, &child)) {
+        if (child) {
+            raise_log__(file, func, line,
+                         "ACCESS: Found value for key \"%s\" (type: %s)",
+                         key, json_type_to_string(child->type));
+        } else {
+            raise_debug__(file, func, line, "ACCESS: Key \"%s\" not found in indexed object", key);
+        }
+        return child;
+    }
+
+    // Per-key tracing is decided once, not for every child
+    bool trace = false;
+#if PRECOMPILED_LOG_LEVEL <= LOG_LEVEL_TRACE
+    trace = logger_get_effective_level(file, func, line) <= LOG_LEVEL_TRACE;
+#endif
+
+    // Perform key search
+    int position = 0;
     
-    // Formatting based on type
-    if (item->type == JSON_OBJECT) {
-        ptr += sprintf(ptr, "{");
-        type_name = "object";
-        
-        Json *child = item->value.child;
-        int child_count = 0;
-        
-        raise_trace__(file, func, line, 
-                      "FORMAT: Processing JSON object children");
-        
-        while (child) {
-            ptr += sprintf(ptr, "\"%s\":", child->key ? child->key : "");
-            char *child_str = json_to_str_with_opts__(file, func, line, arena, child, raw);
-            if (child_str) {
-                ptr += sprintf(ptr, "%s", child_str);
-            } else {
-                raise_warn__(file, func, line, 
-                              "FORMAT: Failed to stringify child element (key=%s)", 
-                              child->key ? child->key : "<null>");
+    while (child) {
+        if (child->key) {
+            if (trace) {
+                raise_trace__(file, func, line, 
+                             "ACCESS: Comparing key \"%s\" with \"%s\" at position %d", 
+                             child->key, key, position);
             }
             
-            if (child->next) {
-                ptr += sprintf(ptr, ",");
+            if (strcmp(child->key, key) == 0) {
+                raise_log__(file, func, line, 
+                             "ACCESS: Found value for key \"%s\" (type: %s)", 
+                             key, json_type_to_string(child->type));
+                return child;
             }
-            child = child->next;
-            child_count++;
+        } else if (trace) {
+            raise_trace__(file, func, line, 
+                         "ACCESS: Skipping element at position %d with NULL key", position);
         }
         
-        sprintf(ptr, "}");
-        raise_trace__(file, func, line, 
-                      "FORMAT: Object conversion complete with %d child elements", child_count);
-    } else if (item->type == JSON_ARRAY) {
-        ptr += sprintf(ptr, "[");
-        type_name = "array";
-        
-        Json *child = item->value.child;
-        int child_count = 0;
-        
-        raise_trace__(file, func, line, 
-                      "FORMAT: Processing JSON array elements");
-        
-        while (child) {
-            char *child_str = json_to_str_with_opts__(file, func, line, arena, child, raw);
-            if (child_str) {
-                ptr += sprintf(ptr, "%s", child_str);
-            } else {
-                raise_warn__(file, func, line, 
-                              "FORMAT: Failed to stringify array element at index %d", child_count);
+        child = child->next;
+        position++;
+    }
+    
+    raise_debug__(file, func, line, 
+                 "ACCESS: Key \"%s\" not found in object (checked %d items)", 
+                 key, position);
+    return NULL;
+}
+
+/*
+ * Mutation. Containers are expanded first if the parse was lazy; objects
+ * keep their key table in step by refilling it in place, or drop it to be
+ * rebuilt larger on the next lookup when it would be more than half full.
+ */
+
+static Json *json_object_find(POSITION_INFO_DECLARATION, const Json *object, const char *key);
+
+static bool json_expect_type(POSITION_INFO_DECLARATION, const Json *item, JsonType type, const char *what) {
+    if (item && item->type == type) return true;
+    raise_warn__(file, func, line, "MUTATE: %s needs a JSON %s, got %s", what, json_type_to_string(type),
+                 item ? json_type_to_string(item->type) : "NULL");
+    return false;
+}
+
+/* Link that points at the position-th child, or at the end when there are fewer; *passed gets how many came before */
+static Json **json_child_link(POSITION_INFO_DECLARATION, Json *container, size_t position, size_t *passed) {
+    Json **link = &container->value.child;
+    size_t i = 0;
+    for (json_child__(file, func, line, container); *link && i < position; i++) link = &(*link)->next;
+    if (passed) *passed = i;
+    return link;
+}
+
+/* Called after the children of object changed; arena, when given, lets a newly wide object get a table */
+static void json_object_index_update(POSITION_INFO_DECLARATION, Arena *arena, Json *object) {
+    JsonObjectIndex *index = object->index;
+    size_t count = 0;
+    for (Json *child = object->value.child; child; child = child->next) count++;
+    if (!index) {
+        if (!arena || count < JSON_INDEX_THRESHOLD_DEFAULT) return;
+        index = arena_alloc_or_null__(file, func, line, arena, sizeof(JsonObjectIndex), false);
+        if (!index) return;
+        *index = (JsonObjectIndex){ .arena = arena };
+        object->index = index;
+        return;
+    }
+    index->failed = false;
+    if (!index->slots) return;
+    if (count * 2 > index->mask + 1) {
+        index->slots = NULL;
+        return;
+    }
+    memset(index->slots, 0, (index->mask + 1) * sizeof(Json *));
+    json_object_index_fill(index->slots, index->mask, object->value.child);
+}
+
+Json *json_new__(POSITION_INFO_DECLARATION, Arena *arena, JsonType type) {
+    if (!arena) {
+        raise_exception__(file, func, line, "MUTATE: Invalid arena (NULL) for a new JSON %s", json_type_to_string(type));
+        return NULL;
+    }
+    Json *item = json_alloc_item__(file, func, line, arena, type);
+    if (type == JSON_STRING || type == JSON_RAW_NUMBER) item->value.string = arena_strdup__(file, func, line, arena, type == JSON_STRING ? "" : "0");
+    return item;
+}
+
+/* Turn a scalar into another scalar; containers are refused so their children are not lost silently */
+static bool json_set_scalar(POSITION_INFO_DECLARATION, Json *item, JsonType type) {
+    if (!item || item->type == JSON_ARRAY || item->type == JSON_OBJECT) {
+        raise_warn__(file, func, line, "MUTATE: Cannot set a %s value on %s", json_type_to_string(type),
+                     item ? json_type_to_string(item->type) : "NULL");
+        return false;
+    }
+    item->type = type;
+    item->flags = 0;
+    memset(&item->value, 0, sizeof(item->value));
+    return true;
+}
+
+bool json_set_null__(POSITION_INFO_DECLARATION, Json *item) {
+    return json_set_scalar(file, func, line, item, JSON_NULL);
+}
+
+bool json_set_bool__(POSITION_INFO_DECLARATION, Json *item, bool value) {
+    if (!json_set_scalar(file, func, line, item, JSON_BOOL)) return false;
+    item->value.boolean = value;
+    return true;
+}
+
+bool json_set_integer__(POSITION_INFO_DECLARATION, Json *item, int64_t value) {
+    if (!json_set_scalar(file, func, line, item, JSON_INTEGER)) return false;
+    item->value.integer = value;
+    return true;
+}
+
+bool json_set_number__(POSITION_INFO_DECLARATION, Json *item, double value) {
+    if (!json_set_scalar(file, func, line, item, JSON_NUMBER)) return false;
+    item->value.number = value;
+    return true;
+}
+
+bool json_set_string__(POSITION_INFO_DECLARATION, Arena *arena, Json *item, const char *value) {
+    if (!arena || !value) {
+        raise_warn__(file, func, line, "MUTATE: json_set_string needs an arena and a string");
+        return false;
+    }
+    if (!json_set_scalar(file, func, line, item, JSON_STRING)) return false;
+    item->value.string = arena_strdup__(file, func, line, arena, value);
+    return true;
+}
+
+Json *json_object_set__(POSITION_INFO_DECLARATION, Arena *arena, Json *object, const char *key, Json *value) {
+    if (!json_expect_type(file, func, line, object, JSON_OBJECT, "json_object_set")) return NULL;
+    if (!arena || !key || !value) {
+        raise_warn__(file, func, line, "MUTATE: json_object_set needs an arena, a key and a value");
+        return NULL;
+    }
+    Json **link = &object->value.child;
+    for (json_child__(file, func, line, object); *link && (!(*link)->key || strcmp((*link)->key, key) != 0); link = &(*link)->next) {}
+    if (*link) {
+        value->key = (*link)->key;
+        value->next = (*link)->next;
+    } else {
+        value->key = arena_strdup__(file, func, line, arena, key);
+        value->next = NULL;
+    }
+    *link = value;
+    json_object_index_update(file, func, line, arena, object);
+    raise_trace__(file, func, line, "MUTATE: Set key \"%s\" of object %p to %s", key, object, json_type_to_string(value->type));
+    return value;
+}
+
+Json *json_object_insert__(POSITION_INFO_DECLARATION, Arena *arena, Json *object, size_t position,
+                           const char *key, Json *value) {
+    if (!json_expect_type(file, func, line, object, JSON_OBJECT, "json_object_insert")) return NULL;
+    if (!arena || !key || !value) {
+        raise_warn__(file, func, line, "MUTATE: json_object_insert needs an arena, a key and a value");
+        return NULL;
+    }
+    if (json_object_find(file, func, line, object, key)) {
+        raise_debug__(file, func, line, "MUTATE: Key \"%s\" already in object %p", key, object);
+        return NULL;
+    }
+    Json **link = json_child_link(file, func, line, object, position, NULL);
+    value->key = arena_strdup__(file, func, line, arena, key);
+    value->next = *link;
+    *link = value;
+    json_object_index_update(file, func, line, arena, object);
+    return value;
+}
+
+size_t json_object_delete__(POSITION_INFO_DECLARATION, Json *object, const char *key) {
+    if (!json_expect_type(file, func, line, object, JSON_OBJECT, "json_object_delete") || !key) return 0;
+    size_t removed = 0;
+    Json **link = &object->value.child;
+    for (json_child__(file, func, line, object); *link;) {
+        if ((*link)->key && strcmp((*link)->key, key) == 0) {
+            Json *gone = *link;
+            *link = gone->next;
+            gone->next = NULL;
+            removed++;
+        } else {
+            link = &(*link)->next;
+        }
+    }
+    if (removed) json_object_index_update(file, func, line, NULL, object);
+    return removed;
+}
+
+bool json_array_push__(POSITION_INFO_DECLARATION, Json *array, Json *value) {
+    return json_array_insert__(file, func, line, array, SIZE_MAX, value);
+}
+
+bool json_array_insert__(POSITION_INFO_DECLARATION, Json *array, size_t position, Json *value) {
+    if (!json_expect_type(file, func, line, array, JSON_ARRAY, "json_array_insert") || !value) return false;
+    size_t passed;
+    Json **link = json_child_link(file, func, line, array, position, &passed);
+    if (passed < position && position != SIZE_MAX) {
+        raise_warn__(file, func, line, "MUTATE: Position %zu is past the end of an array of %zu", position, passed);
+        return false;
+    }
+    value->key = NULL;
+    value->next = *link;
+    *link = value;
+    return true;
+}
+
+Json *json_array_remove__(POSITION_INFO_DECLARATION, Json *array, size_t position) {
+    if (!json_expect_type(file, func, line, array, JSON_ARRAY, "json_array_remove")) return NULL;
+    Json **link = json_child_link(file, func, line, array, position, NULL);
+    Json *gone = *link;
+    if (!gone) return NULL;
+    *link = gone->next;
+    gone->next = NULL;
+    return gone;
+}
+
+Json *json_array_splice__(POSITION_INFO_DECLARATION, Json *array, size_t start, size_t remove, Json *items) {
+    if (!json_expect_type(file, func, line, array, JSON_ARRAY, "json_array_splice")) return NULL;
+    Json **link = json_child_link(file, func, line, array, start, NULL);
+    Json **end = link;
+    for (size_t i = 0; *end && i < remove; i++) end = &(*end)->next;
+    Json *rest = *end;
+    Json *removed = end != link ? *link : NULL;
+    *end = NULL;  // ends the removed chain
+
+    *link = items;
+    for (; *link; link = &(*link)->next) (*link)->key = NULL;
+    *link = rest;
+    return removed;
+}
+
+/* RFC 7396 on one level: objects merge, null deletes, anything else is copied over */
+static Json *json_merge_patch_value(POSITION_INFO_DECLARATION, Arena *arena, Json *target, const Json *patch) {
+    if (patch->type != JSON_OBJECT) return json_clone_compact__(file, func, line, arena, patch);
+    if (!target || target->type != JSON_OBJECT) target = json_alloc_item__(file, func, line, arena, JSON_OBJECT);
+    for (const Json *member = json_child__(file, func, line, patch); member; member = member->next) {
+        if (!member->key) continue;
+        if (member->type == JSON_NULL) {
+            json_object_delete__(file, func, line, target, member->key);
+            continue;
+        }
+        Json *current = json_object_find(file, func, line, target, member->key);
+        Json *merged = json_merge_patch_value(file, func, line, arena, current, member);
+        if (!merged) return NULL;
+        if (merged != current) json_object_set__(file, func, line, arena, target, member->key, merged);
+    }
+    return target;
+}
+
+Json *json_merge_patch__(POSITION_INFO_DECLARATION, Arena *arena, Json *target, const Json *patch) {
+    if (!arena || !patch) {
+        raise_exception__(file, func, line, "MUTATE: Invalid arguments (arena: %p, patch: %p)", arena, patch);
+        return NULL;
+    }
+    Json *result = json_merge_patch_value(file, func, line, arena, target, patch);
+    if (!result) {
+        raise_exception__(file, func, line, "MUTATE: Out of memory applying JSON merge patch");
+        return NULL;
+    }
+    raise_debug__(file, func, line, "MUTATE: Applied merge patch %p to %p (result: %s)",
+                  patch, target, json_type_to_string(result->type));
+    return result;
+}
+
+/*
+ * Compiled paths. json_path_compile does all the string work once; the
+ * evaluators only compare keys and count array positions.
+ */
+
+/* Key lookup without the per-call logging of json_get_object_item */
+static Json *json_object_find(POSITION_INFO_DECLARATION, const Json *object, const char *key) {
+    Json *child = json_child__(file, func, line, object);
+    if (object->index && json_object_index_find(file, func, line, object, key, &child)) return child;
+    for (; child; child = child->next) {
+        if (child->key && strcmp(child->key, key) == 0) return child;
+    }
+    return NULL;
+}
+
+static size_t json_child_count(POSITION_INFO_DECLARATION, const Json *container) {
+    size_t count = 0;
+    for (const Json *child = json_child__(file, func, line, container); child; child = child->next) count++;
+    return count;
+}
+
+/* Array position of a possibly negative index, or -1 when out of range */
+static int64_t json_path_position(int64_t index, size_t length) {
+    if (index < 0) index += (int64_t)length;
+    return index >= 0 && (uint64_t)index < length ? index : -1;
+}
+
+static bool json_path_unquoted(char c) {
+    return (unsigned char)c >= 0x20 && !strchr("\"\\.[]{}", c);
+}
+
+JsonPathResult json_path_compile__(POSITION_INFO_DECLARATION, Arena *arena, const char *source) {
+    if (!arena || !source) {
+        raise_exception__(file, func, line, "PATH: Invalid arguments (arena: %p, source: %p)", arena, source);
+        return RESULT_ERROR(JsonPathResult, JSON_ERROR_INVALID_INPUT, "NULL input");
+    }
+    const char *p = skip_whitespace(source);
+    size_t len = strlen(p);
+    while (len && isspace((unsigned char)p[len - 1])) len--;
+    const char *end = p + len;
+
+    JsonPath *path = arena_alloc__(file, func, line, arena, sizeof(JsonPath));
+    path->source = arena_strdup__(file, func, line, arena, source);
+    path->segments = NULL;
+    path->count = 0;
+    if (len == 1 && *p == '.') return RESULT_SOME(JsonPathResult, *path);
+
+    // Every segment takes at least two characters, but the last one
+    path->segments = arena_alloc__(file, func, line, arena, (len / 2 + 1) * sizeof(JsonPathSegment));
+    const char *error = len ? NULL : "Empty path";
+    bool need_segment = true;
+    while (!error && p < end) {
+        JsonPathSegment *segment = &path->segments[path->count];
+        if (*p == '[') {
+            bool negative = *++p == '-';
+            if (negative) p++;
+            if (!isdigit((unsigned char)*p) || (*p == '0' && (negative || isdigit((unsigned char)p[1])))) {
+                error = "Invalid array index";
+                break;
             }
-            
-            if (child->next) {
-                ptr += sprintf(ptr, ",");
+            int64_t index = 0;
+            for (; isdigit((unsigned char)*p); p++) {
+                if (index > (INT64_MAX - 9) / 10) {
+                    error = "Array index out of range";
+                    break;
+                }
+                index = index * 10 + (*p - '0');
+            }
+            if (error) break;
+            if (*p++ != ']') {
+                error = "Expected ']' after array index";
+                break;
+            }
+            segment->type = JSON_PATH_INDEX;
+            segment->index = negative ? -index : index;
+            segment->key = NULL;
+        } else if (*p == '"') {
+            // Quoted keys may hold anything; "" stands for one quote
+            char *key = arena_alloc__(file, func, line, arena, (size_t)(end - p));
+            size_t n = 0;
+            for (p++;; p++) {
+                if (p >= end) {
+                    error = "Unterminated quoted key";
+                    break;
+                }
+                if (*p == '"') {
+                    if (p + 1 < end && p[1] == '"') p++;
+                    else break;
+                }
+                key[n++] = *p;
             }
-            child = child->next;
-            child_count++;
+            if (error) break;
+            p++;
+            key[n] = '\0';
+            segment->type = JSON_PATH_KEY;
+            segment->key = key;
+        } else if (json_path_unquoted(*p)) {
+            const char *start = p;
+            while (p < end && json_path_unquoted(*p)) p++;
+            char *key = arena_alloc__(file, func, line, arena, (size_t)(p - start) + 1);
+            memcpy(key, start, (size_t)(p - start));
+            key[p - start] = '\0';
+            segment->type = JSON_PATH_KEY;
+            segment->key = key;
+        } else {
+            error = "Unexpected character in path";
+            break;
         }
-        
-        sprintf(ptr, "]");
-        raise_trace__(file, func, line, 
-                      "FORMAT: Array conversion complete with %d elements", child_count);
-    } else if (item->type == JSON_STRING) {
-        type_name = "string";
-        if ((int)raw) {
-            sprintf(ptr, "%s", item->value.string ? item->value.string : "");
+        path->count++;
+        need_segment = false;
+
+        if (p < end && *p == '.') {
+            p++;
+            need_segment = true;
+        } else if (p < end && *p != '[') {
+            error = "Expected '.' or '[' between path segments";
+        }
+    }
+    if (!error && need_segment) error = "Path ends with '.'";
+    if (error) {
+        raise_debug__(file, func, line, "PATH: %s at offset %zu in \"%s\"", error, (size_t)(p - source), source);
+        return RESULT_ERROR(JsonPathResult, JSON_ERROR_INVALID_PATH, (char *)error);
+    }
+    raise_trace__(file, func, line, "PATH: Compiled \"%s\" into %zu segments", source, path->count);
+    return RESULT_SOME(JsonPathResult, *path);
+}
+
+Json *json_path_eval__(POSITION_INFO_DECLARATION, const Json *root, const JsonPath *path) {
+    const Json *node = root;
+    for (size_t i = 0; node && i < path->count; i++) {
+        const JsonPathSegment *segment = &path->segments[i];
+        if (segment->type == JSON_PATH_KEY) {
+            node = node->type == JSON_OBJECT ? json_object_find(file, func, line, node, segment->key) : NULL;
+        } else if (node->type == JSON_ARRAY) {
+            int64_t position = segment->index >= 0
+                ? segment->index : json_path_position(segment->index, json_child_count(file, func, line, node));
+            node = position < 0 ? NULL : json_child__(file, func, line, node);
+            for (int64_t k = 0; node && k < position; k++) node = node->next;
         } else {
-            sprintf(ptr, "\"%s\"", item->value.string ? item->value.string : "");
+            node = NULL;
         }
-    } else if (item->type == JSON_NUMBER) {
-        type_name = "number";
-        sprintf(ptr, "%g", item->value.number);
-    } else if (item->type == JSON_BOOL) {
-        type_name = "boolean";
-        sprintf(ptr, item->value.boolean ? "true" : "false");
-    } else if (item->type == JSON_NULL) {
-        type_name = "null";
-        sprintf(ptr, "null");
     }
-    
-    raise_log__(file, func, line, 
-                  "FORMAT: JSON %s converted to string (length=%zu)", 
-                  type_name, strlen(out));
-    
-    return out;
+    return (Json *)node;
 }
 
-/* Retrieve an object item by key (case-sensitive) */
-Json *json_get_object_item__(POSITION_INFO_DECLARATION, const Json * const object, const char * const key) {
-    raise_trace__(file, func, line, 
-                 "ACCESS: Searching for key \"%s\" in JSON object %p", 
-                 key ? key : "<null>", object);
-    
-    // Check input parameters
-    if (!object) {
-        raise_warn__(file, func, line, 
-                     "ACCESS: Invalid object (NULL) passed to json_get_object_item");
-        return NULL;
-    }
-    
-    if (!key) {
-        raise_warn__(file, func, line, 
-                     "ACCESS: Invalid key (NULL) passed to json_get_object_item");
-        return NULL;
-    }
-    
-    if (object->type != JSON_OBJECT) {
-        raise_warn__(file, func, line, 
-                     "ACCESS: JSON value is not an object (actual type: %d)", object->type);
-        return NULL;
+/*
+ * A path set is a trie of the compiled paths: shared prefixes are resolved
+ * once and every array on the way is walked once for all the indexes
+ * wanted from it.
+ */
+typedef struct JsonPathNode JsonPathNode;
+struct JsonPathNode {
+    JsonPathSegment segment;   /* Edge from the parent */
+    JsonPathNode *children;    /* Outgoing edges, first child */
+    JsonPathNode *next;        /* Sibling edge */
+    size_t *outputs;           /* Paths that end here */
+    size_t output_count;
+    bool negative_index;       /* Some child edge indexes from the end */
+};
+
+struct JsonPathSet {
+    JsonPathNode root;
+    size_t count;
+};
+
+static bool json_path_segment_equal(const JsonPathSegment *a, const JsonPathSegment *b) {
+    if (a->type != b->type) return false;
+    return a->type == JSON_PATH_KEY ? strcmp(a->key, b->key) == 0 : a->index == b->index;
+}
+
+JsonPathSet *json_path_set__(POSITION_INFO_DECLARATION, Arena *arena, const JsonPath *const *paths, size_t count) {
+    JsonPathSet *set = arena_alloc__(file, func, line, arena, sizeof(JsonPathSet));
+    memset(set, 0, sizeof(JsonPathSet));
+    set->count = count;
+
+    // Outputs are counted per node first so each gets one exact array
+    JsonPathNode **leaves = arena_alloc__(file, func, line, arena, (count ? count : 1) * sizeof(JsonPathNode *));
+    for (size_t i = 0; i < count; i++) {
+        JsonPathNode *node = &set->root;
+        for (size_t s = 0; s < paths[i]->count; s++) {
+            const JsonPathSegment *segment = &paths[i]->segments[s];
+            JsonPathNode *child = node->children;
+            while (child && !json_path_segment_equal(&child->segment, segment)) child = child->next;
+            if (!child) {
+                child = arena_alloc__(file, func, line, arena, sizeof(JsonPathNode));
+                memset(child, 0, sizeof(JsonPathNode));
+                child->segment = *segment;
+                child->next = node->children;
+                node->children = child;
+                if (segment->type == JSON_PATH_INDEX && segment->index < 0) node->negative_index = true;
+            }
+            node = child;
+        }
+        leaves[i] = node;
+        node->output_count++;
     }
-    
-    // Count the total number of keys for debugging
-    int total_keys = 0;
-    Json *debug_scan = object->value.child;
-    while (debug_scan) {
-        total_keys++;
-        debug_scan = debug_scan->next;
+    for (size_t i = 0; i < count; i++) {
+        JsonPathNode *node = leaves[i];
+        if (!node->outputs) {
+            node->outputs = arena_alloc__(file, func, line, arena, node->output_count * sizeof(size_t));
+            node->output_count = 0;
+        }
+        node->outputs[node->output_count++] = i;
     }
-    
-    raise_trace__(file, func, line, 
-                 "ACCESS: Object has %d key-value pairs", total_keys);
-    
-    // Perform key search
-    Json *child = object->value.child;
-    int position = 0;
-    
-    while (child) {
-        if (child->key) {
-            raise_trace__(file, func, line, 
-                         "ACCESS: Comparing key \"%s\" with \"%s\" at position %d", 
-                         child->key, key, position);
-            
-            if (strcmp(child->key, key) == 0) {
-                raise_log__(file, func, line, 
-                             "ACCESS: Found value for key \"%s\" (type: %s)", 
-                             key, json_type_to_string(child->type));
-                return child;
+    return set;
+}
+
+static void json_path_set_walk(POSITION_INFO_DECLARATION, const JsonPathNode *node, const Json *value, Json **out) {
+    for (size_t i = 0; i < node->output_count; i++) out[node->outputs[i]] = (Json *)value;
+    if (!node->children) return;
+
+    if (value->type == JSON_OBJECT) {
+        for (const JsonPathNode *edge = node->children; edge; edge = edge->next) {
+            if (edge->segment.type != JSON_PATH_KEY) continue;
+            const Json *child = json_object_find(file, func, line, value, edge->segment.key);
+            if (child) json_path_set_walk(file, func, line, edge, child, out);
+        }
+    } else if (value->type == JSON_ARRAY) {
+        size_t length = node->negative_index ? json_child_count(file, func, line, value) : 0;
+        int64_t last = -1;
+        for (const JsonPathNode *edge = node->children; edge; edge = edge->next) {
+            if (edge->segment.type != JSON_PATH_INDEX) continue;
+            int64_t position = edge->segment.index >= 0
+                ? edge->segment.index : json_path_position(edge->segment.index, length);
+            if (position > last) last = position;
+        }
+        // One pass over the elements, stopping after the furthest wanted position
+        int64_t position = 0;
+        for (const Json *child = json_child__(file, func, line, value); child && position <= last; child = child->next, position++) {
+            for (const JsonPathNode *edge = node->children; edge; edge = edge->next) {
+                if (edge->segment.type != JSON_PATH_INDEX) continue;
+                int64_t wanted = edge->segment.index >= 0
+                    ? edge->segment.index : json_path_position(edge->segment.index, length);
+                if (wanted == position) json_path_set_walk(file, func, line, edge, child, out);
             }
-        } else {
-            raise_trace__(file, func, line, 
-                         "ACCESS: Skipping element at position %d with NULL key", position);
         }
-        
-        child = child->next;
-        position++;
     }
-    
-    raise_debug__(file, func, line, 
-                 "ACCESS: Key \"%s\" not found in object (checked %d items)", 
-                 key, position);
-    return NULL;
 }
 
-char *json_value_to_debug_str__(POSITION_INFO_DECLARATION, Arena *arena, const char *name, const JsonValue *self, JsonType active_variant, PtrSet *visited) {
-    char *child_str = json_to_debug_str__(file, func, line, arena, "child", self->child, visited);
-    char *result = arena_alloc__(file, func, line, arena, 1024);
-    UNION_TO_DEBUG_STR(arena, result, JsonValue, name, self, visited, active_variant, 5,
-        JSON_STRING, string_to_debug_str__(file, func, line, arena, "string", self->string),
-        JSON_NUMBER, float_to_debug_str__(file, func, line, arena, "number", self->number),
-        JSON_BOOL, bool_to_debug_str__(file, func, line, arena, "boolean", self->boolean),
-        JSON_OBJECT, child_str,
-        JSON_ARRAY, child_str
-    );
-    return result;
+void json_path_set_eval__(POSITION_INFO_DECLARATION, const JsonPathSet *set, const Json *root, Json **out) {
+    for (size_t i = 0; i < set->count; i++) out[i] = NULL;
+    if (root) json_path_set_walk(file, func, line, &set->root, root, out);
+}
+
+void json_write_debug(DebugWriter *writer, const char *name, const Json *self) {
+    type_write_debug(writer, &json_descriptor, name, self);
 }
 
 char* json_to_debug_str__(POSITION_INFO_DECLARATION, Arena *arena, const char *name, const Json *self, PtrSet *visited) {
   raise_trace__(file, func, line, "json_to_debug_str(<optimized>, <optimized>)");
 
-  char *result = arena_alloc__(file, func, line, arena, 1024);
-  STRUCT_TO_DEBUG_STR(arena, result, Json, name, self, visited, 3,
-    enum_to_debug_str__(file, func, line, arena, "type", self->type, json_type_to_string(self->type)),
-    string_to_debug_str__(file, func, line, arena, "key", self->key),
-    json_value_to_debug_str__(file, func, line, arena, "value", &self->value, self->type, visited),
-    json_to_debug_str__(file, func, line, arena, "next", self->next, visited)
-  );
-  return result;
+  DebugWriter writer = debug_writer_buffer__(file, func, line, arena, visited, false);
+  json_write_debug(&writer, name, self);
+  return debug_writer_cstr(&writer);
 }
 
 JsonResult debug_str_to_json__(POSITION_INFO_DECLARATION, Arena *arena, const char **s) {
@@ -2171,120 +8015,576 @@ LogRuleResult logger_parse_rules__(CTX_DECLARATION, const char *rules_str) {
     return RESULT_SOME(LogRuleResult, *rules);
 }
 
-// Check if a file matches a pattern
-static int match_file_pattern(const char *file, const char *pattern) {
-    if (!pattern) return 1; // NULL pattern matches any file
-    
-    // Extract the filename part without the path
-    const char *filename = strrchr(file, '/');
-    if (!filename) filename = file;
-    else filename++; // Skip the '/'
-    
-    return fnmatch(pattern, filename, 0) == 0 || fnmatch(pattern, file, 0) == 0;
+// Check if a file matches a pattern
+static int match_file_pattern(const char *file, const char *pattern) {
+    if (!pattern) return 1; // NULL pattern matches any file
+    
+    // Extract the filename part without the path
+    const char *filename = strrchr(file, '/');
+    if (!filename) filename = file;
+    else filename++; // Skip the '/'
+    
+    return fnmatch(pattern, filename, 0) == 0 || fnmatch(pattern, file, 0) == 0;
+}
+
+// Check if a function matches a pattern
+static int match_function_pattern(const char *func, const char *pattern) {
+    if (!pattern) return 1; // NULL pattern matches any function
+    return fnmatch(pattern, func, 0) == 0;
+}
+
+// Get the effective log level for a specific context
+LogLevel logger_get_effective_level(const char *file, const char *func, int line) {
+    // If no rules are defined, use the global level
+    if (!log_rules) return current_log_level;
+    
+    // Default to the global log level
+    LogLevel effective_level = current_log_level;
+    
+    // Check each rule in order
+    for (LogRule *rule = log_rules; rule; rule = rule->next) {
+        int file_match = match_file_pattern(file, rule->file_pattern);
+        int function_match = match_function_pattern(func, rule->function_pattern);
+        int line_match = (rule->line_start == -1 || (line >= rule->line_start && 
+                         (rule->line_end == -1 || line <= rule->line_end)));
+        
+        // If all conditions match, use this rule's level
+        if (file_match && function_match && line_match) {
+            effective_level = rule->level;
+            // Don't break here - later rules can override earlier ones
+        }
+    }
+    
+    return effective_level;
+}
+
+// Add a new log rule programmatically
+HecticError logger_add_rule(Arena *arena, LogRule *rules, LogLevel level, const char *file_pattern, const char *function_pattern, int line_start, int line_end) {
+    LogRuleResult init_result = log_rule_init(arena, level, file_pattern, function_pattern, line_start, line_end);
+    if (IS_RESULT_ERROR(init_result)) {
+        return RESULT_ERROR_VALUE(init_result);
+    }
+    if (!rules) {
+        *rules = RESULT_SOME_VALUE(init_result);
+    } else {
+        LogRule *last = rules;
+        while (last->next) {
+            last = last->next;
+        }
+        *last->next = RESULT_SOME_VALUE(init_result);
+    }
+    return (HecticError){ .code = HECTIC_ERROR_NONE, .message = NULL };
+}
+
+// Print all current logging rules to stderr
+void logger_print_rules() {
+    fprintf(stderr, "Current logging rules:\n");
+    fprintf(stderr, "  Default level: %s\n", log_level_to_string(current_log_level));
+    
+    int rule_count = 0;
+    for (LogRule *rule = log_rules; rule; rule = rule->next) {
+        fprintf(stderr, "  Rule %d: Level=%s, File=%s, Function=%s, Lines=%d:%d\n",
+                ++rule_count,
+                log_level_to_string(rule->level),
+                rule->file_pattern ? rule->file_pattern : "<any>",
+                rule->function_pattern ? rule->function_pattern : "<any>",
+                rule->line_start, rule->line_end);
+    }
+    
+    if (rule_count == 0) {
+        fprintf(stderr, "  No specific rules defined\n");
+    }
+}
+
+void log_rules_write_debug(DebugWriter *writer, const char *name, const LogRule *self) {
+    type_write_debug(writer, &log_rule_descriptor, name, self);
+}
+
+char *log_rules_to_debug_str__(CTX_DECLARATION, char *name, LogRule *self, PtrSet *visited) {
+    DebugWriter writer = debug_writer_buffer__(file, func, line, arena, visited, false);
+    log_rules_write_debug(&writer, name, self);
+    return debug_writer_cstr(&writer);
+}
+
+char *log_rules_to_json_str__(POSITION_INFO_DECLARATION, Arena *arena, const LogRule *rules, int indent) {
+    JsonSink sink = json_sink_buffer__(file, func, line, arena, 0);
+    JsonWriter writer = json_writer(&sink, indent);
+    json_writer_begin_array(&writer);
+    for (const LogRule *rule = rules; rule; rule = rule->next) {
+        json_writer_begin_object(&writer);
+        json_writer_key(&writer, "level");
+        json_writer_string(&writer, log_level_to_string(rule->level));
+        json_writer_key(&writer, "file_pattern");
+        json_writer_string(&writer, rule->file_pattern);
+        json_writer_key(&writer, "function_pattern");
+        json_writer_string(&writer, rule->function_pattern);
+        json_writer_key(&writer, "line_start");
+        json_writer_integer(&writer, rule->line_start);
+        json_writer_key(&writer, "line_end");
+        json_writer_integer(&writer, rule->line_end);
+        json_writer_end_object(&writer);
+    }
+    json_writer_end_array(&writer);
+    char *out = json_sink_cstr(&sink);
+    if (!out) raise_exception__(file, func, line, "FORMAT: Out of memory writing log rules as JSON");
+    return out;
+}
+
+// ----------
+// -- View --
+// ----------
+
+View view_create(const void *data, size_t len, size_t isize) {
+  View view = { .data = data, .len = len, .isize = isize, .terminated = false };
+  return view;
+}
+
+View string_to_view(const char *str) {
+  View view = { .data = str, .len = strlen(str), .isize = sizeof(char), .terminated = true };
+  return view;
+}
+
+View *string_to_view_ptr__(POSITION_INFO_DECLARATION, Arena *arena, const char *str) {
+  View *view = arena_alloc__(file, func, line, arena, sizeof(View));
+  const View tmp = string_to_view(str);
+  *(void **)&view->data = (void *)tmp.data;
+  *(size_t *)&view->len = tmp.len;
+  *(size_t *)&view->isize = tmp.isize;
+  *(bool *)&view->terminated = tmp.terminated;
+  return view;
+}
+
+View view_slice(View view, size_t from, size_t to) {
+  if (to > view.len) to = view.len;
+  if (from > to) from = to;
+  View slice = {
+    .data = view.data ? (const char *)view.data + from * view.isize : NULL,
+    .len = to - from,
+    .isize = view.isize,
+    .terminated = view.terminated && to == view.len,
+  };
+  return slice;
+}
+
+/* The text operations read bytes: a view of wider items is refused rather than misread */
+static bool view_of_chars(View view) {
+  if (view.isize == sizeof(char)) return true;
+  raise_warn("VIEW: Expected a view of chars (data: %p, isize: %zu)", view.data, view.isize);
+  return false;
+}
+
+/* The SIMD scanners take every byte of the set in one register each */
+#define VIEW_SIMD_SET_MAX 8
+
+#ifdef HECTIC_SIMD_X86
+/*
+ * Substring search after Mula, "SIMD-friendly algorithms for substring
+ * searching": blocks are filtered on the first and the last byte of the
+ * needle, only the candidates left are compared in full. needle_len >= 2.
+ */
+__attribute__((target("sse2")))
+static size_t view_find_sse2(const char *p, size_t len, const char *needle, size_t needle_len) {
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i last = _mm_set1_epi8(needle[needle_len - 1]);
+  size_t i = 0;
+  for (; i + needle_len - 1 + 16 <= len; i += 16) {
+    __m128i head = _mm_loadu_si128((const __m128i *)(const void *)(p + i));
+    __m128i tail = _mm_loadu_si128((const __m128i *)(const void *)(p + i + needle_len - 1));
+    unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last)));
+    while (mask) {
+      size_t at = i + (size_t)__builtin_ctz(mask);
+      if (memcmp(p + at + 1, needle + 1, needle_len - 2) == 0) return at;
+      mask &= mask - 1;
+    }
+  }
+  for (; i + needle_len <= len; i++) {
+    if (p[i] == needle[0] && memcmp(p + i + 1, needle + 1, needle_len - 1) == 0) return i;
+  }
+  return VIEW_NPOS;
+}
+
+__attribute__((target("avx2")))
+static size_t view_find_avx2(const char *p, size_t len, const char *needle, size_t needle_len) {
+  const __m256i first = _mm256_set1_epi8(needle[0]);
+  const __m256i last = _mm256_set1_epi8(needle[needle_len - 1]);
+  size_t i = 0;
+  for (; i + needle_len - 1 + 32 <= len; i += 32) {
+    __m256i head = _mm256_loadu_si256((const __m256i *)(const void *)(p + i));
+    __m256i tail = _mm256_loadu_si256((const __m256i *)(const void *)(p + i + needle_len - 1));
+    unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(head, first), _mm256_cmpeq_epi8(tail, last)));
+    while (mask) {
+      size_t at = i + (size_t)__builtin_ctz(mask);
+      if (memcmp(p + at + 1, needle + 1, needle_len - 2) == 0) return at;
+      mask &= mask - 1;
+    }
+  }
+  for (; i + needle_len <= len; i++) {
+    if (p[i] == needle[0] && memcmp(p + i + 1, needle + 1, needle_len - 1) == 0) return i;
+  }
+  return VIEW_NPOS;
+}
+
+/* Small sets: one compare per byte of the set, OR-ed together */
+__attribute__((target("sse2")))
+static size_t view_find_any_sse2(const char *p, size_t len, const char *set, size_t set_len) {
+  __m128i bytes[VIEW_SIMD_SET_MAX];
+  for (size_t k = 0; k < set_len; k++) bytes[k] = _mm_set1_epi8(set[k]);
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(const void *)(p + i));
+    __m128i hit = _mm_cmpeq_epi8(v, bytes[0]);
+    for (size_t k = 1; k < set_len; k++) hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, bytes[k]));
+    unsigned int mask = (unsigned int)_mm_movemask_epi8(hit);
+    if (mask) return i + (size_t)__builtin_ctz(mask);
+  }
+  for (; i < len; i++) {
+    if (memchr(set, p[i], set_len)) return i;
+  }
+  return VIEW_NPOS;
+}
+
+__attribute__((target("avx2")))
+static size_t view_find_any_avx2(const char *p, size_t len, const char *set, size_t set_len) {
+  __m256i bytes[VIEW_SIMD_SET_MAX];
+  for (size_t k = 0; k < set_len; k++) bytes[k] = _mm256_set1_epi8(set[k]);
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(const void *)(p + i));
+    __m256i hit = _mm256_cmpeq_epi8(v, bytes[0]);
+    for (size_t k = 1; k < set_len; k++) hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, bytes[k]));
+    unsigned int mask = (unsigned int)_mm256_movemask_epi8(hit);
+    if (mask) return i + (size_t)__builtin_ctz(mask);
+  }
+  for (; i < len; i++) {
+    if (memchr(set, p[i], set_len)) return i;
+  }
+  return VIEW_NPOS;
+}
+#endif
+
+static size_t view_find_scalar(const char *p, size_t len, const char *needle, size_t needle_len) {
+  size_t i = 0;
+  while (i + needle_len <= len) {
+    const char *hit = memchr(p + i, needle[0], len - needle_len + 1 - i);
+    if (!hit) break;
+    i = (size_t)(hit - p);
+    if (memcmp(p + i + 1, needle + 1, needle_len - 1) == 0) return i;
+    i++;
+  }
+  return VIEW_NPOS;
+}
+
+/* Any set size: a 256-bit membership table */
+static size_t view_find_any_scalar(const char *p, size_t len, const char *set, size_t set_len) {
+  uint64_t table[4] = {0};
+  for (size_t k = 0; k < set_len; k++) {
+    unsigned char c = (unsigned char)set[k];
+    table[c >> 6] |= (uint64_t)1 << (c & 63);
+  }
+  for (size_t i = 0; i < len; i++) {
+    unsigned char c = (unsigned char)p[i];
+    if (table[c >> 6] & ((uint64_t)1 << (c & 63))) return i;
+  }
+  return VIEW_NPOS;
+}
+
+/* glibc and the BSDs already pick a vector memchr for the running CPU */
+size_t view_find_byte(View view, char c) {
+  if (!view_of_chars(view) || !view.len) return VIEW_NPOS;
+  const char *hit = memchr(view.data, c, view.len);
+  return hit ? (size_t)(hit - (const char *)view.data) : VIEW_NPOS;
+}
+
+size_t view_rfind_byte(View view, char c) {
+  if (!view_of_chars(view)) return VIEW_NPOS;
+  const char *p = view.data;
+  for (size_t i = view.len; i > 0; i--) {
+    if (p[i - 1] == c) return i - 1;
+  }
+  return VIEW_NPOS;
+}
+
+size_t view_find(View view, View needle) {
+  if (!view_of_chars(view) || !view_of_chars(needle) || needle.len > view.len) return VIEW_NPOS;
+  if (!needle.len) return 0;
+  if (needle.len == 1) return view_find_byte(view, *(const char *)needle.data);
+  switch (simd_level()) {
+#ifdef HECTIC_SIMD_X86
+    case SIMD_LEVEL_AVX2: return view_find_avx2(view.data, view.len, needle.data, needle.len);
+    case SIMD_LEVEL_SSE2: return view_find_sse2(view.data, view.len, needle.data, needle.len);
+#endif
+    default: return view_find_scalar(view.data, view.len, needle.data, needle.len);
+  }
+}
+
+size_t view_find_any(View view, View set) {
+  if (!view_of_chars(view) || !view_of_chars(set) || !view.len || !set.len) return VIEW_NPOS;
+  if (set.len == 1) return view_find_byte(view, *(const char *)set.data);
+  if (set.len <= VIEW_SIMD_SET_MAX) {
+    switch (simd_level()) {
+#ifdef HECTIC_SIMD_X86
+      case SIMD_LEVEL_AVX2: return view_find_any_avx2(view.data, view.len, set.data, set.len);
+      case SIMD_LEVEL_SSE2: return view_find_any_sse2(view.data, view.len, set.data, set.len);
+#endif
+      default: break;
+    }
+  }
+  return view_find_any_scalar(view.data, view.len, set.data, set.len);
+}
+
+static bool view_is_space(char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+View view_trim_left(View view) {
+  if (!view_of_chars(view)) return view;
+  const char *p = view.data;
+  size_t from = 0;
+  while (from < view.len && view_is_space(p[from])) from++;
+  return view_slice(view, from, view.len);
+}
+
+View view_trim_right(View view) {
+  if (!view_of_chars(view)) return view;
+  const char *p = view.data;
+  size_t to = view.len;
+  while (to > 0 && view_is_space(p[to - 1])) to--;
+  return view_slice(view, 0, to);
+}
+
+View view_trim(View view) {
+  return view_trim_right(view_trim_left(view));
+}
+
+/* Comparisons go byte by byte over whole items, so they take views of any item size */
+bool view_equal(View a, View b) {
+  return a.isize == b.isize && a.len == b.len && (!a.len || memcmp(a.data, b.data, a.len * a.isize) == 0);
+}
+
+int view_compare(View a, View b) {
+  if (a.isize != b.isize) return a.isize < b.isize ? -1 : 1;
+  size_t common = a.len < b.len ? a.len : b.len;
+  int order = common ? memcmp(a.data, b.data, common * a.isize) : 0;
+  if (order) return order;
+  return a.len < b.len ? -1 : a.len > b.len;
+}
+
+bool view_starts_with(View view, View prefix) {
+  return prefix.isize == view.isize && prefix.len <= view.len
+      && (!prefix.len || memcmp(view.data, prefix.data, prefix.len * view.isize) == 0);
+}
+
+bool view_ends_with(View view, View suffix) {
+  return suffix.isize == view.isize && suffix.len <= view.len
+      && (!suffix.len || memcmp((const char *)view.data + (view.len - suffix.len) * view.isize, suffix.data,
+                                suffix.len * view.isize) == 0);
+}
+
+/* Digits of p as an unsigned value no larger than limit */
+static bool view_parse_digits(const char *p, size_t len, uint64_t limit, uint64_t *out) {
+  if (!len) return false;
+  uint64_t value = 0;
+  for (size_t i = 0; i < len; i++) {
+    unsigned digit = (unsigned)(unsigned char)p[i] - '0';
+    if (digit > 9) return false;
+    if (value > (limit - digit) / 10) return false;
+    value = value * 10 + digit;
+  }
+  *out = value;
+  return true;
+}
+
+bool view_parse_uint64(View view, uint64_t *out) {
+  if (!view_of_chars(view)) return false;
+  const char *p = view.data;
+  size_t len = view.len;
+  if (len && *p == '+') p++, len--;
+  return view_parse_digits(p, len, UINT64_MAX, out);
+}
+
+bool view_parse_int64(View view, int64_t *out) {
+  if (!view_of_chars(view)) return false;
+  const char *p = view.data;
+  size_t len = view.len;
+  bool negative = len && *p == '-';
+  if (len && (*p == '-' || *p == '+')) p++, len--;
+  uint64_t magnitude;
+  if (!view_parse_digits(p, len, negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX, &magnitude)) return false;
+  *out = negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+  return true;
 }
 
-// Check if a function matches a pattern
-static int match_function_pattern(const char *func, const char *pattern) {
-    if (!pattern) return 1; // NULL pattern matches any function
-    return fnmatch(pattern, func, 0) == 0;
+static ViewSplit view_split_init(View view, ViewSplitMode mode, char delimiter, View set) {
+  bool chars = view_of_chars(view) && view_of_chars(set);
+  ViewSplit it = {
+    .mode = mode,
+    .rest = !chars ? NULL : view.data ? view.data : "",
+    .rest_len = view.len,
+    .item = NULL,
+    .item_len = 0,
+    .delimiter = delimiter,
+    .set = set.data,
+    .set_len = set.len,
+  };
+  return it;
 }
 
-// Get the effective log level for a specific context
-LogLevel logger_get_effective_level(const char *file, const char *func, int line) {
-    // If no rules are defined, use the global level
-    if (!log_rules) return current_log_level;
-    
-    // Default to the global log level
-    LogLevel effective_level = current_log_level;
-    
-    // Check each rule in order
-    for (LogRule *rule = log_rules; rule; rule = rule->next) {
-        int file_match = match_file_pattern(file, rule->file_pattern);
-        int function_match = match_function_pattern(func, rule->function_pattern);
-        int line_match = (rule->line_start == -1 || (line >= rule->line_start && 
-                         (rule->line_end == -1 || line <= rule->line_end)));
-        
-        // If all conditions match, use this rule's level
-        if (file_match && function_match && line_match) {
-            effective_level = rule->level;
-            // Don't break here - later rules can override earlier ones
-        }
-    }
-    
-    return effective_level;
+ViewSplit view_split(View view, char delimiter) {
+  return view_split_init(view, VIEW_SPLIT_DELIMITER, delimiter, view_create(NULL, 0, sizeof(char)));
 }
 
-// Add a new log rule programmatically
-HecticError logger_add_rule(Arena *arena, LogRule *rules, LogLevel level, const char *file_pattern, const char *function_pattern, int line_start, int line_end) {
-    LogRuleResult init_result = log_rule_init(arena, level, file_pattern, function_pattern, line_start, line_end);
-    if (IS_RESULT_ERROR(init_result)) {
-        return RESULT_ERROR_VALUE(init_result);
-    }
-    if (!rules) {
-        *rules = RESULT_SOME_VALUE(init_result);
-    } else {
-        LogRule *last = rules;
-        while (last->next) {
-            last = last->next;
-        }
-        *last->next = RESULT_SOME_VALUE(init_result);
-    }
-    return (HecticError){ .code = HECTIC_ERROR_NONE, .message = NULL };
+ViewSplit view_lines(View view) {
+  ViewSplit it = view_split_init(view, VIEW_SPLIT_LINES, '\n', view_create(NULL, 0, sizeof(char)));
+  if (!view.len) it.rest = NULL;
+  return it;
 }
 
-// Print all current logging rules to stderr
-void logger_print_rules() {
-    fprintf(stderr, "Current logging rules:\n");
-    fprintf(stderr, "  Default level: %s\n", log_level_to_string(current_log_level));
-    
-    int rule_count = 0;
-    for (LogRule *rule = log_rules; rule; rule = rule->next) {
-        fprintf(stderr, "  Rule %d: Level=%s, File=%s, Function=%s, Lines=%d:%d\n",
-                ++rule_count,
-                log_level_to_string(rule->level),
-                rule->file_pattern ? rule->file_pattern : "<any>",
-                rule->function_pattern ? rule->function_pattern : "<any>",
-                rule->line_start, rule->line_end);
+ViewSplit view_tokens(View view, View separators) {
+  return view_split_init(view, VIEW_SPLIT_TOKENS, '\0', separators);
+}
+
+bool view_split_next(ViewSplit *it) {
+  while (it->rest) {
+    View rest = view_create(it->rest, it->rest_len, sizeof(char));
+    size_t at = it->mode == VIEW_SPLIT_TOKENS ? view_find_any(rest, view_create(it->set, it->set_len, sizeof(char))) : view_find_byte(rest, it->delimiter);
+    it->item = it->rest;
+    if (at == VIEW_NPOS) {
+      it->item_len = it->rest_len;
+      it->rest = NULL;
+      it->rest_len = 0;
+    } else {
+      it->item_len = at;
+      it->rest += at + 1;
+      it->rest_len -= at + 1;
     }
-    
-    if (rule_count == 0) {
-        fprintf(stderr, "  No specific rules defined\n");
+
+    if (it->mode == VIEW_SPLIT_LINES) {
+      // A final newline ends the last line rather than starting an empty one
+      if (it->rest && !it->rest_len) it->rest = NULL;
+      if (it->item_len && it->item[it->item_len - 1] == '\r') it->item_len--;
+    } else if (it->mode == VIEW_SPLIT_TOKENS && !it->item_len) {
+      continue;
     }
+    return true;
+  }
+  return false;
 }
 
-char *log_rules_to_debug_str__(CTX_DECLARATION, char *name, LogRule *self, PtrSet *visited) {
-    char *result = arena_alloc(arena, MEM_KiB);
-    STRUCT_TO_DEBUG_STR(arena, result, LogRule, name, self, visited, 6,
-      enum_to_debug_str__(file, func, line, arena, "level", self->level, log_level_to_string(self->level)),
-      string_to_debug_str__(file, func, line, arena, "file_pattern", self->file_pattern),
-      string_to_debug_str__(file, func, line, arena, "function_pattern", self->function_pattern),
-      int_to_debug_str__(file, func, line, arena, "line_start", self->line_start),
-      int_to_debug_str__(file, func, line, arena, "line_end", self->line_end),
-      log_rules_to_debug_str__(file, func, line, arena, "next", self->next, visited)
-    );
-    return result;
+View view_split_item(const ViewSplit *it) {
+  return view_create(it->item, it->item_len, sizeof(char));
 }
 
-// ----------
-// -- View --
-// ----------
+/*
+ * Chars of a view as a NUL-terminated string for the NUL-bound parsers.
+ * A terminated view is used as is, anything else is copied once.
+ */
+static HecticErrorCode view_to_cstr__(POSITION_INFO_DECLARATION, Arena *arena, View input, const char **out) {
+  if (input.isize != sizeof(char) || (!input.data && input.len)) {
+    raise_exception__(file, func, line, "VIEW: Expected a view of chars (data: %p, isize: %zu)", input.data, input.isize);
+    return VIEW_ERROR_INVALID_INPUT;
+  }
+  if (!input.data) {
+    *out = "";
+    return HECTIC_ERROR_NONE;
+  }
+  if (input.terminated) {
+    *out = input.data;
+    return HECTIC_ERROR_NONE;
+  }
 
-View view_create(const void *data, size_t len, size_t isize) {
-  View view = { .data = data, .len = len, .isize = isize };
-  return view;
+  raise_debug__(file, func, line, "VIEW: Copying %zu bytes of an unterminated view", input.len);
+  char *copy = arena_alloc_or_null__(file, func, line, arena, input.len + 1, false);
+  if (!copy) {
+    raise_exception__(file, func, line, "VIEW: Out of memory copying %zu bytes", input.len);
+    return VIEW_ERROR_OUT_OF_MEMORY;
+  }
+  memcpy(copy, input.data, input.len);
+  copy[input.len] = '\0';
+  *out = copy;
+  return HECTIC_ERROR_NONE;
 }
 
-View string_to_view(const char *str) {
-  return view_create(str, strlen(str), sizeof(char));
+MappedFileResult view_map_file__(POSITION_INFO_DECLARATION, Arena *arena, const char *path, ViewMapAdvice advice) {
+  if (!arena || !path) {
+    raise_exception__(file, func, line, "VIEW: NULL arena or path");
+    return RESULT_ERROR(MappedFileResult, VIEW_ERROR_INVALID_INPUT, "NULL arena or path");
+  }
+  raise_debug__(file, func, line, "VIEW: Mapping %s (advice: %d)", path, (int)advice);
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    raise_exception__(file, func, line, "VIEW: Cannot open %s: %s", path, strerror(errno));
+    return RESULT_ERROR(MappedFileResult, VIEW_ERROR_IO, "Cannot open file");
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    raise_exception__(file, func, line, "VIEW: %s is not a regular file", path);
+    close(fd);
+    return RESULT_ERROR(MappedFileResult, VIEW_ERROR_IO, "Not a regular file");
+  }
+
+  // Round up so at least one zero byte follows the content
+  size_t len = (size_t)st.st_size;
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t size = (len / page + 1) * page;
+
+  void *base;
+  if (len % page) {
+    // The rest of the last page is zero-filled by the kernel
+    base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  } else {
+    // Page-aligned (or empty): reserve an extra zero page and lay the file over the front
+    int zero = open("/dev/zero", O_RDONLY);
+    base = zero < 0 ? MAP_FAILED : mmap(NULL, size, PROT_READ, MAP_PRIVATE, zero, 0);
+    if (zero >= 0) close(zero);
+    if (base != MAP_FAILED && len && mmap(base, len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+      munmap(base, size);
+      base = MAP_FAILED;
+    }
+  }
+  close(fd);
+
+  if (base == MAP_FAILED) {
+    raise_exception__(file, func, line, "VIEW: Cannot map %s: %s", path, strerror(errno));
+    return RESULT_ERROR(MappedFileResult, VIEW_ERROR_IO, "Cannot map file");
+  }
+
+  int hint = advice == VIEW_MAP_SEQUENTIAL ? POSIX_MADV_SEQUENTIAL
+           : advice == VIEW_MAP_WILLNEED   ? POSIX_MADV_WILLNEED
+           :                                 POSIX_MADV_NORMAL;
+  if (len && posix_madvise(base, len, hint) != 0) {
+    raise_warn__(file, func, line, "VIEW: posix_madvise failed for %s", path);
+  }
+
+  MappedFile *mapped = arena_alloc_or_null__(file, func, line, arena, sizeof(MappedFile), false);
+  if (!mapped) {
+    munmap(base, size);
+    raise_exception__(file, func, line, "VIEW: Out of memory for the mapping of %s", path);
+    return RESULT_ERROR(MappedFileResult, VIEW_ERROR_OUT_OF_MEMORY, "Out of memory");
+  }
+  const MappedFile tmp = {
+    .view = { .data = base, .len = len, .isize = sizeof(char), .terminated = true },
+    .base = base,
+    .size = size,
+  };
+  memcpy(mapped, &tmp, sizeof(MappedFile));
+
+  raise_debug__(file, func, line, "VIEW: Mapped %zu bytes of %s at %p", len, path, base);
+  return RESULT_SOME(MappedFileResult, *mapped);
 }
 
-View *string_to_view_ptr__(POSITION_INFO_DECLARATION, Arena *arena, const char *str) {
-  View *view = arena_alloc__(file, func, line, arena, sizeof(View));
-  const View tmp = string_to_view(str);
-  *(void **)&view->data = (void *)tmp.data;
-  *(size_t *)&view->len = tmp.len;
-  *(size_t *)&view->isize = tmp.isize;
-  return view;
+void view_unmap_file__(POSITION_INFO_DECLARATION, MappedFile *mapped) {
+  if (!mapped || !mapped->base) {
+    raise_warn__(file, func, line, "VIEW: Attempted to unmap a file that is not mapped");
+    return;
+  }
+  if (munmap(mapped->base, mapped->size) != 0) {
+    raise_warn__(file, func, line, "VIEW: munmap failed: %s", strerror(errno));
+  }
+  raise_debug__(file, func, line, "VIEW: Unmapped %p", mapped->base);
+  mapped->base = NULL;
+  mapped->size = 0;
 }
 
 // ---------------
@@ -2584,6 +8884,23 @@ TemplateResult template_parse_execute__(POSITION_INFO_DECLARATION, Arena *arena,
   return result;
 }
 
+/* Bytes scanned per step of template_skip_text(); the end of the input is only found by its NUL */
+#define TEMPLATE_SCAN_WINDOW 4096
+
+/* Moves *s to the next byte that can start one of the braces, or to the terminating NUL */
+static void template_skip_text(const char **s, View braces) {
+  for (;;) {
+    size_t window = strnlen(*s, TEMPLATE_SCAN_WINDOW);
+    size_t at = view_find_any(view_create(*s, window, sizeof(char)), braces);
+    if (at != VIEW_NPOS) {
+      *s += at;
+      return;
+    }
+    *s += window;
+    if (window < TEMPLATE_SCAN_WINDOW) return;
+  }
+}
+
 TemplateResult template_parse__(POSITION_INFO_DECLARATION, Arena *arena, const char **s, const TemplateConfig *config, bool inner_parse) {
   raise_trace__(file, func, line, "PARSE: Iteration start");
 
@@ -2607,8 +8924,20 @@ TemplateResult template_parse__(POSITION_INFO_DECLARATION, Arena *arena, const c
 
   int open_brace_len = config->Syntax.Braces.open->len;
 
+  // Text between tags is skipped in one search for the first bytes of the braces
+  const View *open = config->Syntax.Braces.open, *close = config->Syntax.Braces.close;
+  char brace_bytes[2] = {
+    open->len ? *(const char *)open->data : '\0',
+    close->len ? *(const char *)close->data : '\0',
+  };
+  bool skip_text = open->len && (!inner_parse || close->len);
+  View braces = view_create(brace_bytes, inner_parse ? 2 : 1, sizeof(char));
 
   while (*s && **s != '\0') {
+    if (skip_text) {
+      template_skip_text(s, braces);
+      if (**s == '\0') break;
+    }
     // Check for closing brace if this is inner parse
     if (inner_parse && strncmp(*s, config->Syntax.Braces.close->data, config->Syntax.Braces.close->len) == 0) {
       raise_trace__(file, func, line, "PARSE: Found closing brace in inner parse");
@@ -2616,7 +8945,7 @@ TemplateResult template_parse__(POSITION_INFO_DECLARATION, Arena *arena, const c
     }
     if (strncmp(*s, config->Syntax.Braces.open->data, open_brace_len) == 0) {
       if (start != *s) {
-        raise_trace__(file, func, line, "PARSE: Text node: %s", arena_strncpy__(POSITION_INFO, DISPOSABLE_ARENA, start, *s - start));
+        raise_trace__(file, func, line, "PARSE: Text node: %.*s", (int)(*s - start), start);
         
         if (current_node_filled) {
           TemplateNode *new_node = arena_alloc__(file, func, line, arena, sizeof(TemplateNode));
@@ -2684,7 +9013,7 @@ TemplateResult template_parse__(POSITION_INFO_DECLARATION, Arena *arena, const c
           current_result = template_parse_execute__(file, func, line, arena, s, config);
           start = *s;
         } else {
-          raise_exception__(file, func, line, "PARSE: Unknown tag prefix: %s", slice_create__(POSITION_INFO, 1, (char *)tag_prefix, strlen(tag_prefix), 0, TEMPLATE_MAX_PREFIX_LEN));
+          raise_exception__(file, func, line, "PARSE: Unknown tag prefix: %s", slice_create__(POSITION_INFO, 1, (char *)tag_prefix, strnlen(tag_prefix, TEMPLATE_MAX_PREFIX_LEN), 0, TEMPLATE_MAX_PREFIX_LEN));
           return RESULT_ERROR(TemplateResult, TEMPLATE_ERROR_UNKNOWN_TAG, "Unknown tag prefix");
         }
 
@@ -2734,6 +9063,25 @@ TemplateResult template_parse__(POSITION_INFO_DECLARATION, Arena *arena, const c
   return RESULT_SOME(TemplateResult, *root);
 }
 
+TemplateResult template_parse_view__(POSITION_INFO_DECLARATION, Arena *arena, View input, const TemplateConfig *config) {
+  const char *text;
+  HecticErrorCode code = view_to_cstr__(file, func, line, arena, input, &text);
+  if (code != HECTIC_ERROR_NONE) {
+    return RESULT_ERROR(TemplateResult, code, "Unusable view");
+  }
+
+  const char *cursor = text;
+  TemplateResult result = template_parse__(file, func, line, arena, &cursor, config, false);
+  TRY(result);
+
+  // The parser stops at the first NUL, which has to be the one past the end
+  if (cursor != text + input.len) {
+    raise_exception__(file, func, line, "PARSE: NUL byte at %zu inside a %zu byte view", (size_t)(cursor - text), input.len);
+    return RESULT_ERROR(TemplateResult, VIEW_ERROR_INVALID_INPUT, "NUL byte inside the view");
+  }
+  return result;
+}
+
 #undef TEMPLATE_ASSERT_SYNTAX
 
 #define TEMPLATE_NODE_MAX_DEBUG_DEPTH 20
@@ -2752,139 +9100,518 @@ char *template_node_type_to_string(TemplateNodeType type) {
   }
 }
 
-char *template_section_value_to_debug_str__(POSITION_INFO_DECLARATION, Arena *arena, const char *name, const TemplateSectionValue *self, PtrSet *visited) {
-    char *result = arena_alloc(arena, MEM_KiB);
-    STRUCT_TO_DEBUG_STR(arena, result, TemplateSectionValue, name, self, visited, 3,
-      string_to_debug_str__(file, func, line, arena, "iterator", self->iterator),
-      string_to_debug_str__(file, func, line, arena, "collection", self->collection),
-      template_node_to_debug_str__(file, func, line, arena, "body", self->body, visited)
-    );
-    return result;
+void template_node_write_debug(DebugWriter *writer, const char *name, const TemplateNode *self) {
+    type_write_debug(writer, &template_node_descriptor, name, self);
 }
 
-char *template_interpolate_value_to_debug_str__(POSITION_INFO_DECLARATION, Arena *arena, const char *name, const TemplateInterpolateValue *self, PtrSet *visited) {
-    char *result = arena_alloc(arena, MEM_KiB);
-    STRUCT_TO_DEBUG_STR(arena, result, TemplateInterpolateValue, name, self, visited, 1,
-      string_to_debug_str__(file, func, line, arena, "key", self->key)
-    );
-    return result;
+char *template_node_to_debug_str__(POSITION_INFO_DECLARATION, Arena *arena, const char *name, const TemplateNode *self, PtrSet *visited) {
+    DebugWriter writer = debug_writer_buffer__(file, func, line, arena, visited, false);
+    template_node_write_debug(&writer, name, self);
+    return debug_writer_cstr(&writer);
 }
 
-char *template_execute_value_to_debug_str__(POSITION_INFO_DECLARATION, Arena *arena, const char *name, const TemplateExecuteValue *self, PtrSet *visited) {
-    char *result = arena_alloc(arena, MEM_KiB);
-    STRUCT_TO_DEBUG_STR(arena, result, TemplateExecuteValue, name, self, visited, 1,
-      string_to_debug_str__(file, func, line, arena, "code", self->code)
-    );
-    return result;
+
+/* A sibling list as array elements; sections nest their bodies up to TEMPLATE_NODE_MAX_DEBUG_DEPTH */
+static void template_nodes_write_json(JsonWriter *writer, const TemplateNode *node, int depth) {
+    for (; node; node = node->next) {
+        json_writer_begin_object(writer);
+        json_writer_key(writer, "type");
+        json_writer_string(writer, template_node_type_to_string(node->type));
+        json_writer_key(writer, "content");
+        json_writer_begin_object(writer);
+        switch (node->type) {
+            case TEMPLATE_NODE_SECTION:
+                json_writer_key(writer, "iterator");
+                json_writer_string(writer, node->value->section.iterator);
+                json_writer_key(writer, "collection");
+                json_writer_string(writer, node->value->section.collection);
+                break;
+            case TEMPLATE_NODE_INTERPOLATE:
+                json_writer_key(writer, "key");
+                json_writer_string(writer, node->value->interpolate.key);
+                break;
+            case TEMPLATE_NODE_EXECUTE:
+                json_writer_key(writer, "code");
+                json_writer_string(writer, node->value->execute.code);
+                break;
+            case TEMPLATE_NODE_INCLUDE:
+                json_writer_key(writer, "key");
+                json_writer_string(writer, node->value->include.key);
+                break;
+            case TEMPLATE_NODE_TEXT:
+                json_writer_key(writer, "content");
+                json_writer_string(writer, node->value->text.content);
+                break;
+            default:
+                break;
+        }
+        json_writer_end_object(writer);
+        if (node->type == TEMPLATE_NODE_SECTION) {
+            json_writer_key(writer, "body");
+            json_writer_begin_array(writer);
+            if (depth < TEMPLATE_NODE_MAX_DEBUG_DEPTH) {
+                template_nodes_write_json(writer, node->value->section.body, depth + 1);
+            } else if (node->value->section.body) {
+                json_writer_string(writer, "...");
+            }
+            json_writer_end_array(writer);
+        }
+        json_writer_end_object(writer);
+    }
 }
 
-char *template_include_value_to_debug_str__(POSITION_INFO_DECLARATION, Arena *arena, const char *name, const TemplateIncludeValue *self, PtrSet *visited) {
-    char *result = arena_alloc(arena, MEM_KiB);
-    STRUCT_TO_DEBUG_STR(arena, result, TemplateIncludeValue, name, self, visited, 1,
-      string_to_debug_str__(file, func, line, arena, "key", self->key)
-    );
-    return result;
+void template_node_write_json(JsonWriter *writer, const TemplateNode *node) {
+    json_writer_begin_array(writer);
+    template_nodes_write_json(writer, node, 0);
+    json_writer_end_array(writer);
 }
 
-char *template_text_value_to_debug_str__(POSITION_INFO_DECLARATION, Arena *arena, const char *name, const TemplateTextValue *self, PtrSet *visited) {
-    char *result = arena_alloc(arena, MEM_KiB);
-    STRUCT_TO_DEBUG_STR(arena, result, TemplateTextValue, name, self, visited, 1,
-      string_to_debug_str__(file, func, line, arena, "content", self->content)
-    );
-    return result;
+static char *template_node_json__(POSITION_INFO_DECLARATION, Arena *arena, const TemplateNode *node, int indent, int depth) {
+    JsonSink sink = json_sink_buffer__(file, func, line, arena, 0);
+    JsonWriter writer = json_writer(&sink, indent);
+    json_writer_begin_array(&writer);
+    template_nodes_write_json(&writer, node, depth);
+    json_writer_end_array(&writer);
+    char *out = json_sink_cstr(&sink);
+    if (!out) raise_exception__(file, func, line, "FORMAT: Out of memory writing template nodes as JSON");
+    return out;
 }
 
-char *template_value_to_debug_str__(POSITION_INFO_DECLARATION, Arena *arena, const char *name, const TemplateValue *self, TemplateNodeType active_variant, PtrSet *visited) {
-    char *result = arena_alloc(arena, MEM_KiB);
+char *template_node_to_json_str__(POSITION_INFO_DECLARATION, Arena *arena, const TemplateNode *node, int depth) {
+    return template_node_json__(file, func, line, arena, node, 0, depth);
+}
 
-    UNION_TO_DEBUG_STR(arena, result, TemplateValue, name, self, visited, active_variant, 5,
-      TEMPLATE_NODE_SECTION, template_section_value_to_debug_str__(file, func, line, arena, "section", &self->section, visited),
-      TEMPLATE_NODE_INTERPOLATE, template_interpolate_value_to_debug_str__(file, func, line, arena, "interpolate", &self->interpolate, visited),
-      TEMPLATE_NODE_EXECUTE, template_execute_value_to_debug_str__(file, func, line, arena, "execute", &self->execute, visited),
-      TEMPLATE_NODE_INCLUDE, template_include_value_to_debug_str__(file, func, line, arena, "include", &self->include, visited),
-      TEMPLATE_NODE_TEXT, template_text_value_to_debug_str__(file, func, line, arena, "text", &self->text, visited)
-    );
-    return result;
+char *template_node_to_pretty_json_str__(POSITION_INFO_DECLARATION, Arena *arena, const TemplateNode *node) {
+    return template_node_json__(file, func, line, arena, node, 2, 0);
 }
 
-char *template_node_to_debug_str__(POSITION_INFO_DECLARATION, Arena *arena, const char *name, const TemplateNode *self, PtrSet *visited) {
-    char *result = arena_alloc(arena, MEM_KiB);
-    STRUCT_TO_DEBUG_STR(arena, result, TemplateNode, name, self, visited, 3,
-      enum_to_debug_str__(file, func, line, arena, "type", self->type, template_node_type_to_string(self->type)),
-      template_value_to_debug_str__(file, func, line, arena, "value", self->value, self->type, visited),
-      template_node_to_debug_str__(file, func, line, arena, "next", self->next, visited)
-    );
-    return result;
+// ----------------------
+// -- Type descriptors --
+// ----------------------
+
+#define TYPE_HASH_NULL  0x6e756c6cULL  // "null"
+#define TYPE_HASH_CYCLE 0x6379636cULL  // "cycl"
+
+static const void *type_at(const void *owner, size_t offset) {
+    return (const char *)owner + offset;
 }
 
+static const void *type_pointer_at(const void *owner, size_t offset) {
+    return *(const void *const *)type_at(owner, offset);
+}
 
-char *template_node_to_json_str__(POSITION_INFO_DECLARATION, Arena *arena, const TemplateNode *node, int depth) {
-    if (!node) return arena_strncpy__(file, func, line, arena, "", 0);
+/* Member of a union selected by the tag its field points at, NULL if none matches */
+static const TypeField *type_active_member(const TypeDescriptor *type, const TypeField *field, const void *owner, int *tag) {
+    *tag = field->tag_offset == TYPE_NO_TAG ? -1 : *(const int *)type_at(owner, field->tag_offset);
+    for (size_t i = 0; i < type->field_count; i++)
+        if (type->fields[i].variant == *tag) return &type->fields[i];
+    return NULL;
+}
 
-    if (depth > TEMPLATE_NODE_MAX_DEBUG_DEPTH) {
-      return arena_strncpy__(file, func, line, arena, "...", 3);
-    }
+static const TypeField *type_next_field(const TypeDescriptor *type) {
+    for (size_t i = 0; i < type->field_count; i++)
+        if (type->fields[i].next) return &type->fields[i];
+    return NULL;
+}
 
-    // Use a temporary buffer on the stack for building the string
-    char temp_buf[MEM_MiB];
-    size_t len = 0;
-    
-    #define APPEND(...) do { \
-        int written = snprintf(temp_buf + len, sizeof(temp_buf) - len, ##__VA_ARGS__); \
-        if (written < 0) return NULL; \
-        len += written; \
-    } while (0)
+// -- Debug --
 
-    if (depth == 0) {
-      APPEND("[");
-    }
+static void type_write_debug_field(DebugWriter *writer, const TypeField *field, const void *owner);
 
-    APPEND("{\"type\":\"%s\",", template_node_type_to_string(node->type));
+static void type_write_debug_union(DebugWriter *writer, const TypeField *field, const void *owner, const void *value) {
+    const TypeDescriptor *type = field->type;
+    if (!debug_write_visit(writer, "union", type->name, field->name, value)) return;
 
-    switch (node->type) {
-        case TEMPLATE_NODE_SECTION:
-            APPEND("\"content\":{\"iterator\":\"%s\",\"collection\":\"%s\"}",
-                node->value->section.iterator,
-                node->value->section.collection);
-            char *body_str = template_node_to_json_str__(file, func, line, arena, node->value->section.body, depth + 1);
-            if (body_str) {
-                APPEND(",\"body\":[%s]", body_str);
-            }
+    int tag;
+    const TypeField *member = type_active_member(type, field, owner, &tag);
+    if (!member) {
+        debug_write_field(writer, "%sunion%s %s %s = <invalid variant %d> %s%p%s", DEBUG_COLOR(COLOR_GREEN), DEBUG_COLOR(COLOR_RESET),
+            type->name, field->name, tag, DEBUG_COLOR(COLOR_CYAN), value, DEBUG_COLOR(COLOR_RESET));
+        return;
+    }
+    debug_write_open(writer, "union", type->name, field->name);
+    type_write_debug_field(writer, member, value);
+    debug_write_leave(writer, value);
+}
+
+static void type_write_debug_field(DebugWriter *writer, const TypeField *field, const void *owner) {
+    const void *at = type_at(owner, field->offset);
+    switch (field->kind) {
+        case TYPE_INT:     debug_write_int(writer, field->name, *(const int *)at); break;
+        case TYPE_INT64:   debug_write_int64(writer, field->name, *(const int64_t *)at); break;
+        case TYPE_SIZE_T:  debug_write_size_t(writer, field->name, *(const size_t *)at); break;
+        case TYPE_FLOAT:   debug_write_float(writer, field->name, *(const float *)at); break;
+        case TYPE_DOUBLE:  debug_write_float(writer, field->name, *(const double *)at); break;
+        case TYPE_BOOL:    debug_write_bool(writer, field->name, *(const int *)at); break;
+        case TYPE_CHAR:    debug_write_char(writer, field->name, *(const char *)at); break;
+        case TYPE_STRING:  debug_write_string(writer, field->name, *(const char *const *)at); break;
+        case TYPE_POINTER: debug_write_ptr(writer, field->name, *(const void *const *)at); break;
+        case TYPE_BYTES: {
+            const void *data = *(const void *const *)at;
+            if (!data) debug_write_ptr(writer, field->name, data);
+            else debug_write_field(writer, "%s = %p <%zu bytes>", field->name, data, *(const size_t *)type_at(owner, field->length_offset));
+            break;
+        }
+        case TYPE_ENUM: {
+            int value = *(const int *)at;
+            debug_write_enum(writer, field->name, (size_t)value, field->enum_name ? field->enum_name(value) : "?");
+            break;
+        }
+        case TYPE_REF:
+        case TYPE_INLINE: {
+            const void *value = field->kind == TYPE_REF ? *(const void *const *)at : at;
+            if (field->type->is_union) type_write_debug_union(writer, field, owner, value);
+            else type_write_debug(writer, field->type, field->name, value);
+            break;
+        }
+        case TYPE_CUSTOM:
+            if (field->hooks && field->hooks->write_debug) field->hooks->write_debug(writer, field->name, owner);
             break;
-        case TEMPLATE_NODE_INTERPOLATE:
-            APPEND("\"content\":{\"key\":\"%s\"}", node->value->interpolate.key);
+    }
+}
+
+void type_write_debug(DebugWriter *writer, const TypeDescriptor *type, const char *name, const void *value) {
+    const TypeField *next = type_next_field(type);
+    DebugChain chain = {0};
+    while (debug_write_enter(writer, type->is_union ? "union" : "struct", type->name, name, value)) {
+        for (size_t i = 0; i < type->field_count; i++)
+            if (&type->fields[i] != next) type_write_debug_field(writer, &type->fields[i], value);
+        if (!next) {
+            debug_write_leave(writer, value);
             break;
-        case TEMPLATE_NODE_EXECUTE:
-            APPEND("\"content\":{\"code\":\"%s\"}", node->value->execute.code);
+        }
+        // The link is the last field: leave this struct open and describe the next one inside it
+        debug_chain_push(writer, &chain, value);
+        value = type_pointer_at(value, next->offset);
+        name = next->name;
+    }
+    debug_chain_close(writer, &chain);
+}
+
+char *type_to_debug_str__(POSITION_INFO_DECLARATION, Arena *arena, const TypeDescriptor *type, const char *name, const void *value, PtrSet *visited) {
+    DebugWriter writer = debug_writer_buffer__(file, func, line, arena, visited, false);
+    type_write_debug(&writer, type, name, value);
+    return debug_writer_cstr(&writer);
+}
+
+// -- JSON --
+
+static void type_write_json_struct(JsonWriter *writer, PtrSet *visited, const TypeDescriptor *type, const void *value);
+
+static void type_write_json_field(JsonWriter *writer, PtrSet *visited, const TypeField *field, const void *owner) {
+    const void *at = type_at(owner, field->offset);
+    switch (field->kind) {
+        case TYPE_INT:    json_writer_integer(writer, *(const int *)at); break;
+        case TYPE_INT64:  json_writer_integer(writer, *(const int64_t *)at); break;
+        case TYPE_SIZE_T: json_writer_integer(writer, (int64_t)*(const size_t *)at); break;
+        case TYPE_FLOAT:  json_writer_number(writer, *(const float *)at); break;
+        case TYPE_DOUBLE: json_writer_number(writer, *(const double *)at); break;
+        case TYPE_BOOL:   json_writer_bool(writer, *(const int *)at != 0); break;
+        case TYPE_CHAR:   json_writer_string_len(writer, (const char *)at, 1); break;
+        case TYPE_STRING: json_writer_string(writer, *(const char *const *)at); break;
+        case TYPE_POINTER: json_writer_null(writer); break;
+        case TYPE_BYTES: {
+            const char *data = *(const char *const *)at;
+            if (data) json_writer_string_len(writer, data, *(const size_t *)type_at(owner, field->length_offset));
+            else json_writer_null(writer);
             break;
-        case TEMPLATE_NODE_INCLUDE:
-            APPEND("\"content\":{\"key\":\"%s\"}", node->value->include.key);
+        }
+        case TYPE_ENUM: {
+            int value = *(const int *)at;
+            if (field->enum_name) json_writer_string(writer, field->enum_name(value));
+            else json_writer_integer(writer, value);
             break;
-        case TEMPLATE_NODE_TEXT:
-            APPEND("\"content\":{\"content\":\"%s\"}", node->value->text.content);
+        }
+        case TYPE_REF:
+        case TYPE_INLINE: {
+            const void *value = field->kind == TYPE_REF ? *(const void *const *)at : at;
+            if (!value) {
+                json_writer_null(writer);
+            } else if (field->type->is_union) {
+                int tag;
+                const TypeField *member = type_active_member(field->type, field, owner, &tag);
+                if (!member) {
+                    json_writer_null(writer);
+                    break;
+                }
+                json_writer_begin_object(writer);
+                json_writer_key(writer, member->name);
+                type_write_json_field(writer, visited, member, value);
+                json_writer_end_object(writer);
+            } else {
+                type_write_json(writer, visited, field->type, value);
+            }
             break;
-        default:
+        }
+        case TYPE_CUSTOM:
+            if (field->hooks && field->hooks->write_json) field->hooks->write_json(writer, owner);
+            else json_writer_null(writer);
             break;
     }
+}
+
+static void type_write_json_struct(JsonWriter *writer, PtrSet *visited, const TypeDescriptor *type, const void *value) {
+    if (visited) {
+        if (debug_ptrset_contains__(visited, value, type->name, "")) {
+            json_writer_null(writer);
+            return;
+        }
+        debug_ptrset_add__(writer->sink->file, writer->sink->func, writer->sink->line, writer->sink->arena, visited, value, type->name, "");
+    }
+    json_writer_begin_object(writer);
+    for (size_t i = 0; i < type->field_count; i++) {
+        const TypeField *field = &type->fields[i];
+        if (field->next || field->kind == TYPE_POINTER) continue;
+        json_writer_key(writer, field->name);
+        type_write_json_field(writer, visited, field, value);
+    }
+    json_writer_end_object(writer);
+}
+
+void type_write_json(JsonWriter *writer, PtrSet *visited, const TypeDescriptor *type, const void *value) {
+    const TypeField *next = type_next_field(type);
+    if (!next) {
+        if (value) type_write_json_struct(writer, visited, type, value);
+        else json_writer_null(writer);
+        return;
+    }
+    json_writer_begin_array(writer);
+    for (; value; value = type_pointer_at(value, next->offset)) {
+        if (visited && debug_ptrset_contains__(visited, value, type->name, "")) break;
+        type_write_json_struct(writer, visited, type, value);
+    }
+    json_writer_end_array(writer);
+}
+
+char *type_to_json_str__(POSITION_INFO_DECLARATION, Arena *arena, const TypeDescriptor *type, const void *value, int indent) {
+    JsonSink sink = json_sink_buffer__(file, func, line, arena, 0);
+    JsonWriter writer = json_writer(&sink, indent);
+    type_write_json(&writer, ptrset_init__(file, func, line, arena), type, value);
+    return json_sink_cstr(&sink);
+}
+
+// -- Hash --
+
+static uint64_t type_hash_round(uint64_t state, uint64_t word) {
+    state ^= word * 0xc2b2ae3d27d4eb4fULL;
+    state = (state << 31) | (state >> 33);
+    return state * 0x9e3779b97f4a7c15ULL;
+}
 
-    APPEND("}");
+static uint64_t type_hash_bytes(uint64_t state, const char *data, size_t len) {
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        state = type_hash_round(state, word);
+    }
+    uint64_t tail = 0;
+    if (i < len) memcpy(&tail, data + i, len - i);
+    return type_hash_round(type_hash_round(state, tail), len);
+}
 
-    if (node->next) {
-        char *next_str = template_node_to_json_str__(file, func, line, arena, node->next, depth + 1);
-        if (next_str) {
-            APPEND(",%s", next_str);
+static uint64_t type_hash_value(POSITION_INFO_DECLARATION, Arena *arena, PtrSet *visited, uint64_t state, const TypeDescriptor *type, const void *value);
+
+static uint64_t type_hash_field(POSITION_INFO_DECLARATION, Arena *arena, PtrSet *visited, uint64_t state, const TypeField *field, const void *owner) {
+    const void *at = type_at(owner, field->offset);
+    switch (field->kind) {
+        case TYPE_INT:
+        case TYPE_BOOL:
+        case TYPE_ENUM:   return type_hash_round(state, (uint64_t)(int64_t)*(const int *)at);
+        case TYPE_INT64:  return type_hash_round(state, (uint64_t)*(const int64_t *)at);
+        case TYPE_SIZE_T: return type_hash_round(state, (uint64_t)*(const size_t *)at);
+        case TYPE_CHAR:   return type_hash_round(state, (unsigned char)*(const char *)at);
+        case TYPE_FLOAT:
+        case TYPE_DOUBLE: {
+            double number = field->kind == TYPE_FLOAT ? *(const float *)at : *(const double *)at;
+            uint64_t bits;
+            if (number == 0) number = 0;  // -0 and 0 compare equal
+            memcpy(&bits, &number, sizeof(bits));
+            return type_hash_round(state, bits);
+        }
+        case TYPE_STRING: {
+            const char *string = *(const char *const *)at;
+            return string ? type_hash_bytes(state, string, strlen(string)) : type_hash_round(state, TYPE_HASH_NULL);
         }
+        case TYPE_BYTES: {
+            const char *data = *(const char *const *)at;
+            if (!data) return type_hash_round(state, TYPE_HASH_NULL);
+            return type_hash_bytes(state, data, *(const size_t *)type_at(owner, field->length_offset));
+        }
+        case TYPE_POINTER: return state;
+        case TYPE_REF:
+        case TYPE_INLINE: {
+            const void *value = field->kind == TYPE_REF ? *(const void *const *)at : at;
+            if (!value) return type_hash_round(state, TYPE_HASH_NULL);
+            if (!field->type->is_union) return type_hash_value(file, func, line, arena, visited, state, field->type, value);
+            int tag;
+            const TypeField *member = type_active_member(field->type, field, owner, &tag);
+            state = type_hash_round(state, (uint64_t)(int64_t)tag);
+            return member ? type_hash_field(file, func, line, arena, visited, state, member, value) : state;
+        }
+        case TYPE_CUSTOM:
+            return field->hooks && field->hooks->hash ? field->hooks->hash(state, owner) : state;
     }
+    return state;
+}
 
-    if (depth == 0) {
-      APPEND("]");
+static uint64_t type_hash_value(POSITION_INFO_DECLARATION, Arena *arena, PtrSet *visited, uint64_t state, const TypeDescriptor *type, const void *value) {
+    const TypeField *next = type_next_field(type);
+    size_t count = 0;
+    for (; value; value = next ? type_pointer_at(value, next->offset) : NULL, count++) {
+        if (debug_ptrset_contains__(visited, value, type->name, "")) return type_hash_round(state, TYPE_HASH_CYCLE);
+        debug_ptrset_add__(file, func, line, arena, visited, value, type->name, "");
+        for (size_t i = 0; i < type->field_count; i++)
+            if (&type->fields[i] != next) state = type_hash_field(file, func, line, arena, visited, state, &type->fields[i], value);
     }
+    // The length keeps [a, b] apart from a struct holding a then b
+    return type_hash_round(state, count);
+}
 
-    // Copy the final string to arena-allocated memory
-    char *result = arena_strncpy__(file, func, line, arena, temp_buf, len);
-    return result;
+uint64_t type_hash__(POSITION_INFO_DECLARATION, Arena *arena, const TypeDescriptor *type, const void *value) {
+    PtrSet *visited = ptrset_init__(file, func, line, arena);
+    uint64_t hash = type_hash_value(file, func, line, arena, visited, 0x27d4eb2f165667c5ULL, type, value);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// -- Built-in descriptors --
+
+static const char *json_type_name(int value) {
+    return json_type_to_string((JsonType)value);
+}
+
+static const char *log_level_name(int value) {
+    return log_level_to_string((LogLevel)value);
+}
+
+static const char *template_node_type_name(int value) {
+    return template_node_type_to_string((TemplateNodeType)value);
 }
 
+/* JsonValue.string may borrow its body from the input, so it is read through the owning Json */
+static const Json *json_value_owner(const void *value) {
+    return (const Json *)((const char *)value - offsetof(Json, value));
+}
+
+static void json_value_string_debug(DebugWriter *writer, const char *name, const void *owner) {
+    const Json *item = json_value_owner(owner);
+    if (!(item->flags & JSON_STRING_BORROWED)) {
+        debug_write_string(writer, name, item->value.string);
+        return;
+    }
+    char *temp;
+    size_t len;
+    const char *text = json_string_bytes(item, &len, &temp);
+    debug_write_field(writer, "%s = %s%p%s \"%.*s\"", name, DEBUG_COLOR(COLOR_CYAN), (const void *)item->value.string,
+                      DEBUG_COLOR(COLOR_RESET), (int)len, text);
+    arena_memory_free(temp);
+}
+
+static void json_value_string_json(JsonWriter *writer, const void *owner) {
+    char *temp;
+    size_t len;
+    const char *text = json_string_bytes(json_value_owner(owner), &len, &temp);
+    json_writer_string_len(writer, text, len);
+    arena_memory_free(temp);
+}
+
+static uint64_t json_value_string_hash(uint64_t state, const void *owner) {
+    char *temp;
+    size_t len;
+    const char *text = json_string_bytes(json_value_owner(owner), &len, &temp);
+    state = type_hash_bytes(state, text, len);
+    arena_memory_free(temp);
+    return state;
+}
+
+static const TypeFieldHooks json_value_string_hooks = {
+    .write_debug = json_value_string_debug,
+    .write_json = json_value_string_json,
+    .hash = json_value_string_hash,
+};
+
+static const TypeField json_value_fields[] = {
+    TYPE_MEMBER_CUSTOM(JsonValue, string, &json_value_string_hooks, JSON_STRING),
+    TYPE_MEMBER_CUSTOM(JsonValue, string, &json_value_string_hooks, JSON_RAW_NUMBER),
+    TYPE_MEMBER(JsonValue, number, TYPE_DOUBLE, JSON_NUMBER),
+    TYPE_MEMBER(JsonValue, integer, TYPE_INT64, JSON_INTEGER),
+    TYPE_MEMBER(JsonValue, boolean, TYPE_BOOL, JSON_BOOL),
+    TYPE_MEMBER_REF(JsonValue, child, &json_descriptor, JSON_OBJECT),
+    TYPE_MEMBER_REF(JsonValue, child, &json_descriptor, JSON_ARRAY),
+};
+static const TypeDescriptor json_value_descriptor = TYPE_UNION(JsonValue, json_value_fields);
+
+static const TypeField json_fields[] = {
+    TYPE_FIELD_ENUM(Json, type, json_type_name),
+    TYPE_FIELD(Json, key, TYPE_STRING),
+    TYPE_FIELD_UNION_INLINE(Json, value, &json_value_descriptor, type),
+    TYPE_FIELD_NEXT(Json, next, &json_descriptor),
+};
+const TypeDescriptor json_descriptor = TYPE_STRUCT(Json, json_fields);
+
+static const TypeField log_rule_fields[] = {
+    TYPE_FIELD_ENUM(LogRule, level, log_level_name),
+    TYPE_FIELD(LogRule, file_pattern, TYPE_STRING),
+    TYPE_FIELD(LogRule, function_pattern, TYPE_STRING),
+    TYPE_FIELD(LogRule, line_start, TYPE_INT),
+    TYPE_FIELD(LogRule, line_end, TYPE_INT),
+    TYPE_FIELD_NEXT(LogRule, next, &log_rule_descriptor),
+};
+const TypeDescriptor log_rule_descriptor = TYPE_STRUCT(LogRule, log_rule_fields);
+
+static const TypeField slice_fields[] = {
+    TYPE_FIELD_BYTES(Slice, data, len),
+    TYPE_FIELD(Slice, len, TYPE_SIZE_T),
+    TYPE_FIELD(Slice, isize, TYPE_SIZE_T),
+};
+const TypeDescriptor slice_descriptor = TYPE_STRUCT(Slice, slice_fields);
+
+static const TypeField template_section_fields[] = {
+    TYPE_FIELD(TemplateSectionValue, iterator, TYPE_STRING),
+    TYPE_FIELD(TemplateSectionValue, collection, TYPE_STRING),
+    TYPE_FIELD_REF(TemplateSectionValue, body, &template_node_descriptor),
+};
+static const TypeDescriptor template_section_descriptor = TYPE_STRUCT(TemplateSectionValue, template_section_fields);
+
+static const TypeField template_interpolate_fields[] = {
+    TYPE_FIELD(TemplateInterpolateValue, key, TYPE_STRING),
+};
+static const TypeDescriptor template_interpolate_descriptor = TYPE_STRUCT(TemplateInterpolateValue, template_interpolate_fields);
+
+static const TypeField template_execute_fields[] = {
+    TYPE_FIELD(TemplateExecuteValue, code, TYPE_STRING),
+};
+static const TypeDescriptor template_execute_descriptor = TYPE_STRUCT(TemplateExecuteValue, template_execute_fields);
+
+static const TypeField template_include_fields[] = {
+    TYPE_FIELD(TemplateIncludeValue, key, TYPE_STRING),
+};
+static const TypeDescriptor template_include_descriptor = TYPE_STRUCT(TemplateIncludeValue, template_include_fields);
+
+static const TypeField template_text_fields[] = {
+    TYPE_FIELD(TemplateTextValue, content, TYPE_STRING),
+};
+static const TypeDescriptor template_text_descriptor = TYPE_STRUCT(TemplateTextValue, template_text_fields);
+
+static const TypeField template_value_fields[] = {
+    TYPE_MEMBER_INLINE(TemplateValue, section, &template_section_descriptor, TEMPLATE_NODE_SECTION),
+    TYPE_MEMBER_INLINE(TemplateValue, interpolate, &template_interpolate_descriptor, TEMPLATE_NODE_INTERPOLATE),
+    TYPE_MEMBER_INLINE(TemplateValue, execute, &template_execute_descriptor, TEMPLATE_NODE_EXECUTE),
+    TYPE_MEMBER_INLINE(TemplateValue, include, &template_include_descriptor, TEMPLATE_NODE_INCLUDE),
+    TYPE_MEMBER_INLINE(TemplateValue, text, &template_text_descriptor, TEMPLATE_NODE_TEXT),
+};
+static const TypeDescriptor template_value_descriptor = TYPE_UNION(TemplateValue, template_value_fields);
+
+static const TypeField template_node_fields[] = {
+    TYPE_FIELD_ENUM(TemplateNode, type, template_node_type_name),
+    TYPE_FIELD_UNION_REF(TemplateNode, value, &template_value_descriptor, type),
+    TYPE_FIELD_NEXT(TemplateNode, next, &template_node_descriptor),
+};
+const TypeDescriptor template_node_descriptor = TYPE_STRUCT(TemplateNode, template_node_fields);
+
 // ----------
 // -- diff --
 // ----------
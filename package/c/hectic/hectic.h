@@ -12,6 +12,8 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
 
 /* 
  * Hectic Library - A C utility library
@@ -34,6 +36,7 @@
  * - LOG_LEVEL: Set global log level ("TRACE", "DEBUG", etc.)
  * - LOG_FILE: Set log file path
  * - LOG_OUTPUT_MODE: Set output mode ("STDERR_ONLY", "FILE_ONLY", "BOTH")
+ * - LOG_FORMAT: Set line format ("TEXT", "JSON", "LOGFMT")
  */
 
 // -------------
@@ -115,6 +118,18 @@ typedef enum {
   DEBUG_TO_JSON_PARSE_LEFT_OPERAND_ERROR = 700005,
   DEBUG_TO_JSON_PARSE_NO_START_ERROR = 700006,
   DEBUG_TO_JSON_PARSE_NO_END_ERROR = 700007,
+  JSON_ERROR_INVALID_INPUT = 600001,
+  JSON_ERROR_SYNTAX = 600002,
+  JSON_ERROR_OUT_OF_MEMORY = 600003,
+  JSON_ERROR_DEPTH_LIMIT = 600004,
+  JSON_ERROR_TOKEN_TOO_LONG = 600005,
+  JSON_ERROR_IO = 600006,
+  JSON_ERROR_ABORTED = 600007,
+  JSON_ERROR_INVALID_PATH = 600008,
+  JSON_ERROR_INVALID_BINARY = 600009,
+  VIEW_ERROR_INVALID_INPUT = 500001,
+  VIEW_ERROR_IO = 500002,
+  VIEW_ERROR_OUT_OF_MEMORY = 500003,
 } HecticErrorCode;
 
 // Define color macros based on output type
@@ -258,12 +273,29 @@ typedef enum {
     LOG_OUTPUT_BOTH           // Write to both stderr and file
 } LogOutputMode;
 
+/*
+ * Log line format - controls how each log line is encoded
+ */
+typedef enum {
+    LOG_FORMAT_TEXT,          // "<time> <LEVEL> <file>:<func>:<line> <message>" (default)
+    LOG_FORMAT_JSON,          // One JSON object per line (JSON Lines)
+    LOG_FORMAT_LOGFMT         // Space separated key=value pairs (logfmt)
+} LogFormat;
+
 /**
  * Set log output mode
  * @param mode The output mode (stderr only, file only, or both)
  */
 void logger_set_output_mode(LogOutputMode mode);
 
+/**
+ * Set log line format, applies to both raise_* and raise_kv calls
+ * @param format The line format (text, JSON Lines or logfmt)
+ */
+void logger_set_format(LogFormat format);
+
+LogFormat log_format_from_string(const char *format_str);
+
 /**
  * Set log file path
  * @param file_path Path to the log file. If NULL, file logging is disabled.
@@ -382,6 +414,88 @@ char* raise_message(LogLevel level, const char *file, const char *func, int line
 #define raise_exception(...) raise_message(LOG_LEVEL_EXCEPTION, __FILE__, __func__, __LINE__, ##__VA_ARGS__)
 #endif
 
+// -----------------------
+// -- Structured Logger --
+// -----------------------
+
+typedef enum {
+    LOG_KV_STRING,
+    LOG_KV_INT,
+    LOG_KV_UINT,
+    LOG_KV_FLOAT,
+    LOG_KV_BOOL,
+} LogKvType;
+
+/*
+ * Typed log field. Build it with the KV_* macros, never by hand: they
+ * precompute the key length and the quoted JSON member prefix at compile time,
+ * so encoding a field is a couple of memcpy calls and no format parsing.
+ * Keys must be string literals without characters that need JSON escaping.
+ */
+typedef struct {
+    const char *key;          // Bare key, e.g. "user"
+    const char *json_key;     // Quoted JSON member prefix, e.g. "\"user\":"
+    size_t key_len;
+    size_t json_key_len;
+    LogKvType type;
+    union {                   // Last, see LOG_KV_ARRAY__
+        const char *string;
+        long long integer;
+        unsigned long long uinteger;
+        double number;
+        int boolean;
+    } value;
+} LogKv;
+
+#define LOG_KV__(k, kind, member, v) \
+    { .key = k, .json_key = "\"" k "\":", .key_len = sizeof(k) - 1, \
+      .json_key_len = sizeof("\"" k "\":") - 1, .type = kind, .value.member = (v) }
+
+#define KV_STR(k, v)   LOG_KV__(k, LOG_KV_STRING, string, v)
+#define KV_INT(k, v)   LOG_KV__(k, LOG_KV_INT, integer, v)
+#define KV_UINT(k, v)  LOG_KV__(k, LOG_KV_UINT, uinteger, v)
+#define KV_FLOAT(k, v) LOG_KV__(k, LOG_KV_FLOAT, number, v)
+#define KV_BOOL(k, v)  LOG_KV__(k, LOG_KV_BOOL, boolean, v)
+
+/**
+ * Core structured logging function. Encodes the message and the typed fields
+ * straight into a line of the current LogFormat.
+ *
+ * @param level Severity level of the message
+ * @param file Source file where log was generated
+ * @param func Function where log was generated
+ * @param line Line number where log was generated
+ * @param message Plain message, not a format string
+ * @param fields Typed fields, see KV_* macros
+ * @param count Number of fields
+ * @return Timestamp string for the log message
+ */
+char* raise_kv_message(LogLevel level, const char *file, const char *func, int line,
+                       const char *message, const LogKv *fields, size_t count);
+
+/* raise_kv_message() with the message in entries[0].value.string and count fields after it */
+char* raise_kv_array(LogLevel level, const char *file, const char *func, int line,
+                     const LogKv *entries, size_t count);
+
+/*
+ * The message and the fields in one array, so raise_kv() needs no
+ * arguments past the message. The message sets the last member of the
+ * first entry and each field fills an entry after it.
+ */
+#define LOG_KV_ARRAY__(...) ((const LogKv[]){ [0].value.string = __VA_ARGS__ })
+#define LOG_KV_COUNT__(...) (sizeof(LOG_KV_ARRAY__(__VA_ARGS__)) / sizeof(LogKv) - 1)
+
+/*
+ * Usage: raise_kv(LOG_LEVEL_INFO, "request done", KV_STR("path", path), KV_INT("status", 200));
+ *        raise_kv(LOG_LEVEL_INFO, "started");
+ * Levels below PRECOMPILED_LOG_LEVEL are folded away at compile time.
+ */
+#define raise_kv(level, ...) \
+    ((int)(level) >= (int)PRECOMPILED_LOG_LEVEL \
+        ? raise_kv_array(level, __FILE__, __func__, __LINE__, \
+                         LOG_KV_ARRAY__(__VA_ARGS__), LOG_KV_COUNT__(__VA_ARGS__)) \
+        : NULL)
+
 // ----------
 // -- misc --
 // ----------
@@ -401,6 +515,33 @@ char* raise_message(LogLevel level, const char *file, const char *func, int line
 void substr_clone__(const char *file, const char *func, int line, const char * const src, char *dest, size_t from, size_t len);
 #define substr_clone(src, dest, from, len) substr_clone__(__FILE__, __func__, __LINE__, src, dest, from, len)
 
+// ----------
+// -- Simd --
+// ----------
+
+/*
+ * Instruction set used by the vectorized scanners (JSON structural index, ...).
+ * Detected once at runtime; every level has the same observable behavior,
+ * so lowering it is only useful for tests and benchmarks.
+ */
+typedef enum {
+    SIMD_LEVEL_SCALAR,
+    SIMD_LEVEL_SSE2,
+    SIMD_LEVEL_AVX2,
+} SimdLevel;
+
+const char *simd_level_to_string(SimdLevel level);
+
+// Best level supported by the running CPU
+SimdLevel simd_level_detect(void);
+
+// Level currently used by the scanners
+SimdLevel simd_level(void);
+
+// Force a level; values above the detected one are clamped to it.
+// Set it before starting threads that scan, it is not synchronized with them
+void simd_set_level(SimdLevel level);
+
 // -----------
 // -- arena --
 // -----------
@@ -506,15 +647,30 @@ static Arena disposable_arena __attribute__((unused)) = {0};
 /*
  * Set of pointers to track visited objects
  * Used to detect cycles in debug strings
+ *
+ * Open addressing keyed on (ptr, type, field_name). Type and field names are
+ * interned to small ids once per set, so a lookup hashes the pointer and
+ * compares integers; the field name keeps same-type fields of a union apart.
  */
+typedef struct {
+    void const *ptr;
+    uint32_t type_id;   // 0 marks an empty slot
+    uint32_t field_id;
+} PtrSetEntry;
+
+typedef struct {
+    const char *name;
+    uint64_t hash;      // 0 marks an empty slot
+    uint32_t id;
+} PtrSetName;
+
 typedef struct PtrSet {
-    struct {
-        void const *ptr;
-        const char *type;
-        const char *field_name;  // Add field name to distinguish between same-type fields in unions
-    } *data;
+    PtrSetEntry *entries;
     size_t size;
-    size_t capacity;
+    size_t capacity;       // power of two
+    PtrSetName *names;     // interned type and field names
+    size_t name_count;
+    size_t name_capacity;  // power of two
 } PtrSet;
 
 PtrSet *ptrset_init__(const char *file, const char *func, int line, Arena *arena);
@@ -523,6 +679,71 @@ PtrSet *ptrset_init__(const char *file, const char *func, int line, Arena *arena
 bool debug_ptrset_contains__(PtrSet *set, const void *ptr, const char *type, const char *field_name);
 void debug_ptrset_add__(const char *file, const char *func, int line, Arena *arena, PtrSet *set, const void *ptr, const char *type, const char *field_name);
 
+/*
+ * Streaming writer behind the *_to_debug_str family. Every field is
+ * formatted once, straight into a single buffer grown in the arena or into
+ * a FILE*, and nested structs are never copied into their parents, so a
+ * dump costs time linear in its output. With pretty set the layout of
+ * debug_to_pretty_str() is produced inline; lines only break at structure,
+ * never inside a string value. visited may be NULL to skip cycle checks.
+ *
+ *   DebugWriter w = debug_writer_buffer(arena, ptrset_init(arena), false);
+ *   if (debug_write_enter(&w, "struct", "Point", name, point)) {
+ *       debug_write_int(&w, "x", point->x);
+ *       debug_write_int(&w, "y", point->y);
+ *       debug_write_leave(&w, point);
+ *   }
+ *   char *text = debug_writer_cstr(&w);
+ */
+typedef struct {
+    Arena *arena;     // Buffer growth and visited entries
+    PtrSet *visited;
+    FILE *stream;     // NULL writes into data
+    char *data;
+    size_t len;
+    size_t capacity;
+    bool pretty;
+    int level;        // Open structs and unions
+    bool first;       // Nothing written yet at this level
+    const char *file; // Where the writer was made, for its log messages
+    const char *func;
+    int line;
+} DebugWriter;
+
+DebugWriter debug_writer_buffer__(const char *file, const char *func, int line, Arena *arena, PtrSet *visited, bool pretty);
+DebugWriter debug_writer_file__(const char *file, const char *func, int line, Arena *arena, FILE *stream, PtrSet *visited, bool pretty);
+#define debug_writer_buffer(arena, visited, pretty) debug_writer_buffer__(__FILE__, __func__, __LINE__, arena, visited, pretty)
+#define debug_writer_file(arena, stream, visited, pretty) debug_writer_file__(__FILE__, __func__, __LINE__, arena, stream, visited, pretty)
+
+// NUL-terminated contents of a buffer writer; NULL for a FILE* writer
+char *debug_writer_cstr(DebugWriter *writer);
+
+// Start a new field and format it in place
+void debug_write_field(DebugWriter *writer, const char *fmt, ...);
+// A field already rendered by one of the *_to_debug_str functions
+void debug_write_text(DebugWriter *writer, const char *text);
+
+/*
+ * Cycle and NULL handling of STRUCT_TO_DEBUG_STR: writes "<cycle detected>"
+ * or NULL and returns false, otherwise records ptr in visited and returns
+ * true. kind is "struct" or "union"; a NULL name becomes "$1".
+ */
+bool debug_write_visit(DebugWriter *writer, const char *kind, const char *type, const char *name, const void *ptr);
+void debug_write_open(DebugWriter *writer, const char *kind, const char *type, const char *name);
+void debug_write_leave(DebugWriter *writer, const void *ptr);
+// debug_write_visit() then debug_write_open(); fields follow when it returns true
+bool debug_write_enter(DebugWriter *writer, const char *kind, const char *type, const char *name, const void *ptr);
+
+void debug_write_string(DebugWriter *writer, const char *name, const char *string);
+void debug_write_int(DebugWriter *writer, const char *name, int number);
+void debug_write_float(DebugWriter *writer, const char *name, double number);
+void debug_write_int64(DebugWriter *writer, const char *name, int64_t number);
+void debug_write_size_t(DebugWriter *writer, const char *name, size_t number);
+void debug_write_ptr(DebugWriter *writer, const char *name, const void *ptr);
+void debug_write_char(DebugWriter *writer, const char *name, char c);
+void debug_write_bool(DebugWriter *writer, const char *name, int boolean);
+void debug_write_enum(DebugWriter *writer, const char *name, size_t enum_value, const char *enum_str);
+
 #define DEBUGSTR(arena, type, value) DEBUGSTR_##type(arena, value)
 
 #define DEBUGSTR_Slice(arena, value) slice_to_debug_str(arena, value)
@@ -547,6 +768,8 @@ char *int_to_debug_str__(const char *file, const char *func, int line, Arena *ar
 
 char *float_to_debug_str__(const char *file, const char *func, int line, Arena *arena, const char *name, double number);
 
+char *int64_to_debug_str__(const char *file, const char *func, int line, Arena *arena, const char *name, int64_t number);
+
 char *size_t_to_debug_str__(const char *file, const char *func, int line, Arena *arena, const char *name, size_t number);
 
 char *ptr_to_debug_str__(const char *file, const char *func, int line, Arena *arena, const char *name, void *ptr);
@@ -561,6 +784,14 @@ char *struct_to_debug_str__(const char *file, const char *func, int line, Arena
 
 bool debug_ptrset_contains(PtrSet *set, void *ptr);
 
+/*
+ * Whether the byte at ptr can be read, found without touching it: no signal
+ * handler is installed, so it is safe from any thread. Pages found readable
+ * are remembered per thread for the next few calls. When the probe itself
+ * fails, the answer is 1 and nothing is remembered.
+ */
+int is_readable(const void *ptr);
+
 #define ENUM_TO_DEBUG_STR(arena, name, enum_value, enum_str) \
     enum_to_debug_str__(__FILE__, __func__, __LINE__, arena, name, enum_value, enum_str)
 #define STRING_TO_DEBUG_STR(arena, name, string) \
@@ -569,6 +800,8 @@ bool debug_ptrset_contains(PtrSet *set, void *ptr);
     int_to_debug_str__(__FILE__, __func__, __LINE__, arena, name, number)
 #define FLOAT_TO_DEBUG_STR(arena, name, number) \
     float_to_debug_str__(__FILE__, __func__, __LINE__, arena, name, number)
+#define INT64_TO_DEBUG_STR(arena, name, number) \
+    int64_to_debug_str__(__FILE__, __func__, __LINE__, arena, name, number)
 #define SIZE_T_TO_DEBUG_STR(arena, name, number) \
     size_t_to_debug_str__(__FILE__, __func__, __LINE__, arena, name, number)
 #define PTR_TO_DEBUG_STR(arena, name, ptr) \
@@ -616,7 +849,9 @@ bool debug_ptrset_contains(PtrSet *set, void *ptr);
  *     as the 'return' statements within the macro will exit the current function.
  *
  * Returns:
- *   - A debug string created by arena_strdup_fmt__ containing the structure's debugging information.
+ *   - A debug string containing the structure's debugging information. The fields
+ *     arrive already rendered and are copied once more into it; dumpers that
+ *     should stay linear on deep graphs write through a DebugWriter instead.
  */
 #define STRUCT_TO_DEBUG_STR(arena, buffer, type, name, ptr, visited, count, ...) do { \
     if (!name) \
@@ -672,10 +907,126 @@ HecticError logger_add_rule(Arena *arena, LogRule *rules, LogLevel level, const
 LogLevel logger_get_effective_level(const char *file, const char *func, int line);
 
 char *log_rules_to_debug_str__(const char *file, const char *func, int line, Arena *arena, char *name, LogRule *self, PtrSet *visited);
+void log_rules_write_debug(DebugWriter *writer, const char *name, const LogRule *self);
 
 #define LOG_RULES_TO_DEBUG_STR(arena, name, self) \
     log_rules_to_debug_str__(__FILE__, __func__, __LINE__, arena, name, self, ptrset_init(arena))
 
+// The rule chain as a JSON array, written in one pass; indent 0 is compact
+char *log_rules_to_json_str__(const char *file, const char *func, int line, Arena *arena, const LogRule *rules, int indent);
+
+#define LOG_RULES_TO_JSON_STR(arena, rules, indent) \
+    log_rules_to_json_str__(__FILE__, __func__, __LINE__, arena, rules, indent)
+
+// ----------
+// -- View --
+// ----------
+
+typedef struct {
+    const void * const data;
+    const size_t len;
+    const size_t isize;
+    const bool terminated;  // a readable NUL follows the last item, so NUL-bound parsers can run in place
+} View;
+
+View view_create(const void *data, size_t len, size_t isize);
+View string_to_view(const char *str);
+
+/*
+ * Text operations on views of chars. None of them copy or allocate: results
+ * are views into the same bytes, so they live as long as the input does.
+ * Searches use the SIMD level from simd_level() and return VIEW_NPOS when
+ * there is no match. A view of wider items is refused with a warning: no
+ * match, false, the view unchanged or no items. Comparisons are the
+ * exception and work on any item size, byte by byte; views of different
+ * item sizes never compare equal.
+ */
+#define VIEW_NPOS ((size_t)-1)
+
+// Clamped to the view; terminated only if it still ends where the view ends
+View view_slice(View view, size_t from, size_t to);
+
+size_t view_find_byte(View view, char c);
+size_t view_find(View view, View needle);
+// First byte that is any of the bytes of set
+size_t view_find_any(View view, View set);
+size_t view_rfind_byte(View view, char c);
+
+// ASCII whitespace
+View view_trim(View view);
+View view_trim_left(View view);
+View view_trim_right(View view);
+
+bool view_equal(View a, View b);
+int view_compare(View a, View b);
+bool view_starts_with(View view, View prefix);
+bool view_ends_with(View view, View suffix);
+
+/*
+ * The whole view as a decimal integer with an optional sign; false on an
+ * empty view, any other byte or overflow, and *out is left untouched.
+ */
+bool view_parse_int64(View view, int64_t *out);
+bool view_parse_uint64(View view, uint64_t *out);
+
+typedef enum {
+    VIEW_SPLIT_DELIMITER,  // every delimiter ends an item, empty items included
+    VIEW_SPLIT_LINES,      // '\n' or "\r\n"; no empty item after a final newline
+    VIEW_SPLIT_TOKENS,     // runs of any byte of the set separate non-empty items
+} ViewSplitMode;
+
+/*
+ * Iterator over the items of a view:
+ *
+ *   ViewSplit it = view_lines(text);
+ *   while (view_split_next(&it)) {
+ *       View line = view_split_item(&it);
+ *   }
+ */
+typedef struct {
+    ViewSplitMode mode;
+    const char *rest;   // NULL once the input is used up
+    size_t rest_len;
+    const char *item;
+    size_t item_len;
+    char delimiter;
+    const char *set;    // separators of VIEW_SPLIT_TOKENS
+    size_t set_len;
+} ViewSplit;
+
+ViewSplit view_split(View view, char delimiter);
+ViewSplit view_lines(View view);
+ViewSplit view_tokens(View view, View separators);
+bool view_split_next(ViewSplit *it);
+View view_split_item(const ViewSplit *it);
+
+typedef enum {
+    VIEW_MAP_NORMAL,
+    VIEW_MAP_SEQUENTIAL,  // one front-to-back pass, what the parsers do
+    VIEW_MAP_WILLNEED,    // start reading the whole file in right away
+} ViewMapAdvice;
+
+/*
+ * A file mapped read-only. view is always terminated: the mapping is padded
+ * with zeroes past the end of the file, so parsers read it in place without
+ * a copy. The mapping is owned by this handle and lives until
+ * view_unmap_file(); trees that borrow from it (JSON_STRINGS_BORROWED, the
+ * lazy engine) must be dropped first.
+ */
+typedef struct {
+    View view;
+    void *base;
+    size_t size;  // bytes mapped, the padding included
+} MappedFile;
+
+RESULT(MappedFile, MappedFile);
+
+MappedFileResult view_map_file__(const char *file, const char *func, int line, Arena *arena, const char *path, ViewMapAdvice advice);
+void view_unmap_file__(const char *file, const char *func, int line, MappedFile *mapped);
+
+#define view_map_file(arena, path, advice) view_map_file__(__FILE__, __func__, __LINE__, arena, path, advice)
+#define view_unmap_file(mapped) view_unmap_file__(__FILE__, __func__, __LINE__, mapped)
+
 // ----------
 // -- Json --
 // ----------
@@ -694,40 +1045,665 @@ typedef enum {
     JSON_STRING,
     JSON_ARRAY,
     JSON_OBJECT,
+    JSON_INTEGER,     /* Integral number that fits int64_t, kept exact */
+    JSON_RAW_NUMBER,  /* Number kept as its source text in value.string */
 } JsonType;
 
 typedef union {
     double number;
+    int64_t integer;
     char *string;
     int boolean;
     Json *child;  /* Child element (for arrays/objects) */
 } JsonValue;
 
+/* Hash table over the keys of a wide object, see json_object_index() */
+typedef struct JsonObjectIndex JsonObjectIndex;
+
+/* Json.flags */
+#define JSON_STRING_BORROWED 0x1u  /* value.string points at the body in the input, ended by its closing quote */
+#define JSON_STRING_ESCAPED  0x2u  /* Borrowed body still holds escapes, decoded by json_string() */
+#define JSON_STRING_LENGTH_SHIFT 2  /* Borrowed: byte length of the body in the bits above, longer bodies are copied */
+
 /* Full JSON structure */
 struct Json {
     struct Json *next;   /* Next sibling */
     JsonType type;
+    unsigned flags;      /* JSON_STRING_* */
     JsonValue value;
     char *key;           /* Key if item is in an object */
+    JsonObjectIndex *index;  /* Owned by the library, never assign it: key table of wide objects,
+                                or the children not parsed yet after a lazy parse */
 };
 
 RESULT(Json, Json);
 
+typedef enum {
+    JSON_PARSER_RECURSIVE,   /* Byte-at-a-time recursive descent (default) */
+    JSON_PARSER_STRUCTURAL,  /* SIMD structural index first, then an iterative tree build */
+    JSON_PARSER_LAZY,        /* Whole input checked up front, containers built one level at a time
+                                on first access, see json_children() */
+} JsonParserEngine;
+
+typedef enum {
+    JSON_NUMBERS_AUTO,    /* JSON_INTEGER when integral and in int64 range, else JSON_NUMBER (default) */
+    JSON_NUMBERS_DOUBLE,  /* Always JSON_NUMBER */
+    JSON_NUMBERS_RAW,     /* Always JSON_RAW_NUMBER, the text exactly as written */
+} JsonNumberMode;
+
+#define JSON_INDEX_THRESHOLD_DEFAULT 16
+#define JSON_MAX_DEPTH_DEFAULT 1024
+
+/*
+ * Key tables of wide objects. With the default, the first lookup builds
+ * the table and so writes to the tree; pick EAGER or NONE, or call
+ * json_settle(), for a tree that several threads look keys up in.
+ */
+typedef enum {
+    JSON_INDEX_LAZY,   /* Wide objects get a table on their first lookup (default) */
+    JSON_INDEX_EAGER,  /* Wide objects get a table while parsing, lookups only read */
+    JSON_INDEX_NONE,   /* Lookups always walk the children */
+} JsonIndexMode;
+
+/*
+ * Where string values and keys live. The default copies them into the
+ * arena, so the input can go away right after parsing. The other modes
+ * avoid the copy and tie the tree to the input buffer's lifetime.
+ */
+typedef enum {
+    JSON_STRINGS_COPY,      /* Decoded copies in the arena (default) */
+    JSON_STRINGS_BORROWED,  /* Values point into the read-only input; keys are still copied.
+                               Read values through json_string(), which decodes escapes on
+                               first use. The input must outlive the tree. */
+    JSON_STRINGS_INSITU,    /* Keys and values decoded inside the input buffer, which is
+                               overwritten. Only through json_parse_insitu(). */
+} JsonStringMode;
+
+typedef struct {
+    JsonParserEngine engine;
+    JsonNumberMode numbers;
+    JsonStringMode strings;
+    JsonIndexMode index;
+    size_t index_threshold;  /* Keys an object needs to be indexed, 0 means JSON_INDEX_THRESHOLD_DEFAULT */
+    size_t max_depth;        /* Deepest container nesting before JSON_ERROR_DEPTH_LIMIT, 0 means JSON_MAX_DEPTH_DEFAULT */
+} JsonParseOptions;
+
 Json *json_parse__(const char* file, const char* func, int line, Arena *arena, const char **s);
 #define json_parse(arena, s) json_parse__(__FILE__, __func__, __LINE__, arena, s)
 
+/*
+ * Parse with explicit options (NULL means defaults). Every engine accepts
+ * the same documents, builds the same tree and leaves *s at the same place.
+ */
+JsonResult json_parse_with_opts__(const char* file, const char* func, int line, Arena *arena, const char **s, const JsonParseOptions *opts);
+#define json_parse_with_opts(arena, s, opts) json_parse_with_opts__(__FILE__, __func__, __LINE__, arena, s, opts)
+
+/*
+ * Parse a writable buffer in place (JSON_STRINGS_INSITU whatever opts
+ * says): strings are unescaped where they stand and NUL-terminated over
+ * their closing quote, so the tree points into *s and the buffer is no
+ * longer valid JSON. It must outlive the tree.
+ */
+JsonResult json_parse_insitu__(const char* file, const char* func, int line, Arena *arena, char **s, const JsonParseOptions *opts);
+#define json_parse_insitu(arena, s, opts) json_parse_insitu__(__FILE__, __func__, __LINE__, arena, s, opts)
+
+/*
+ * Parse exactly input.len bytes of char data, which must hold one JSON
+ * value and nothing but whitespace after it. Nothing past the end is read:
+ * an unterminated view is copied into the arena once, a terminated one
+ * (string_to_view(), view_map_file()) is parsed in place.
+ */
+JsonResult json_parse_view__(const char* file, const char* func, int line, Arena *arena, View input, const JsonParseOptions *opts);
+#define json_parse_view(arena, input, opts) json_parse_view__(__FILE__, __func__, __LINE__, arena, input, opts)
+
+/*
+ * Text of a string or raw number, NUL-terminated. A borrowed string is
+ * decoded into arena on first use and keeps the copy. NULL for other types.
+ */
+const char *json_string__(const char* file, const char* func, int line, Arena *arena, Json *item);
+#define json_string(arena, item) json_string__(__FILE__, __func__, __LINE__, arena, item)
+
+/*
+ * Streaming tokenizer. Input arrives in chunks of any size and tokens are
+ * pulled one at a time, or pushed to a callback, without building a tree.
+ * All memory is taken at init: one byte per nesting level and a buffer for
+ * the longest string or scalar token, so it does not grow with the input.
+ * A max_depth of 0 means JSON_MAX_DEPTH_DEFAULT, as in JsonParseOptions.
+ *
+ *   JsonStream *stream = json_stream_init(arena, 64, 64 * MEM_KiB);
+ *   json_stream_feed(stream, chunk, len);
+ *   while ((type = json_stream_next(stream, &token)) != JSON_TOKEN_NONE) { ... }
+ *   // feed the next chunk, or json_stream_finish() at end of input
+ */
+typedef enum {
+    JSON_TOKEN_NONE,          /* Current chunk is used up, feed more or finish */
+    JSON_TOKEN_OBJECT_BEGIN,
+    JSON_TOKEN_OBJECT_END,
+    JSON_TOKEN_ARRAY_BEGIN,
+    JSON_TOKEN_ARRAY_END,
+    JSON_TOKEN_KEY,
+    JSON_TOKEN_STRING,
+    JSON_TOKEN_NUMBER,
+    JSON_TOKEN_INTEGER,       /* Integral number in int64 range, see token.integer */
+    JSON_TOKEN_BOOL,
+    JSON_TOKEN_NULL,
+    JSON_TOKEN_END,           /* Document complete */
+    JSON_TOKEN_ERROR,         /* See json_stream_error() */
+} JsonTokenType;
+
+typedef struct {
+    JsonTokenType type;
+    const char *string;  /* KEY/STRING: decoded text; scalars: source text. Valid until the next call */
+    size_t length;
+    double number;
+    int64_t integer;
+    int boolean;
+    size_t depth;        /* Number of enclosing containers */
+} JsonToken;
+
+typedef struct JsonStream JsonStream;
+
+/* Producer for json_stream_parse: fill buf with up to cap bytes, 0 at end, -1 on error */
+typedef ssize_t (*JsonStreamReader)(void *ctx, char *buf, size_t cap);
+
+/* Consumer for json_stream_parse: return false to stop */
+typedef bool (*JsonStreamCallback)(const JsonToken *token, void *user);
+
+const char *json_token_type_to_string(JsonTokenType type);
+
+JsonStream *json_stream_init__(const char* file, const char* func, int line, Arena *arena, size_t max_depth, size_t max_token);
+#define json_stream_init(arena, max_depth, max_token) json_stream_init__(__FILE__, __func__, __LINE__, arena, max_depth, max_token)
+
+// The chunk must stay valid until json_stream_next returns JSON_TOKEN_NONE
+void json_stream_feed(JsonStream *stream, const char *chunk, size_t len);
+
+// No more input will be fed
+void json_stream_finish(JsonStream *stream);
+
+JsonTokenType json_stream_next(JsonStream *stream, JsonToken *token);
+
+HecticError json_stream_error(const JsonStream *stream);
+
+// Input bytes consumed so far
+size_t json_stream_offset(const JsonStream *stream);
+
+EmptyResult json_stream_parse__(const char* file, const char* func, int line, JsonStream *stream,
+                                JsonStreamReader reader, void *reader_ctx, JsonStreamCallback callback, void *user);
+#define json_stream_parse(stream, reader, reader_ctx, callback, user) \
+    json_stream_parse__(__FILE__, __func__, __LINE__, stream, reader, reader_ctx, callback, user)
+
+EmptyResult json_stream_parse_fd__(const char* file, const char* func, int line, JsonStream *stream,
+                                   int fd, JsonStreamCallback callback, void *user);
+#define json_stream_parse_fd(stream, fd, callback, user) \
+    json_stream_parse_fd__(__FILE__, __func__, __LINE__, stream, fd, callback, user)
+
+/* Longest output of json_number_to_str, including the NUL */
+#define JSON_NUMBER_MAX_LEN 32
+
+/* Shortest text that reads back as the same double, the closest if several (Grisu3 with an exact fallback); returns its length */
+size_t json_number_to_str(double value, char *out);
+
+/*
+ * Output sink for the serializer: a buffer that is either grown in an arena
+ * or drained to a file descriptor when full. Writes after a failure are
+ * dropped and `failed` stays set.
+ */
+typedef struct JsonSink JsonSink;
+struct JsonSink {
+    char *data;
+    size_t len;
+    size_t cap;
+    bool (*drain)(JsonSink *sink, size_t need);  /* Make room for `need` more bytes */
+    Arena *arena;
+    int fd;
+    void *ctx;                                   /* Free for custom drains */
+    bool failed;
+    const char *file;                            /* Where the sink was made, for its log messages */
+    const char *func;
+    int line;
+};
+
+JsonSink json_sink_buffer__(const char* file, const char* func, int line, Arena *arena, size_t capacity);
+#define json_sink_buffer(arena, capacity) json_sink_buffer__(__FILE__, __func__, __LINE__, arena, capacity)
+
+// Buffer of `capacity` bytes (0 for 64 KiB) from the arena, written to fd when full
+JsonSink json_sink_fd__(const char* file, const char* func, int line, Arena *arena, int fd, size_t capacity);
+#define json_sink_fd(arena, fd, capacity) json_sink_fd__(__FILE__, __func__, __LINE__, arena, fd, capacity)
+
+void json_sink_write(JsonSink *sink, const char *data, size_t len);
+void json_sink_putc(JsonSink *sink, char c);
+void json_sink_string(JsonSink *sink, const char *s);   /* Quoted and escaped */
+void json_sink_number(JsonSink *sink, double value);    /* null for NaN and infinities */
+void json_sink_integer(JsonSink *sink, int64_t value);
+
+// Write out whatever an fd sink still buffers; false if any write failed
+bool json_sink_flush(JsonSink *sink);
+
+// NUL-terminated contents of a buffer sink, NULL after a failure
+char *json_sink_cstr(JsonSink *sink);
+
+typedef struct {
+    JsonRawOpt raw;  /* Strings without quotes or escaping */
+    int indent;      /* Spaces per nesting level, 0 for compact output */
+    bool canonical;  /* RFC 8785 form: keys sorted by UTF-16 code units, no whitespace, numbers
+                        as the shortest double (NaN and infinities as null); raw and indent are ignored */
+    bool exact_integers;  /* With canonical: integral numbers in the int64 range keep every digit
+                             instead of going through a double, so ids above 2^53 stay apart.
+                             No longer RFC 8785. */
+} JsonWriteOptions;
+
+// Serialize in one pass; opts may be NULL for compact output
+bool json_write__(const char* file, const char* func, int line, JsonSink *sink, const Json *item, const JsonWriteOptions *opts);
+#define json_write(sink, item, opts) json_write__(__FILE__, __func__, __LINE__, sink, item, opts)
+
+/*
+ * Hash of the canonical form with exact_integers, computed without
+ * building it: trees that differ only in key order, whitespace or number
+ * spelling hash the same, while integers differing past 2^53 do not.
+ * Suitable for cache keys, not for security.
+ */
+uint64_t json_hash__(const char* file, const char* func, int line, const Json *item);
+#define json_hash(item) json_hash__(__FILE__, __func__, __LINE__, item)
+
+/* Same canonical form; a hash mismatch answers false before the trees are walked */
+bool json_equal__(const char* file, const char* func, int line, const Json *a, const Json *b);
+#define json_equal(a, b) json_equal__(__FILE__, __func__, __LINE__, a, b)
+
+/*
+ * Streaming writer for JSON that has no tree behind it. Calls must form
+ * a valid document (a key before every object member, ends matching
+ * begins); nothing is checked. indent works as in JsonWriteOptions.
+ *
+ *   JsonSink sink = json_sink_buffer(arena, 0);
+ *   JsonWriter w = json_writer(&sink, 2);
+ *   json_writer_begin_object(&w);
+ *   json_writer_key(&w, "id");
+ *   json_writer_integer(&w, 7);
+ *   json_writer_end_object(&w);
+ *   char *text = json_sink_cstr(&sink);
+ */
+typedef struct {
+    JsonSink *sink;
+    int indent;
+    int level;       /* Open containers */
+    bool first;      /* Nothing written yet in the innermost container */
+    bool after_key;  /* The next value belongs to the key just written */
+} JsonWriter;
+
+JsonWriter json_writer(JsonSink *sink, int indent);
+void json_writer_begin_object(JsonWriter *writer);
+void json_writer_end_object(JsonWriter *writer);
+void json_writer_begin_array(JsonWriter *writer);
+void json_writer_end_array(JsonWriter *writer);
+void json_writer_key(JsonWriter *writer, const char *key);
+void json_writer_string(JsonWriter *writer, const char *value);  /* NULL writes null */
+void json_writer_string_len(JsonWriter *writer, const char *value, size_t len);
+void json_writer_integer(JsonWriter *writer, int64_t value);
+void json_writer_number(JsonWriter *writer, double value);
+void json_writer_bool(JsonWriter *writer, bool value);
+void json_writer_null(JsonWriter *writer);
+void json_writer_value(JsonWriter *writer, const Json *item);   /* A whole tree, indented in place */
+
 char *json_to_str__(const char* file, const char* func, int line, Arena *arena, const Json * const item);
 #define JSON_TO_STR(arena, item) json_to_str__(__FILE__, __func__, __LINE__, arena, item)
 
 char *json_to_str_with_opts__(const char* file, const char* func, int line, Arena *arena, const Json * const item, JsonRawOpt raw);
 #define JSON_TO_STR_WITH_OPTS(arena, item, raw) json_to_str_with_opts__(__FILE__, __func__, __LINE__, arena, item, raw)
 
-/* Retrieve an object item by key (case-sensitive) */
+/*
+ * Retrieve an object item by key (case-sensitive). Despite the const, the
+ * first lookup in a wide object of a JSON_INDEX_LAZY tree builds its key
+ * table in the parse arena, so it must not race other readers.
+ */
 Json *json_get_object_item__(const char* file, const char* func, int line, const Json * const object, const char * const key);
 
 #define json_get_object_item(object, key) json_get_object_item__(__FILE__, __func__, __LINE__, object, key)
 
+/*
+ * First element or member of an array or object, NULL for other values.
+ * After a JSON_PARSER_LAZY parse, value.child of a container stays NULL
+ * until something asks for it, so iterate with this instead:
+ *   for (Json *item = json_children(array); item; item = item->next) { ... }
+ * The lazy parse keeps pointers into the input, which must outlive the tree.
+ */
+Json *json_children__(const char* file, const char* func, int line, const Json *container);
+#define json_children(container) json_children__(__FILE__, __func__, __LINE__, container)
+
+/*
+ * Reading a tree can write to it. The first json_children(), lookup, path
+ * or write that reaches a lazy container parses its children, and the
+ * first lookup in a wide object without a built key table builds one, both
+ * into the parse arena, const pointer or not. A tree that several threads
+ * read at once must have neither left: settle it first. This expands every
+ * lazy container and builds every key table under item. False when an
+ * arena ran out; lookups in those objects then walk without writing.
+ */
+bool json_settle__(const char* file, const char* func, int line, Json *item);
+#define json_settle(item) json_settle__(__FILE__, __func__, __LINE__, item)
+
+/*
+ * Build the key table of an object now, in arena. Lookups then cost O(1)
+ * and still return the first child with a given key. Code that adds or
+ * removes children of an indexed object by hand must call this again, or
+ * json_object_unindex() to go back to walking the list; take the children
+ * through json_children() before editing them. Returns false if object is
+ * not an object or the arena has no room, in which case lookups keep
+ * walking the list.
+ */
+bool json_object_index__(const char* file, const char* func, int line, Arena *arena, Json *object);
+#define json_object_index(arena, object) json_object_index__(__FILE__, __func__, __LINE__, arena, object)
+
+/* Drop the key table of an object; children still waiting for a lazy parse are kept */
+void json_object_unindex(Json *object);
+
+/*
+ * Deep copy of item into a single allocation from arena: nodes in
+ * depth-first order, followed by one copy of every distinct key and
+ * string. Borrowed strings are decoded and lazy containers expanded, so
+ * the source arena and input can be reset once this returns. Objects
+ * that had a key table get a fresh one on their first lookup. NULL when
+ * the arena has no room for the block.
+ */
+Json *json_clone_compact__(const char* file, const char* func, int line, Arena *arena, const Json *item);
+#define json_clone_compact(arena, item) json_clone_compact__(__FILE__, __func__, __LINE__, arena, item)
+
+/*
+ * Mutation. Values handed in must be detached (not in another container)
+ * and become part of the tree; keys are copied into arena. Lazy containers
+ * are expanded first, and objects keep their key table up to date, getting
+ * one once they reach JSON_INDEX_THRESHOLD_DEFAULT keys.
+ */
+
+/* null, false, 0, "", [] or {} */
+Json *json_new__(const char* file, const char* func, int line, Arena *arena, JsonType type);
+#define json_new(arena, type) json_new__(__FILE__, __func__, __LINE__, arena, type)
+
+/* Replace a scalar's value (and type); false for containers */
+bool json_set_null__(const char* file, const char* func, int line, Json *item);
+#define json_set_null(item) json_set_null__(__FILE__, __func__, __LINE__, item)
+bool json_set_bool__(const char* file, const char* func, int line, Json *item, bool value);
+#define json_set_bool(item, value) json_set_bool__(__FILE__, __func__, __LINE__, item, value)
+bool json_set_integer__(const char* file, const char* func, int line, Json *item, int64_t value);
+#define json_set_integer(item, value) json_set_integer__(__FILE__, __func__, __LINE__, item, value)
+bool json_set_number__(const char* file, const char* func, int line, Json *item, double value);
+#define json_set_number(item, value) json_set_number__(__FILE__, __func__, __LINE__, item, value)
+bool json_set_string__(const char* file, const char* func, int line, Arena *arena, Json *item, const char *value);
+#define json_set_string(arena, item, value) json_set_string__(__FILE__, __func__, __LINE__, arena, item, value)
+
+/* Put value in place of the first member named key, or append it; returns value */
+Json *json_object_set__(const char* file, const char* func, int line, Arena *arena, Json *object, const char *key, Json *value);
+#define json_object_set(arena, object, key, value) json_object_set__(__FILE__, __func__, __LINE__, arena, object, key, value)
+
+/* Insert a member before position (past the end appends); NULL when the key is already there */
+Json *json_object_insert__(const char* file, const char* func, int line, Arena *arena, Json *object, size_t position, const char *key, Json *value);
+#define json_object_insert(arena, object, position, key, value) json_object_insert__(__FILE__, __func__, __LINE__, arena, object, position, key, value)
+
+/* Remove every member named key; returns how many there were */
+size_t json_object_delete__(const char* file, const char* func, int line, Json *object, const char *key);
+#define json_object_delete(object, key) json_object_delete__(__FILE__, __func__, __LINE__, object, key)
+
+bool json_array_push__(const char* file, const char* func, int line, Json *array, Json *value);
+#define json_array_push(array, value) json_array_push__(__FILE__, __func__, __LINE__, array, value)
+
+/* Insert before position, which may be the length; false when it is past that */
+bool json_array_insert__(const char* file, const char* func, int line, Json *array, size_t position, Json *value);
+#define json_array_insert(array, position, value) json_array_insert__(__FILE__, __func__, __LINE__, array, position, value)
+
+/* The detached element, NULL when position is out of range */
+Json *json_array_remove__(const char* file, const char* func, int line, Json *array, size_t position);
+#define json_array_remove(array, position) json_array_remove__(__FILE__, __func__, __LINE__, array, position)
+
+/*
+ * Replace up to `remove` elements from start with the chain items (linked
+ * through next, NULL to only remove). Returns the removed elements as a
+ * NULL-terminated chain.
+ */
+Json *json_array_splice__(const char* file, const char* func, int line, Json *array, size_t start, size_t remove, Json *items);
+#define json_array_splice(array, start, remove, items) json_array_splice__(__FILE__, __func__, __LINE__, array, start, remove, items)
+
+/*
+ * Apply an RFC 7396 merge patch to target in place and return the result,
+ * which is a new value when either side is not an object (target may be
+ * NULL). Values from patch are copied into arena, so one patch can be
+ * layered onto many targets.
+ */
+Json *json_merge_patch__(const char* file, const char* func, int line, Arena *arena, Json *target, const Json *patch);
+#define json_merge_patch(arena, target, patch) json_merge_patch__(__FILE__, __func__, __LINE__, arena, target, patch)
+
+/*
+ * Compiled paths in the hemar path syntax:
+ *   .                  the root itself
+ *   a.b[3].c           keys and array indexes, "a[0][1]" needs no dots
+ *   items[-1]          negative indexes count from the end
+ *   "key.with spaces"  quoted keys, "" inside the quotes is one quote
+ * Compile once, then evaluate against any number of documents without
+ * parsing the path again.
+ */
+typedef enum {
+    JSON_PATH_KEY,
+    JSON_PATH_INDEX,
+} JsonPathSegmentType;
+
+typedef struct {
+    JsonPathSegmentType type;
+    const char *key;   /* JSON_PATH_KEY */
+    int64_t index;     /* JSON_PATH_INDEX, negative counts from the end */
+} JsonPathSegment;
+
+typedef struct {
+    const char *source;
+    JsonPathSegment *segments;
+    size_t count;      /* 0 for the root path "." */
+} JsonPath;
+
+RESULT(JsonPath, JsonPath);
+
+JsonPathResult json_path_compile__(const char* file, const char* func, int line, Arena *arena, const char *source);
+#define json_path_compile(arena, source) json_path_compile__(__FILE__, __func__, __LINE__, arena, source)
+
+/* Value at path under root, or NULL when some segment is missing or of the wrong kind */
+Json *json_path_eval__(const char* file, const char* func, int line, const Json *root, const JsonPath *path);
+#define json_path_eval(root, path) json_path_eval__(__FILE__, __func__, __LINE__, root, path)
+
+/*
+ * Many paths over one document in a single traversal: shared prefixes are
+ * resolved once and each array on the way is walked once. out[i] receives
+ * the value of paths[i], or NULL.
+ */
+typedef struct JsonPathSet JsonPathSet;
+
+JsonPathSet *json_path_set__(const char* file, const char* func, int line, Arena *arena, const JsonPath *const *paths, size_t count);
+#define json_path_set(arena, paths, count) json_path_set__(__FILE__, __func__, __LINE__, arena, paths, count)
+
+void json_path_set_eval__(const char* file, const char* func, int line, const JsonPathSet *set, const Json *root, Json **out);
+#define json_path_set_eval(set, root, out) json_path_set_eval__(__FILE__, __func__, __LINE__, set, root, out)
+
+/*
+ * Tape: a parsed document as one array of tagged 64-bit words with all
+ * strings in a single buffer. Values are addressed by word index; the
+ * root value is at JSON_TAPE_ROOT and JSON_TAPE_NONE means "not found".
+ * Skipping a container and taking its length are O(1). The tape parser is
+ * strict like the stream tokenizer: no trailing commas, no open containers.
+ *
+ *   JsonTapeResult r = json_tape_parse(arena, &input);
+ *   size_t users = json_tape_object_get(tape, JSON_TAPE_ROOT, "users");
+ *   JsonTapeIter it = json_tape_iter(tape, users);
+ *   while (json_tape_iter_next(&it, &user, NULL)) { ... }
+ */
+#define JSON_TAPE_NONE 0
+#define JSON_TAPE_ROOT 1
+
+typedef struct {
+    uint64_t *words;
+    size_t count;
+    char *strings;       /* NUL-terminated, lengths are on the tape */
+    size_t strings_len;
+} JsonTape;
+
+RESULT(JsonTape, JsonTape);
+
+typedef struct {
+    const JsonTape *tape;
+    size_t at;
+    size_t end;
+    bool object;
+} JsonTapeIter;
+
+JsonTapeResult json_tape_parse__(const char* file, const char* func, int line, Arena *arena, const char **s);
+#define json_tape_parse(arena, s) json_tape_parse__(__FILE__, __func__, __LINE__, arena, s)
+
+JsonTapeResult json_tape_from_json__(const char* file, const char* func, int line, Arena *arena, const Json *root);
+#define json_tape_from_json(arena, root) json_tape_from_json__(__FILE__, __func__, __LINE__, arena, root)
+
+/* Node tree for the value at `at`; strings are shared with the tape, not copied */
+Json *json_tape_to_json__(const char* file, const char* func, int line, Arena *arena, const JsonTape *tape, size_t at);
+#define json_tape_to_json(arena, tape, at) json_tape_to_json__(__FILE__, __func__, __LINE__, arena, tape, at)
+
+JsonType json_tape_type(const JsonTape *tape, size_t at);
+size_t json_tape_skip(const JsonTape *tape, size_t at);       /* Index of the next sibling */
+size_t json_tape_length(const JsonTape *tape, size_t at);     /* Elements, members or string bytes */
+bool json_tape_bool(const JsonTape *tape, size_t at);
+int64_t json_tape_integer(const JsonTape *tape, size_t at);   /* Doubles are truncated */
+double json_tape_number(const JsonTape *tape, size_t at);     /* Integers are converted */
+const char *json_tape_string(const JsonTape *tape, size_t at); /* Strings and raw numbers, else NULL */
+
+JsonTapeIter json_tape_iter(const JsonTape *tape, size_t container);
+/* Next element or member; key is NULL inside arrays */
+bool json_tape_iter_next(JsonTapeIter *it, size_t *value, const char **key);
+
+size_t json_tape_array_get(const JsonTape *tape, size_t array, size_t index);
+size_t json_tape_object_get(const JsonTape *tape, size_t object, const char *key);
+
+/*
+ * Binary documents in the spirit of Postgres jsonb: written once, then
+ * mapped and read in place without building nodes. A value is a 64-bit
+ * reference with its tag in the top byte, as on the tape: null, booleans
+ * and integers that fit 56 bits are inline, the rest sits at a file offset.
+ *   string, raw number  u64 length, the bytes, NUL
+ *   array               u64 count, count references
+ *   object              u64 count, count key offsets (strings), count value
+ *                       references, count u32 member positions sorted by key
+ * Members keep their document order; lookups binary-search the sorted
+ * positions. The 32-byte header holds magic, version, size, a checksum of
+ * the rest and the root reference. Everything is 8-byte aligned and in
+ * host byte order, so a file from a foreign-endian host fails the version
+ * check.
+ */
+#define JSON_BINARY_VERSION 1
+#define JSON_BINARY_NONE 0
+
+typedef uint64_t JsonBinaryRef;
+
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    JsonBinaryRef root;
+    MappedFile *file;    /* Set when the bytes come from json_binary_open() */
+} JsonBinary;
+
+RESULT(JsonBinary, JsonBinary);
+
+/* Encoded document in the arena */
+JsonBinaryResult json_binary_encode__(const char* file, const char* func, int line, Arena *arena, const Json *root);
+#define json_binary_encode(arena, root) json_binary_encode__(__FILE__, __func__, __LINE__, arena, root)
+
+/* Encode root straight into a file; it is replaced atomically */
+EmptyResult json_binary_write__(const char* file, const char* func, int line, const Json *root, const char *path);
+#define json_binary_write(root, path) json_binary_write__(__FILE__, __func__, __LINE__, root, path)
+
+/* Check the header and checksum of bytes already in memory */
+JsonBinaryResult json_binary_load__(const char* file, const char* func, int line, Arena *arena, View bytes);
+#define json_binary_load(arena, bytes) json_binary_load__(__FILE__, __func__, __LINE__, arena, bytes)
+
+/* Map a file written by json_binary_write(); it stays mapped until json_binary_close() */
+JsonBinaryResult json_binary_open__(const char* file, const char* func, int line, Arena *arena, const char *path);
+#define json_binary_open(arena, path) json_binary_open__(__FILE__, __func__, __LINE__, arena, path)
+
+void json_binary_close__(const char* file, const char* func, int line, JsonBinary *binary);
+#define json_binary_close(binary) json_binary_close__(__FILE__, __func__, __LINE__, binary)
+
+JsonType json_binary_type(const JsonBinary *binary, JsonBinaryRef ref);
+size_t json_binary_length(const JsonBinary *binary, JsonBinaryRef ref);      /* Elements, members or string bytes */
+bool json_binary_bool(const JsonBinary *binary, JsonBinaryRef ref);
+int64_t json_binary_integer(const JsonBinary *binary, JsonBinaryRef ref);    /* Doubles are truncated */
+double json_binary_number(const JsonBinary *binary, JsonBinaryRef ref);      /* Integers are converted */
+const char *json_binary_string(const JsonBinary *binary, JsonBinaryRef ref); /* Strings and raw numbers, else NULL */
+
+JsonBinaryRef json_binary_array_get(const JsonBinary *binary, JsonBinaryRef array, size_t index);
+JsonBinaryRef json_binary_object_get(const JsonBinary *binary, JsonBinaryRef object, const char *key);
+/* Member at index in document order, its key through *key when not NULL */
+JsonBinaryRef json_binary_object_at(const JsonBinary *binary, JsonBinaryRef object, size_t index, const char **key);
+
+/*
+ * Node tree for ref; strings and keys point into the binary, not copied.
+ * Containers nested deeper than JSON_MAX_DEPTH_DEFAULT, or laid out out of
+ * the writer's order (as a forged file with looping refs would be), are
+ * read as null.
+ */
+Json *json_binary_to_json__(const char* file, const char* func, int line, Arena *arena, const JsonBinary *binary, JsonBinaryRef ref);
+#define json_binary_to_json(arena, binary, ref) json_binary_to_json__(__FILE__, __func__, __LINE__, arena, binary, ref)
+
+/*
+ * JSON Lines / NDJSON: one value per line, parsed on worker threads.
+ * Records end at newlines outside strings; blank lines are skipped. Work
+ * is handed out in chunks of about chunk_size bytes, each parsed into
+ * arenas of its own, and results come back in input order. A record that
+ * fails only costs its own line.
+ *
+ *   JsonLinesResult r = json_lines_parse(arena, mapped->view, NULL);
+ *   for (size_t i = 0; i < r.Result.some->count; i++) ...
+ *   json_lines_free(r.Result.some);
+ */
+#define JSON_LINES_CHUNK_DEFAULT (256 * 1024)
+
+typedef struct {
+    size_t threads;          /* Workers, 0 means one per online CPU */
+    size_t chunk_size;       /* 0 means JSON_LINES_CHUNK_DEFAULT */
+    JsonParseOptions parse;  /* For every record; the lazy engine and in-situ strings are refused,
+                                and records are always read by the structural engine, which
+                                stops at the end of the line */
+} JsonLinesOptions;
+
+typedef struct {
+    size_t line;        /* 1-based line the record starts on */
+    size_t offset;      /* Of the record in the input */
+    size_t length;      /* Up to, not including, the newline */
+    Json *value;        /* NULL when the record failed */
+    HecticError error;  /* HECTIC_ERROR_NONE on success */
+} JsonLine;
+
+typedef struct {
+    JsonLine *lines;
+    size_t count;
+    size_t failed;
+    Arena **arenas;     /* Hold the values, released by json_lines_free() */
+    size_t arena_count;
+} JsonLines;
+
+RESULT(JsonLines, JsonLines);
+
+JsonLinesResult json_lines_parse__(const char* file, const char* func, int line, Arena *arena, View input, const JsonLinesOptions *opts);
+#define json_lines_parse(arena, input, opts) json_lines_parse__(__FILE__, __func__, __LINE__, arena, input, opts)
+
+void json_lines_free__(const char* file, const char* func, int line, JsonLines *lines);
+#define json_lines_free(lines) json_lines_free__(__FILE__, __func__, __LINE__, lines)
+
+/*
+ * Streaming variant: records go to callback in input order, on the calling
+ * thread, and a value is only valid during its callback. Workers stay a
+ * few chunks ahead at most, so memory does not grow with the input.
+ * Returning false stops the batch with JSON_ERROR_ABORTED. The arena is
+ * only used to copy an unterminated input.
+ */
+typedef bool (*JsonLineCallback)(const JsonLine *record, void *ctx);
+
+EmptyResult json_lines_each__(const char* file, const char* func, int line, Arena *arena, View input, const JsonLinesOptions *opts,
+                              JsonLineCallback callback, void *ctx);
+#define json_lines_each(arena, input, opts, callback, ctx) json_lines_each__(__FILE__, __func__, __LINE__, arena, input, opts, callback, ctx)
+
 char* json_to_debug_str__(const char* file, const char* func, int line, Arena *arena, const char *name, const Json *self, PtrSet *visited);
+// Siblings are written in a loop, so long arrays do not recurse per element
+void json_write_debug(DebugWriter *writer, const char *name, const Json *self);
 
 #define JSON_TO_DEBUG_STR(arena, name, json) json_to_debug_str__(__FILE__, __func__, __LINE__, arena, name, json, ptrset_init(arena))
 
@@ -791,16 +1767,6 @@ char* slice_to_debug_str__(const char* file, const char* func, int line, Arena *
 
 #define slice_to_debug_str(arena, slice) slice_to_debug_str__(__FILE__, __func__, __LINE__, arena, slice)
 
-// ----------
-// -- View --
-// ----------
-
-typedef struct {
-    const void * const data;
-    const size_t len;
-    const size_t isize;
-} View;
-
 // ---------------
 // -- Templater --
 // ---------------
@@ -881,14 +1847,25 @@ RESULT(Template, TemplateNode);
 
 TemplateResult template_parse__(const char *file, const char *func, int line, Arena *arena, const char **s, const TemplateConfig *config, bool inner_parse);
 
+TemplateResult template_parse_view__(const char *file, const char *func, int line, Arena *arena, View input, const TemplateConfig *config);
+
 TemplateConfig template_default_config__(const char *file, const char *func, int line, Arena *arena);
 
 char *template_node_to_debug_str__(const char *file, const char *func, int line, Arena *arena, const char *name, const TemplateNode *self, PtrSet *visited);
+void template_node_write_debug(DebugWriter *writer, const char *name, const TemplateNode *self);
 
 char *template_node_to_json_str__(const char *file, const char *func, int line, Arena *arena, const TemplateNode *node, int depth);
 
+char *template_node_to_pretty_json_str__(const char *file, const char *func, int line, Arena *arena, const TemplateNode *node);
+
+// A node and its siblings as a JSON array, streamed into writer
+void template_node_write_json(JsonWriter *writer, const TemplateNode *node);
+
 #define template_parse(arena, s, config) template_parse__(__FILE__, __func__, __LINE__, arena, s, config, false)
 
+// Same as template_parse(), bounded by input.len (see json_parse_view())
+#define template_parse_view(arena, input, config) template_parse_view__(__FILE__, __func__, __LINE__, arena, input, config)
+
 #define template_default_config(arena) template_default_config__(__FILE__, __func__, __LINE__, arena)
 
 #define TEMPLATE_NODE_TO_DEBUG_STR(arena, name, node) \
@@ -902,19 +1879,157 @@ TemplateNode init_template_node__(const char *file, const char *func, int line,
 #define init_template_node(arena, type) \
     init_template_node__(__FILE__, __func__, __LINE__, arena, type)
 
-#define TEMPLATE_NODE_DISPOSABLE_JSON(node) __extension__ ({ \
-    Arena *debug_arena = DISPOSABLE_ARENA; \
-    const char *json_str = TEMPLATE_NODE_TO_JSON_STR(debug_arena, &node); \
-    Json *json = json_parse(debug_arena, &json_str); \
-    arena_strdup(debug_arena, JSON_TO_PRETTY_STR(debug_arena, json)); \
-})
+#define TEMPLATE_NODE_DISPOSABLE_JSON(node) \
+    template_node_to_pretty_json_str__(__FILE__, __func__, __LINE__, DISPOSABLE_ARENA, &node)
 
-#define TEMPLATE_NODE_PRETTY_JSON(node, arena) __extension__ ({ \
-    Arena *debug_arena = DISPOSABLE_ARENA; \
-    const char *json_str = TEMPLATE_NODE_TO_JSON_STR(debug_arena, &node); \
-    Json *json = json_parse(debug_arena, &json_str); \
-    arena_strdup(arena, JSON_TO_PRETTY_STR(debug_arena, json)); \
-})
+#define TEMPLATE_NODE_PRETTY_JSON(node, arena) \
+    template_node_to_pretty_json_str__(__FILE__, __func__, __LINE__, arena, &node)
+
+// ----------------------
+// -- Type descriptors --
+// ----------------------
+
+/*
+ * Compile-time reflection: a table per struct or union listing each field
+ * with its name, offset and kind. One generic walker per output reads the
+ * table, so debug dumps, JSON and structural hashes need no varargs and
+ * no reparsing, and every described type gets all three.
+ *
+ * Conventions the walkers rely on:
+ *   - Fields are written in table order; fields left out are not shown.
+ *   - TYPE_ENUM fields are read as int.
+ *   - A union is reached through a field that names the int-sized tag in
+ *     its owner; each union member carries the tag value that selects it.
+ *   - At most one TYPE_FIELD_NEXT per struct, listed last, linking to the
+ *     same type. Chains are walked in a loop, not by recursion, and come
+ *     out as one JSON array.
+ *   - TYPE_POINTER fields are addresses: shown in dumps, left out of JSON
+ *     and hashes.
+ *
+ * Describing a user type:
+ *
+ *   typedef struct Point { int x; char *label; struct Point *next; } Point;
+ *   static const char *point_kind_name(int value) { ... }
+ *
+ *   extern const TypeDescriptor point_descriptor;
+ *   static const TypeField point_fields[] = {
+ *       TYPE_FIELD(Point, x, TYPE_INT),
+ *       TYPE_FIELD(Point, label, TYPE_STRING),
+ *       TYPE_FIELD_NEXT(Point, next, &point_descriptor),
+ *   };
+ *   const TypeDescriptor point_descriptor = TYPE_STRUCT(Point, point_fields);
+ *
+ *   TYPE_TO_DEBUG_STR(arena, &point_descriptor, "point", &point);
+ */
+typedef enum {
+    TYPE_INT,
+    TYPE_INT64,
+    TYPE_SIZE_T,
+    TYPE_FLOAT,
+    TYPE_DOUBLE,
+    TYPE_BOOL,      // int, written true/false
+    TYPE_CHAR,
+    TYPE_STRING,    // char *, NUL-terminated or NULL
+    TYPE_BYTES,     // void * of `length` bytes, length read from the size_t at length_offset
+    TYPE_POINTER,
+    TYPE_ENUM,
+    TYPE_REF,       // Pointer to a described type
+    TYPE_INLINE,    // Described type embedded in place
+    TYPE_CUSTOM,    // Written by the field's hooks
+} TypeFieldKind;
+
+typedef struct TypeDescriptor TypeDescriptor;
+
+/* Outputs of a TYPE_CUSTOM field; owner is the struct or union holding it */
+typedef struct {
+    void (*write_debug)(DebugWriter *writer, const char *name, const void *owner);
+    void (*write_json)(JsonWriter *writer, const void *owner);
+    uint64_t (*hash)(uint64_t state, const void *owner);
+} TypeFieldHooks;
+
+#define TYPE_NO_TAG ((size_t)-1)
+
+typedef struct {
+    const char *name;
+    size_t offset;
+    TypeFieldKind kind;
+    const TypeDescriptor *type;        // TYPE_REF, TYPE_INLINE
+    const char *(*enum_name)(int value);  // TYPE_ENUM
+    size_t tag_offset;                 // Union targets: the tag in the owner, else TYPE_NO_TAG
+    size_t length_offset;              // TYPE_BYTES
+    int variant;                       // Union members: tag value selecting this member
+    bool next;                         // Sibling link, see TYPE_FIELD_NEXT
+    const TypeFieldHooks *hooks;       // TYPE_CUSTOM
+} TypeField;
+
+struct TypeDescriptor {
+    const char *name;
+    size_t size;
+    bool is_union;
+    const TypeField *fields;
+    size_t field_count;
+};
+
+#define TYPE_FIELD_BASE(owner, field) .name = #field, .offset = offsetof(owner, field), .tag_offset = TYPE_NO_TAG
+
+#define TYPE_FIELD(owner, field, field_kind) \
+    { TYPE_FIELD_BASE(owner, field), .kind = field_kind }
+#define TYPE_FIELD_ENUM(owner, field, to_name) \
+    { TYPE_FIELD_BASE(owner, field), .kind = TYPE_ENUM, .enum_name = to_name }
+#define TYPE_FIELD_BYTES(owner, field, length_field) \
+    { TYPE_FIELD_BASE(owner, field), .kind = TYPE_BYTES, .length_offset = offsetof(owner, length_field) }
+#define TYPE_FIELD_REF(owner, field, descriptor) \
+    { TYPE_FIELD_BASE(owner, field), .kind = TYPE_REF, .type = descriptor }
+#define TYPE_FIELD_INLINE(owner, field, descriptor) \
+    { TYPE_FIELD_BASE(owner, field), .kind = TYPE_INLINE, .type = descriptor }
+#define TYPE_FIELD_NEXT(owner, field, descriptor) \
+    { TYPE_FIELD_BASE(owner, field), .kind = TYPE_REF, .type = descriptor, .next = true }
+#define TYPE_FIELD_CUSTOM(owner, field, field_hooks) \
+    { TYPE_FIELD_BASE(owner, field), .kind = TYPE_CUSTOM, .hooks = field_hooks }
+
+// A union reached through field, its active member chosen by owner's tag
+#define TYPE_FIELD_UNION_REF(owner, field, descriptor, tag) \
+    { .name = #field, .offset = offsetof(owner, field), .kind = TYPE_REF, .type = descriptor, .tag_offset = offsetof(owner, tag) }
+#define TYPE_FIELD_UNION_INLINE(owner, field, descriptor, tag) \
+    { .name = #field, .offset = offsetof(owner, field), .kind = TYPE_INLINE, .type = descriptor, .tag_offset = offsetof(owner, tag) }
+
+// Union members: as above, with the tag value that makes them active
+#define TYPE_MEMBER(owner, field, field_kind, tag_value) \
+    { TYPE_FIELD_BASE(owner, field), .kind = field_kind, .variant = tag_value }
+#define TYPE_MEMBER_REF(owner, field, descriptor, tag_value) \
+    { TYPE_FIELD_BASE(owner, field), .kind = TYPE_REF, .type = descriptor, .variant = tag_value }
+#define TYPE_MEMBER_INLINE(owner, field, descriptor, tag_value) \
+    { TYPE_FIELD_BASE(owner, field), .kind = TYPE_INLINE, .type = descriptor, .variant = tag_value }
+#define TYPE_MEMBER_CUSTOM(owner, field, field_hooks, tag_value) \
+    { TYPE_FIELD_BASE(owner, field), .kind = TYPE_CUSTOM, .hooks = field_hooks, .variant = tag_value }
+
+#define TYPE_STRUCT(type, field_table) \
+    { .name = #type, .size = sizeof(type), .is_union = false, .fields = field_table, .field_count = sizeof(field_table) / sizeof((field_table)[0]) }
+#define TYPE_UNION(type, field_table) \
+    { .name = #type, .size = sizeof(type), .is_union = true, .fields = field_table, .field_count = sizeof(field_table) / sizeof((field_table)[0]) }
+
+extern const TypeDescriptor json_descriptor;
+extern const TypeDescriptor log_rule_descriptor;
+extern const TypeDescriptor slice_descriptor;
+extern const TypeDescriptor template_node_descriptor;
+
+// value points at a described struct; the layout of the STRUCT_TO_DEBUG_STR family
+void type_write_debug(DebugWriter *writer, const TypeDescriptor *type, const char *name, const void *value);
+
+// An object per struct, an array per sibling chain; a revisited pointer is written as null
+void type_write_json(JsonWriter *writer, PtrSet *visited, const TypeDescriptor *type, const void *value);
+
+// Equal for values that dump the same, addresses aside; arena holds the visited set
+uint64_t type_hash__(const char *file, const char *func, int line, Arena *arena, const TypeDescriptor *type, const void *value);
+
+char *type_to_debug_str__(const char *file, const char *func, int line, Arena *arena, const TypeDescriptor *type, const char *name, const void *value, PtrSet *visited);
+char *type_to_json_str__(const char *file, const char *func, int line, Arena *arena, const TypeDescriptor *type, const void *value, int indent);
+
+#define TYPE_TO_DEBUG_STR(arena, type, name, value) \
+    type_to_debug_str__(__FILE__, __func__, __LINE__, arena, type, name, value, ptrset_init(arena))
+#define TYPE_TO_JSON_STR(arena, type, value, indent) \
+    type_to_json_str__(__FILE__, __func__, __LINE__, arena, type, value, indent)
+#define type_hash(arena, type, value) type_hash__(__FILE__, __func__, __LINE__, arena, type, value)
 
 // --------------
 // -- Colorize --
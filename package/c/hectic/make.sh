@@ -1,9 +1,11 @@
 #!/bin/sh
-# Usage: make.sh [build|check[test1 test2 ...]] [--norun] [--debug] [--color] [--no-asan]
+# Usage: make.sh [build|check[test1 test2 ...]|bench [args ...]] [--norun] [--debug] [--color] [--no-asan]
 # Options:
 #   build         Build the library and app (default if no mode is provided).
 #   watch         Build the library and app and watch for changes.
 #   check         Build tests; runs them unless --norun is specified.
+#   bench         Build the JSON benchmark without sanitizers and run it;
+#                 remaining arguments go to the benchmark (see bench/json.c).
 #   --norun       (check only) Build tests but do not run them.
 #   --debug       Build with -O0 (debug mode).
 #   --color       Pass -fdiagnostics-color=always to compiler.
@@ -31,10 +33,12 @@ check_dependencies
 
 print_help() {
   cat <<EOF
-Usage: $0 [build|check[test1 test2 ...]] [--norun] [--debug] [--color] [--no-asan]
+Usage: $0 [build|check[test1 test2 ...]|bench [args ...]] [--norun] [--debug] [--color] [--no-asan]
   build         Build the library and app (default).
   watch         Build the library and app and watch for changes.
   check         Build tests; runs them unless --norun is specified.
+  bench         Build the JSON benchmark without sanitizers and run it.
+                  [--save] [--baseline FILE] [--tolerance PERCENT] [DIR ...]
   --norun       (check only) Build tests but do not run them.
   --debug       Build with debug flags (-O0).
   --color       Force colored compiler diagnostics.
@@ -55,7 +59,7 @@ esac
 # Default flags
 RUN_TESTS=1
 OPTFLAGS="-O2"
-CFLAGS="-Wall -Wextra -Werror -pedantic -fsanitize=address -fanalyzer"
+CFLAGS="-Wall -Wextra -Werror -pedantic -pthread -fsanitize=address -fanalyzer"
 LDFLAGS="-lhectic -static-libasan"
 STD_FLAGS="-std=c99"
 COLOR_FLAG=""
@@ -177,6 +181,17 @@ case "$MODE" in
       fi
     done
     ;;
+  bench)
+    mkdir -p target/bench
+    echo "# Build benchmark"
+    # Sanitizers and the analyzer would dominate the timings, so the library
+    # is rebuilt here with the optimisation flags only
+    # shellcheck disable=SC2086
+    cc $OPTFLAGS $STD_FLAGS $COLOR_FLAG -pthread -c hectic.c -o target/bench/hectic.o || exit 1
+    # shellcheck disable=SC2086
+    cc $OPTFLAGS $COLOR_FLAG -pthread -I. bench/json.c target/bench/hectic.o -o target/bench/json || exit 1
+    target/bench/json "$@"
+    ;;
   *)
     print_help
     exit 1
@@ -188,6 +188,154 @@
     logger_free();                                                                     \
 } while(0)
 
+#define TEST_KV_FORMAT(FORMAT, EXPECTED_FMT, ...) do {                               \
+    FILE *orig_stderr = stderr;                                                     \
+    FILE *temp = tmpfile();                                                         \
+    char result_buffer[512];                                                        \
+    if (!temp) { perror("tmpfile"); exit(EXIT_FAILURE); }                           \
+    stderr = temp;                                                                  \
+    logger_level(LOG_LEVEL_INFO);                                                   \
+    logger_set_format(FORMAT);                                                      \
+    const char* time_str = raise_kv(LOG_LEVEL_INFO, __VA_ARGS__);                  \
+    logger_set_format(LOG_FORMAT_TEXT);                                             \
+    logger_level_reset();                                                           \
+    fflush(stderr);                                                                 \
+    fseek(temp, 0, SEEK_SET);                                                       \
+    size_t nread = fread(result_buffer, 1, sizeof(result_buffer)-1, temp);          \
+    result_buffer[nread] = '\0';                                                    \
+    stderr = orig_stderr;                                                           \
+    fclose(temp);                                                                   \
+    char expected_buffer[512];                                                      \
+    snprintf(expected_buffer, sizeof(expected_buffer), EXPECTED_FMT,                \
+             time_str, __FILE__, __func__, __LINE__);                               \
+    ASSERT_STR_EQ(result_buffer, expected_buffer);                                  \
+} while(0)
+
+#define TEST_FORMATTED_RAISE(FORMAT, EXPECTED_FMT) do {                              \
+    FILE *orig_stderr = stderr;                                                     \
+    FILE *temp = tmpfile();                                                         \
+    char result_buffer[512];                                                        \
+    if (!temp) { perror("tmpfile"); exit(EXIT_FAILURE); }                           \
+    stderr = temp;                                                                  \
+    logger_level(LOG_LEVEL_INFO);                                                   \
+    logger_set_format(FORMAT);                                                      \
+    const char* time_str = raise_warn("disk %d%% full\tat %s", 93, "/var");        \
+    logger_set_format(LOG_FORMAT_TEXT);                                             \
+    logger_level_reset();                                                           \
+    fflush(stderr);                                                                 \
+    fseek(temp, 0, SEEK_SET);                                                       \
+    size_t nread = fread(result_buffer, 1, sizeof(result_buffer)-1, temp);          \
+    result_buffer[nread] = '\0';                                                    \
+    stderr = orig_stderr;                                                           \
+    fclose(temp);                                                                   \
+    char expected_buffer[512];                                                      \
+    snprintf(expected_buffer, sizeof(expected_buffer), EXPECTED_FMT,                \
+             time_str, __FILE__, __func__, __LINE__);                               \
+    ASSERT_STR_EQ(result_buffer, expected_buffer);                                  \
+} while(0)
+
+static void test_structured_logging(void) {
+    TEST_KV_FORMAT(LOG_FORMAT_JSON,
+        "{\"time\":\"%s\",\"level\":\"INFO\",\"file\":\"%s\",\"func\":\"%s\",\"line\":%d,"
+        "\"msg\":\"user \\\"logged\\\" in\",\"user\":\"al ice\",\"id\":-42,\"ok\":true,\"rate\":0.5,\"bytes\":18446744073709551615,\"note\":null}\n",
+        "user \"logged\" in", KV_STR("user", "al ice"), KV_INT("id", -42), KV_BOOL("ok", 1), KV_FLOAT("rate", 0.5),
+        KV_UINT("bytes", 18446744073709551615ULL), KV_STR("note", NULL));
+
+    TEST_KV_FORMAT(LOG_FORMAT_LOGFMT,
+        "time=\"%s\" level=INFO file=%s func=%s line=%d msg=\"user \\\"logged\\\" in\" user=\"al ice\" id=-42 ok=true\n",
+        "user \"logged\" in", KV_STR("user", "al ice"), KV_INT("id", -42), KV_BOOL("ok", 1));
+
+    TEST_KV_FORMAT(LOG_FORMAT_TEXT,
+        "%s INFO %s:%s:%d user \"logged\" in user=bob id=7\n",
+        "user \"logged\" in", KV_STR("user", "bob"), KV_INT("id", 7));
+
+    // A message alone, with no fields after it
+    TEST_KV_FORMAT(LOG_FORMAT_JSON,
+        "{\"time\":\"%s\",\"level\":\"INFO\",\"file\":\"%s\",\"func\":\"%s\",\"line\":%d,\"msg\":\"started\"}\n",
+        "started");
+
+    // Existing printf-style calls are encoded the same way
+    TEST_FORMATTED_RAISE(LOG_FORMAT_JSON,
+        "{\"time\":\"%s\",\"level\":\"WARN\",\"file\":\"%s\",\"func\":\"%s\",\"line\":%d,\"msg\":\"disk 93%% full\\tat /var\"}\n");
+    TEST_FORMATTED_RAISE(LOG_FORMAT_LOGFMT,
+        "time=\"%s\" level=WARN file=%s func=%s line=%d msg=\"disk 93%% full\\tat /var\"\n");
+}
+
+/* Logs message (and field) in format and returns the line that came out on stderr */
+static char *capture_long_line(LogFormat format, const char *message, const LogKv *field, char *out, size_t size) {
+    FILE *orig_stderr = stderr;
+    FILE *temp = tmpfile();
+    if (!temp) { perror("tmpfile"); exit(EXIT_FAILURE); }
+    stderr = temp;
+    logger_level(LOG_LEVEL_INFO);
+    logger_set_format(format);
+    if (field) raise_kv_message(LOG_LEVEL_INFO, __FILE__, __func__, __LINE__, message, field, 1);
+    else raise_info("%s", message);
+    logger_set_format(LOG_FORMAT_TEXT);
+    logger_level_reset();
+    fflush(stderr);
+    fseek(temp, 0, SEEK_SET);
+    size_t nread = fread(out, 1, size - 1, temp);
+    out[nread] = '\0';
+    stderr = orig_stderr;
+    fclose(temp);
+    return out;
+}
+
+static void test_long_lines(void) {
+    // Over 4 KiB of text with escapes and two-byte characters all the way through
+    enum { MESSAGE_LEN = 6000 };
+    char *message = malloc(MESSAGE_LEN + 1);
+    char *out = malloc(4 * MESSAGE_LEN);
+    assert(message && out);
+    for (size_t i = 0; i < MESSAGE_LEN; i += 6) memcpy(message + i, "ab\"\xc3\xa9\n", 6);
+    message[MESSAGE_LEN] = '\0';
+    Arena arena = arena_init(MEM_MiB);
+
+    LogFormat formats[] = { LOG_FORMAT_JSON, LOG_FORMAT_LOGFMT, LOG_FORMAT_TEXT };
+    for (size_t f = 0; f < 3; f++) {
+        // Every start that is not inside the two-byte character, so the cut lands everywhere
+        for (size_t shift = 0; shift < 6; shift++) {
+            if (shift == 4) continue;
+            capture_long_line(formats[f], message + shift, NULL, out, 4 * MESSAGE_LEN);
+            size_t len = strlen(out);
+            assert(len > 0 && len < 4096 && out[len - 1] == '\n');
+            assert(strchr(out, '\n') == out + len - 1 || formats[f] == LOG_FORMAT_TEXT);
+            if (formats[f] != LOG_FORMAT_JSON) continue;
+
+            // Still one JSON object, its msg cut short and closed
+            out[len - 1] = '\0';
+            JsonResult parsed = json_parse_view(&arena, view_create(out, len - 1, sizeof(char)), NULL);
+            assert(IS_RESULT_SOME(parsed));
+            const char *msg = json_get_object_item(parsed.Result.some, "msg")->value.string;
+            assert(strlen(msg) > 2000 && strncmp(msg, message + shift, strlen(msg)) == 0);
+        }
+    }
+
+    // A field that does not fit is left out whole
+    LogKv big = KV_STR("payload", message);
+    capture_long_line(LOG_FORMAT_JSON, "short", &big, out, 4 * MESSAGE_LEN);
+    size_t len = strlen(out);
+    out[len - 1] = '\0';
+    JsonResult parsed = json_parse_view(&arena, view_create(out, len - 1, sizeof(char)), NULL);
+    assert(IS_RESULT_SOME(parsed));
+    assert(strcmp(json_get_object_item(parsed.Result.some, "msg")->value.string, "short") == 0);
+    assert(!json_get_object_item(parsed.Result.some, "payload"));
+
+    // Keys longer than 255 bytes keep their full length
+#define KEY_10 "kkkkkkkkkk"
+#define KEY_100 KEY_10 KEY_10 KEY_10 KEY_10 KEY_10 KEY_10 KEY_10 KEY_10 KEY_10 KEY_10
+    LogKv wide = KV_INT(KEY_100 KEY_100 KEY_100, 1);
+    capture_long_line(LOG_FORMAT_JSON, "wide", &wide, out, 4 * MESSAGE_LEN);
+    assert(strstr(out, ",\"" KEY_100 KEY_100 KEY_100 "\":1}"));
+    capture_long_line(LOG_FORMAT_LOGFMT, "wide", &wide, out, 4 * MESSAGE_LEN);
+    assert(strstr(out, " " KEY_100 KEY_100 KEY_100 "=1\n"));
+
+    arena_free(&arena);
+    free(out);
+    free(message);
+}
+
 int main(void) {
     debug_color_mode = COLOR_MODE_DISABLE;
     printf("%sRunning %s%s%s\n", OPTIONAL_COLOR(COLOR_GREEN), OPTIONAL_COLOR(COLOR_CYAN), __FILE__,  OPTIONAL_COLOR(COLOR_RESET));
@@ -212,6 +360,14 @@ int main(void) {
     
     TEST_MODE_SWITCHING();
 
+    printf("%sTesting structured logging...%s\n", OPTIONAL_COLOR(COLOR_CYAN), OPTIONAL_COLOR(COLOR_RESET));
+
+    test_structured_logging();
+
+    printf("%sTesting lines longer than LOG_LINE_MAX...%s\n", OPTIONAL_COLOR(COLOR_CYAN), OPTIONAL_COLOR(COLOR_RESET));
+
+    test_long_lines();
+
     printf("%sall tests passed.%s%s%s\n", OPTIONAL_COLOR(COLOR_GREEN), OPTIONAL_COLOR(COLOR_CYAN), __FILE__, OPTIONAL_COLOR(COLOR_RESET));
     return 0;
 }
\ No newline at end of file
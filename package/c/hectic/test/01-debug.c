@@ -1,5 +1,11 @@
 #include "hectic.h"
 #include <assert.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 typedef struct Struct Struct;
 
@@ -150,6 +156,179 @@ void test_debug_to_indented_str(Arena *arena) {
     assert(strcmp(indented, expected) == 0);
 }
 
+typedef struct {
+    TestUnionVariant kind;
+    TestUnion value;
+} Tagged;
+
+extern const TypeDescriptor struct_descriptor;
+static const TypeField struct_fields[] = {
+    TYPE_FIELD(Struct, a, TYPE_INT),
+    TYPE_FIELD(Struct, b, TYPE_INT),
+    TYPE_FIELD_NEXT(Struct, next, &struct_descriptor),
+};
+const TypeDescriptor struct_descriptor = TYPE_STRUCT(Struct, struct_fields);
+
+static const TypeField test_union_fields[] = {
+    TYPE_MEMBER(TestUnion, a, TYPE_INT, TEST_UNION_VARIANT_A),
+    TYPE_MEMBER(TestUnion, b, TYPE_STRING, TEST_UNION_VARIANT_B),
+    TYPE_MEMBER(TestUnion, c, TYPE_FLOAT, TEST_UNION_VARIANT_C),
+};
+static const TypeDescriptor test_union_descriptor = TYPE_UNION(TestUnion, test_union_fields);
+
+static const TypeField tagged_fields[] = {
+    TYPE_FIELD(Tagged, kind, TYPE_INT),
+    TYPE_FIELD_UNION_INLINE(Tagged, value, &test_union_descriptor, kind),
+};
+static const TypeDescriptor tagged_descriptor = TYPE_STRUCT(Tagged, tagged_fields);
+
+void test_type_descriptors(Arena *arena) {
+    // Table-driven dumps match the hand-written ones, cycle included
+    Struct cyclic = {.a = 1, .b = 2, .next = NULL};
+    cyclic.next = &cyclic;
+    char *by_table = TYPE_TO_DEBUG_STR(arena, &struct_descriptor, "struct", &cyclic);
+    char *by_hand = struct_to_debug_str(arena, "struct", &cyclic, ptrset_init(arena));
+    assert(strcmp(by_table, by_hand) == 0);
+
+    Tagged tagged = {.kind = TEST_UNION_VARIANT_A, .value = {.a = 7}};
+    char *union_by_hand = test_union_to_debug_str(arena, "value", &tagged.value, ptrset_init(arena), TEST_UNION_VARIANT_A);
+    assert(strstr(TYPE_TO_DEBUG_STR(arena, &tagged_descriptor, "tagged", &tagged), union_by_hand) != NULL);
+
+    // Chains become arrays, unions an object holding the active member
+    Struct third = {.a = 5, .b = 6, .next = NULL};
+    Struct second = {.a = 3, .b = 4, .next = &third};
+    Struct first = {.a = 1, .b = 2, .next = &second};
+    assert(strcmp(TYPE_TO_JSON_STR(arena, &struct_descriptor, &first, 0),
+                  "[{\"a\":1,\"b\":2},{\"a\":3,\"b\":4},{\"a\":5,\"b\":6}]") == 0);
+    assert(strcmp(TYPE_TO_JSON_STR(arena, &tagged_descriptor, &tagged, 0), "{\"kind\":0,\"value\":{\"a\":7}}") == 0);
+    Tagged text = {.kind = TEST_UNION_VARIANT_B, .value = {.b = "hi"}};
+    assert(strcmp(TYPE_TO_JSON_STR(arena, &tagged_descriptor, &text, 0), "{\"kind\":1,\"value\":{\"b\":\"hi\"}}") == 0);
+    // A cyclic chain stops where it loops
+    assert(strcmp(TYPE_TO_JSON_STR(arena, &struct_descriptor, &cyclic, 0), "[{\"a\":1,\"b\":2}]") == 0);
+
+    // Hashes follow content, not addresses
+    Struct other_third = third, other_second = second, other_first = first;
+    other_second.next = &other_third;
+    other_first.next = &other_second;
+    uint64_t hash = type_hash(arena, &struct_descriptor, &first);
+    assert(hash == type_hash(arena, &struct_descriptor, &other_first));
+    other_third.b = 7;
+    assert(hash != type_hash(arena, &struct_descriptor, &other_first));
+    assert(type_hash(arena, &struct_descriptor, &first) != type_hash(arena, &struct_descriptor, &second));
+    assert(type_hash(arena, &tagged_descriptor, &tagged) != type_hash(arena, &tagged_descriptor, &text));
+
+    // Built-in types are described too
+    const char *json = "{\"a\":[1,\"x\"]}";
+    Json *root = json_parse(arena, &json);
+    assert(strcmp(TYPE_TO_JSON_STR(arena, &json_descriptor, root, 0),
+                  "[{\"type\":\"OBJECT\",\"key\":null,\"value\":{\"child\":[{\"type\":\"ARRAY\",\"key\":\"a\",\"value\":{\"child\":["
+                  "{\"type\":\"INTEGER\",\"key\":null,\"value\":{\"integer\":1}},"
+                  "{\"type\":\"STRING\",\"key\":null,\"value\":{\"string\":\"x\"}}]}}]}}]") == 0);
+    char bytes[] = "abc";
+    Slice slice = {.data = bytes, .len = 3, .isize = 1};
+    assert(strcmp(TYPE_TO_JSON_STR(arena, &slice_descriptor, &slice, 0), "{\"data\":\"abc\",\"len\":3,\"isize\":1}") == 0);
+}
+
+void test_ptrset(Arena *arena) {
+    enum { COUNT = 4000 };
+    Struct *items = arena_alloc(arena, COUNT * sizeof(Struct));
+    PtrSet *visited = ptrset_init(arena);
+
+    for (int i = 0; i < COUNT; i++) {
+        debug_ptrset_add__(__FILE__, __func__, __LINE__, arena, visited, &items[i], "Struct", "next");
+    }
+    // Adding again is a no-op
+    debug_ptrset_add__(__FILE__, __func__, __LINE__, arena, visited, &items[0], "Struct", "next");
+    assert(visited->size == COUNT);
+
+    for (int i = 0; i < COUNT; i++) {
+        assert(debug_ptrset_contains__(visited, &items[i], "Struct", "next"));
+    }
+    // The same pointer under another field or type is a separate entry
+    assert(!debug_ptrset_contains__(visited, &items[0], "Struct", "other"));
+    assert(!debug_ptrset_contains__(visited, &items[0], "Struct2", "next"));
+    debug_ptrset_add__(__FILE__, __func__, __LINE__, arena, visited, &items[0], "Struct", "other");
+    assert(debug_ptrset_contains__(visited, &items[0], "Struct", "other"));
+    assert(visited->size == COUNT + 1);
+
+    // Names compare by content, not by address
+    char type[] = "Struct", field[] = "next";
+    assert(debug_ptrset_contains__(visited, &items[COUNT - 1], type, field));
+    assert(!debug_ptrset_contains__(visited, (char *)&items[COUNT - 1] + 1, type, field));
+}
+
+static void *probe_readable(void *arg) {
+    const char *page = arg;
+    int local = 0;
+    for (int i = 0; i < 1000; i++) {
+        if (!is_readable(&local) || is_readable(page) || is_readable(NULL)) return NULL;
+    }
+    return (void *)1;
+}
+
+static void counting_handler(int sig) { (void)sig; }
+
+/* The non-blocking pipe is_readable probes through: read end in fds[0], write end in fds[1] */
+static bool find_probe_pipe(int fds[2]) {
+    fds[0] = fds[1] = -1;
+    for (int fd = 3; fd < 1024; fd++) {
+        struct stat st;
+        int flags = fcntl(fd, F_GETFL);
+        if (flags < 0 || !(flags & O_NONBLOCK) || fstat(fd, &st) != 0 || !S_ISFIFO(st.st_mode)) continue;
+        fds[(flags & O_ACCMODE) == O_WRONLY] = fd;
+    }
+    return fds[0] >= 0 && fds[1] >= 0;
+}
+
+void test_is_readable(void) {
+    int local = 42;
+    assert(is_readable(&local));
+    assert(is_readable("literal"));
+    assert(!is_readable(NULL));
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    int zero = open("/dev/zero", O_RDONLY);
+    char *page = mmap(NULL, page_size, PROT_NONE, MAP_PRIVATE, zero, 0);
+    assert(page != MAP_FAILED);
+    close(zero);
+    assert(!is_readable(page));
+    assert(!is_readable(page + page_size - 1));
+
+    // A SIGSEGV handler installed by the caller is left alone
+    struct sigaction mine = {0}, seen;
+    mine.sa_handler = counting_handler;
+    sigemptyset(&mine.sa_mask);
+    assert(sigaction(SIGSEGV, &mine, NULL) == 0);
+    assert(!is_readable(page));
+    assert(sigaction(SIGSEGV, NULL, &seen) == 0);
+    assert(seen.sa_handler == counting_handler);
+    signal(SIGSEGV, SIG_DFL);
+
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++) assert(pthread_create(&threads[i], NULL, probe_readable, page) == 0);
+    for (int i = 0; i < 4; i++) {
+        void *ok;
+        pthread_join(threads[i], &ok);
+        assert(ok);
+    }
+
+    // A failed probe is no answer: it must not be remembered as readable
+    int fds[2];
+    zero = open("/dev/zero", O_RDONLY);
+    char *mapped = mmap(NULL, page_size, PROT_READ, MAP_PRIVATE, zero, 0);
+    close(zero);
+    assert(mapped != MAP_FAILED && find_probe_pipe(fds));
+    char filler[4096] = {0};
+    while (write(fds[1], filler, sizeof(filler)) > 0) {}
+    while (write(fds[1], filler, 1) > 0) {}
+    assert(is_readable(mapped));
+    while (read(fds[0], filler, sizeof(filler)) > 0) {}
+    assert(mprotect(mapped, page_size, PROT_NONE) == 0);
+    assert(!is_readable(mapped));
+    munmap(mapped, page_size);
+    munmap(page, page_size);
+}
+
 int main(void) {
     printf("%sRunning %s%s%s\n", OPTIONAL_COLOR(COLOR_GREEN), OPTIONAL_COLOR(COLOR_CYAN), __FILE__,  OPTIONAL_COLOR(COLOR_RESET));
     debug_color_mode = COLOR_MODE_DISABLE;
@@ -169,6 +348,15 @@ int main(void) {
     printf("%sTesting debug_to_indented_str%s\n", OPTIONAL_COLOR(COLOR_GREEN), OPTIONAL_COLOR(COLOR_RESET));
     test_debug_to_indented_str(&arena);
 
+    printf("%sTesting ptrset%s\n", OPTIONAL_COLOR(COLOR_GREEN), OPTIONAL_COLOR(COLOR_RESET));
+    test_ptrset(&arena);
+
+    printf("%sTesting type descriptors%s\n", OPTIONAL_COLOR(COLOR_GREEN), OPTIONAL_COLOR(COLOR_RESET));
+    test_type_descriptors(&arena);
+
+    printf("%sTesting is_readable%s\n", OPTIONAL_COLOR(COLOR_GREEN), OPTIONAL_COLOR(COLOR_RESET));
+    test_is_readable();
+
     arena_free(&arena);
     logger_free();
     printf("%sAll tests passed %s%s%s\n", OPTIONAL_COLOR(COLOR_GREEN), OPTIONAL_COLOR(COLOR_CYAN), __FILE__, OPTIONAL_COLOR(COLOR_RESET));
@@ -11,6 +11,17 @@ void test_parse_rules(Arena *arena) {
     assert(result.type != RESULT_ERROR);
 
     raise_notice("result.some: %s", LOG_RULES_TO_DEBUG_STR(arena, "result.some", &RESULT_SOME_VALUE(result)));
+
+    const char *json = LOG_RULES_TO_JSON_STR(arena, &RESULT_SOME_VALUE(result), 0);
+    raise_notice("json: %s", json);
+    assert(strcmp(json,
+        "[{\"level\":\"INFO\",\"file_pattern\":\"02-logger-rules.c\",\"function_pattern\":null,\"line_start\":5,\"line_end\":13},"
+        "{\"level\":\"NOTICE\",\"file_pattern\":\"hectic.c\",\"function_pattern\":\"arena_alloc__\",\"line_start\":-1,\"line_end\":-1}]") == 0);
+
+    // Pretty output is the same document laid out like JSON_TO_PRETTY_STR
+    const char *cursor = json;
+    Json *parsed = json_parse(arena, &cursor);
+    assert(strcmp(LOG_RULES_TO_JSON_STR(arena, &RESULT_SOME_VALUE(result), 2), JSON_TO_PRETTY_STR(arena, parsed)) == 0);
 }
 
 int main(void) {
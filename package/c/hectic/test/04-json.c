@@ -3,6 +3,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <math.h>
+#include <sys/stat.h>
 #include "hectic.h"
 
 #define ARENA_SIZE 1024 * 1024
@@ -25,8 +29,8 @@ static void test_parse_json_object(Arena *arena) {
 static void test_parse_json_number(Arena *arena) {
     const char *json = "42";
     Json *root = json_parse(arena, &json);
-    assert(root->type == JSON_NUMBER);
-    assert(root->value.number == 42);
+    assert(root->type == JSON_INTEGER);
+    assert(root->value.integer == 42);
 }
 
 // Test 3: Parse JSON string.
@@ -45,8 +49,8 @@ static void test_get_object_items(Arena *arena) {
     assert(item_a && item_a->type == JSON_STRING);
     assert(strcmp(item_a->value.string, "1") == 0);
     Json *item_b = json_get_object_item(root, "b");
-    assert(item_b && item_b->type == JSON_NUMBER);
-    assert(item_b->value.number == 2);
+    assert(item_b && item_b->type == JSON_INTEGER);
+    assert(item_b->value.integer == 2);
 }
 
 // Test 5: Print JSON object.
@@ -90,8 +94,8 @@ static void test_nested_json_object(Arena *arena) {
 
     Json *inner = json_get_object_item(outer, "inner");
     assert(inner != NULL);
-    assert(inner->type == JSON_NUMBER);
-    assert(inner->value.number == 100);
+    assert(inner->type == JSON_INTEGER);
+    assert(inner->value.integer == 100);
 
 }
 
@@ -108,15 +112,1448 @@ static void test_arena_reset_reuse(Arena *arena) {
     assert(strcmp(printed2, "\"another test\"") == 0);
 }
 
-// FIXME: SIGFAULT
-//static void test_json_to_debug_str(Arena *arena) {
-//    const char *json = "{\"key\":\"value\", \"num\":3.14}";
-//    Json *root = json_parse(arena, &json);
-//    raise_notice("root: %s", json_to_string(DISPOSABLE_ARENA, root));
-//    char *debug_str = JSON_TO_DEBUG_STR(arena, "root", root);
-//    raise_notice("debug_str: %s", debug_str);
-//    assert(strcmp(debug_str, "struct Json root = {type = JSON_OBJECT, key = \"key\", value = struct JsonValue = {string = \"value\"}, next = NULL}") == 0);
-//}
+static bool json_tree_equal(const Json *a, const Json *b) {
+    for (; a && b; a = a->next, b = b->next) {
+        if (a->type != b->type) return false;
+        if ((a->key == NULL) != (b->key == NULL)) return false;
+        if (a->key && strcmp(a->key, b->key) != 0) return false;
+        switch (a->type) {
+            case JSON_STRING:
+            case JSON_RAW_NUMBER:
+                if ((a->value.string == NULL) != (b->value.string == NULL)) return false;
+                if (a->value.string && strcmp(a->value.string, b->value.string) != 0) return false;
+                break;
+            case JSON_NUMBER:
+                if (memcmp(&a->value.number, &b->value.number, sizeof(double)) != 0) return false;
+                break;
+            case JSON_INTEGER:
+                if (a->value.integer != b->value.integer) return false;
+                break;
+            case JSON_BOOL:
+                if (a->value.boolean != b->value.boolean) return false;
+                break;
+            case JSON_ARRAY:
+            case JSON_OBJECT:
+                if (!json_tree_equal(a->value.child, b->value.child)) return false;
+                break;
+            default:
+                break;
+        }
+    }
+    return a == b;
+}
+
+static void assert_engines_agree(Arena *arena, const char *doc) {
+    JsonParseOptions recursive = { .engine = JSON_PARSER_RECURSIVE };
+    JsonParseOptions structural = { .engine = JSON_PARSER_STRUCTURAL };
+    const char *expected_end = doc;
+    JsonResult expected = json_parse_with_opts(arena, &expected_end, &recursive);
+
+    for (int level = SIMD_LEVEL_SCALAR; level <= (int)simd_level_detect(); level++) {
+        simd_set_level((SimdLevel)level);
+        const char *end = doc;
+        JsonResult actual = json_parse_with_opts(arena, &end, &structural);
+        if (IS_RESULT_ERROR(expected) != IS_RESULT_ERROR(actual)
+            || (IS_RESULT_SOME(expected)
+                && (end != expected_end || !json_tree_equal(expected.Result.some, actual.Result.some)))) {
+            fprintf(stderr, "engines disagree (%s) on: %.80s\n", simd_level_to_string((SimdLevel)level), doc);
+            assert(0);
+        }
+    }
+    simd_set_level(simd_level_detect());
+}
+
+// Test 10: Structural engine builds the same tree as the recursive one.
+static void test_structural_engine(Arena *arena) {
+    // Half of these documents are rejected on purpose, keep the warnings quiet
+    logger_level(LOG_LEVEL_EXCEPTION);
+
+    const char *docs[] = {
+        "", "   ", "null", "true", "false", "nullx", "42", "-1.5e3", "-", "0x1F", "\"\"", "\"abc",
+        "\"a\\\"b\"", "\"a\\\\\"", "  {\"key\":\"value\"}  trailing",
+        "[]", "{}", "[", "{", "[[", "[1,", "[1,  ", "[1", "[1 2]", "[,1]", "[1,]", "{,}",
+        "{\"a\":1,", "{\"a\"}", "{\"a\":}", "{a:1}", "[truex]", "[1.5e]", "[\"abc]", "[\"a\"x]",
+        "{\"a\":[1,{\"b\":null,\"c\":[true,false]}],\"d\":\"x,y:{z}[]\"}",
+        "[ \t\n\v\f\r1 , 2 ]", "{\"outer\":{\"inner\":100}}", "[\\\"]", "[-nan]",
+    };
+    for (size_t i = 0; i < sizeof(docs) / sizeof(docs[0]); i++) {
+        assert_engines_agree(arena, docs[i]);
+        arena_reset(arena);
+    }
+
+    // Strings, escapes and scalars straddling every position of the 64-byte blocks
+    static char doc[64 * 1024];
+    size_t len = 0;
+    len += (size_t)snprintf(doc + len, sizeof(doc) - len, "[");
+    for (int n = 0; n < 150; n++) {
+        len += (size_t)snprintf(doc + len, sizeof(doc) - len, "%s{\"k%d\":\"%.*s\\\"%.*s\\\\\",\"n\":%d.25,\"b\":[%s]}",
+                                n ? "," : "", n, n % 70, "ppppppppppppppppppppppppppppppppppppppppppppppppppppppppppppppppppppp",
+                                (n % 5) * 2, "\\\\\\\\\\\\\\\\", n, n % 2 ? "true" : "null");
+    }
+    snprintf(doc + len, sizeof(doc) - len, "]");
+    assert_engines_agree(arena, doc);
+
+    const char *parsed = doc;
+    JsonParseOptions structural = { .engine = JSON_PARSER_STRUCTURAL };
+    JsonResult result = json_parse_with_opts(arena, &parsed, &structural);
+    assert(IS_RESULT_SOME(result) && *parsed == '\0');
+
+    // Cut the document everywhere: both engines must still agree
+    for (size_t cut = 1; cut < 300; cut++) {
+        char saved = doc[cut];
+        doc[cut] = '\0';
+        assert_engines_agree(arena, doc);
+        doc[cut] = saved;
+        arena_reset(arena);
+    }
+}
+
+static Json *parse_with_engine(Arena *arena, const char *json, JsonParserEngine engine) {
+    JsonParseOptions opts = { .engine = engine };
+    JsonResult result = json_parse_with_opts(arena, &json, &opts);
+    return IS_RESULT_ERROR(result) ? NULL : result.Result.some;
+}
+
+// Test 11: Escapes are decoded, UTF-8 is validated, printers escape again.
+static void test_string_decoding(Arena *arena) {
+    struct { const char *json; const char *decoded; } valid[] = {
+        { "\"a\\\"b\\\\c\\/d\\b\\f\\n\\r\\t\"", "a\"b\\c/d\b\f\n\r\t" },
+        { "\"caf\\u00e9 \\u20AC\"", "caf\xc3\xa9 \xe2\x82\xac" },
+        { "\"\\ud83d\\ude00\"", "\xf0\x9f\x98\x80" },
+        { "\"raw \xc3\xa9 \xf0\x9f\x98\x80\"", "raw \xc3\xa9 \xf0\x9f\x98\x80" },
+    };
+    const char *invalid[] = {
+        "\"\\x\"", "\"\\u12\"", "\"\\ud83d\"", "\"\\ude00\"", "\"\\ud83d\\u0041\"", "\"\\u0000\"",
+        "\"\xff\"", "\"\xc0\xaf\"", "\"\xed\xa0\x80\"", "\"\xf4\x90\x80\x80\"", "\"\xe2\x82\"",
+        "\"abc", "\"abc\\\"", "[\"abc\\", "{\"k\\q\":1}",
+    };
+
+    // Escapes at every offset of the 16/32-byte scan windows
+    char long_json[256], long_decoded[256];
+    char filler[200];
+    memset(filler, 'x', sizeof(filler));
+
+    logger_level(LOG_LEVEL_EXCEPTION);
+    for (int level = SIMD_LEVEL_SCALAR; level <= (int)simd_level_detect(); level++) {
+        simd_set_level((SimdLevel)level);
+        for (int engine = JSON_PARSER_RECURSIVE; engine <= JSON_PARSER_STRUCTURAL; engine++) {
+            for (size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); i++) {
+                Json *root = parse_with_engine(arena, valid[i].json, (JsonParserEngine)engine);
+                assert(root && root->type == JSON_STRING);
+                assert(strcmp(root->value.string, valid[i].decoded) == 0);
+            }
+            for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+                assert(parse_with_engine(arena, invalid[i], (JsonParserEngine)engine) == NULL);
+            }
+            for (int k = 0; k < 100; k++) {
+                snprintf(long_json, sizeof(long_json), "\"%.*s\\n%.*s\xc3\xa9\"", k, filler, 100 - k, filler);
+                snprintf(long_decoded, sizeof(long_decoded), "%.*s\n%.*s\xc3\xa9", k, filler, 100 - k, filler);
+                Json *root = parse_with_engine(arena, long_json, (JsonParserEngine)engine);
+                assert(root && strcmp(root->value.string, long_decoded) == 0);
+            }
+            arena_reset(arena);
+        }
+    }
+    simd_set_level(simd_level_detect());
+
+    const char *json = "{\"k\\\"ey\":\"line\\nbreak\\u0001\"}";
+    Json *root = json_parse(arena, &json);
+    assert(root);
+    assert(strcmp(root->value.child->key, "k\"ey") == 0);
+    assert(strcmp(root->value.child->value.string, "line\nbreak\x01") == 0);
+    assert(strcmp(JSON_TO_STR(arena, root), "{\"k\\\"ey\":\"line\\nbreak\\u0001\"}") == 0);
+}
+
+typedef struct {
+    char text[1024];
+    size_t len;
+} TokenLog;
+
+static void token_log_append(TokenLog *log, const JsonToken *token) {
+    char *out = log->text + log->len;
+    size_t cap = sizeof(log->text) - log->len;
+    int n = 0;
+    switch (token->type) {
+        case JSON_TOKEN_OBJECT_BEGIN: n = snprintf(out, cap, "{"); break;
+        case JSON_TOKEN_OBJECT_END:   n = snprintf(out, cap, "}"); break;
+        case JSON_TOKEN_ARRAY_BEGIN:  n = snprintf(out, cap, "["); break;
+        case JSON_TOKEN_ARRAY_END:    n = snprintf(out, cap, "]"); break;
+        case JSON_TOKEN_KEY:          n = snprintf(out, cap, "K(%s)", token->string); break;
+        case JSON_TOKEN_STRING:       n = snprintf(out, cap, "S(%s)", token->string); break;
+        case JSON_TOKEN_NUMBER:       n = snprintf(out, cap, "N(%g)", token->number); break;
+        case JSON_TOKEN_INTEGER:      n = snprintf(out, cap, "I(%" PRId64 ")", token->integer); break;
+        case JSON_TOKEN_BOOL:         n = snprintf(out, cap, "B(%d)", token->boolean); break;
+        case JSON_TOKEN_NULL:         n = snprintf(out, cap, "Z"); break;
+        case JSON_TOKEN_END:          n = snprintf(out, cap, "$"); break;
+        default:                      n = snprintf(out, cap, "?"); break;
+    }
+    if ((size_t)n >= cap) n = (int)cap - 1;  // a full log keeps its prefix
+    log->len += (size_t)n;
+}
+
+static bool token_log_callback(const JsonToken *token, void *user) {
+    token_log_append(user, token);
+    return true;
+}
+
+/* Feed json in chunks of `step` bytes; returns the token log or the error code */
+static HecticErrorCode stream_in_chunks(Arena *arena, const char *json, size_t step, size_t max_depth, TokenLog *log) {
+    JsonStream *stream = json_stream_init(arena, max_depth, 32);
+    JsonToken token;
+    size_t len = strlen(json), pos = 0;
+    log->len = 0;
+    log->text[0] = '\0';
+    for (;;) {
+        JsonTokenType type = json_stream_next(stream, &token);
+        if (type == JSON_TOKEN_ERROR) return json_stream_error(stream).code;
+        if (type == JSON_TOKEN_NONE) {
+            if (pos >= len) {
+                json_stream_finish(stream);
+            } else {
+                size_t n = len - pos < step ? len - pos : step;
+                json_stream_feed(stream, json + pos, n);
+                pos += n;
+            }
+            continue;
+        }
+        token_log_append(log, &token);
+        if (type == JSON_TOKEN_END) return HECTIC_ERROR_NONE;
+    }
+}
+
+// Test 12: Streaming tokenizer over arbitrary chunk boundaries.
+static void test_stream_tokens(Arena *arena) {
+    const char *json = " {\"a\" : [1, -2.5e1, \"x\\ny\", true, false, null, {}, []],\n \"caf\\u00e9\":{\"b\":\"\\ud83d\\ude00\"}} ";
+    const char *expected = "{K(a)[I(1)N(-25)S(x\ny)B(1)B(0)Z{}[]]K(caf\xc3\xa9){K(b)S(\xf0\x9f\x98\x80)}}$";
+    TokenLog log;
+    for (size_t step = 1; step <= strlen(json); step++) {
+        assert(stream_in_chunks(arena, json, step, 8, &log) == HECTIC_ERROR_NONE);
+        assert(strcmp(log.text, expected) == 0);
+        arena_reset(arena);
+    }
+
+    struct { const char *json; size_t max_depth; HecticErrorCode code; } failures[] = {
+        { "[1,]", 8, JSON_ERROR_SYNTAX },
+        { "[1", 8, JSON_ERROR_SYNTAX },
+        { "{\"a\" 1}", 8, JSON_ERROR_SYNTAX },
+        { "\"abc", 8, JSON_ERROR_SYNTAX },
+        { "[truex]", 8, JSON_ERROR_SYNTAX },
+        { "[1.5e]", 8, JSON_ERROR_SYNTAX },
+        { "\"\\q\"", 8, JSON_ERROR_SYNTAX },
+        { "1 2", 8, JSON_ERROR_SYNTAX },
+        { "[[[]]]", 2, JSON_ERROR_DEPTH_LIMIT },
+        { "\"0123456789012345678901234567890123456789\"", 8, JSON_ERROR_TOKEN_TOO_LONG },
+    };
+    for (size_t i = 0; i < sizeof(failures) / sizeof(failures[0]); i++) {
+        for (size_t step = 1; step <= 3; step++) {
+            assert(stream_in_chunks(arena, failures[i].json, step, failures[i].max_depth, &log) == failures[i].code);
+            arena_reset(arena);
+        }
+    }
+
+    // max_depth 0 is the default limit, as for json_parse_with_opts
+    char *deep = arena_alloc(arena, 2 * JSON_MAX_DEPTH_DEFAULT + 3);
+    memset(deep, '[', JSON_MAX_DEPTH_DEFAULT);
+    memset(deep + JSON_MAX_DEPTH_DEFAULT, ']', JSON_MAX_DEPTH_DEFAULT);
+    deep[2 * JSON_MAX_DEPTH_DEFAULT] = '\0';
+    assert(stream_in_chunks(arena, deep, 512, 0, &log) == HECTIC_ERROR_NONE);
+    memmove(deep + 1, deep, 2 * JSON_MAX_DEPTH_DEFAULT + 1);
+    deep[0] = '[';
+    strcat(deep, "]");
+    assert(stream_in_chunks(arena, deep, 512, 0, &log) == JSON_ERROR_DEPTH_LIMIT);
+    arena_reset(arena);
+
+    // Push mode over a file descriptor
+    int fds[2];
+    assert(pipe(fds) == 0);
+    const char *piped = "[{\"k\":\"v\"}, 3]";
+    assert(write(fds[1], piped, strlen(piped)) == (ssize_t)strlen(piped));
+    close(fds[1]);
+    log.len = 0;
+    JsonStream *stream = json_stream_init(arena, 8, 64);
+    EmptyResult result = json_stream_parse_fd(stream, fds[0], token_log_callback, &log);
+    close(fds[0]);
+    assert(IS_RESULT_SOME(result));
+    assert(strcmp(log.text, "[{K(k)S(v)}I(3)]$") == 0);
+}
+
+/* Fewest digits printf needs for value to read back */
+static int printf_shortest_digits(double value) {
+    char text[40];
+    for (int precision = 1; precision < 17; precision++) {
+        snprintf(text, sizeof(text), "%.*e", precision - 1, value);
+        if (strtod(text, NULL) == value) return precision;
+    }
+    return 17;
+}
+
+static int significant_digits(const char *text) {
+    int first = -1, last = -1, n = 0;
+    for (const char *c = text; *c && *c != 'e'; c++) {
+        if (*c < '0' || *c > '9') continue;
+        if (*c != '0') {
+            if (first < 0) first = n;
+            last = n;
+        }
+        n++;
+    }
+    return last - first + 1;
+}
+
+// Test 13: Doubles print in the shortest form that reads back exactly.
+static void test_number_to_str(void) {
+    struct { double value; const char *text; } cases[] = {
+        { 0.0, "0" }, { -0.0, "-0" }, { 42, "42" }, { -1, "-1" }, { 3.14, "3.14" }, { 0.1, "0.1" },
+        { 0.5, "0.5" }, { 1.0 / 3, "0.3333333333333333" }, { 123.456, "123.456" },
+        { 1e21, "1e+21" }, { 1e20, "100000000000000000000" }, { 123456789012345680000.0, "123456789012345680000" },
+        { 1e-6, "0.000001" }, { 1e-7, "1e-7" }, { 1.5e-7, "1.5e-7" }, { 5e-324, "5e-324" },
+        { 1.7976931348623157e308, "1.7976931348623157e+308" }, { 2.2250738585072014e-308, "2.2250738585072014e-308" },
+        { 9007199254740993.0, "9007199254740992" }, { 3.172230058817275e16, "31722300588172750" },
+        { 2.2250738585072011e-308, "2.225073858507201e-308" }, { 9007199254740992.0 * 1024, "9223372036854776000" },
+    };
+    char buffer[JSON_NUMBER_MAX_LEN];
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        size_t len = json_number_to_str(cases[i].value, buffer);
+        if (strcmp(buffer, cases[i].text) != 0) {
+            fprintf(stderr, "json_number_to_str: expected %s, got %s\n", cases[i].text, buffer);
+            assert(0);
+        }
+        assert(len == strlen(cases[i].text));
+    }
+
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for (int i = 0; i < 200000; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        double value;
+        memcpy(&value, &state, sizeof(value));
+        if (value != value || value - value != 0) continue;
+        json_number_to_str(value, buffer);
+        assert(strtod(buffer, NULL) == value);
+        assert(strlen(buffer) < JSON_NUMBER_MAX_LEN);
+        if (i % 16 == 0 && value != 0) assert(significant_digits(buffer) <= printf_shortest_digits(value));
+    }
+}
+
+// Test 14: Serializer handles large documents, pretty mode and fd sinks.
+static void test_serializer(Arena *arena) {
+    static char doc[32 * 1024];
+    size_t len = 0;
+    len += (size_t)snprintf(doc + len, sizeof(doc) - len, "{\"items\":[");
+    for (int n = 0; n < 300; n++) {
+        len += (size_t)snprintf(doc + len, sizeof(doc) - len, "%s{\"id\":%d,\"ratio\":%.17g,\"name\":\"item \\\"%d\\\"\\n\"}",
+                                n ? "," : "", n, n / 7.0, n);
+    }
+    snprintf(doc + len, sizeof(doc) - len, "],\"empty\":{},\"none\":[]}");
+
+    const char *cursor = doc;
+    Json *root = json_parse(arena, &cursor);
+    assert(root);
+    char *printed = JSON_TO_STR(arena, root);
+    assert(strlen(printed) > 1024);
+    const char *reparse = printed;
+    Json *again = json_parse(arena, &reparse);
+    assert(again && json_tree_equal(root, again));
+    assert(strstr(printed, "\"name\":\"item \\\"299\\\"\\n\"") != NULL);
+
+    const char *small = "{\"a\":[1,{\"b\":null}],\"c\":{},\"d\":[],\"e\":\"x\\ty\"}";
+    Json *small_root = json_parse(arena, &small);
+    assert(strcmp(JSON_TO_PRETTY_STR(arena, small_root),
+                  "{\n"
+                  "  \"a\": [\n"
+                  "    1,\n"
+                  "    {\n"
+                  "      \"b\": null\n"
+                  "    }\n"
+                  "  ],\n"
+                  "  \"c\": {\n"
+                  "  },\n"
+                  "  \"d\": [\n"
+                  "  ],\n"
+                  "  \"e\": \"x\\ty\"\n"
+                  "}") == 0);
+    assert(strcmp(JSON_TO_STR_WITH_OPTS(arena, small_root->value.child->next->next->next, JSON_RAW), "x\ty") == 0);
+
+    // A tiny fd buffer forces many drains
+    int fds[2];
+    assert(pipe(fds) == 0);
+    JsonSink sink = json_sink_fd(arena, fds[1], 16);
+    assert(strcmp(sink.file, __FILE__) == 0 && strcmp(sink.func, __func__) == 0);
+    assert(json_write(&sink, small_root, NULL) && json_sink_flush(&sink));
+    close(fds[1]);
+    char piped[256];
+    ssize_t got = read(fds[0], piped, sizeof(piped) - 1);
+    close(fds[0]);
+    assert(got > 0);
+    piped[got] = '\0';
+    assert(strcmp(piped, JSON_TO_STR(arena, small_root)) == 0);
+}
+
+static Json *parse_numbers(Arena *arena, const char *doc, JsonNumberMode numbers, JsonParserEngine engine) {
+    JsonParseOptions opts = { .engine = engine, .numbers = numbers };
+    JsonResult result = json_parse_with_opts(arena, &doc, &opts);
+    return IS_RESULT_ERROR(result) ? NULL : result.Result.some;
+}
+
+// Test 15: Number grammar, exact integers and correctly rounded doubles.
+static void test_number_parsing(Arena *arena) {
+    JsonParserEngine engines[] = { JSON_PARSER_RECURSIVE, JSON_PARSER_STRUCTURAL };
+    for (size_t e = 0; e < 2; e++) {
+        Json *root = parse_numbers(arena, "[9223372036854775807,-9223372036854775808,9223372036854775808,-0,0,1e2,12.50]",
+                                   JSON_NUMBERS_AUTO, engines[e]);
+        assert(root && root->type == JSON_ARRAY);
+        Json *item = root->value.child;
+        assert(item->type == JSON_INTEGER && item->value.integer == INT64_MAX);
+        item = item->next;
+        assert(item->type == JSON_INTEGER && item->value.integer == INT64_MIN);
+        item = item->next;
+        assert(item->type == JSON_NUMBER && item->value.number == 9223372036854775808.0);
+        item = item->next;
+        assert(item->type == JSON_NUMBER && item->value.number == 0 && signbit(item->value.number));
+        item = item->next;
+        assert(item->type == JSON_INTEGER && item->value.integer == 0);
+        item = item->next;
+        assert(item->type == JSON_NUMBER && item->value.number == 100);
+        item = item->next;
+        assert(item->type == JSON_NUMBER && item->value.number == 12.5);
+        assert(strcmp(JSON_TO_STR(arena, root),
+                      "[9223372036854775807,-9223372036854775808,9223372036854776000,-0,0,100,12.5]") == 0);
+
+        // Leading zeros, bare dots and a lone sign are not JSON numbers
+        logger_level(LOG_LEVEL_EXCEPTION);
+        const char *invalid[] = { "[01]", "[.5]", "[1.]", "[-]", "[+1]", "[1e]" };
+        for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+            assert(parse_numbers(arena, invalid[i], JSON_NUMBERS_AUTO, engines[e]) == NULL);
+        }
+
+        const char *text = "[1.10,-0.0e+00,123456789012345678901234567890]";
+        Json *raw = parse_numbers(arena, text, JSON_NUMBERS_RAW, engines[e]);
+        assert(raw && raw->value.child->type == JSON_RAW_NUMBER);
+        assert(strcmp(raw->value.child->value.string, "1.10") == 0);
+        assert(strcmp(JSON_TO_STR(arena, raw), text) == 0);
+
+        Json *doubles = parse_numbers(arena, "[7,-3]", JSON_NUMBERS_DOUBLE, engines[e]);
+        assert(doubles && doubles->value.child->type == JSON_NUMBER && doubles->value.child->value.number == 7);
+        assert(doubles->value.child->next->value.number == -3);
+    }
+
+    // Random decimal strings must round exactly like strtod
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    char text[64];
+    for (int i = 0; i < 100000; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        int digits = 1 + (int)(state % 25);
+        int exponent = (int)((state >> 8) % 700) - 350;
+        size_t len = 0;
+        if (state & (1ULL << 40)) text[len++] = '-';
+        text[len++] = (char)('1' + (state >> 16) % 9);
+        uint64_t digit_state = state;
+        if (digits > 1) text[len++] = '.';
+        for (int d = 1; d < digits; d++) {
+            digit_state = digit_state * 6364136223846793005ULL + 1442695040888963407ULL;
+            text[len++] = (char)('0' + (digit_state >> 60) % 10);
+        }
+        snprintf(text + len, sizeof(text) - len, "e%d", exponent);
+
+        const char *cursor = text;
+        JsonParseOptions opts = { .numbers = JSON_NUMBERS_DOUBLE };
+        JsonResult result = json_parse_with_opts(arena, &cursor, &opts);
+        assert(IS_RESULT_SOME(result));
+        double expected = strtod(text, NULL);
+        if (memcmp(&result.Result.some->value.number, &expected, sizeof(double)) != 0) {
+            fprintf(stderr, "number parse: %s gave %.17g, expected %.17g\n", text, result.Result.some->value.number, expected);
+            assert(0);
+        }
+        if (i % 1000 == 0) arena_reset(arena);
+    }
+}
+
+// Test 16: Wide objects answer lookups from a key table, in every index mode.
+static void test_object_index(Arena *arena) {
+    static char doc[64 * 1024];
+    size_t len = (size_t)snprintf(doc, sizeof(doc), "{\"dup\":\"first\"");
+    for (int n = 0; n < 2000; n++) {
+        len += (size_t)snprintf(doc + len, sizeof(doc) - len, ",\"key%d\":%d", n, n);
+    }
+    snprintf(doc + len, sizeof(doc) - len, ",\"dup\":\"second\",\"small\":{\"a\":1}}");
+
+    JsonIndexMode modes[] = { JSON_INDEX_LAZY, JSON_INDEX_EAGER, JSON_INDEX_NONE };
+    JsonParserEngine engines[] = { JSON_PARSER_RECURSIVE, JSON_PARSER_STRUCTURAL };
+    for (size_t m = 0; m < 3; m++) {
+        for (size_t e = 0; e < 2; e++) {
+            JsonParseOptions opts = { .engine = engines[e], .index = modes[m] };
+            const char *cursor = doc;
+            JsonResult result = json_parse_with_opts(arena, &cursor, &opts);
+            assert(IS_RESULT_SOME(result));
+            Json *root = result.Result.some;
+            assert((root->index != NULL) == (modes[m] != JSON_INDEX_NONE));
+
+            for (int n = 0; n < 2000; n += 7) {
+                char key[16];
+                snprintf(key, sizeof(key), "key%d", n);
+                Json *item = json_get_object_item(root, key);
+                assert(item && item->type == JSON_INTEGER && item->value.integer == n);
+            }
+            assert(json_get_object_item(root, "key2000") == NULL);
+            assert(json_get_object_item(root, "") == NULL);
+            assert(strcmp(json_get_object_item(root, "dup")->value.string, "first") == 0);
+
+            // Narrow objects stay unindexed and insertion order is untouched
+            Json *small = json_get_object_item(root, "small");
+            assert(small && small->index == NULL && json_get_object_item(small, "a"));
+            assert(strcmp(root->value.child->key, "dup") == 0);
+            assert(strcmp(root->value.child->next->key, "key0") == 0);
+            arena_reset(arena);
+        }
+    }
+
+    // Hand-built objects are indexed on request
+    const char *text = "{\"x\":1,\"y\":2}";
+    Json *built = json_parse(arena, &text);
+    assert(built->index == NULL);
+    assert(json_object_index(arena, built) && built->index != NULL);
+    assert(json_get_object_item(built, "y")->value.integer == 2);
+    assert(json_get_object_item(built, "z") == NULL);
+    assert(!json_object_index(arena, built->value.child));
+}
+
+static Json *eval_path(Arena *arena, const Json *root, const char *source) {
+    JsonPathResult compiled = json_path_compile(arena, source);
+    assert(IS_RESULT_SOME(compiled));
+    return json_path_eval(root, compiled.Result.some);
+}
+
+// Test 17: Compiled paths, one at a time and as a set.
+static void test_json_path(Arena *arena) {
+    const char *text = "{\"a\":{\"b\":[10,11,{\"c\":\"deep\"},13]},\"key with spaces\":1,"
+                       "\".key\":2,\"q\\\"uote\":3,\"m\":[[0,1],[2,3]],\"n\":null}";
+    Json *root = json_parse(arena, &text);
+    assert(root);
+
+    assert(eval_path(arena, root, ".") == root);
+    assert(eval_path(arena, root, "a.b[1]")->value.integer == 11);
+    assert(strcmp(eval_path(arena, root, "a.b[2].c")->value.string, "deep") == 0);
+    assert(eval_path(arena, root, "a.b[-1]")->value.integer == 13);
+    assert(eval_path(arena, root, "a.b[-4]")->value.integer == 10);
+    assert(eval_path(arena, root, "a.\"b\".[0]")->value.integer == 10);
+    assert(eval_path(arena, root, "\"key with spaces\"")->value.integer == 1);
+    assert(eval_path(arena, root, "  \".key\"  ")->value.integer == 2);
+    assert(eval_path(arena, root, "\"q\"\"uote\"")->value.integer == 3);
+    assert(eval_path(arena, root, "m[1][0]")->value.integer == 2);
+    assert(eval_path(arena, root, "n")->type == JSON_NULL);
+    assert(eval_path(arena, root, "a.b[4]") == NULL);
+    assert(eval_path(arena, root, "a.b[-5]") == NULL);
+    assert(eval_path(arena, root, "a.b.c") == NULL);
+    assert(eval_path(arena, root, "a[0]") == NULL);
+    assert(eval_path(arena, root, "missing.x") == NULL);
+
+    const char *invalid[] = { "", "a.", ".a", "a..b", "a[01]", "a[-0]", "a[]", "a[1", "\"open", "a\"b\"", "a]" };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        JsonPathResult compiled = json_path_compile(arena, invalid[i]);
+        assert(IS_RESULT_ERROR(compiled) && compiled.Result.error.code == JSON_ERROR_INVALID_PATH);
+    }
+
+    const char *sources[] = { "a.b[0]", "a.b[-1]", "a.b[2].c", "m[0][1]", "m[-1][-1]", "a.b[0]", ".",
+                              "nope", "a.b[9]", "n", "\"key with spaces\"", "a.b[2].missing" };
+    size_t count = sizeof(sources) / sizeof(sources[0]);
+    const JsonPath *paths[sizeof(sources) / sizeof(sources[0])];
+    Json *out[sizeof(sources) / sizeof(sources[0])];
+    for (size_t i = 0; i < count; i++) {
+        JsonPathResult compiled = json_path_compile(arena, sources[i]);
+        assert(IS_RESULT_SOME(compiled));
+        paths[i] = compiled.Result.some;
+    }
+    JsonPathSet *set = json_path_set(arena, paths, count);
+    json_path_set_eval(set, root, out);
+    for (size_t i = 0; i < count; i++) {
+        assert(out[i] == json_path_eval(root, paths[i]));
+    }
+    assert(out[4]->value.integer == 3 && out[7] == NULL && out[6] == root);
+}
+
+// Test 18: Tape layout, its accessors and conversion to and from nodes.
+static void test_json_tape(Arena *arena) {
+    const char *text = " {\"id\":9007199254740993,\"ratio\":0.25,\"tags\":[\"a\",\"b\\u00e9\",[]],"
+                       "\"nested\":{\"ok\":true,\"off\":false,\"none\":null,\"empty\":{}},\"last\":\"x\"} tail";
+    const char *cursor = text;
+    JsonTapeResult result = json_tape_parse(arena, &cursor);
+    assert(IS_RESULT_SOME(result));
+    assert(strcmp(cursor, " tail") == 0);
+    JsonTape *tape = result.Result.some;
+
+    assert(json_tape_type(tape, JSON_TAPE_ROOT) == JSON_OBJECT);
+    assert(json_tape_length(tape, JSON_TAPE_ROOT) == 5);
+    assert(json_tape_skip(tape, JSON_TAPE_ROOT) == tape->count);
+    size_t id = json_tape_object_get(tape, JSON_TAPE_ROOT, "id");
+    assert(json_tape_type(tape, id) == JSON_INTEGER && json_tape_integer(tape, id) == 9007199254740993LL);
+    assert(json_tape_number(tape, json_tape_object_get(tape, JSON_TAPE_ROOT, "ratio")) == 0.25);
+    size_t tags = json_tape_object_get(tape, JSON_TAPE_ROOT, "tags");
+    assert(json_tape_type(tape, tags) == JSON_ARRAY && json_tape_length(tape, tags) == 3);
+    assert(strcmp(json_tape_string(tape, json_tape_array_get(tape, tags, 1)), "b\xc3\xa9") == 0);
+    assert(json_tape_length(tape, json_tape_array_get(tape, tags, 1)) == 3);
+    assert(json_tape_length(tape, json_tape_array_get(tape, tags, 2)) == 0);
+    assert(json_tape_array_get(tape, tags, 3) == JSON_TAPE_NONE);
+    assert(json_tape_object_get(tape, JSON_TAPE_ROOT, "missing") == JSON_TAPE_NONE);
+    size_t nested = json_tape_object_get(tape, JSON_TAPE_ROOT, "nested");
+    assert(json_tape_bool(tape, json_tape_object_get(tape, nested, "ok")));
+    assert(json_tape_type(tape, json_tape_object_get(tape, nested, "none")) == JSON_NULL);
+    assert(strcmp(json_tape_string(tape, json_tape_skip(tape, nested) + 2), "x") == 0);
+
+    const char *keys[5];
+    size_t value, n = 0;
+    JsonTapeIter it = json_tape_iter(tape, JSON_TAPE_ROOT);
+    while (json_tape_iter_next(&it, &value, &keys[n])) n++;
+    assert(n == 5 && strcmp(keys[0], "id") == 0 && strcmp(keys[4], "last") == 0);
+
+    // Same tree as the node parser, and back again
+    const char *again = text;
+    Json *root = json_parse(arena, &again);
+    Json *converted = json_tape_to_json(arena, tape, JSON_TAPE_ROOT);
+    assert(json_tree_equal(root, converted));
+    JsonTapeResult from = json_tape_from_json(arena, root);
+    assert(IS_RESULT_SOME(from));
+    assert(from.Result.some->count == tape->count);
+    assert(memcmp(from.Result.some->words, tape->words, tape->count * sizeof(uint64_t)) == 0);
+    assert(strcmp(JSON_TO_STR(arena, json_tape_to_json(arena, from.Result.some, JSON_TAPE_ROOT)),
+                  JSON_TO_STR(arena, root)) == 0);
+
+    const char *scalar = "-12.5";
+    JsonTapeResult single = json_tape_parse(arena, &scalar);
+    assert(IS_RESULT_SOME(single) && json_tape_number(single.Result.some, JSON_TAPE_ROOT) == -12.5);
+
+    const char *invalid[] = { "", "[1,]", "{\"a\":1,}", "[1", "{\"a\"}", "[01]", "{1:2}", "\"open" };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        const char *bad = invalid[i];
+        assert(IS_RESULT_ERROR(json_tape_parse(arena, &bad)));
+    }
+}
+
+static size_t arena_used(const Arena *arena) {
+    return (size_t)((char *)arena->current - (char *)arena->begin);
+}
+
+// Test 19: Lazy parse only pays for what is visited.
+static void test_lazy_parse(Arena *arena) {
+    static char doc[96 * 1024];
+    size_t len = (size_t)snprintf(doc, sizeof(doc), "{\"meta\":{\"id\":7,\"tag\":\"a]\\\"}\"},\"items\":[");
+    for (int n = 0; n < 1000; n++) {
+        len += (size_t)snprintf(doc + len, sizeof(doc) - len, "%s{\"id\":%d,\"name\":\"item %d\",\"list\":[%d,[%d]]}",
+                                n ? "," : "", n, n, n, n);
+    }
+    snprintf(doc + len, sizeof(doc) - len, "],\"tail\":\"end\"}");
+
+    size_t before = arena_used(arena);
+    const char *cursor = doc;
+    JsonParseOptions lazy = { .engine = JSON_PARSER_LAZY };
+    JsonResult result = json_parse_with_opts(arena, &cursor, &lazy);
+    assert(IS_RESULT_SOME(result) && *cursor == '\0');
+    Json *root = result.Result.some;
+    assert(root->value.child == NULL);
+
+    Json *meta = json_get_object_item(root, "meta");
+    assert(meta && json_get_object_item(meta, "id")->value.integer == 7);
+    assert(strcmp(json_get_object_item(meta, "tag")->value.string, "a]\"}") == 0);
+    assert(strcmp(json_get_object_item(root, "tail")->value.string, "end") == 0);
+    size_t lazy_used = arena_used(arena) - before;
+    JsonPathResult path = json_path_compile(arena, "items[999].list[1][0]");
+    assert(IS_RESULT_SOME(path));
+    assert(json_path_eval(root, path.Result.some)->value.integer == 999);
+
+    before = arena_used(arena);
+    const char *full_cursor = doc;
+    Json *full = json_parse(arena, &full_cursor);
+    size_t full_used = arena_used(arena) - before;
+    assert(lazy_used * 50 < full_used);
+
+    // Visiting everything yields the same document
+    assert(strcmp(JSON_TO_STR(arena, root), JSON_TO_STR(arena, full)) == 0);
+    size_t count = 0;
+    for (Json *item = json_children(json_get_object_item(root, "items")); item; item = item->next) count++;
+    assert(count == 1000);
+
+    // A settled tree is read without writing: no expansion or key table is left for a reader to build
+    arena_reset(arena);
+    path = json_path_compile(arena, "items[999].list[1][0]");
+    JsonParseOptions indexed = { .engine = JSON_PARSER_LAZY, .index_threshold = 2 };
+    cursor = doc;
+    result = json_parse_with_opts(arena, &cursor, &indexed);
+    assert(IS_RESULT_SOME(result));
+    Json *settled = result.Result.some;
+    json_object_unindex(settled);
+    assert(json_settle(settled));
+    before = arena_used(arena);
+    assert(json_path_eval(settled, path.Result.some)->value.integer == 999);
+    assert(json_get_object_item(json_get_object_item(settled, "meta"), "id")->value.integer == 7);
+    count = 0;
+    for (Json *item = json_children(json_get_object_item(settled, "items")); item; item = item->next) {
+        assert(json_get_object_item(json_get_object_item(item, "list"), "x") == NULL);
+        count += json_get_object_item(item, "id")->value.integer == (int64_t)count;
+    }
+    assert(count == 1000);
+    assert(arena_used(arena) == before);
+
+    // Dropping a key table keeps the children
+    assert(json_object_index(arena, settled));
+    json_object_unindex(settled);
+    assert(strcmp(json_get_object_item(settled, "tail")->value.string, "end") == 0);
+
+    // Regions that are not built yet are still checked: the lazy engine accepts what the others do
+    logger_level(LOG_LEVEL_EXCEPTION);
+    const char *documents[] = {
+        "{\"a\":[1,2,}, \"b\":{\"x\":tru}}", "{\"bad\":[1,,2],\"good\":1}", "{\"a\":[1,2}", "[1,[2}]",
+        "{\"a\" 1}", "{1:2}", "[\"\\x\"]", "[\"\\ud800\"]", "[\"\xff\"]", "[01]", "[-]", "[1 2]", "[nul]",
+        "[", "[1,", "{\"a\":1,", "[[1,", "[[", " [ ] ", "{\"k\":[\"]\\\"}\"],\"n\":-0.5e3}", "\"s\"", "",
+    };
+    JsonParseOptions recursive = { .engine = JSON_PARSER_RECURSIVE };
+    for (size_t i = 0; i < sizeof(documents) / sizeof(documents[0]); i++) {
+        const char *expected_cursor = documents[i];
+        JsonResult expected = json_parse_with_opts(arena, &expected_cursor, &recursive);
+        const char *lazy_cursor = documents[i];
+        result = json_parse_with_opts(arena, &lazy_cursor, &lazy);
+        assert(IS_RESULT_SOME(result) == IS_RESULT_SOME(expected));
+        if (IS_RESULT_SOME(result)) {
+            assert(lazy_cursor == expected_cursor);
+            assert(strcmp(JSON_TO_STR(arena, result.Result.some), JSON_TO_STR(arena, expected.Result.some)) == 0);
+        } else {
+            assert(RESULT_ERROR_CODE(result) == RESULT_ERROR_CODE(expected));
+        }
+    }
+}
+
+// Test 20: Borrowed and in-situ strings point into the input.
+static void test_string_modes(Arena *arena) {
+    const char *text = "{\"plain\":\"hello\",\"esc\\u0061ped\":\"tab\\there \\u00e9\",\"list\":[\"x\",\"\"]}";
+    const char *copy_cursor = text;
+    Json *copied = json_parse(arena, &copy_cursor);
+    char *expected = JSON_TO_STR(arena, copied);
+    size_t len = strlen(text);
+
+    JsonParserEngine engines[] = { JSON_PARSER_RECURSIVE, JSON_PARSER_STRUCTURAL, JSON_PARSER_LAZY };
+    for (size_t e = 0; e < 3; e++) {
+        JsonParseOptions borrowed = { .engine = engines[e], .strings = JSON_STRINGS_BORROWED };
+        const char *cursor = text;
+        JsonResult result = json_parse_with_opts(arena, &cursor, &borrowed);
+        assert(IS_RESULT_SOME(result));
+        Json *root = result.Result.some;
+        Json *plain = json_get_object_item(root, "plain");
+        Json *escaped = json_get_object_item(root, "escaped");
+        // Each records its body length, so reading it does not look for the closing quote again
+        assert(plain->flags == (JSON_STRING_BORROWED | 5u << JSON_STRING_LENGTH_SHIFT));
+        assert(plain->value.string >= text && plain->value.string < text + len);
+        assert(escaped->flags == (JSON_STRING_BORROWED | JSON_STRING_ESCAPED | 16u << JSON_STRING_LENGTH_SHIFT));
+        assert(json_children(json_get_object_item(root, "list"))->next->flags == JSON_STRING_BORROWED);
+        assert(strcmp(JSON_TO_STR(arena, root), expected) == 0);
+        assert(strcmp(json_string(arena, escaped), "tab\there \xc3\xa9") == 0);
+        assert(escaped->flags == 0 && strcmp(json_string(arena, plain), "hello") == 0);
+        assert(json_string(arena, root) == NULL);
+
+        // Validation is not skipped for borrowed bodies
+        logger_level(LOG_LEVEL_EXCEPTION);
+        const char *bad = "[\"\\x\"]";
+        assert(IS_RESULT_ERROR(json_parse_with_opts(arena, &bad, &borrowed)));
+
+        char *buffer = arena_strdup(arena, text);
+        char *insitu_cursor = buffer;
+        JsonParseOptions insitu = { .engine = engines[e] };
+        result = json_parse_insitu(arena, &insitu_cursor, &insitu);
+        assert(IS_RESULT_SOME(result));
+        root = result.Result.some;
+        escaped = json_get_object_item(root, "escaped");
+        assert(escaped && escaped->key >= buffer && escaped->key < buffer + len);
+        assert(escaped->value.string >= buffer && escaped->value.string < buffer + len);
+        assert(strcmp(escaped->value.string, "tab\there \xc3\xa9") == 0);
+        assert(strcmp(JSON_TO_STR(arena, root), expected) == 0);
+    }
+
+    JsonParseOptions wrong = { .strings = JSON_STRINGS_INSITU };
+    const char *cursor = text;
+    assert(IS_RESULT_ERROR(json_parse_with_opts(arena, &cursor, &wrong)));
+}
+
+// Writes text to a fresh temporary file padded with spaces to size bytes.
+static void write_temp_json(char *path, const char *text, size_t size) {
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    FILE *out = fdopen(fd, "w");
+    assert(out);
+    fputs(text, out);
+    for (size_t i = strlen(text); i < size; i++) fputc(' ', out);
+    fclose(out);
+}
+
+// Test 21: Views are parsed within their length, mapped files in place.
+static void test_view_parse(Arena *arena) {
+    // Only "[1,2]" belongs to the view
+    const char buffer[] = "[1,2][3]";
+    JsonResult result = json_parse_view(arena, view_create(buffer, 5, sizeof(char)), NULL);
+    assert(IS_RESULT_SOME(result));
+    assert(strcmp(JSON_TO_STR(arena, result.Result.some), "[1,2]") == 0);
+
+    logger_level(LOG_LEVEL_EXCEPTION);
+    assert(IS_RESULT_ERROR(json_parse_view(arena, view_create(buffer, 6, sizeof(char)), NULL)));
+    assert(IS_RESULT_ERROR(json_parse_view(arena, view_create(buffer, 4, sizeof(char)), NULL)));
+    result = json_parse_view(arena, view_create(buffer, 5, sizeof(int)), NULL);
+    assert(IS_RESULT_ERROR(result) && RESULT_ERROR_CODE(result) == VIEW_ERROR_INVALID_INPUT);
+
+    MappedFileResult missing = view_map_file(arena, "/nonexistent/hectic.json", VIEW_MAP_SEQUENTIAL);
+    assert(IS_RESULT_ERROR(missing) && RESULT_ERROR_CODE(missing) == VIEW_ERROR_IO);
+
+    // One file ends inside a page, the other exactly on a page boundary
+    const char *text = "{\"name\":\"mapped\",\"list\":[1,2.5,true,null]}";
+    size_t sizes[] = { strlen(text), (size_t)sysconf(_SC_PAGESIZE) };
+    for (size_t i = 0; i < 2; i++) {
+        char path[] = "/tmp/hectic-json-XXXXXX";
+        write_temp_json(path, text, sizes[i]);
+
+        MappedFileResult mapped = view_map_file(arena, path, i ? VIEW_MAP_WILLNEED : VIEW_MAP_SEQUENTIAL);
+        assert(IS_RESULT_SOME(mapped));
+        MappedFile *file = mapped.Result.some;
+        const char *data = file->view.data;
+        assert(file->view.len == sizes[i] && file->view.terminated && data[file->view.len] == '\0');
+
+        JsonParseOptions opts = { .engine = JSON_PARSER_STRUCTURAL, .strings = JSON_STRINGS_BORROWED };
+        result = json_parse_view(arena, file->view, &opts);
+        assert(IS_RESULT_SOME(result));
+        Json *name = json_get_object_item(result.Result.some, "name");
+        assert(name->value.string >= data && name->value.string < data + file->view.len);
+        assert(strcmp(JSON_TO_STR(arena, result.Result.some), "{\"name\":\"mapped\",\"list\":[1,2.5,true,null]}") == 0);
+
+        view_unmap_file(file);
+        assert(file->base == NULL);
+        unlink(path);
+    }
+}
+
+typedef struct {
+    size_t seen;
+    size_t next_i;
+    size_t stop_after;
+} LinesCounter;
+
+static bool count_line(const JsonLine *record, void *ctx) {
+    LinesCounter *counter = ctx;
+    assert(record->value);
+    assert((size_t)json_get_object_item(record->value, "i")->value.integer == counter->next_i++);
+    return ++counter->seen != counter->stop_after;
+}
+
+// Test 22: JSON Lines come back in input order with per-line errors.
+static void test_json_lines(Arena *arena) {
+    logger_level(LOG_LEVEL_EXCEPTION);
+    const char *text =
+        "{\"a\":1}\n"
+        "\n"
+        "  [true, \"x\"]  \r\n"
+        "{\"bad\":}\n"
+        "{\"split\":\"one\ntwo\"}\n"
+        "1 2\n"
+        "\"last\"";
+    JsonParserEngine engines[] = { JSON_PARSER_RECURSIVE, JSON_PARSER_STRUCTURAL };
+    for (size_t e = 0; e < 2; e++) {
+        JsonLinesOptions opts = { .threads = 3, .chunk_size = 8, .parse = { .engine = engines[e] } };
+        JsonLinesResult result = json_lines_parse(arena, string_to_view(text), &opts);
+        assert(IS_RESULT_SOME(result));
+        JsonLines *lines = result.Result.some;
+        assert(lines->count == 6 && lines->failed == 2);
+
+        size_t expected_lines[] = { 1, 3, 4, 5, 7, 8 };
+        for (size_t i = 0; i < lines->count; i++) assert(lines->lines[i].line == expected_lines[i]);
+        assert(strcmp(JSON_TO_STR(arena, lines->lines[0].value), "{\"a\":1}") == 0);
+        assert(strcmp(JSON_TO_STR(arena, lines->lines[1].value), "[true,\"x\"]") == 0);
+        assert(!lines->lines[2].value && lines->lines[2].error.code == JSON_ERROR_SYNTAX);
+        // The quoted newline does not split the record
+        assert(lines->lines[3].length == strlen("{\"split\":\"one\ntwo\"}"));
+        assert(strcmp(json_get_object_item(lines->lines[3].value, "split")->value.string, "one\ntwo") == 0);
+        assert(!lines->lines[4].value && lines->lines[4].error.code == JSON_ERROR_SYNTAX);
+        assert(strcmp(lines->lines[5].value->value.string, "last") == 0);
+        json_lines_free(lines);
+    }
+
+    // Enough records for many chunks on several workers
+    size_t count = 2000;
+    char *big = arena_alloc(arena, count * 16);
+    char *w = big;
+    for (size_t i = 0; i < count; i++) w += sprintf(w, "{\"i\":%zu}\n", i);
+    View view = view_create(big, (size_t)(w - big), sizeof(char));
+
+    JsonLinesOptions opts = { .threads = 4, .chunk_size = 512 };
+    JsonLinesResult result = json_lines_parse(arena, view, &opts);
+    assert(IS_RESULT_SOME(result) && result.Result.some->count == count && result.Result.some->failed == 0);
+    for (size_t i = 0; i < count; i++) {
+        JsonLine *record = &result.Result.some->lines[i];
+        assert(record->line == i + 1);
+        assert((size_t)json_get_object_item(record->value, "i")->value.integer == i);
+    }
+
+    // Wide records get their key table on the first lookup, in an arena that must outlive the batch
+    size_t wide_count = 50;
+    char *wide = arena_alloc(arena, wide_count * 256);
+    w = wide;
+    for (size_t i = 0; i < wide_count; i++) {
+        for (int k = 0; k < 20; k++) w += sprintf(w, "%s\"k%d\":%zu", k ? "," : "{", k, i * 100 + (size_t)k);
+        w += sprintf(w, "}\n");
+    }
+    JsonLinesOptions wide_opts = { .threads = 2, .chunk_size = 64 };
+    JsonLinesResult wide_result = json_lines_parse(arena, view_create(wide, (size_t)(w - wide), sizeof(char)), &wide_opts);
+    assert(IS_RESULT_SOME(wide_result) && wide_result.Result.some->count == wide_count);
+    for (size_t i = 0; i < wide_count; i++) {
+        Json *record = wide_result.Result.some->lines[i].value;
+        assert((size_t)json_get_object_item(record, "k17")->value.integer == i * 100 + 17);
+        assert(json_get_object_item(record, "k20") == NULL);
+    }
+    json_lines_free(wide_result.Result.some);
+    json_lines_free(result.Result.some);
+
+    LinesCounter counter = { .stop_after = 0 };
+    assert(IS_RESULT_SOME(json_lines_each(arena, view, &opts, count_line, &counter)));
+    assert(counter.seen == count);
+
+    counter = (LinesCounter){ .stop_after = 100 };
+    EmptyResult stopped = json_lines_each(arena, view, &opts, count_line, &counter);
+    assert(IS_RESULT_ERROR(stopped) && RESULT_ERROR_CODE(stopped) == JSON_ERROR_ABORTED);
+    assert(counter.seen == 100);
+
+    // An unclosed '[' ends with its own line instead of reading on into the next ones;
+    // like any container left open at the end of input it reads as empty
+    size_t rows = 2000;
+    char *hostile = arena_alloc(arena, 2 + rows * 41 + 1);
+    w = hostile;
+    w += sprintf(w, "[\n");
+    for (size_t i = 0; i < rows; i++) w += sprintf(w, "0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,\n");
+    for (size_t e = 0; e < 2; e++) {
+        JsonLinesOptions single = { .threads = 1, .parse = { .engine = e ? JSON_PARSER_STRUCTURAL : JSON_PARSER_RECURSIVE } };
+        result = json_lines_parse(arena, view_create(hostile, (size_t)(w - hostile), sizeof(char)), &single);
+        assert(IS_RESULT_SOME(result));
+        assert(result.Result.some->count == rows + 1 && result.Result.some->failed == rows);
+        assert(strcmp(JSON_TO_STR(arena, result.Result.some->lines[0].value), "[]") == 0);
+        assert(result.Result.some->lines[1].error.code == JSON_ERROR_SYNTAX);
+        json_lines_free(result.Result.some);
+    }
+
+    JsonLinesOptions lazy = { .parse = { .engine = JSON_PARSER_LAZY } };
+    assert(IS_RESULT_ERROR(json_lines_parse(arena, view, &lazy)));
+}
+
+// Test 23: Binary documents round-trip and are read in place.
+static void test_json_binary(Arena *arena) {
+    char *keys = arena_alloc(arena, 1024);
+    char *w = keys;
+    w += sprintf(w, "{");
+    for (int i = 39; i >= 0; i--) w += sprintf(w, "\"k%02d\":%d,", i, i);
+    sprintf(w, "\"k07\":\"dup\"}");
+
+    const char *docs[] = {
+        "{\"name\":\"caf\\u00e9\",\"tags\":[\"a\",\"\",{}],\"n\":null,\"t\":true,\"f\":false,"
+        "\"small\":-5,\"big\":9007199254740993,\"min\":-9223372036854775808,\"pi\":3.25,\"e\":[]}",
+        "[1,[2,[3,[4]]],\"x\"]",
+        "\"alone\"",
+        "42",
+        keys,
+    };
+    for (size_t d = 0; d < sizeof(docs) / sizeof(docs[0]); d++) {
+        const char *cursor = docs[d];
+        Json *root = json_parse(arena, &cursor);
+        JsonBinaryResult encoded = json_binary_encode(arena, root);
+        assert(IS_RESULT_SOME(encoded));
+        JsonBinaryResult loaded = json_binary_load(arena, view_create(encoded.Result.some->data, encoded.Result.some->size, sizeof(char)));
+        assert(IS_RESULT_SOME(loaded));
+        JsonBinary *binary = loaded.Result.some;
+        Json *back = json_binary_to_json(arena, binary, binary->root);
+        assert(strcmp(JSON_TO_STR(arena, back), JSON_TO_STR(arena, root)) == 0);
+    }
+
+    const char *cursor = docs[0];
+    Json *root = json_parse(arena, &cursor);
+    JsonBinary *binary = json_binary_encode(arena, root).Result.some;
+    assert(json_binary_type(binary, binary->root) == JSON_OBJECT && json_binary_length(binary, binary->root) == 10);
+    assert(strcmp(json_binary_string(binary, json_binary_object_get(binary, binary->root, "name")), "caf\xc3\xa9") == 0);
+    assert(json_binary_integer(binary, json_binary_object_get(binary, binary->root, "small")) == -5);
+    assert(json_binary_integer(binary, json_binary_object_get(binary, binary->root, "big")) == INT64_C(9007199254740993));
+    assert(json_binary_integer(binary, json_binary_object_get(binary, binary->root, "min")) == INT64_MIN);
+    assert(json_binary_number(binary, json_binary_object_get(binary, binary->root, "pi")) == 3.25);
+    assert(json_binary_bool(binary, json_binary_object_get(binary, binary->root, "t")));
+    JsonBinaryRef tags = json_binary_object_get(binary, binary->root, "tags");
+    assert(json_binary_type(binary, json_binary_array_get(binary, tags, 2)) == JSON_OBJECT);
+    assert(json_binary_array_get(binary, tags, 3) == JSON_BINARY_NONE);
+    assert(json_binary_object_get(binary, binary->root, "nam") == JSON_BINARY_NONE);
+    const char *key;
+    json_binary_object_at(binary, binary->root, 1, &key);
+    assert(strcmp(key, "tags") == 0);
+
+    // Lookups binary-search the sorted keys; a duplicate resolves to the first
+    cursor = keys;
+    binary = json_binary_encode(arena, json_parse(arena, &cursor)).Result.some;
+    for (int i = 0; i < 40; i++) {
+        char name[8];
+        sprintf(name, "k%02d", i);
+        assert(json_binary_integer(binary, json_binary_object_get(binary, binary->root, name)) == i);
+    }
+
+    // Written with one call, opened by mapping the file
+    char path[] = "/tmp/hectic-jsonb-XXXXXX";
+    close(mkstemp(path));
+    assert(chmod(path, 0640) == 0);
+    assert(IS_RESULT_SOME(json_binary_write(root, path)));
+    struct stat written;
+    assert(stat(path, &written) == 0 && (written.st_mode & 0777) == 0640);
+    JsonBinaryResult opened = json_binary_open(arena, path);
+    assert(IS_RESULT_SOME(opened) && opened.Result.some->file);
+    binary = opened.Result.some;
+    assert(json_binary_integer(binary, json_binary_object_get(binary, binary->root, "small")) == -5);
+    assert(strcmp(JSON_TO_STR(arena, json_binary_to_json(arena, binary, binary->root)), JSON_TO_STR(arena, root)) == 0);
+    json_binary_close(binary);
+    unlink(path);
+
+    // Damage is caught by the header checks
+    logger_level(LOG_LEVEL_EXCEPTION);
+    JsonBinary *good = json_binary_encode(arena, root).Result.some;
+    unsigned char *copy = arena_alloc(arena, good->size);
+    memcpy(copy, good->data, good->size);
+    copy[good->size / 2] ^= 1;
+    JsonBinaryResult broken = json_binary_load(arena, view_create(copy, good->size, sizeof(char)));
+    assert(IS_RESULT_ERROR(broken) && RESULT_ERROR_CODE(broken) == JSON_ERROR_INVALID_BINARY);
+    assert(IS_RESULT_ERROR(json_binary_load(arena, view_create(good->data, good->size - 8, sizeof(char)))));
+
+    // A string whose NUL is gone reads as missing, even when the checksum is made to match
+    cursor = "[\"abcdefg\",\"z\"]";
+    JsonBinary *plain = json_binary_encode(arena, json_parse(arena, &cursor)).Result.some;
+    unsigned char *unterminated = arena_alloc(arena, plain->size);
+    memcpy(unterminated, plain->data, plain->size);
+    // After the header and the array (count, two refs): the length word, then the 7 bytes and their NUL
+    size_t text_at = 32 + 24;
+    assert(memcmp(unterminated + text_at + 8, "abcdefg", 8) == 0);
+    unterminated[text_at + 8 + 7] = 'h';
+    uint64_t checksum = 0xcbf29ce484222325ULL;
+    for (size_t i = 32; i + 8 <= plain->size; i += 8) {
+        uint64_t word;
+        memcpy(&word, unterminated + i, sizeof(word));
+        checksum = (checksum ^ word) * 0x100000001b3ULL;
+    }
+    checksum ^= checksum >> 33;
+    checksum *= 0xff51afd7ed558ccdULL;
+    checksum ^= checksum >> 33;
+    memcpy(unterminated + 16, &checksum, sizeof(checksum));
+    JsonBinaryResult crafted = json_binary_load(arena, view_create(unterminated, plain->size, sizeof(char)));
+    assert(IS_RESULT_SOME(crafted));
+    JsonBinary *bad_text = crafted.Result.some;
+    assert(json_binary_string(bad_text, json_binary_array_get(bad_text, bad_text->root, 0)) == NULL);
+    assert(strcmp(json_binary_string(bad_text, json_binary_array_get(bad_text, bad_text->root, 1)), "z") == 0);
+    assert(strcmp(JSON_TO_STR(arena, json_binary_to_json(arena, bad_text, bad_text->root)), "[null,\"z\"]") == 0);
+
+    // A container ref pointing back at its parent is read as null instead of looping
+    cursor = "[[1,2],[3]]";
+    JsonBinary *forged = json_binary_encode(arena, json_parse(arena, &cursor)).Result.some;
+    // After the 32-byte header: the outer count, then the ref of its first element
+    memcpy((unsigned char *)forged->data + 32 + 8, &forged->root, sizeof(forged->root));
+    assert(strcmp(JSON_TO_STR(arena, json_binary_to_json(arena, forged, forged->root)), "[null,[3]]") == 0);
+}
+
+// Test 24: Nesting is bounded by max_depth in every engine, without using the C stack.
+static void test_parse_depth(Arena *arena) {
+    JsonParserEngine engines[] = { JSON_PARSER_RECURSIVE, JSON_PARSER_STRUCTURAL, JSON_PARSER_LAZY };
+    size_t deep = 100000;
+    char *doc = arena_alloc(arena, 2 * deep + 1);
+
+    logger_level(LOG_LEVEL_EXCEPTION);
+    for (size_t e = 0; e < sizeof(engines) / sizeof(engines[0]); e++) {
+        JsonParseOptions opts = { .engine = engines[e] };
+
+        // Far past the default limit: a clean error, not a stack overflow
+        memset(doc, '[', deep);
+        memset(doc + deep, ']', deep);
+        doc[2 * deep] = '\0';
+        const char *cursor = doc;
+        JsonResult result = json_parse_with_opts(arena, &cursor, &opts);
+        assert(IS_RESULT_ERROR(result) && RESULT_ERROR_CODE(result) == JSON_ERROR_DEPTH_LIMIT);
+
+        // Exactly at the default limit is fine, one more is not
+        for (size_t extra = 0; extra <= 1; extra++) {
+            size_t n = JSON_MAX_DEPTH_DEFAULT + extra;
+            memset(doc, '[', n);
+            memset(doc + n, ']', n);
+            doc[2 * n] = '\0';
+            cursor = doc;
+            result = json_parse_with_opts(arena, &cursor, &opts);
+            assert(extra ? IS_RESULT_ERROR(result) && RESULT_ERROR_CODE(result) == JSON_ERROR_DEPTH_LIMIT
+                         : IS_RESULT_SOME(result) && *cursor == '\0');
+        }
+
+        // A raised limit lets deeper documents through
+        opts.max_depth = 3000;
+        memset(doc, '[', 3000);
+        memset(doc + 3000, ']', 3000);
+        doc[6000] = '\0';
+        cursor = doc;
+        assert(IS_RESULT_SOME(json_parse_with_opts(arena, &cursor, &opts)) && *cursor == '\0');
+
+        // A custom limit counts arrays and objects alike
+        opts.max_depth = 3;
+        cursor = "{\"a\":[{\"b\":1}],\"c\":[]}";
+        assert(IS_RESULT_SOME(json_parse_with_opts(arena, &cursor, &opts)));
+        cursor = "{\"a\":[{\"b\":[1]}]}";
+        result = json_parse_with_opts(arena, &cursor, &opts);
+        assert(IS_RESULT_ERROR(result) && RESULT_ERROR_CODE(result) == JSON_ERROR_DEPTH_LIMIT);
+
+        // Syntax errors stay syntax errors
+        cursor = "[[1,]]";
+        result = json_parse_with_opts(arena, &cursor, &opts);
+        assert(IS_RESULT_ERROR(result) && RESULT_ERROR_CODE(result) == JSON_ERROR_SYNTAX);
+    }
+
+    // The tree is the one the grammar describes, siblings after deep closes included
+    const char *json = "[[[1,2],{\"k\":[true]}],[],\"s\",{\"a\":{\"b\":null},\"c\":-1}]";
+    Json *root = json_parse(arena, &json);
+    assert(root && strcmp(JSON_TO_STR(arena, root), "[[[1,2],{\"k\":[true]}],[],\"s\",{\"a\":{\"b\":null},\"c\":-1}]") == 0);
+}
+
+// Test 25: Canonical output, structural hash and equality ignore key order and number spelling.
+static void test_canonical(Arena *arena) {
+    const JsonWriteOptions canonical = { .canonical = true, .indent = 4 };
+    struct { const char *json; const char *expected; } cases[] = {
+        // RFC 8785, section 3.2.2
+        { "{\"numbers\":[333333333.33333329,1E30,4.50,2e-3,0.000000000000000000000000001],"
+          "\"string\":\"\\u20ac$\\u000F\\u000aA'\\u0042\\u0022\\u005c\\\\\\\"\\/\",\"literals\":[null,true,false]}",
+          "{\"literals\":[null,true,false],\"numbers\":[333333333.3333333,1e+30,4.5,0.002,1e-27],"
+          "\"string\":\"\xe2\x82\xac$\\u000f\\nA'B\\\"\\\\\\\\\\\"/\"}" },
+        // RFC 8785, section 3.2.3: UTF-16 order puts the surrogate pair before U+FB33
+        { "{\"\\u20ac\":\"Euro\",\"\\r\":\"CR\",\"\\ufb33\":\"Hebrew\",\"1\":\"One\",\"\\ud83d\\ude00\":\"Smiley\","
+          "\"\\u0080\":\"Control\",\"\\u00f6\":\"Latin\"}",
+          "{\"\\r\":\"CR\",\"1\":\"One\",\"\xc2\x80\":\"Control\",\"\xc3\xb6\":\"Latin\",\"\xe2\x82\xac\":\"Euro\","
+          "\"\xf0\x9f\x98\x80\":\"Smiley\",\"\xef\xac\xb3\":\"Hebrew\"}" },
+        { "[-0, 1.0, 100, 9007199254740993, {\"b\":1,\"a\":[],\"b\":2}]",
+          "[0,1,100,9007199254740992,{\"a\":[],\"b\":1,\"b\":2}]" },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const char *cursor = cases[i].json;
+        Json *root = json_parse(arena, &cursor);
+        assert(root);
+        JsonSink sink = json_sink_buffer(arena, 0);
+        assert(json_write(&sink, root, &canonical));
+        assert(strcmp(json_sink_cstr(&sink), cases[i].expected) == 0);
+    }
+
+    const char *same[][2] = {
+        { "{\"a\":1,\"b\":[true,null,\"x\"]}", " { \"b\" : [ true , null , \"x\" ] , \"a\" : 1.0 } " },
+        { "[1e2, -0.0, 12345678901234567890]", "[100, 0, 1.2345678901234567e19]" },
+        { "{\"s\":\"caf\\u00e9\"}", "{\"s\":\"caf\xc3\xa9\"}" },
+        { "[9007199254740992, 1e15, -9223372036854775808]", "[9007199254740992.0, 1000000000000000, -9.223372036854775808e18]" },
+    };
+    const char *differ[][2] = {
+        { "{\"a\":1}", "{\"a\":1.5}" },
+        { "[1,2]", "[2,1]" },
+        { "{\"a\":null}", "{\"a\":false}" },
+        { "{\"a\":[]}", "{\"a\":{}}" },
+        { "\"1\"", "1" },
+        { "{\"a\":1,\"a\":2}", "{\"a\":2,\"a\":1}" },
+        // Integers stay exact past 2^53, where their doubles meet
+        { "{\"id\":9007199254740993}", "{\"id\":9007199254740992}" },
+        { "9007199254740993", "9007199254740992.0" },
+        { "9223372036854775807", "9223372036854775806" },
+    };
+    JsonParseOptions modes[] = {
+        { .engine = JSON_PARSER_RECURSIVE },
+        { .engine = JSON_PARSER_LAZY, .strings = JSON_STRINGS_BORROWED, .numbers = JSON_NUMBERS_RAW },
+    };
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        for (size_t i = 0; i < sizeof(same) / sizeof(same[0]); i++) {
+            const char *left = same[i][0], *right = same[i][1];
+            Json *a = json_parse(arena, &left);
+            Json *b = json_parse_with_opts(arena, &right, &modes[m]).Result.some;
+            assert(json_hash(a) == json_hash(b));
+            assert(json_equal(a, b) && json_equal(b, a));
+        }
+        for (size_t i = 0; i < sizeof(differ) / sizeof(differ[0]); i++) {
+            const char *left = differ[i][0], *right = differ[i][1];
+            Json *a = json_parse(arena, &left);
+            Json *b = json_parse_with_opts(arena, &right, &modes[m]).Result.some;
+            assert(json_hash(a) != json_hash(b));
+            assert(!json_equal(a, b));
+        }
+    }
+
+    // The canonical form itself stays RFC 8785 unless asked for exact integers
+    const char *big_id = "{\"id\":9007199254740993,\"x\":1.0}";
+    Json *ids = json_parse(arena, &big_id);
+    JsonWriteOptions exact = { .canonical = true, .exact_integers = true };
+    JsonSink exact_sink = json_sink_buffer(arena, 0);
+    assert(json_write(&exact_sink, ids, &exact));
+    assert(strcmp(json_sink_cstr(&exact_sink), "{\"id\":9007199254740993,\"x\":1}") == 0);
+    JsonWriteOptions rfc = { .canonical = true };
+    JsonSink rfc_sink = json_sink_buffer(arena, 0);
+    assert(json_write(&rfc_sink, ids, &rfc));
+    assert(strcmp(json_sink_cstr(&rfc_sink), "{\"id\":9007199254740992,\"x\":1}") == 0);
+
+    // Hashing a document larger than the hash sink's buffer still sees every byte
+    char *doc = arena_alloc(arena, 8192);
+    char *w = doc + sprintf(doc, "[");
+    for (int i = 0; i < 500; i++) w += sprintf(w, "%d,", i);
+    sprintf(w, "500]");
+    const char *cursor = doc;
+    Json *a = json_parse(arena, &cursor);
+    doc[w - doc + 1] = '1';
+    cursor = doc;
+    Json *b = json_parse(arena, &cursor);
+    assert(json_hash(a) != json_hash(b) && !json_equal(a, b));
+}
+
+// Test 26: A compact clone outlives its source arena and shares equal strings.
+static void test_clone_compact(Arena *arena) {
+    Arena scratch = arena_init(ARENA_SIZE);
+    char *doc = arena_alloc(arena, 4096);
+    char *w = doc + sprintf(doc, "{\"rows\":[");
+    for (int i = 0; i < 20; i++) w += sprintf(w, "{\"id\":%d,\"tag\":\"t\\u00e9\",\"n\":%d.5},", i, i);
+    w += sprintf(w, "{}],\"wide\":{");
+    for (int i = 0; i < 20; i++) w += sprintf(w, "\"k%d\":%d,", i, i);
+    sprintf(w, "\"big\":123456789012345678901}, \"e\":\"\"}");
+
+    JsonParseOptions modes[] = {
+        { .engine = JSON_PARSER_RECURSIVE },
+        { .engine = JSON_PARSER_LAZY, .strings = JSON_STRINGS_BORROWED, .numbers = JSON_NUMBERS_RAW },
+    };
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        char *input = arena_alloc(&scratch, strlen(doc) + 1);
+        strcpy(input, doc);
+        const char *cursor = input;
+        Json *source = json_parse_with_opts(&scratch, &cursor, &modes[m]).Result.some;
+        char *expected = JSON_TO_STR(arena, source);
+        assert(json_get_object_item(json_get_object_item(source, "wide"), "k3"));
+
+        Json *clone = json_clone_compact(arena, source);
+        assert(clone);
+        memset(input, ' ', strlen(input));
+        arena_reset(&scratch);
+        memset(scratch.begin, 0xAA, scratch.capacity);
+
+        assert(strcmp(JSON_TO_STR(arena, clone), expected) == 0);
+        // Depth-first, one block
+        Json *rows = json_children(clone);
+        assert(rows == clone + 1 && json_children(rows) == clone + 2 && json_children(json_children(rows)) == clone + 3);
+        // Equal strings are stored once
+        Json *first = json_children(rows), *second = first->next;
+        assert(first->value.child->key == second->value.child->key);
+        assert(json_get_object_item(first, "tag")->value.string == json_get_object_item(second, "tag")->value.string);
+        assert(strcmp(json_get_object_item(second, "tag")->value.string, "t\xc3\xa9") == 0);
+        assert(json_get_object_item(second, "tag")->flags == 0);
+        // Wide objects keep a key table
+        Json *wide = json_get_object_item(clone, "wide");
+        assert(wide->index && strcmp(JSON_TO_STR(arena, json_get_object_item(wide, "k19")), "19") == 0);
+    }
+
+    logger_level(LOG_LEVEL_EXCEPTION);
+    Arena tiny = arena_init(256);
+    const char *cursor = doc;
+    Json *root = json_parse(arena, &cursor);
+    assert(json_clone_compact(&tiny, root) == NULL);
+    arena_free(&tiny);
+    arena_free(&scratch);
+}
+
+static Json *parse_text(Arena *arena, const char *json) {
+    return json_parse(arena, &json);
+}
+
+// Test 27: Trees can be edited in place, indexes follow, merge patches layer.
+static void test_mutation(Arena *arena) {
+    Json *root = parse_text(arena, "{\"a\":1,\"b\":[1,2,3],\"c\":{\"d\":true}}");
+    Json *x = json_new(arena, JSON_STRING);
+    assert(json_set_string(arena, x, "x") && json_object_set(arena, root, "a", x) == x);
+    assert(json_object_set(arena, root, "e", json_new(arena, JSON_NULL)));
+    assert(json_object_insert(arena, root, 0, "z", json_new(arena, JSON_OBJECT)));
+    assert(json_object_insert(arena, root, 0, "a", json_new(arena, JSON_NULL)) == NULL);
+    assert(json_object_delete(root, "c") == 1 && json_object_delete(root, "c") == 0);
+    assert(strcmp(JSON_TO_STR(arena, root), "{\"z\":{},\"a\":\"x\",\"b\":[1,2,3],\"e\":null}") == 0);
+
+    Json *b = json_get_object_item(root, "b");
+    Json *n = json_new(arena, JSON_INTEGER);
+    assert(json_set_integer(n, 0) && json_array_insert(b, 0, n));
+    assert(json_array_push(b, json_new(arena, JSON_BOOL)));
+    assert(!json_array_insert(b, 99, json_new(arena, JSON_NULL)));
+    Json *removed = json_array_remove(b, 1);
+    assert(removed && removed->value.integer == 1 && !removed->next);
+    assert(json_array_remove(b, 99) == NULL);
+    Json *first = json_new(arena, JSON_NUMBER), *second = json_new(arena, JSON_NULL);
+    assert(json_set_number(first, 2.5));
+    first->next = second;
+    Json *cut = json_array_splice(b, 1, 2, first);
+    assert(cut && cut->value.integer == 2 && cut->next->value.integer == 3 && !cut->next->next);
+    assert(json_array_splice(b, 10, 1, NULL) == NULL);
+    assert(strcmp(JSON_TO_STR(arena, b), "[0,2.5,null,false]") == 0);
+
+    logger_level(LOG_LEVEL_EXCEPTION);
+    assert(!json_set_bool(b, true) && !json_array_push(root, n));
+    assert(json_set_bool(json_children(b), true) && json_set_null(x));
+
+    // Key tables stay right through edits, and objects that grow get one
+    char wide[512], *w = wide + sprintf(wide, "{");
+    for (int i = 0; i < 20; i++) w += sprintf(w, "%s\"k%d\":%d", i ? "," : "", i, i);
+    sprintf(w, "}");
+    const char *cursor = wide;
+    JsonParseOptions eager = { .index = JSON_INDEX_EAGER };
+    Json *indexed = json_parse_with_opts(arena, &cursor, &eager).Result.some;
+    Json *built = json_new(arena, JSON_OBJECT);
+    for (int i = 0; i < 20; i++) {
+        char key[8];
+        sprintf(key, "k%d", i);
+        Json *value = json_new(arena, JSON_INTEGER);
+        json_set_integer(value, i);
+        json_object_set(arena, built, key, value);
+    }
+    assert(indexed->index && built->index && json_equal(indexed, built));
+    Json *objects[] = { indexed, built };
+    for (size_t o = 0; o < 2; o++) {
+        Json *object = objects[o];
+        json_object_delete(object, "k3");
+        assert(!json_get_object_item(object, "k3") && json_get_object_item(object, "k4")->value.integer == 4);
+        json_object_set(arena, object, "k4", json_new(arena, JSON_NULL));
+        assert(json_get_object_item(object, "k4")->type == JSON_NULL);
+        for (int i = 20; i < 40; i++) {
+            char key[8];
+            sprintf(key, "k%d", i);
+            json_object_insert(arena, object, 0, key, json_new(arena, JSON_BOOL));
+        }
+        assert(json_get_object_item(object, "k39")->type == JSON_BOOL && json_get_object_item(object, "k19"));
+    }
+
+    // A lazily parsed tree is expanded before it is edited
+    cursor = "{\"a\":[1],\"b\":{}}";
+    JsonParseOptions lazy = { .engine = JSON_PARSER_LAZY };
+    Json *deferred = json_parse_with_opts(arena, &cursor, &lazy).Result.some;
+    assert(json_array_push(json_get_object_item(deferred, "a"), json_new(arena, JSON_NULL)));
+    assert(json_object_set(arena, deferred, "c", json_new(arena, JSON_ARRAY)));
+    assert(strcmp(JSON_TO_STR(arena, deferred), "{\"a\":[1,null],\"b\":{},\"c\":[]}") == 0);
+
+    // RFC 7396, appendix A
+    const char *patches[][3] = {
+        { "{\"a\":\"b\"}", "{\"a\":\"c\"}", "{\"a\":\"c\"}" },
+        { "{\"a\":\"b\"}", "{\"b\":\"c\"}", "{\"a\":\"b\",\"b\":\"c\"}" },
+        { "{\"a\":\"b\"}", "{\"a\":null}", "{}" },
+        { "{\"a\":\"b\",\"b\":\"c\"}", "{\"a\":null}", "{\"b\":\"c\"}" },
+        { "{\"a\":[\"b\"]}", "{\"a\":\"c\"}", "{\"a\":\"c\"}" },
+        { "{\"a\":\"c\"}", "{\"a\":[\"b\"]}", "{\"a\":[\"b\"]}" },
+        { "{\"a\":{\"b\":\"c\"}}", "{\"a\":{\"b\":\"d\",\"c\":null}}", "{\"a\":{\"b\":\"d\"}}" },
+        { "{\"a\":[{\"b\":\"c\"}]}", "{\"a\":[1]}", "{\"a\":[1]}" },
+        { "[\"a\",\"b\"]", "[\"c\",\"d\"]", "[\"c\",\"d\"]" },
+        { "{\"a\":\"b\"}", "[\"c\"]", "[\"c\"]" },
+        { "{\"a\":\"foo\"}", "null", "null" },
+        { "{\"a\":\"foo\"}", "\"bar\"", "\"bar\"" },
+        { "{\"e\":null}", "{\"a\":1}", "{\"e\":null,\"a\":1}" },
+        { "[1,2]", "{\"a\":\"b\",\"c\":null}", "{\"a\":\"b\"}" },
+        { "{}", "{\"a\":{\"bb\":{\"ccc\":null}}}", "{\"a\":{\"bb\":{}}}" },
+    };
+    for (size_t i = 0; i < sizeof(patches) / sizeof(patches[0]); i++) {
+        Json *patch = parse_text(arena, patches[i][1]);
+        Json *result = json_merge_patch(arena, parse_text(arena, patches[i][0]), patch);
+        assert(result && json_equal(result, parse_text(arena, patches[i][2])));
+        // The patch itself is left alone and can be layered again
+        assert(json_equal(patch, parse_text(arena, patches[i][1])));
+    }
+}
+
+// Test 28: The streaming writer lays documents out exactly like the tree serializer.
+static void test_json_writer(Arena *arena) {
+    const char *json = "{\"id\":7,\"name\":\"a\\\"b\\n\",\"ok\":true,\"none\":null,\"pi\":3.5,"
+                       "\"empty\":{},\"list\":[],\"nested\":[[1,{\"k\":false}],\"x\"],\"tree\":{\"a\":[1,2]}}";
+    Json *expected = parse_text(arena, json);
+    Json *tree = parse_text(arena, "{\"a\":[1,2]}");
+
+    for (int indent = 0; indent <= 4; indent += 2) {
+        JsonSink sink = json_sink_buffer(arena, 0);
+        JsonWriter w = json_writer(&sink, indent);
+        json_writer_begin_object(&w);
+        json_writer_key(&w, "id");
+        json_writer_integer(&w, 7);
+        json_writer_key(&w, "name");
+        json_writer_string(&w, "a\"b\n");
+        json_writer_key(&w, "ok");
+        json_writer_bool(&w, true);
+        json_writer_key(&w, "none");
+        json_writer_string(&w, NULL);
+        json_writer_key(&w, "pi");
+        json_writer_number(&w, 3.5);
+        json_writer_key(&w, "empty");
+        json_writer_begin_object(&w);
+        json_writer_end_object(&w);
+        json_writer_key(&w, "list");
+        json_writer_begin_array(&w);
+        json_writer_end_array(&w);
+        json_writer_key(&w, "nested");
+        json_writer_begin_array(&w);
+        json_writer_begin_array(&w);
+        json_writer_integer(&w, 1);
+        json_writer_begin_object(&w);
+        json_writer_key(&w, "k");
+        json_writer_bool(&w, false);
+        json_writer_end_object(&w);
+        json_writer_end_array(&w);
+        json_writer_string(&w, "x");
+        json_writer_end_array(&w);
+        json_writer_key(&w, "tree");
+        json_writer_value(&w, tree);
+        json_writer_end_object(&w);
+
+        JsonSink reference = json_sink_buffer(arena, 0);
+        JsonWriteOptions opts = { .indent = indent };
+        assert(json_write(&reference, expected, &opts));
+        assert(strcmp(json_sink_cstr(&sink), json_sink_cstr(&reference)) == 0);
+    }
+}
+
+// Test 29: Debug dumps stream in one pass; long sibling chains do not recurse per element.
+static void test_json_to_debug_str(Arena *arena) {
+    ColorMode saved = debug_color_mode;
+    debug_color_mode = COLOR_MODE_DISABLE;
+
+    Json *root = parse_text(arena, "{\"key\":\"value\"}");
+    Json *child = root->value.child;
+    char *debug_str = JSON_TO_DEBUG_STR(arena, "root", root);
+    char *expected = arena_strdup_fmt(arena,
+        "struct Json root = {enum type = OBJECT %zu , key = NULL, union JsonValue value = {"
+        "struct Json child = {enum type = STRING %zu , key = %p \"key\", union JsonValue value = {"
+        "string = %p \"value\"} %p, struct Json next = NULL} %p} %p, struct Json next = NULL} %p",
+        (size_t)JSON_OBJECT, (size_t)JSON_STRING, (void *)child->key, (void *)child->value.string,
+        (void *)&child->value, (void *)child, (void *)&root->value, (void *)root);
+    assert(strcmp(debug_str, expected) == 0);
+
+    // Pretty output matches prettifying the flat dump
+    DebugWriter pretty = debug_writer_buffer(arena, ptrset_init(arena), true);
+    assert(strcmp(pretty.file, __FILE__) == 0 && strcmp(pretty.func, __func__) == 0);
+    json_write_debug(&pretty, "root", root);
+    assert(strcmp(debug_writer_cstr(&pretty), debug_to_pretty_str(arena, debug_str)) == 0);
+
+    // A FILE* writer produces the same bytes
+    FILE *stream = tmpfile();
+    assert(stream);
+    DebugWriter to_file = debug_writer_file(arena, stream, ptrset_init(arena), false);
+    json_write_debug(&to_file, "root", root);
+    long size = ftell(stream);
+    assert(size == (long)strlen(debug_str));
+    rewind(stream);
+    char *read_back = arena_alloc(arena, (size_t)size + 1);
+    assert(fread(read_back, 1, (size_t)size, stream) == (size_t)size);
+    read_back[size] = '\0';
+    fclose(stream);
+    assert(strcmp(read_back, debug_str) == 0);
+
+    // 20k elements would be 20k nested calls if siblings recursed
+    Arena big = arena_init(64 * MEM_MiB);
+    JsonSink sink = json_sink_buffer(&big, 0);
+    JsonWriter writer = json_writer(&sink, 0);
+    json_writer_begin_array(&writer);
+    for (int i = 0; i < 20000; i++) json_writer_integer(&writer, i);
+    json_writer_end_array(&writer);
+    Json *array = parse_text(&big, json_sink_cstr(&sink));
+    char *dump = JSON_TO_DEBUG_STR(&big, "array", array);
+    size_t next_count = 0;
+    for (const char *p = dump; (p = strstr(p, "struct Json next = {")); p++) next_count++;
+    assert(next_count == 19999);
+    assert(strstr(dump, "integer = 19999} ") != NULL);
+    arena_free(&big);
+
+    debug_color_mode = saved;
+}
 
 //static void test_debug_str_to_json(Arena *arena) {
 //    const char *debug_str = "struct SomeStruct struct_name = {name = \"value\", next = NULL, value = 123}";
@@ -152,8 +1589,45 @@ int main(void) {
     test_nested_json_object(&arena);
     arena_reset(&arena);
     test_arena_reset_reuse(&arena);
-    //arena_reset(&arena);
-    //test_json_to_debug_str(&arena);
+    arena_reset(&arena);
+    test_structural_engine(&arena);
+    arena_reset(&arena);
+    test_string_decoding(&arena);
+    arena_reset(&arena);
+    test_stream_tokens(&arena);
+    arena_reset(&arena);
+    test_number_to_str();
+    test_serializer(&arena);
+    arena_reset(&arena);
+    test_number_parsing(&arena);
+    arena_reset(&arena);
+    test_object_index(&arena);
+    arena_reset(&arena);
+    test_json_path(&arena);
+    arena_reset(&arena);
+    test_json_tape(&arena);
+    arena_reset(&arena);
+    test_lazy_parse(&arena);
+    arena_reset(&arena);
+    test_string_modes(&arena);
+    arena_reset(&arena);
+    test_view_parse(&arena);
+    arena_reset(&arena);
+    test_json_lines(&arena);
+    arena_reset(&arena);
+    test_json_binary(&arena);
+    arena_reset(&arena);
+    test_parse_depth(&arena);
+    arena_reset(&arena);
+    test_canonical(&arena);
+    arena_reset(&arena);
+    test_clone_compact(&arena);
+    arena_reset(&arena);
+    test_mutation(&arena);
+    arena_reset(&arena);
+    test_json_writer(&arena);
+    arena_reset(&arena);
+    test_json_to_debug_str(&arena);
     //arena_reset(&arena);
     //test_debug_str_to_json(&arena);
 
@@ -330,6 +330,48 @@ static void simplest_execute_test_template_parse(Arena *arena, TemplateConfig *c
     }
 }
 
+static void view_test_template_parse(Arena *arena, TemplateConfig *config) {
+    // Only the first 21 bytes belong to the template, the rest must never be read
+    const char buffer[] = "Hello {% name %} and {% name2 %}";
+    View view = view_create(buffer, 21, sizeof(char));
+
+    TemplateResult view_result = template_parse_view(arena, view, config);
+    assert(IS_RESULT_SOME(view_result));
+
+    const char *template_str = "Hello {% name %} and ";
+    TemplateResult str_result = template_parse(arena, &template_str, config);
+    assert(IS_RESULT_SOME(str_result));
+
+    const char *view_json = TEMPLATE_NODE_TO_JSON_STR(arena, view_result.Result.some);
+    const char *str_json = TEMPLATE_NODE_TO_JSON_STR(arena, str_result.Result.some);
+    assert(strcmp(view_json, str_json) == 0);
+
+    // A NUL inside the view would silently cut the template short
+    logger_level(LOG_LEVEL_EXCEPTION);
+    const char with_nul[] = "Hello\0{% name %}";
+    TemplateResult nul_result = template_parse_view(arena, view_create(with_nul, sizeof(with_nul) - 1, sizeof(char)), config);
+    assert(IS_RESULT_ERROR(nul_result));
+    assert(RESULT_ERROR_CODE(nul_result) == VIEW_ERROR_INVALID_INPUT);
+    logger_level(LOG_LEVEL_INFO);
+}
+
+static void json_dump_test_template_parse(Arena *arena, TemplateConfig *config) {
+    // Text with quotes and newlines must come out as valid JSON
+    const char *template_str = "say \"hi\"\n\\ {% name %}";
+    TemplateResult result = template_parse(arena, &template_str, config);
+    assert(IS_RESULT_SOME(result));
+
+    const char *json_str = TEMPLATE_NODE_TO_JSON_STR(arena, result.Result.some);
+    Json *json = json_parse(arena, &json_str);
+    assert(json && json->type == JSON_ARRAY);
+    Json *content = json_get_object_item(json_get_object_item(json_children(json), "content"), "content");
+    assert(content && strcmp(content->value.string, "say \"hi\"\n\\ ") == 0);
+
+    // The pretty dump is written directly, with the same layout as re-serializing the tree
+    char *pretty = TEMPLATE_NODE_PRETTY_JSON(*result.Result.some, arena);
+    assert(strcmp(pretty, JSON_TO_PRETTY_STR(arena, json)) == 0);
+}
+
 int main(void) {
     printf("%sRunning %s%s%s\n", OPTIONAL_COLOR(COLOR_GREEN), OPTIONAL_COLOR(COLOR_CYAN), __FILE__,  OPTIONAL_COLOR(COLOR_RESET));
     debug_color_mode = COLOR_MODE_DISABLE;
@@ -370,6 +412,14 @@ int main(void) {
     printf("%sTest 6: simplest_execute_test_template_parse passed%s\n", OPTIONAL_COLOR(COLOR_GREEN), OPTIONAL_COLOR(COLOR_RESET));
     arena_reset(&arena);
 
+    view_test_template_parse(&arena, &config);
+    printf("%sTest 7: view_test_template_parse passed%s\n", OPTIONAL_COLOR(COLOR_GREEN), OPTIONAL_COLOR(COLOR_RESET));
+    arena_reset(&arena);
+
+    json_dump_test_template_parse(&arena, &config);
+    printf("%sTest 8: json_dump_test_template_parse passed%s\n", OPTIONAL_COLOR(COLOR_GREEN), OPTIONAL_COLOR(COLOR_RESET));
+    arena_reset(&arena);
+
     logger_free();
     arena_free(&config_arena);
     arena_free(&arena);
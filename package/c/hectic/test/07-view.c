@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "hectic.h"
+
+#define V(str) string_to_view(str)
+
+static size_t naive_find(const char *s, size_t len, const char *needle, size_t needle_len) {
+    for (size_t i = 0; i + needle_len <= len; i++) {
+        if (memcmp(s + i, needle, needle_len) == 0) return i;
+    }
+    return VIEW_NPOS;
+}
+
+static size_t naive_find_any(const char *s, size_t len, const char *set) {
+    for (size_t i = 0; i < len; i++) {
+        if (strchr(set, s[i])) return i;
+    }
+    return VIEW_NPOS;
+}
+
+void test_view_find(void) {
+    assert(view_find_byte(V("hello"), 'l') == 2);
+    assert(view_find_byte(V("hello"), 'z') == VIEW_NPOS);
+    assert(view_find_byte(V(""), 'a') == VIEW_NPOS);
+    assert(view_rfind_byte(V("a/b/c"), '/') == 3);
+    assert(view_rfind_byte(V("abc"), '/') == VIEW_NPOS);
+
+    assert(view_find(V("hello world"), V("world")) == 6);
+    assert(view_find(V("hello world"), V("")) == 0);
+    assert(view_find(V("hello"), V("hello world")) == VIEW_NPOS);
+    assert(view_find(V("aaab"), V("ab")) == 2);
+    assert(view_find_any(V("key = value"), V(" =")) == 3);
+    assert(view_find_any(V("abc"), V("")) == VIEW_NPOS);
+
+    // The length bounds the search, not a NUL
+    const char bytes[] = {'a', 'b', '\0', 'c', 'd'};
+    assert(view_find_byte(view_create(bytes, 5, sizeof(char)), 'd') == 4);
+    assert(view_find(view_create(bytes, 4, sizeof(char)), V("cd")) == VIEW_NPOS);
+
+    // Every level agrees with a byte-by-byte reference on inputs long enough for the vector loops
+    enum { LEN = 1000 };
+    char text[LEN];
+    unsigned seed = 7;
+    for (int i = 0; i < LEN; i++) {
+        seed = seed * 1103515245 + 12345;
+        text[i] = "abcd\n"[(seed >> 16) % 5];
+    }
+    const char *needles[] = {"ab", "abc", "dcba", "a\nb", "ddddddd", "cdabcdabcdabcdabcdabcdabcdabcdabcdab"};
+    const char *sets[] = {"\n", "xd", "xyz", "b\nq", "0123456789d", "xxxxxxxxxxxxc"};
+    for (int level = SIMD_LEVEL_SCALAR; level <= (int)simd_level_detect(); level++) {
+        simd_set_level((SimdLevel)level);
+        for (size_t from = 0; from < 40; from++) {
+            View view = view_create(text + from, LEN - from, sizeof(char));
+            for (size_t n = 0; n < sizeof(needles) / sizeof(*needles); n++) {
+                assert(view_find(view, V(needles[n])) == naive_find(text + from, LEN - from, needles[n], strlen(needles[n])));
+            }
+            for (size_t n = 0; n < sizeof(sets) / sizeof(*sets); n++) {
+                assert(view_find_any(view, V(sets[n])) == naive_find_any(text + from, LEN - from, sets[n]));
+            }
+        }
+    }
+    simd_set_level(simd_level_detect());
+}
+
+void test_view_trim_compare(void) {
+    assert(view_equal(view_trim(V("  \t value \r\n")), V("value")));
+    assert(view_equal(view_trim_left(V("  value ")), V("value ")));
+    assert(view_equal(view_trim_right(V("  value ")), V("  value")));
+    assert(view_trim(V(" \n\t ")).len == 0);
+
+    View trimmed = view_trim_left(V("  tail"));
+    assert(trimmed.terminated);
+    assert(!view_trim_right(V("head  ")).terminated);
+
+    assert(view_equal(view_slice(V("hello world"), 6, 11), V("world")));
+    assert(view_slice(V("abc"), 2, 100).len == 1);
+    assert(view_slice(V("abc"), 5, 1).len == 0);
+
+    assert(view_compare(V("abc"), V("abd")) < 0);
+    assert(view_compare(V("ab"), V("abc")) < 0);
+    assert(view_compare(V("abc"), V("ab")) > 0);
+    assert(view_compare(V("abc"), V("abc")) == 0);
+    assert(view_starts_with(V("include foo"), V("include ")));
+    assert(!view_starts_with(V("inc"), V("include ")));
+    assert(view_ends_with(V("data.json"), V(".json")));
+    assert(!view_ends_with(V("json"), V(".json")));
+}
+
+void test_view_parse_int(void) {
+    int64_t i = 0;
+    uint64_t u = 0;
+    assert(view_parse_int64(V("42"), &i) && i == 42);
+    assert(view_parse_int64(V("-17"), &i) && i == -17);
+    assert(view_parse_int64(V("+5"), &i) && i == 5);
+    assert(view_parse_int64(V("9223372036854775807"), &i) && i == INT64_MAX);
+    assert(view_parse_int64(V("-9223372036854775808"), &i) && i == INT64_MIN);
+    assert(view_parse_uint64(V("18446744073709551615"), &u) && u == UINT64_MAX);
+
+    i = 1;
+    assert(!view_parse_int64(V("9223372036854775808"), &i));
+    assert(!view_parse_int64(V(""), &i));
+    assert(!view_parse_int64(V("-"), &i));
+    assert(!view_parse_int64(V("12a"), &i));
+    assert(!view_parse_int64(V(" 12"), &i));
+    assert(i == 1);
+    assert(!view_parse_uint64(V("-1"), &u));
+    assert(!view_parse_uint64(V("18446744073709551616"), &u));
+
+    // Only the bytes of the view count
+    assert(view_parse_int64(view_slice(V("123456"), 1, 3), &i) && i == 23);
+}
+
+void test_view_split(void) {
+    const char *fields[] = {"a", "", "b", ""};
+    ViewSplit it = view_split(V("a,,b,"), ',');
+    size_t count = 0;
+    while (view_split_next(&it)) {
+        assert(count < 4);
+        assert(view_equal(view_split_item(&it), V(fields[count])));
+        count++;
+    }
+    assert(count == 4);
+
+    it = view_split(V(""), ',');
+    assert(view_split_next(&it) && view_split_item(&it).len == 0);
+    assert(!view_split_next(&it));
+
+    const char *lines[] = {"first", "", "third"};
+    it = view_lines(V("first\r\n\nthird\n"));
+    count = 0;
+    while (view_split_next(&it)) {
+        assert(view_equal(view_split_item(&it), V(lines[count])));
+        count++;
+    }
+    assert(count == 3);
+    it = view_lines(V(""));
+    assert(!view_split_next(&it));
+    it = view_lines(V("no newline"));
+    assert(view_split_next(&it) && view_equal(view_split_item(&it), V("no newline")));
+    assert(!view_split_next(&it));
+
+    const char *tokens[] = {"SELECT", "*", "FROM", "t"};
+    it = view_tokens(V("  SELECT *\n\tFROM   t  "), V(" \t\n"));
+    count = 0;
+    while (view_split_next(&it)) {
+        assert(view_equal(view_split_item(&it), V(tokens[count])));
+        count++;
+    }
+    assert(count == 4);
+
+    // Items point into the input
+    const char *text = "x=1";
+    it = view_split(V(text), '=');
+    assert(view_split_next(&it) && view_split_item(&it).data == text);
+    assert(view_split_next(&it) && view_split_item(&it).data == text + 2);
+}
+
+void test_view_wide_items(void) {
+    int32_t numbers[] = {1, ' ', 3, 4};
+    int32_t same[] = {1, ' ', 3, 4};
+    View wide = view_create(numbers, 4, sizeof(int32_t));
+
+    // Comparisons cover whole items
+    assert(view_equal(wide, view_create(same, 4, sizeof(int32_t))));
+    assert(!view_equal(wide, view_create(same, 3, sizeof(int32_t))));
+    assert(!view_equal(wide, view_create(same, sizeof(same), sizeof(char))));
+    assert(view_compare(view_slice(wide, 0, 2), wide) < 0);
+    assert(view_starts_with(wide, view_create(same, 2, sizeof(int32_t))));
+    assert(view_ends_with(wide, view_create(same + 2, 2, sizeof(int32_t))));
+    assert(!view_ends_with(wide, view_create(same, 2, sizeof(int32_t))));
+
+    // Text operations refuse them instead of reading their bytes as chars
+    logger_level(LOG_LEVEL_EXCEPTION);
+    assert(view_find_byte(wide, 3) == VIEW_NPOS);
+    assert(view_rfind_byte(wide, 1) == VIEW_NPOS);
+    assert(view_find(wide, V("a")) == VIEW_NPOS);
+    assert(view_find_any(V("abc"), wide) == VIEW_NPOS);
+    assert(view_trim(wide).len == 4);
+    int64_t i = 7;
+    assert(!view_parse_int64(wide, &i) && i == 7);
+    ViewSplit it = view_split(wide, ',');
+    assert(!view_split_next(&it));
+    it = view_tokens(V("a b"), wide);
+    assert(!view_split_next(&it));
+}
+
+int main() {
+    printf("%sRunning %s%s%s\n", OPTIONAL_COLOR(COLOR_GREEN), OPTIONAL_COLOR(COLOR_CYAN), __FILE__,  OPTIONAL_COLOR(COLOR_RESET));
+    logger_init();
+
+    test_view_find();
+    test_view_trim_compare();
+    test_view_parse_int();
+    test_view_split();
+    test_view_wide_items();
+
+    logger_free();
+    printf("%sall tests passed.%s%s%s\n", OPTIONAL_COLOR(COLOR_GREEN), OPTIONAL_COLOR(COLOR_CYAN), __FILE__, OPTIONAL_COLOR(COLOR_RESET));
+    return 0;
+}